@@ -0,0 +1,102 @@
+//
+//  BenchmarkSupport.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__BenchmarkSupport__
+#define __USBHID__BenchmarkSupport__
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "USBHIDLatencyHistogram.h"
+
+
+namespace usbhid_test {
+
+
+//
+// Parses "--name value" pairs.  Every option must be declared with a default before it's read, so that
+// --help can list them and a misspelled option is rejected.
+//
+class BenchmarkOptions {
+    
+public:
+    BenchmarkOptions(const char *description, int argc, const char * const *argv) :
+        description(description),
+        argc(argc),
+        argv(argv)
+    { }
+    
+    void declare(const std::string &name, const std::string &defaultValue, const std::string &help) {
+        Option option = { defaultValue, help };
+        options[name] = option;
+    }
+    
+    // Returns false (after printing usage or an error) if the program should exit
+    bool parse() {
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+            if (arg == "--help") {
+                printUsage();
+                return false;
+            }
+            if (arg.compare(0, 2, "--") != 0 || !options.count(arg.substr(2)) || i + 1 >= argc) {
+                std::fprintf(stderr, "Invalid argument: %s\n", arg.c_str());
+                printUsage();
+                return false;
+            }
+            options[arg.substr(2)].value = argv[++i];
+        }
+        return true;
+    }
+    
+    const std::string & getString(const std::string &name) const { return options.at(name).value; }
+    double getDouble(const std::string &name) const { return std::strtod(getString(name).c_str(), nullptr); }
+    long getLong(const std::string &name) const { return std::strtol(getString(name).c_str(), nullptr, 0); }
+    
+private:
+    struct Option {
+        std::string value;
+        std::string help;
+    };
+    
+    void printUsage() const {
+        std::fprintf(stderr, "%s\n\nOptions:\n", description);
+        for (const auto &option : options) {
+            std::fprintf(stderr,
+                         "  --%-20s %s (default: %s)\n",
+                         option.first.c_str(),
+                         option.second.help.c_str(),
+                         option.second.value.c_str());
+        }
+    }
+    
+    const char * const description;
+    const int argc;
+    const char * const * const argv;
+    std::map<std::string, Option> options;
+    
+};
+
+
+inline void printLatency(const char *label, const mworks::USBHIDLatencyHistogram &histogram) {
+    std::printf("%s: median %.1f us, 99th percentile %.1f us, 99.9th percentile %.1f us, max %.1f us\n",
+                label,
+                double(histogram.getQuantileNS(0.5)) / 1.0e3,
+                double(histogram.getQuantileNS(0.99)) / 1.0e3,
+                double(histogram.getQuantileNS(0.999)) / 1.0e3,
+                double(histogram.getMaxNS()) / 1.0e3);
+}
+
+
+}  // namespace usbhid_test
+
+
+#endif // !defined(__USBHID__BenchmarkSupport__)
@@ -0,0 +1,92 @@
+//
+//  MWorksCoreShim.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "MWorksCoreShim.h"
+
+#include <cstdarg>
+#include <cstdio>
+
+#include <boost/chrono/system_clocks.hpp>
+
+
+namespace mworks {
+
+
+namespace {
+    
+    std::atomic<std::size_t> messageCounts[3];
+    std::atomic<bool> messagesPrinted(true);
+    
+    MWTime steadyTimeNS() {
+        return boost::chrono::duration_cast<boost::chrono::nanoseconds>(
+            boost::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    
+    void printMessage(MessageType type, const char *prefix, const char *format, va_list args) {
+        messageCounts[int(type)].fetch_add(1);
+        if (messagesPrinted) {
+            std::fputs(prefix, stderr);
+            std::vfprintf(stderr, format, args);
+            std::fputc('\n', stderr);
+        }
+    }
+    
+}
+
+
+boost::shared_ptr<Clock> Clock::instance() {
+    static const boost::shared_ptr<Clock> clock(new Clock());
+    return clock;
+}
+
+
+Clock::Clock() :
+    baseTimeNS(steadyTimeNS())
+{ }
+
+
+MWTime Clock::getSystemTimeNS() const {
+    return steadyTimeNS();
+}
+
+
+void mprintf(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    printMessage(MessageType::Info, "", format, args);
+    va_end(args);
+}
+
+
+void mwarning(int domain, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    printMessage(MessageType::Warning, "WARNING: ", format, args);
+    va_end(args);
+}
+
+
+void merror(int domain, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    printMessage(MessageType::Error, "ERROR: ", format, args);
+    va_end(args);
+}
+
+
+std::size_t getMessageCount(MessageType type) {
+    return messageCounts[int(type)].load();
+}
+
+
+void setMessagesPrinted(bool printed) {
+    messagesPrinted = printed;
+}
+
+
+}  // namespace mworks
@@ -0,0 +1,99 @@
+//
+//  MWorksCoreShim.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  Stands in for USBHID-Prefix.pch when the plugin's core-independent sources are built outside Xcode.  It
+//  declares only the handful of MWorksCore names those sources use: the namespace macros, MWTime, Clock,
+//  SimpleException, and the message functions (which write to stderr).
+//
+
+#ifndef __USBHID__MWorksCoreShim__
+#define __USBHID__MWorksCoreShim__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <boost/bind/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/move/move.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/scope_exit.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/future.hpp>
+#include <boost/thread/thread.hpp>
+
+#if !defined(__APPLE__)
+enum {
+    kHIDPage_Undefined = 0x00,
+    kHIDUsage_Undefined = 0x00
+};
+#endif
+
+#define BEGIN_NAMESPACE_MW namespace mworks {
+#define END_NAMESPACE_MW }
+#define MW_OVERRIDE override
+#define M_IODEVICE_MESSAGE_DOMAIN 0
+
+
+namespace mworks {
+
+
+typedef long long MWTime;
+
+
+class SimpleException : public std::runtime_error {
+public:
+    SimpleException(int domain, const std::string &message) : std::runtime_error(message) { }
+    SimpleException(int domain, const std::string &message, const std::string &subject) :
+        std::runtime_error(message + ": " + subject)
+    { }
+};
+
+
+// Monotonic, with an arbitrary base time, like MWorks' own clock
+class Clock : boost::noncopyable {
+public:
+    static boost::shared_ptr<Clock> instance();
+    MWTime getSystemBaseTimeNS() const { return baseTimeNS; }
+    MWTime getSystemTimeNS() const;
+    
+private:
+    Clock();
+    const MWTime baseTimeNS;
+};
+
+
+enum class MessageType {
+    Info,
+    Warning,
+    Error
+};
+
+
+void mprintf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+void mwarning(int domain, const char *format, ...) __attribute__((format(printf, 2, 3)));
+void merror(int domain, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+// Number of messages of the given type issued so far, so that tests can check for warnings and errors
+std::size_t getMessageCount(MessageType type);
+
+// If false, messages are counted but not printed
+void setMessagesPrinted(bool printed);
+
+
+}  // namespace mworks
+
+
+using namespace boost::placeholders;
+
+
+#endif // !defined(__USBHID__MWorksCoreShim__)
@@ -0,0 +1,79 @@
+//
+//  TestSupport.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "TestSupport.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+
+namespace usbhid_test {
+
+
+namespace {
+    int failureCount = 0;
+    std::atomic<bool> countingAllocations(false);
+    std::atomic<std::uint64_t> allocationCount(0);
+}
+
+
+void fail(const char *file, int line, const std::string &message) {
+    std::fprintf(stderr, "%s:%d: %s\n", file, line, message.c_str());
+    failureCount++;
+}
+
+
+int exitStatus() {
+    if (failureCount) {
+        std::fprintf(stderr, "%d check(s) failed\n", failureCount);
+        return 1;
+    }
+    return 0;
+}
+
+
+void startCountingAllocations() {
+    allocationCount = 0;
+    countingAllocations = true;
+}
+
+
+std::uint64_t stopCountingAllocations() {
+    countingAllocations = false;
+    return allocationCount.load();
+}
+
+
+}  // namespace usbhid_test
+
+
+void * operator new(std::size_t size) {
+    if (usbhid_test::countingAllocations.load(std::memory_order_relaxed)) {
+        usbhid_test::allocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void *memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+
+void * operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+
+void operator delete[](void *memory) noexcept {
+    std::free(memory);
+}
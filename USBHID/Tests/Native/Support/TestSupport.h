@@ -0,0 +1,54 @@
+//
+//  TestSupport.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__TestSupport__
+#define __USBHID__TestSupport__
+
+#include <cstdint>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+
+namespace usbhid_test {
+
+
+// Records a failed check.  Each test program returns exitStatus() from main, so ctest sees the failure.
+void fail(const char *file, int line, const std::string &message);
+int exitStatus();
+
+
+template <typename A, typename B>
+void checkEqual(const A &actual, const B &expected, const char *expression, const char *file, int line) {
+    if (!(actual == expected)) {
+        std::ostringstream message;
+        message << expression << " is " << +actual << ", expected " << +expected;
+        fail(file, line, message.str());
+    }
+}
+
+
+//
+// Counts calls to the global operator new (from any thread) while counting is enabled.  Linking
+// TestSupport.cpp into a program replaces its global operator new and delete.
+//
+void startCountingAllocations();
+std::uint64_t stopCountingAllocations();  // Returns the number of allocations since start
+
+
+}  // namespace usbhid_test
+
+
+#define USBHID_CHECK(condition) \
+    do { if (!(condition)) usbhid_test::fail(__FILE__, __LINE__, "check failed: " #condition); } while (false)
+
+#define USBHID_CHECK_EQUAL(actual, expected) \
+    usbhid_test::checkEqual((actual), (expected), #actual, __FILE__, __LINE__)
+
+
+#endif // !defined(__USBHID__TestSupport__)
@@ -0,0 +1,220 @@
+//
+//  benchmark_channel_lookup.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  Measures the per-value cost of finding the channel for an input value, in isolation, two ways:
+//
+//    map:   USBHIDDevice's former lookup, operator[] on a std::map from usage pair to
+//           boost::shared_ptr<USBHIDInputChannel>, which inserts an empty entry for each unmapped usage
+//    table: the current lookup, the IOKit backend's cookie-indexed channel index table followed by an index
+//           into USBHIDDevice's channel vector
+//
+//  Each runs over the same stream of values, drawn uniformly from every element of the device, mapped or
+//  not, for the 15 channels of Tests/USBHID/joystick.xml on a Dual Action gamepad and for 106 channels (every
+//  key and modifier) on a boot keyboard.  The channels here are stand-ins that just store the value.
+//
+
+#include <algorithm>
+#include <random>
+
+#include "BenchmarkSupport.h"
+
+using namespace mworks;
+
+
+namespace {
+
+
+struct Channel {
+    Channel() : value(0) { }
+    void postValue(long newValue) { value = newValue; }
+    long value;
+};
+
+
+struct Element {
+    std::uint32_t cookie;
+    long usagePage;
+    long usage;
+};
+
+
+struct Configuration {
+    const char *name;
+    std::vector<Element> elements;              // Every input element of the device, in cookie order
+    std::vector<std::pair<long, long>> channelUsages;
+};
+
+
+// Cookies are small integers assigned in element order, starting after the collection elements
+void addElement(Configuration &config, long usagePage, long usage) {
+    const Element element = { std::uint32_t(config.elements.size() + 3), usagePage, usage };
+    config.elements.push_back(element);
+}
+
+
+Configuration makeJoystickConfiguration() {
+    Configuration config;
+    config.name = "joystick (15 channels, 25 elements)";
+    
+    for (long usage : { 0x30, 0x31, 0x32, 0x35, 0x39 }) {
+        addElement(config, 0x01, usage);
+    }
+    for (long button = 1; button <= 12; button++) {
+        addElement(config, 0x09, button);
+    }
+    for (int index = 0; index < 8; index++) {
+        addElement(config, 0xFF00, 0x01);
+    }
+    
+    // As in Tests/USBHID/joystick.xml
+    config.channelUsages = {
+        { 0x09, 2 }, { 0x09, 3 }, { 0x09, 1 }, { 0x09, 4 }, { 0x09, 7 }, { 0x09, 5 }, { 0x09, 8 }, { 0x09, 6 },
+        { 0x01, 57 }, { 0x01, 48 }, { 0x01, 49 }, { 0x01, 50 }, { 0x01, 53 }, { 0x09, 9 }, { 0x09, 10 }
+    };
+    
+    return config;
+}
+
+
+Configuration makeKeyboardConfiguration() {
+    Configuration config;
+    config.name = "keyboard (106 channels, 110 elements)";
+    
+    // Modifiers, then one element per key code (including the error codes 0x00-0x03, which aren't mapped)
+    for (long usage = 0xE0; usage <= 0xE7; usage++) {
+        addElement(config, 0x07, usage);
+    }
+    for (long usage = 0x00; usage <= 0x65; usage++) {
+        addElement(config, 0x07, usage);
+    }
+    
+    for (long usage = 0x04; usage <= 0x65; usage++) {
+        config.channelUsages.push_back(std::make_pair(0x07L, usage));
+    }
+    for (long usage = 0xE0; usage <= 0xE7; usage++) {
+        config.channelUsages.push_back(std::make_pair(0x07L, usage));
+    }
+    
+    return config;
+}
+
+
+class MapLookup {
+    
+public:
+    explicit MapLookup(const Configuration &config) {
+        for (const auto &usagePair : config.channelUsages) {
+            inputChannels[usagePair].reset(new Channel());
+        }
+    }
+    
+    void handleValue(const Element &element, long value) {
+        const boost::shared_ptr<Channel> &channel = inputChannels[std::make_pair(element.usagePage, element.usage)];
+        if (channel) {
+            channel->postValue(value);
+        }
+    }
+    
+    std::size_t getMapSize() const { return inputChannels.size(); }
+    
+private:
+    std::map< std::pair<long, long>, boost::shared_ptr<Channel> > inputChannels;
+    
+};
+
+
+const std::size_t noChannel = std::size_t(-1);
+
+
+class TableLookup {
+    
+public:
+    explicit TableLookup(const Configuration &config) {
+        for (std::size_t channelIndex = 0; channelIndex < config.channelUsages.size(); channelIndex++) {
+            channels.push_back(boost::shared_ptr<Channel>(new Channel()));
+            channelsByIndex.push_back(channels.back().get());
+        }
+        
+        for (const auto &element : config.elements) {
+            const auto usagePair = std::make_pair(element.usagePage, element.usage);
+            const auto iter = std::find(config.channelUsages.begin(), config.channelUsages.end(), usagePair);
+            if (iter != config.channelUsages.end()) {
+                if (element.cookie >= channelIndexByCookie.size()) {
+                    channelIndexByCookie.resize(element.cookie + 1, noChannel);
+                }
+                channelIndexByCookie[element.cookie] = iter - config.channelUsages.begin();
+            }
+        }
+    }
+    
+    void handleValue(const Element &element, long value) {
+        const std::size_t channelIndex = ((element.cookie < channelIndexByCookie.size()) ?
+                                          channelIndexByCookie[element.cookie] :
+                                          noChannel);
+        if (channelIndex < channelsByIndex.size()) {
+            channelsByIndex[channelIndex]->postValue(value);
+        }
+    }
+    
+private:
+    std::vector<boost::shared_ptr<Channel>> channels;
+    std::vector<std::size_t> channelIndexByCookie;
+    std::vector<Channel *> channelsByIndex;
+    
+};
+
+
+template <typename Lookup>
+double timeLookup(Lookup &lookup, const std::vector<const Element *> &stream, long valueCount) {
+    const boost::shared_ptr<Clock> clock = Clock::instance();
+    
+    const MWTime startTimeNS = clock->getSystemTimeNS();
+    for (long valueIndex = 0; valueIndex < valueCount; valueIndex++) {
+        lookup.handleValue(*(stream[valueIndex % stream.size()]), valueIndex);
+    }
+    const MWTime elapsedNS = clock->getSystemTimeNS() - startTimeNS;
+    
+    return double(elapsedNS) / double(valueCount);
+}
+
+
+}  // namespace
+
+
+int main(int argc, char *argv[]) {
+    usbhid_test::BenchmarkOptions options("Compares map and table lookup of input channels", argc, argv);
+    options.declare("values", "20000000", "number of input values to look up in each configuration");
+    if (!options.parse()) {
+        return 2;
+    }
+    const long valueCount = std::max(options.getLong("values"), 1L);
+    
+    for (const Configuration &config : { makeJoystickConfiguration(), makeKeyboardConfiguration() }) {
+        std::minstd_rand random;
+        std::uniform_int_distribution<std::size_t> elementIndex(0, config.elements.size() - 1);
+        std::vector<const Element *> stream(4096);
+        for (auto &element : stream) {
+            element = &(config.elements[elementIndex(random)]);
+        }
+        
+        MapLookup mapLookup(config);
+        TableLookup tableLookup(config);
+        const std::size_t initialMapSize = mapLookup.getMapSize();
+        
+        const double mapNS = timeLookup(mapLookup, stream, valueCount);
+        const double tableNS = timeLookup(tableLookup, stream, valueCount);
+        
+        std::printf("%s:\n", config.name);
+        std::printf("  map:   %.2f ns/value (map grew from %lu to %lu entries)\n",
+                    mapNS,
+                    static_cast<unsigned long>(initialMapSize),
+                    static_cast<unsigned long>(mapLookup.getMapSize()));
+        std::printf("  table: %.2f ns/value (%.1fx)\n", tableNS, ((tableNS > 0.0) ? mapNS / tableNS : 0.0));
+    }
+    
+    return 0;
+}
@@ -0,0 +1,149 @@
+//
+//  benchmark_decoder.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  Compares a ReportDecoder running the generic extraction ops with one using a device profile's
+//  specialized extractor, on the profile's own report descriptor.  Both decoders first decode the same
+//  random reports (including some too short for the profile), and the run fails if their output differs.
+//  Each is then timed over a stream of reports in which one byte changes per report, as with a live device.
+//
+
+#include <random>
+
+#include "BenchmarkSupport.h"
+#include "USBHIDReportDecoder.h"
+
+using namespace mworks;
+using namespace mworks::usbhid;
+
+
+namespace {
+
+
+typedef std::vector<std::pair<std::uint32_t, std::int32_t>> DecodedValues;
+
+
+std::vector<std::uint32_t> getTargetUsages() {
+    return {
+        ReportDescriptor::makeUsage(0x01, 0x30),  // X
+        ReportDescriptor::makeUsage(0x01, 0x31),  // Y
+        ReportDescriptor::makeUsage(0x01, 0x32),  // Z
+        ReportDescriptor::makeUsage(0x01, 0x35),  // Rz
+        ReportDescriptor::makeUsage(0x01, 0x39),  // Hat switch
+        ReportDescriptor::makeUsage(0x09, 1),
+        ReportDescriptor::makeUsage(0x09, 2),
+        ReportDescriptor::makeUsage(0x09, 10)
+    };
+}
+
+
+// Returns the number of reports whose decoded values differ
+std::size_t compareDecoders(ReportDecoder &generic, ReportDecoder &profiled, std::size_t reportSize, long reportCount) {
+    std::minstd_rand random;
+    std::vector<std::uint8_t> report(reportSize);
+    DecodedValues genericValues, profiledValues;
+    std::size_t mismatchCount = 0;
+    
+    for (long reportIndex = 0; reportIndex < reportCount; reportIndex++) {
+        for (auto &byte : report) {
+            byte = std::uint8_t(random());
+        }
+        const std::size_t length = ((reportIndex % 50 == 0) ? reportSize - 2 : reportSize);
+        
+        genericValues.clear();
+        generic.decode(report.data(), length, [&genericValues](const ExtractionOp &op, std::int32_t value) {
+            genericValues.push_back(DecodedValues::value_type(op.usage + op.bitOffset, value));
+        });
+        profiledValues.clear();
+        profiled.decode(report.data(), length, [&profiledValues](const ExtractionOp &op, std::int32_t value) {
+            profiledValues.push_back(DecodedValues::value_type(op.usage + op.bitOffset, value));
+        });
+        
+        if (genericValues != profiledValues) {
+            mismatchCount++;
+        }
+    }
+    
+    return mismatchCount;
+}
+
+
+double timeDecoder(ReportDecoder &decoder, std::size_t reportSize, long reportCount, long &checksum) {
+    const boost::shared_ptr<Clock> clock = Clock::instance();
+    std::vector<std::uint8_t> report(reportSize, 0);
+    long sum = 0;
+    
+    const MWTime startTimeNS = clock->getSystemTimeNS();
+    for (long reportIndex = 0; reportIndex < reportCount; reportIndex++) {
+        report[reportIndex % reportSize] ^= std::uint8_t((std::uint32_t(reportIndex) * 2654435761u) >> 24);
+        decoder.decode(report.data(), reportSize, [&sum](const ExtractionOp &op, std::int32_t value) {
+            sum += value;
+        });
+    }
+    const MWTime elapsedNS = clock->getSystemTimeNS() - startTimeNS;
+    
+    // Keeps the compiler from discarding the decoded values
+    checksum = sum;
+    return double(elapsedNS) / double(reportCount);
+}
+
+
+}  // namespace
+
+
+int main(int argc, char *argv[]) {
+    usbhid_test::BenchmarkOptions options("Compares the generic and profile-specialized report decoders", argc, argv);
+    options.declare("profile", "logitech_dual_action", "name of the device profile to decode");
+    options.declare("reports", "5000000", "number of reports to time each decoder on");
+    options.declare("verify-reports", "200000", "number of random reports on which to compare the decoders");
+    if (!options.parse()) {
+        return 2;
+    }
+    
+    const DeviceProfile *profile = findDeviceProfile(options.getString("profile"));
+    if (!profile) {
+        std::fprintf(stderr, "Unknown profile: %s\n", options.getString("profile").c_str());
+        return 2;
+    }
+    
+    const ReportDescriptor descriptor(profile->reportDescriptor, profile->reportDescriptorSize);
+    const std::size_t reportSize = descriptor.getMaxReportSize(ReportType::Input);
+    const long reportCount = options.getLong("reports");
+    int status = 0;
+    
+    // First only the usages a typical experiment maps to channels, then every usage the device reports
+    for (bool includeOtherUsages : { false, true }) {
+        ReportDecoder generic(descriptor, getTargetUsages(), includeOtherUsages);
+        ReportDecoder profiled(descriptor, getTargetUsages(), includeOtherUsages);
+        if (!profiled.useProfile(*profile)) {
+            std::fprintf(stderr, "Profile \"%s\" doesn't match its own descriptor\n", profile->name);
+            return 1;
+        }
+        
+        std::printf("%s (%lu ops):\n",
+                    (includeOtherUsages ? "All usages" : "Mapped usages"),
+                    static_cast<unsigned long>(generic.getExtractor().getOps().size()));
+        
+        const std::size_t mismatchCount = compareDecoders(generic, profiled, reportSize, options.getLong("verify-reports"));
+        if (mismatchCount) {
+            std::fprintf(stderr, "  Decoders disagree on %lu reports\n", static_cast<unsigned long>(mismatchCount));
+            status = 1;
+        }
+        
+        long genericChecksum, profiledChecksum;
+        const double genericNS = timeDecoder(generic, reportSize, reportCount, genericChecksum);
+        const double profiledNS = timeDecoder(profiled, reportSize, reportCount, profiledChecksum);
+        if (genericChecksum != profiledChecksum) {
+            std::fprintf(stderr, "  Decoders produced different checksums\n");
+            status = 1;
+        }
+        
+        std::printf("  generic:  %.1f ns/report\n", genericNS);
+        std::printf("  profiled: %.1f ns/report (%.2fx)\n", profiledNS, ((profiledNS > 0.0) ? genericNS / profiledNS : 0.0));
+    }
+    
+    return status;
+}
@@ -0,0 +1,280 @@
+//
+//  benchmark_input.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  Drives the input path headlessly.  The synthetic or replay backend (the same ones behind
+//  usbhid_synthetic and usbhid_replay) delivers values on its I/O thread to USBHIDInputDispatcher, the
+//  input path that USBHIDDevice uses, which filters, time stamps, and batches them and posts them directly,
+//  or through its dispatch queue and thread.  Posting stores the value and measures the delay since the
+//  value's time stamp, since there are no MWorks variables here.
+//
+//  Reports throughput, the delay from time stamp to posting, allocations per value once I/O is running,
+//  and dropped and late values.  With --max-allocations 0, it fails if the steady-state input path allocates.
+//
+
+#include "BenchmarkSupport.h"
+#include "TestSupport.h"
+#include "USBHIDInputDispatcher.h"
+#include "USBHIDReplayBackend.h"
+#include "USBHIDSyntheticBackend.h"
+
+using namespace mworks;
+
+
+namespace {
+
+
+class PostingTarget : public USBHIDInputDispatcher::Target {
+    
+public:
+    PostingTarget(USBHIDBackend &backend, std::size_t channelCount, std::uint64_t lateThresholdNS) :
+        backend(backend),
+        clock(Clock::instance()),
+        lateThresholdNS(lateThresholdNS),
+        postedValues(channelCount, 0),
+        postedCount(0),
+        lateCount(0),
+        frameNumber(0)
+    { }
+    
+    void postValue(std::size_t channelIndex, long integerValue, MWTime time) override {
+        postedValues[channelIndex] = integerValue;
+        
+        // MWorks time has microsecond resolution, so this is accurate to within 1us
+        const std::int64_t delayNS = clock->getSystemTimeNS() - (time * 1000 + clock->getSystemBaseTimeNS());
+        postDelay.record(delayNS);
+        if (delayNS > std::int64_t(lateThresholdNS)) {
+            lateCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        postedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    void postMultiUsageValues(std::size_t multiUsageIndex, const std::vector<long> &values, MWTime time) override { }
+    
+    void postFrameNumber(long newFrameNumber, MWTime time) override {
+        frameNumber.store(newFrameNumber, std::memory_order_relaxed);
+    }
+    
+    void postDroppedEventCount(long droppedEventCount) override { }
+    
+    void requestWakeup(std::uint64_t timeNS) override {
+        backend.requestWakeup(timeNS);
+    }
+    
+    std::uint64_t getPostedCount() const { return postedCount.load(); }
+    std::uint64_t getLateCount() const { return lateCount.load(); }
+    long getFrameNumber() const { return frameNumber.load(); }
+    const USBHIDLatencyHistogram & getPostDelay() const { return postDelay; }
+    
+private:
+    USBHIDBackend &backend;
+    const boost::shared_ptr<Clock> clock;
+    const std::uint64_t lateThresholdNS;
+    
+    std::vector<long> postedValues;
+    std::atomic<std::uint64_t> postedCount;
+    std::atomic<std::uint64_t> lateCount;
+    std::atomic<long> frameNumber;
+    USBHIDLatencyHistogram postDelay;
+    
+};
+
+
+// Hands the backend's values to the dispatcher, as USBHIDDevice does
+class ForwardingDelegate : public USBHIDBackend::Delegate {
+    
+public:
+    explicit ForwardingDelegate(USBHIDInputDispatcher &dispatcher) :
+        dispatcher(dispatcher),
+        deliveredCount(0)
+    { }
+    
+    void handleInputValue(const USBHIDBackend::InputValue &value) override {
+        dispatcher.handleInputValue(value);
+        deliveredCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    void handleWakeup(std::uint64_t currentTimeNS) override {
+        dispatcher.handleWakeup(currentTimeNS);
+    }
+    
+    void handleFrameEnd() override {
+        dispatcher.handleFrameEnd();
+    }
+    
+    std::uint64_t getDeliveredCount() const { return deliveredCount.load(); }
+    
+private:
+    USBHIDInputDispatcher &dispatcher;
+    std::atomic<std::uint64_t> deliveredCount;
+    
+};
+
+
+std::unique_ptr<USBHIDBackend> createBackend(const usbhid_test::BenchmarkOptions &options) {
+    const std::string source = options.getString("source");
+    
+    if (source == "replay") {
+        return std::unique_ptr<USBHIDBackend>(new USBHIDReplayBackend("benchmark",
+                                                                      options.getString("capture"),
+                                                                      options.getDouble("speed")));
+    }
+    
+    if (source != "synthetic") {
+        std::fprintf(stderr, "Invalid source: %s\n", source.c_str());
+        return std::unique_ptr<USBHIDBackend>();
+    }
+    
+    USBHIDSyntheticBackend::Options syntheticOptions;
+    syntheticOptions.reportRate = options.getDouble("rate");
+    syntheticOptions.valuesPerReport = options.getLong("values-per-report");
+    syntheticOptions.valueMin = 0;
+    syntheticOptions.valueMax = 1023;
+    syntheticOptions.simulatedProfile = nullptr;
+    syntheticOptions.specializedDecoder = false;
+    
+    const std::string distribution = options.getString("distribution");
+    if (distribution == "random_walk") {
+        syntheticOptions.distribution = USBHIDSyntheticBackend::Distribution::RandomWalk;
+    } else if (distribution == "uniform") {
+        syntheticOptions.distribution = USBHIDSyntheticBackend::Distribution::Uniform;
+    } else if (distribution == "alternating") {
+        syntheticOptions.distribution = USBHIDSyntheticBackend::Distribution::Alternating;
+    } else {
+        std::fprintf(stderr, "Invalid distribution: %s\n", distribution.c_str());
+        return std::unique_ptr<USBHIDBackend>();
+    }
+    
+    return std::unique_ptr<USBHIDBackend>(new USBHIDSyntheticBackend("benchmark", syntheticOptions));
+}
+
+
+}  // namespace
+
+
+int main(int argc, char *argv[]) {
+    usbhid_test::BenchmarkOptions options("Measures throughput, posting delay, and allocations on the input path",
+                                          argc,
+                                          argv);
+    options.declare("source", "synthetic", "synthetic or replay");
+    options.declare("rate", "1000", "synthetic reports per second, or 0 for as fast as possible");
+    options.declare("channels", "16", "number of synthetic channels");
+    options.declare("values-per-report", "0", "synthetic values per report, or 0 for every channel");
+    options.declare("distribution", "random_walk", "random_walk, uniform, or alternating");
+    options.declare("capture", USBHID_TEST_DATA_DIR "/joystick_replay.hidcap", "capture file to replay");
+    options.declare("speed", "0", "replay speed, or 0 for as fast as possible");
+    options.declare("usage-page", "1", "usage page of the replayed device");
+    options.declare("usage", "4", "usage of the replayed device");
+    options.declare("duration", "2", "seconds to run");
+    options.declare("warmup", "0.1", "seconds to run before counting allocations");
+    options.declare("queue-size", "4096", "dispatch queue capacity, or 0 to post on the I/O thread");
+    options.declare("batch", "0", "1 to batch each report's values, as batch_reports does");
+    options.declare("late-us", "1000", "delay from time stamp to posting beyond which a value counts as late");
+    options.declare("max-allocations", "-1", "allocations after warmup beyond which the run fails, or -1 for no limit");
+    if (!options.parse()) {
+        return 2;
+    }
+    
+    const std::size_t channelCount = options.getLong("channels");
+    const long queueSize = options.getLong("queue-size");
+    std::unique_ptr<USBHIDBackend> backend = createBackend(options);
+    if (!backend || channelCount == 0 || queueSize < 0) {
+        return 2;
+    }
+    
+    // Synthetic channels are buttons, so any number of them have distinct usages.  Replay delivers only the
+    // recorded values of those usages.
+    std::vector<USBHIDBackend::UsagePair> channelUsages;
+    std::vector<USBHIDInputDispatcher::Channel> channels;
+    for (std::size_t channelIndex = 0; channelIndex < channelCount; channelIndex++) {
+        channelUsages.push_back(USBHIDBackend::UsagePair(0x09, long(channelIndex + 1)));
+        const USBHIDInputDispatcher::Channel channel = { 0x09, std::uint32_t(channelIndex + 1), 0, false, 0.0 };
+        channels.push_back(channel);
+    }
+    const USBHIDBackend::DeviceMatchingCriteria criteria = { options.getLong("usage-page"), options.getLong("usage"), 0 };
+    if (!(backend->openDevice(criteria)) ||
+        !(backend->prepareInputs(channelUsages, 0, false, false)))
+    {
+        return 1;
+    }
+    
+    USBHIDInputDispatcher::Options dispatcherOptions;
+    dispatcherOptions.dispatchQueueSize = queueSize;
+    dispatcherOptions.mergeWindowUS = 0;
+    dispatcherOptions.batchReports = (options.getLong("batch") != 0);
+    dispatcherOptions.measureLatency = false;
+    dispatcherOptions.inputLogger = nullptr;
+    
+    PostingTarget target(*backend, channelCount, options.getLong("late-us") * 1000);
+    USBHIDInputDispatcher dispatcher("benchmark", target, dispatcherOptions);
+    dispatcher.configure(channels, std::vector<std::size_t>(), nullptr, nullptr);
+    ForwardingDelegate delegate(dispatcher);
+    
+    // As USBHIDDevice does, calibrate the clock only once the initial values have been read
+    if (!(dispatcher.start())) {
+        return 1;
+    }
+    if (!(backend->readInitialValues(delegate))) {
+        dispatcher.stop();
+        return 1;
+    }
+    dispatcher.setCalibratingClock(true);
+    if (!(backend->startIO(delegate))) {
+        dispatcher.stop();
+        return 1;
+    }
+    
+    // The dispatcher warns each time its queue overflows, which at high rates would swamp the output, so
+    // messages are only counted
+    setMessagesPrinted(false);
+    const std::size_t warningCount = getMessageCount(MessageType::Warning);
+    
+    const boost::shared_ptr<Clock> clock = Clock::instance();
+    const double warmupS = options.getDouble("warmup");
+    const double durationS = std::max(options.getDouble("duration"), warmupS);
+    boost::this_thread::sleep_for(boost::chrono::microseconds(std::int64_t(warmupS * 1.0e6)));
+    
+    const MWTime countStartTimeNS = clock->getSystemTimeNS();
+    const std::uint64_t countStartValues = delegate.getDeliveredCount();
+    usbhid_test::startCountingAllocations();
+    boost::this_thread::sleep_for(boost::chrono::microseconds(std::int64_t((durationS - warmupS) * 1.0e6)));
+    const std::uint64_t allocationCount = usbhid_test::stopCountingAllocations();
+    const std::uint64_t countedValues = delegate.getDeliveredCount() - countStartValues;
+    const double countedS = double(clock->getSystemTimeNS() - countStartTimeNS) / 1.0e9;
+    
+    (void)backend->stopIO();
+    dispatcher.stop();
+    setMessagesPrinted(true);
+    
+    std::printf("Delivered %llu values, %.0f values/s (excluding warmup)\n",
+                static_cast<unsigned long long>(delegate.getDeliveredCount()),
+                ((countedS > 0.0) ? double(countedValues) / countedS : 0.0));
+    if (dispatcherOptions.batchReports) {
+        std::printf("Posted %ld frames\n", target.getFrameNumber());
+    }
+    usbhid_test::printLatency("Time stamp to post", target.getPostDelay());
+    std::printf("Allocations: %llu (%.4f per value) after warmup\n",
+                static_cast<unsigned long long>(allocationCount),
+                (countedValues ? double(allocationCount) / double(countedValues) : 0.0));
+    std::printf("Dropped: %llu, late (over %ld us): %llu\n",
+                static_cast<unsigned long long>(dispatcher.getDroppedEventCount()),
+                options.getLong("late-us"),
+                static_cast<unsigned long long>(target.getLateCount()));
+    std::printf("Warnings: %lu\n", static_cast<unsigned long>(getMessageCount(MessageType::Warning) - warningCount));
+    
+    if (target.getPostedCount() + dispatcher.getDroppedEventCount() != delegate.getDeliveredCount()) {
+        std::fprintf(stderr, "Posted and dropped values don't add up to the delivered values\n");
+        return 1;
+    }
+    
+    const long maxAllocations = options.getLong("max-allocations");
+    if (maxAllocations >= 0 && allocationCount > std::uint64_t(maxAllocations)) {
+        std::fprintf(stderr, "Allocations after warmup exceed the limit of %ld\n", maxAllocations);
+        return 1;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,196 @@
+//
+//  benchmark_input_logging.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  Measures what log_all_input_values adds to the per-value cost of the dispatch step, which posts each
+//  value (here, stores it and records a time stamp in a latency histogram, as USBHIDDevice does).  Three
+//  ways:
+//
+//    off:        no logging
+//    buffered:   USBHIDInputLogger::log, the current path, with the logger's thread running
+//    formatted:  the former path's formatting of one multi-line message per value.  The message is only
+//                formatted into a string, not delivered, so this is a lower bound on the former cost.
+//
+//  Values are dispatched in bursts no larger than the logging queue, with a pause after each (not timed)
+//  for the logger to drain it, so that every buffered value is actually logged rather than dropped.
+//
+
+#include <cstdarg>
+#include <random>
+
+#include "BenchmarkSupport.h"
+#include "USBHIDInputLogger.h"
+
+using namespace mworks;
+
+
+namespace {
+
+
+struct Value {
+    std::uint32_t usagePage;
+    std::uint32_t usage;
+    long integerValue;
+};
+
+
+enum class Mode {
+    Off,
+    Buffered,
+    Formatted
+};
+
+
+class Dispatcher {
+    
+public:
+    Dispatcher(Mode mode, USBHIDInputLogger &logger) :
+        mode(mode),
+        logger(logger),
+        clock(Clock::instance()),
+        postedValues(16, 0),
+        lastTimeNS(clock->getSystemTimeNS())
+    { }
+    
+    void dispatch(const Value &value) {
+        postedValues[value.usage % postedValues.size()] = value.integerValue;
+        const MWTime currentTimeNS = clock->getSystemTimeNS();
+        intervals.record(currentTimeNS - lastTimeNS);
+        lastTimeNS = currentTimeNS;
+        
+        switch (mode) {
+            case Mode::Off:
+                break;
+            
+            case Mode::Buffered:
+                logger.log(value.usagePage, value.usage, value.integerValue);
+                break;
+            
+            case Mode::Formatted:
+                (void)formatMessage("HID input on device \"%s\":\n"
+                                    "\tUsage page:\t%u\t(0x%02X)\n"
+                                    "\tUsage:\t\t%u\t(0x%02X)\n"
+                                    "\tValue:\t\t%ld",
+                                    "benchmark",
+                                    value.usagePage, value.usagePage,
+                                    value.usage, value.usage,
+                                    value.integerValue);
+                break;
+        }
+    }
+    
+private:
+    // Formats into a new string, as the message system does for each message
+    static std::string formatMessage(const char *format, ...) {
+        char buffer[512];
+        va_list args;
+        va_start(args, format);
+        const int length = std::vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        return std::string(buffer, std::max(length, 0));
+    }
+    
+    const Mode mode;
+    USBHIDInputLogger &logger;
+    const boost::shared_ptr<Clock> clock;
+    std::vector<long> postedValues;
+    USBHIDLatencyHistogram intervals;
+    MWTime lastTimeNS;
+    
+};
+
+
+double timeDispatch(Mode mode, const std::vector<Value> &stream, long valueCount, std::size_t burstSize) {
+    const boost::shared_ptr<Clock> clock = Clock::instance();
+    const MWTime drainIntervalUS = 5000;
+    
+    USBHIDInputLogger logger("benchmark", burstSize, drainIntervalUS);
+    if (mode == Mode::Buffered && !logger.start()) {
+        return 0.0;
+    }
+    
+    Dispatcher dispatcher(mode, logger);
+    MWTime elapsedNS = 0;
+    
+    for (long valueIndex = 0; valueIndex < valueCount; ) {
+        const long burstEnd = std::min(valueCount, valueIndex + long(burstSize));
+        
+        const MWTime startTimeNS = clock->getSystemTimeNS();
+        for (; valueIndex < burstEnd; valueIndex++) {
+            dispatcher.dispatch(stream[valueIndex % stream.size()]);
+        }
+        elapsedNS += clock->getSystemTimeNS() - startTimeNS;
+        
+        if (mode == Mode::Buffered) {
+            boost::this_thread::sleep_for(boost::chrono::microseconds(4 * drainIntervalUS));
+        }
+    }
+    
+    logger.stop();
+    
+    return double(elapsedNS) / double(valueCount);
+}
+
+
+}  // namespace
+
+
+int main(int argc, char *argv[]) {
+    usbhid_test::BenchmarkOptions options("Measures the per-value cost of logging input values", argc, argv);
+    options.declare("values", "10000000", "number of values to dispatch in each mode");
+    options.declare("burst", "262144", "values per burst, and the logging queue size");
+    options.declare("max-ratio", "0", "maximum ratio of buffered to unlogged cost, or 0 for no limit");
+    if (!options.parse()) {
+        return 2;
+    }
+    const long valueCount = std::max(options.getLong("values"), 1L);
+    const std::size_t burstSize = std::max(options.getLong("burst"), 1L);
+    
+    // An analog stick: two axes, each moving in small steps
+    std::minstd_rand random;
+    std::vector<Value> stream(4096);
+    long position[2] = { 128, 128 };
+    for (std::size_t index = 0; index < stream.size(); index++) {
+        long &axis = position[index % 2];
+        axis = std::max(0L, std::min(255L, axis + long(random() % 5) - 2));
+        const Value value = { 0x01, std::uint32_t(0x30 + index % 2), axis };
+        stream[index] = value;
+    }
+    
+    // The logger's summaries are counted, not printed
+    setMessagesPrinted(false);
+    const double offNS = timeDispatch(Mode::Off, stream, valueCount, burstSize);
+    const std::size_t infoCount = getMessageCount(MessageType::Info);
+    const std::size_t warningCount = getMessageCount(MessageType::Warning);
+    const double bufferedNS = timeDispatch(Mode::Buffered, stream, valueCount, burstSize);
+    const std::size_t summaryCount = getMessageCount(MessageType::Info) - infoCount;
+    const bool valuesDropped = (getMessageCount(MessageType::Warning) != warningCount);
+    const double formattedNS = timeDispatch(Mode::Formatted, stream, valueCount, burstSize);
+    setMessagesPrinted(true);
+    
+    const double ratio = ((offNS > 0.0) ? bufferedNS / offNS : 0.0);
+    std::printf("off:       %.1f ns/value\n", offNS);
+    std::printf("buffered:  %.1f ns/value (%.2fx off, %llu summary messages)\n",
+                bufferedNS,
+                ratio,
+                static_cast<unsigned long long>(summaryCount));
+    std::printf("formatted: %.1f ns/value (%.2fx off, formatting only)\n",
+                formattedNS,
+                ((offNS > 0.0) ? formattedNS / offNS : 0.0));
+    
+    if (valuesDropped) {
+        std::fprintf(stderr, "The logger dropped values; use a smaller --burst\n");
+        return 1;
+    }
+    
+    const double maxRatio = options.getDouble("max-ratio");
+    if (maxRatio > 0.0 && ratio > maxRatio) {
+        std::fprintf(stderr, "Logging costs more than %.1fx the unlogged dispatch\n", maxRatio);
+        return 1;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,199 @@
+//
+//  benchmark_startup.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  Measures the element discovery done when a device is set up, for a generated report descriptor with
+//  hundreds of input elements, every one of them mapped to a channel.  Both ways parse the descriptor, find
+//  the element for every channel, and decode a first report for the initial values; they differ only in how
+//  the elements are found:
+//
+//    single pass:  what the hidraw backend does: the ReportDecoder matches every element against an index
+//                  of the channel usages in one pass
+//    per channel:  a search of every element for each channel, modelled on the IOKit backend's former
+//                  IOHIDDeviceCopyMatchingElements call per channel
+//
+//  IOKit itself can't be exercised here, and the real per-channel calls also crossed into the HID manager,
+//  so the ratio between the two is only a rough indication of the improvement on macOS.
+//
+
+#include "BenchmarkSupport.h"
+#include "TestSupport.h"
+#include "USBHIDReportDecoder.h"
+
+using namespace mworks;
+using namespace mworks::usbhid;
+
+
+namespace {
+
+
+void appendItem(std::vector<std::uint8_t> &descriptor, std::uint8_t prefix, std::uint32_t data) {
+    if (data <= 0xFF) {
+        descriptor.push_back(prefix | 0x01);
+        descriptor.push_back(std::uint8_t(data));
+    } else {
+        descriptor.push_back(prefix | 0x02);
+        descriptor.push_back(std::uint8_t(data));
+        descriptor.push_back(std::uint8_t(data >> 8));
+    }
+}
+
+
+//
+// A joystick with eight 16-bit axes, then half the remaining elements as buttons (declared with a usage
+// range) and half as 8-bit vendor-defined values (each declared with its own usage)
+//
+std::vector<std::uint8_t> generateDescriptor(std::uint32_t elementCount, std::vector<std::uint32_t> &usages) {
+    const std::uint32_t axisCount = 8;
+    const std::uint32_t buttonCount = (elementCount - axisCount) / 2;
+    const std::uint32_t vendorCount = elementCount - axisCount - buttonCount;
+    
+    std::vector<std::uint8_t> descriptor;
+    appendItem(descriptor, 0x04, 0x01);  // Usage Page (Generic Desktop)
+    appendItem(descriptor, 0x08, 0x04);  // Usage (Joystick)
+    appendItem(descriptor, 0xA0, 0x01);  // Collection (Application)
+    
+    appendItem(descriptor, 0x14, 0);       // Logical Minimum (0)
+    appendItem(descriptor, 0x24, 0xFFFF);  // Logical Maximum (65535)
+    for (std::uint32_t axis = 0; axis < axisCount; axis++) {
+        appendItem(descriptor, 0x08, 0x30 + axis);  // Usage (X + axis)
+        usages.push_back(ReportDescriptor::makeUsage(0x01, 0x30 + axis));
+    }
+    appendItem(descriptor, 0x74, 16);         // Report Size (16)
+    appendItem(descriptor, 0x94, axisCount);  // Report Count
+    appendItem(descriptor, 0x80, 0x02);       // Input (Data, Variable, Absolute)
+    
+    appendItem(descriptor, 0x04, 0x09);          // Usage Page (Button)
+    appendItem(descriptor, 0x18, 1);             // Usage Minimum (1)
+    appendItem(descriptor, 0x28, buttonCount);   // Usage Maximum
+    appendItem(descriptor, 0x24, 1);             // Logical Maximum (1)
+    appendItem(descriptor, 0x74, 1);             // Report Size (1)
+    appendItem(descriptor, 0x94, buttonCount);   // Report Count
+    appendItem(descriptor, 0x80, 0x02);          // Input (Data, Variable, Absolute)
+    for (std::uint32_t button = 1; button <= buttonCount; button++) {
+        usages.push_back(ReportDescriptor::makeUsage(0x09, button));
+    }
+    if (buttonCount % 8) {
+        appendItem(descriptor, 0x94, 8 - buttonCount % 8);  // Report Count (padding)
+        appendItem(descriptor, 0x80, 0x01);                 // Input (Constant)
+    }
+    
+    appendItem(descriptor, 0x04, 0xFF00);  // Usage Page (Vendor Defined 0xFF00)
+    appendItem(descriptor, 0x24, 0xFF);    // Logical Maximum (255)
+    for (std::uint32_t vendor = 1; vendor <= vendorCount; vendor++) {
+        appendItem(descriptor, 0x08, vendor);  // Usage
+        usages.push_back(ReportDescriptor::makeUsage(0xFF00, vendor));
+    }
+    appendItem(descriptor, 0x74, 8);            // Report Size (8)
+    appendItem(descriptor, 0x94, vendorCount);  // Report Count
+    appendItem(descriptor, 0x80, 0x02);         // Input (Data, Variable, Absolute)
+    
+    descriptor.push_back(0xC0);  // End Collection
+    
+    return descriptor;
+}
+
+
+// Decodes an all-zero report, as the backends do for the initial values, and returns the number of values
+std::size_t decodeInitialValues(const ReportDescriptor &descriptor, ReportDecoder &decoder) {
+    const std::vector<std::uint8_t> report(descriptor.getMaxReportSize(ReportType::Input), 0);
+    std::size_t initialValueCount = 0;
+    decoder.decode(report.data(), report.size(), [&initialValueCount](const ExtractionOp &op, std::int32_t value) {
+        initialValueCount++;
+    });
+    return initialValueCount;
+}
+
+
+std::size_t startSinglePass(const std::vector<std::uint8_t> &descriptorData, const std::vector<std::uint32_t> &usages) {
+    const ReportDescriptor descriptor(descriptorData.data(), descriptorData.size());
+    ReportDecoder decoder(descriptor, usages, false);
+    
+    return decodeInitialValues(descriptor, decoder);
+}
+
+
+std::size_t startPerChannel(const std::vector<std::uint8_t> &descriptorData, const std::vector<std::uint32_t> &usages) {
+    const ReportDescriptor descriptor(descriptorData.data(), descriptorData.size());
+    
+    // Search every element for each channel's usage, as a matching call does, collecting the usages found
+    std::vector<std::uint32_t> foundUsages;
+    for (std::uint32_t usage : usages) {
+        bool found = false;
+        for (const auto &field : descriptor.getFields()) {
+            if (field.reportType != ReportType::Input || field.isConstant()) {
+                continue;
+            }
+            for (std::uint32_t index = 0; index < field.count; index++) {
+                if (field.usageAtIndex(index) == usage) {
+                    found = true;
+                }
+            }
+        }
+        if (found) {
+            foundUsages.push_back(usage);
+        }
+    }
+    
+    // The found elements still have to be read for their initial values
+    ReportDecoder decoder(descriptor, foundUsages, false);
+    
+    return decodeInitialValues(descriptor, decoder);
+}
+
+
+template <typename Start>
+double timeStartup(Start &&start, long repetitionCount, std::size_t &result) {
+    const boost::shared_ptr<Clock> clock = Clock::instance();
+    
+    const MWTime startTimeNS = clock->getSystemTimeNS();
+    for (long repetition = 0; repetition < repetitionCount; repetition++) {
+        result = start();
+    }
+    const MWTime elapsedNS = clock->getSystemTimeNS() - startTimeNS;
+    
+    return double(elapsedNS) / double(repetitionCount) / 1.0e3;
+}
+
+
+}  // namespace
+
+
+int main(int argc, char *argv[]) {
+    usbhid_test::BenchmarkOptions options("Measures element discovery for a device with many elements", argc, argv);
+    options.declare("elements", "512", "number of input elements (at least 10), all mapped to channels");
+    options.declare("repetitions", "200", "number of times to set up the device in each way");
+    if (!options.parse()) {
+        return 2;
+    }
+    const std::uint32_t elementCount = std::max(options.getLong("elements"), 10L);
+    const long repetitionCount = std::max(options.getLong("repetitions"), 1L);
+    
+    std::vector<std::uint32_t> usages;
+    const std::vector<std::uint8_t> descriptor = generateDescriptor(elementCount, usages);
+    
+    std::size_t singlePassCount = 0, perChannelCount = 0;
+    const double singlePassUS = timeStartup([&]() { return startSinglePass(descriptor, usages); },
+                                            repetitionCount,
+                                            singlePassCount);
+    const double perChannelUS = timeStartup([&]() { return startPerChannel(descriptor, usages); },
+                                            repetitionCount,
+                                            perChannelCount);
+    
+    std::printf("%lu elements, %lu byte descriptor:\n",
+                static_cast<unsigned long>(usages.size()),
+                static_cast<unsigned long>(descriptor.size()));
+    std::printf("  single pass: %.1f us\n", singlePassUS);
+    std::printf("  per channel: %.1f us (%.1fx, modelled)\n",
+                perChannelUS,
+                ((singlePassUS > 0.0) ? perChannelUS / singlePassUS : 0.0));
+    
+    // Every element must be found, so the first report must yield every initial value
+    USBHID_CHECK_EQUAL(singlePassCount, usages.size());
+    USBHID_CHECK_EQUAL(perChannelCount, usages.size());
+    
+    return usbhid_test::exitStatus();
+}
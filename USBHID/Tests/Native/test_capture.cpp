@@ -0,0 +1,107 @@
+//
+//  test_capture.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  Writes capture files with CaptureWriter, whose writer thread does the file I/O, and reads them back
+//  with CaptureReader.
+//
+
+#include <unistd.h>
+
+#include "TestSupport.h"
+#include "USBHIDCapture.h"
+
+using namespace mworks::usbhid;
+
+
+namespace {
+
+
+std::string makeTemporaryPath() {
+    return "/tmp/usbhid_test_capture_" + std::to_string(getpid()) + ".mwhidcap";
+}
+
+
+CaptureRecord makeRecord(std::uint32_t index) {
+    const CaptureRecord record = {
+        1000000ull * index,
+        std::uint16_t(0x01),
+        std::uint16_t(0x30 + index % 3),
+        std::int32_t(index)
+    };
+    return record;
+}
+
+
+void checkRecords(const std::string &path, std::uint32_t expectedCount) {
+    const CaptureReader reader(path);
+    USBHID_CHECK_EQUAL(reader.getHeader().vendorID, 0x046Du);
+    USBHID_CHECK_EQUAL(reader.getRecordCount(), expectedCount);
+    
+    std::uint32_t mismatchCount = 0;
+    for (std::uint32_t index = 0; index < reader.getRecordCount(); index++) {
+        const CaptureRecord &record = reader.getRecords()[index];
+        const CaptureRecord expected = makeRecord(index);
+        if (record.timestampNS != expected.timestampNS ||
+            record.usage != expected.usage ||
+            record.value != expected.value)
+        {
+            mismatchCount++;
+        }
+    }
+    USBHID_CHECK_EQUAL(mismatchCount, 0u);
+}
+
+
+// Records appended faster than a small buffer can be written are kept, in order, and each flush makes
+// everything appended so far visible to readers
+void testFlush() {
+    const std::string path = makeTemporaryPath();
+    CaptureHeader header = makeCaptureHeader();
+    header.vendorID = 0x046D;
+    
+    {
+        CaptureWriter writer(path, header, 16);
+        std::uint32_t recordCount = 0;
+        for (int round = 0; round < 3; round++) {
+            for (std::uint32_t index = 0; index < 10000; index++) {
+                writer.append(makeRecord(recordCount++));
+            }
+            USBHID_CHECK(writer.flush());
+            USBHID_CHECK_EQUAL(writer.getRecordCount(), recordCount);
+            checkRecords(path, recordCount);
+        }
+        
+        // Left for the destructor to write
+        for (std::uint32_t index = 0; index < 5; index++) {
+            writer.append(makeRecord(recordCount++));
+        }
+    }
+    
+    checkRecords(path, 30005);
+    (void)unlink(path.c_str());
+}
+
+
+void testCreateFailure() {
+    bool threw = false;
+    try {
+        CaptureWriter writer("/nonexistent/directory/capture", makeCaptureHeader());
+    } catch (const CaptureError &) {
+        threw = true;
+    }
+    USBHID_CHECK(threw);
+}
+
+
+}  // namespace
+
+
+int main() {
+    testFlush();
+    testCreateFailure();
+    return usbhid_test::exitStatus();
+}
@@ -0,0 +1,144 @@
+//
+//  test_clock_mapper.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  Feeds USBHIDClockMapper an hour of simulated input at 1 kHz, with up to 1 ms of receive latency jitter,
+//  sampling as USBHIDDevice does.  Mapped times must stay monotonic and exactly offset from the time stamps,
+//  whatever the fit measures, and the measured drift must be close to the simulated drift.
+//
+
+#include <random>
+
+#include "TestSupport.h"
+#include "USBHIDClockMapper.h"
+
+using namespace mworks;
+
+
+namespace {
+
+
+const MWTime baseTimeNS = 5000000000;
+const std::uint64_t startTimestampNS = 7000000000;
+const std::uint64_t eventIntervalNS = 1000000;   // 1 kHz
+const std::uint64_t durationNS = 3600000000000;  // 1 hour
+const std::int64_t maxJitterNS = 1000000;        // 1 ms
+
+
+struct Result {
+    std::uint64_t nonMonotonicCount;
+    MWTime maxErrorUS;
+    double driftPPM;
+    double jitterNS;
+    double meanLatencyNS;
+};
+
+
+// driftPPM is the rate at which the receiving clock gains on the time stamps
+Result simulate(double driftPPM) {
+    USBHIDClockMapper mapper(baseTimeNS);
+    std::minstd_rand random;
+    std::uniform_int_distribution<std::int64_t> latencyNS(0, maxJitterNS);
+    
+    Result result = { 0, 0, 0.0, 0.0, 0.0 };
+    MWTime lastTimeUS = 0;
+    
+    for (std::uint64_t offsetNS = 0; offsetNS < durationNS; offsetNS += eventIntervalNS) {
+        const std::uint64_t timestampNS = startTimestampNS + offsetNS;
+        if (mapper.checkTimestamp(timestampNS)) {
+            const MWTime systemTimeNS = (MWTime(timestampNS) +
+                                         MWTime(driftPPM * 1.0e-6 * double(offsetNS)) +
+                                         latencyNS(random));
+            mapper.addSample(timestampNS, systemTimeNS);
+        }
+        
+        const MWTime timeUS = mapper.toMWorksTime(timestampNS);
+        if (offsetNS > 0 && timeUS <= lastTimeUS) {
+            result.nonMonotonicCount++;
+        }
+        lastTimeUS = timeUS;
+        
+        const MWTime expectedUS = (MWTime(timestampNS) - baseTimeNS) / 1000;
+        result.maxErrorUS = std::max(result.maxErrorUS, std::abs(timeUS - expectedUS));
+    }
+    
+    result.driftPPM = mapper.getDriftPPM();
+    result.jitterNS = mapper.getJitterNS();
+    result.meanLatencyNS = mapper.getMeanLatencyNS();
+    USBHID_CHECK_EQUAL(mapper.getSampleCount(), durationNS / 100000000);
+    
+    return result;
+}
+
+
+void testJitterWithoutDrift() {
+    const Result result = simulate(0.0);
+    std::printf("No drift: measured %.2f ppm, jitter %.3f ms, mean latency %.3f ms\n",
+                result.driftPPM,
+                result.jitterNS / 1.0e6,
+                result.meanLatencyNS / 1.0e6);
+    
+    USBHID_CHECK_EQUAL(result.nonMonotonicCount, 0u);
+    USBHID_CHECK_EQUAL(result.maxErrorUS, 0);
+    
+    // Uniform jitter over [0, 1 ms] has a mean of 0.5 ms and a standard deviation of about 0.29 ms.  The
+    // drift estimate from 10 s of such samples is noisy, but should be near zero.
+    USBHID_CHECK(std::abs(result.driftPPM) < 10.0);
+    USBHID_CHECK(result.jitterNS > 0.2e6 && result.jitterNS < 0.4e6);
+    USBHID_CHECK(result.meanLatencyNS > 0.3e6 && result.meanLatencyNS < 0.7e6);
+}
+
+
+void testDriftIsDiagnosticOnly() {
+    // Small enough that the latency stays under the stale limit for the whole hour
+    const Result result = simulate(20.0);
+    std::printf("20 ppm drift: measured %.2f ppm\n", result.driftPPM);
+    
+    // The drift is measured, but conversion is still a fixed offset
+    USBHID_CHECK(result.driftPPM > 10.0 && result.driftPPM < 30.0);
+    USBHID_CHECK_EQUAL(result.nonMonotonicCount, 0u);
+    USBHID_CHECK_EQUAL(result.maxErrorUS, 0);
+}
+
+
+void testAnomalies() {
+    USBHIDClockMapper mapper(baseTimeNS);
+    
+    USBHID_CHECK(mapper.checkTimestamp(startTimestampNS));
+    mapper.addSample(startTimestampNS, MWTime(startTimestampNS) + 200000);
+    USBHID_CHECK(!mapper.checkTimestamp(startTimestampNS + 1000));  // Before the next sample is due
+    
+    USBHID_CHECK(!mapper.checkTimestamp(startTimestampNS - 1));      // Backwards
+    USBHID_CHECK_EQUAL(mapper.getNonMonotonicCount(), 1u);
+    
+    std::uint64_t timestampNS = startTimestampNS + 100000000;
+    USBHID_CHECK(mapper.checkTimestamp(timestampNS));
+    mapper.addSample(timestampNS, MWTime(timestampNS) + 200000000);  // 200 ms old
+    USBHID_CHECK_EQUAL(mapper.getStaleCount(), 1u);
+    
+    timestampNS += 100000000;
+    USBHID_CHECK(mapper.checkTimestamp(timestampNS));
+    mapper.addSample(timestampNS, MWTime(timestampNS) - 5000000);    // 5 ms in the future
+    USBHID_CHECK_EQUAL(mapper.getFutureCount(), 1u);
+    
+    USBHID_CHECK_EQUAL(mapper.getSampleCount(), 1u);
+    USBHID_CHECK_EQUAL(mapper.getDriftPPM(), 0.0);
+    
+    mapper.reset();
+    USBHID_CHECK_EQUAL(mapper.getSampleCount(), 0u);
+    USBHID_CHECK_EQUAL(mapper.getNonMonotonicCount(), 0u);
+}
+
+
+}  // namespace
+
+
+int main() {
+    testJitterWithoutDrift();
+    testDriftIsDiagnosticOnly();
+    testAnomalies();
+    return usbhid_test::exitStatus();
+}
@@ -0,0 +1,251 @@
+//
+//  test_event_merger.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  Checks the ordering guarantees of USBHIDEventMerger: events with equal time stamps keep their submission
+//  order, late events are reported and still dispatched, flush waits out a dispatch in progress before
+//  dispatching the client's remaining events in order, and submitting doesn't allocate.
+//
+
+#include "TestSupport.h"
+#include "USBHIDEventMerger.h"
+
+using namespace mworks;
+
+
+namespace {
+
+
+class TestClient : boost::noncopyable {
+    
+public:
+    TestClient() :
+        blockFirstDispatch(false),
+        firstDispatchStarted(false),
+        firstDispatchReleased(false)
+    { }
+    
+    void dispatchMergedEvent(int event) {
+        boost::mutex::scoped_lock lock(mutex);
+        
+        if (blockFirstDispatch && !firstDispatchStarted) {
+            firstDispatchStarted = true;
+            condition.notify_all();
+            while (!firstDispatchReleased) {
+                condition.wait(lock);
+            }
+        }
+        
+        events.push_back(event);
+        threads.push_back(boost::this_thread::get_id());
+    }
+    
+    // Makes the first dispatch block until releaseFirstDispatch is called
+    void setBlockFirstDispatch() {
+        boost::mutex::scoped_lock lock(mutex);
+        blockFirstDispatch = true;
+    }
+    
+    bool waitForFirstDispatchStarted() {
+        boost::mutex::scoped_lock lock(mutex);
+        return condition.wait_for(lock, boost::chrono::seconds(5), [this]() { return firstDispatchStarted; });
+    }
+    
+    void releaseFirstDispatch() {
+        boost::mutex::scoped_lock lock(mutex);
+        firstDispatchReleased = true;
+        condition.notify_all();
+    }
+    
+    // Waits up to five seconds for the given number of events to be dispatched
+    std::vector<int> waitForEvents(std::size_t count) {
+        const boost::chrono::steady_clock::time_point deadline = (boost::chrono::steady_clock::now() +
+                                                                  boost::chrono::seconds(5));
+        while (true) {
+            {
+                boost::mutex::scoped_lock lock(mutex);
+                if (events.size() >= count || boost::chrono::steady_clock::now() >= deadline) {
+                    return events;
+                }
+            }
+            boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+        }
+    }
+    
+    std::vector<boost::thread::id> getThreads() {
+        boost::mutex::scoped_lock lock(mutex);
+        return threads;
+    }
+    
+private:
+    boost::mutex mutex;
+    boost::condition_variable condition;
+    std::vector<int> events;
+    std::vector<boost::thread::id> threads;
+    bool blockFirstDispatch;
+    bool firstDispatchStarted;
+    bool firstDispatchReleased;
+    
+};
+
+
+typedef USBHIDEventMerger<TestClient, int> Merger;
+
+
+void checkEvents(const std::vector<int> &actual, const std::vector<int> &expected, int line) {
+    if (actual != expected) {
+        std::ostringstream message;
+        message << "dispatched events:";
+        for (int event : actual) {
+            message << " " << event;
+        }
+        usbhid_test::fail(__FILE__, line, message.str());
+    }
+}
+
+
+std::uint64_t currentTimeNS() {
+    return std::uint64_t(Clock::instance()->getSystemTimeNS());
+}
+
+
+//
+// Events from two clients with the same time stamp are dispatched in submission order, as are each
+// client's own events
+//
+void testEqualTimestamps() {
+    const boost::shared_ptr<Merger> merger = Merger::instance("equal_timestamps", 200000);
+    TestClient first, second;
+    
+    const std::uint64_t timestampNS = currentTimeNS();
+    for (int event = 0; event < 20; event++) {
+        USBHID_CHECK(merger->submit(((event % 3) ? first : second), event, timestampNS));
+    }
+    // An earlier event submitted afterward still goes first
+    USBHID_CHECK(merger->submit(second, -1, timestampNS - 1));
+    
+    checkEvents(first.waitForEvents(13), { 1, 2, 4, 5, 7, 8, 10, 11, 13, 14, 16, 17, 19 }, __LINE__);
+    checkEvents(second.waitForEvents(8), { -1, 0, 3, 6, 9, 12, 15, 18 }, __LINE__);
+}
+
+
+//
+// An event stamped earlier than one already dispatched is late.  submit reports it, and it's dispatched
+// anyway.
+//
+void testLateArrival() {
+    const boost::shared_ptr<Merger> merger = Merger::instance("late_arrival", 1000);
+    TestClient client;
+    
+    const std::uint64_t timestampNS = currentTimeNS();
+    USBHID_CHECK(merger->submit(client, 1, timestampNS));
+    checkEvents(client.waitForEvents(1), { 1 }, __LINE__);
+    
+    USBHID_CHECK(!merger->submit(client, 2, timestampNS - 1));
+    USBHID_CHECK(merger->submit(client, 3, timestampNS));
+    USBHID_CHECK(merger->submit(client, 4, timestampNS + 1));
+    checkEvents(client.waitForEvents(4), { 1, 2, 3, 4 }, __LINE__);
+}
+
+
+//
+// A flush issued while the merging thread is dispatching to the same client waits for that dispatch to
+// finish, then dispatches the client's pending events, in order, on the flushing thread.  Other clients'
+// events stay pending.
+//
+void testFlushDuringDispatch() {
+    const boost::shared_ptr<Merger> merger = Merger::instance("flush_during_dispatch", 0);
+    TestClient client, other;
+    client.setBlockFirstDispatch();
+    
+    const std::uint64_t timestampNS = currentTimeNS();
+    USBHID_CHECK(merger->submit(client, 1, timestampNS));
+    USBHID_CHECK(client.waitForFirstDispatchStarted());
+    
+    // Stamped far enough in the future that the merging thread holds them
+    const std::uint64_t futureNS = timestampNS + 60000000000ULL;
+    USBHID_CHECK(merger->submit(client, 4, futureNS + 3));
+    USBHID_CHECK(merger->submit(other, 100, futureNS + 1));
+    USBHID_CHECK(merger->submit(client, 2, futureNS + 1));
+    USBHID_CHECK(merger->submit(client, 3, futureNS + 1));
+    
+    std::atomic<bool> flushed(false);
+    boost::thread flushThread([&]() {
+        merger->flush(client);
+        flushed = true;
+    });
+    
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(50));
+    USBHID_CHECK(!flushed);
+    checkEvents(client.waitForEvents(0), {}, __LINE__);
+    
+    client.releaseFirstDispatch();
+    flushThread.join();
+    USBHID_CHECK(flushed);
+    checkEvents(client.waitForEvents(4), { 1, 2, 3, 4 }, __LINE__);
+    
+    const std::vector<boost::thread::id> threads = client.getThreads();
+    USBHID_CHECK_EQUAL(threads.size(), std::size_t(4));
+    if (threads.size() == 4) {
+        USBHID_CHECK(threads[1] == threads[2] && threads[2] == threads[3]);
+        USBHID_CHECK(threads[1] != threads[0]);
+    }
+    
+    checkEvents(other.waitForEvents(0), {}, __LINE__);
+    merger->flush(other);
+    checkEvents(other.waitForEvents(1), { 100 }, __LINE__);
+}
+
+
+//
+// Submitting doesn't allocate while the pending events fit in the merger's reserved storage.  Beyond that,
+// the storage grows, and a single warning reports it.
+//
+void testPendingCapacity() {
+    const boost::shared_ptr<Merger> merger = Merger::instance("pending_capacity", 0);
+    TestClient client;
+    
+    // Stamped in the future, so that nothing is dispatched (and nothing allocated by the client) meanwhile
+    const std::uint64_t futureNS = currentTimeNS() + 60000000000ULL;
+    const int reservedCount = 1024;
+    
+    usbhid_test::startCountingAllocations();
+    for (int event = 0; event < reservedCount; event++) {
+        (void)merger->submit(client, event, futureNS + event);
+    }
+    USBHID_CHECK_EQUAL(usbhid_test::stopCountingAllocations(), std::uint64_t(0));
+    
+    const std::size_t warningCount = getMessageCount(MessageType::Warning);
+    setMessagesPrinted(false);
+    for (int event = reservedCount; event < 3 * reservedCount; event++) {
+        (void)merger->submit(client, event, futureNS + event);
+    }
+    setMessagesPrinted(true);
+    USBHID_CHECK_EQUAL(getMessageCount(MessageType::Warning), warningCount + 1);
+    
+    // Nothing was lost
+    merger->flush(client);
+    const std::vector<int> events = client.waitForEvents(3 * reservedCount);
+    USBHID_CHECK_EQUAL(events.size(), std::size_t(3 * reservedCount));
+    for (std::size_t index = 0; index < events.size(); index++) {
+        if (events[index] != int(index)) {
+            USBHID_CHECK_EQUAL(events[index], int(index));
+            break;
+        }
+    }
+}
+
+
+}  // namespace
+
+
+int main() {
+    testEqualTimestamps();
+    testLateArrival();
+    testFlushDuringDispatch();
+    testPendingCapacity();
+    return usbhid_test::exitStatus();
+}
@@ -0,0 +1,197 @@
+//
+//  test_input_dispatcher.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  Drives USBHIDInputDispatcher, the input path that USBHIDDevice uses, with reports for three regular
+//  channels, one regular channel with duplicate suppression, and one three-usage multi-usage channel.  Each
+//  way of posting (directly on the I/O thread, through a dispatch queue, with report batching, and through
+//  a merge group) must post every value, the multi-usage channel once per change, and the frame number (in
+//  batch mode), and must not allocate once running.  Reports arrive at 10 kHz, faster than any real device,
+//  but slowly enough that the merge group can keep up.
+//
+
+#include "TestSupport.h"
+#include "USBHIDInputDispatcher.h"
+
+using namespace mworks;
+
+
+namespace {
+
+
+const std::size_t channelCount = 4;
+const std::size_t multiUsageSize = 3;
+const long suppressedValue = 7;
+
+
+class RecordingTarget : public USBHIDInputDispatcher::Target {
+    
+public:
+    RecordingTarget() :
+        values(channelCount, -1),
+        multiUsageValues(multiUsageSize, -1),
+        postCount(0),
+        multiUsagePostCount(0),
+        frameNumber(0),
+        droppedEventCount(0)
+    { }
+    
+    void postValue(std::size_t channelIndex, long integerValue, MWTime time) override {
+        values[channelIndex] = integerValue;
+        postCount++;
+    }
+    
+    void postMultiUsageValues(std::size_t multiUsageIndex, const std::vector<long> &newValues, MWTime time) override {
+        multiUsageValues.assign(newValues.begin(), newValues.end());
+        multiUsagePostCount++;
+    }
+    
+    void postFrameNumber(long newFrameNumber, MWTime time) override {
+        frameNumber = newFrameNumber;
+    }
+    
+    void postDroppedEventCount(long newDroppedEventCount) override {
+        droppedEventCount = newDroppedEventCount;
+    }
+    
+    void requestWakeup(std::uint64_t timeNS) override { }
+    
+    // Written by whichever thread posts, and read only after the dispatcher stops
+    std::vector<long> values;
+    std::vector<long> multiUsageValues;
+    std::uint64_t postCount;
+    std::uint64_t multiUsagePostCount;
+    long frameNumber;
+    long droppedEventCount;
+    
+};
+
+
+// Delivers one report, as a backend does, and returns the value of the multi-usage channel's first usage
+long deliverReport(USBHIDInputDispatcher &dispatcher, long reportIndex, std::uint64_t timestampNS) {
+    for (std::size_t channelIndex = 0; channelIndex < channelCount; channelIndex++) {
+        const long integerValue = ((channelIndex == channelCount - 1) ? suppressedValue : reportIndex + long(channelIndex));
+        const USBHIDBackend::InputValue value = { channelIndex, 0x01, std::uint32_t(0x30 + channelIndex), integerValue, timestampNS };
+        dispatcher.handleInputValue(value);
+    }
+    
+    // The multi-usage channel changes every other report
+    const long multiUsageValue = (reportIndex / 2) % 2;
+    for (std::size_t offset = 0; offset < multiUsageSize; offset++) {
+        const USBHIDBackend::InputValue value = {
+            channelCount + offset,
+            0x09,
+            std::uint32_t(1 + offset),
+            multiUsageValue,
+            timestampNS
+        };
+        dispatcher.handleInputValue(value);
+    }
+    
+    dispatcher.handleFrameEnd();
+    
+    boost::this_thread::sleep_for(boost::chrono::microseconds(100));
+    
+    return multiUsageValue;
+}
+
+
+void testPosting(const char *name, const USBHIDInputDispatcher::Options &options, long reportCount) {
+    std::printf("%s\n", name);
+    
+    const boost::shared_ptr<Clock> clock = Clock::instance();
+    RecordingTarget target;
+    std::uint64_t allocationCount = 0;
+    long lastMultiUsageValue = -1;
+    
+    {
+        USBHIDInputDispatcher dispatcher("test", target, options);
+        
+        std::vector<USBHIDInputDispatcher::Channel> channels;
+        for (std::size_t channelIndex = 0; channelIndex < channelCount; channelIndex++) {
+            const USBHIDInputDispatcher::Channel channel = {
+                0x01,
+                std::uint32_t(0x30 + channelIndex),
+                0,
+                (channelIndex == channelCount - 1),
+                0.0
+            };
+            channels.push_back(channel);
+        }
+        dispatcher.configure(channels, std::vector<std::size_t>(1, multiUsageSize), nullptr, nullptr);
+        
+        USBHID_CHECK(dispatcher.start());
+        dispatcher.setCalibratingClock(true);
+        
+        // Warm up, so that anything allocated on first use (by the clock mapper's first sample, say) is
+        // excluded
+        const long warmupCount = reportCount / 10;
+        for (long reportIndex = 0; reportIndex < warmupCount; reportIndex++) {
+            lastMultiUsageValue = deliverReport(dispatcher, reportIndex, clock->getSystemTimeNS());
+        }
+        
+        usbhid_test::startCountingAllocations();
+        for (long reportIndex = warmupCount; reportIndex < reportCount; reportIndex++) {
+            lastMultiUsageValue = deliverReport(dispatcher, reportIndex, clock->getSystemTimeNS());
+        }
+        allocationCount = usbhid_test::stopCountingAllocations();
+        
+        dispatcher.stop();
+        USBHID_CHECK_EQUAL(dispatcher.getDroppedEventCount(), 0u);
+    }
+    
+    for (std::size_t channelIndex = 0; channelIndex < channelCount - 1; channelIndex++) {
+        USBHID_CHECK_EQUAL(target.values[channelIndex], reportCount - 1 + long(channelIndex));
+    }
+    USBHID_CHECK_EQUAL(target.values[channelCount - 1], suppressedValue);
+    
+    // The suppressed channel is posted only once
+    USBHID_CHECK_EQUAL(target.postCount, std::uint64_t(reportCount) * (channelCount - 1) + 1);
+    
+    // Posted in full with the first report, then once for each change
+    USBHID_CHECK(target.multiUsageValues == std::vector<long>(multiUsageSize, lastMultiUsageValue));
+    USBHID_CHECK_EQUAL(target.multiUsagePostCount, std::uint64_t((reportCount + 1) / 2));
+    
+    USBHID_CHECK_EQUAL(target.frameNumber, (options.batchReports ? reportCount : 0L));
+    USBHID_CHECK_EQUAL(target.droppedEventCount, 0L);
+    USBHID_CHECK_EQUAL(allocationCount, 0u);
+}
+
+
+USBHIDInputDispatcher::Options makeOptions() {
+    USBHIDInputDispatcher::Options options;
+    options.dispatchQueueSize = 0;
+    options.mergeWindowUS = 0;
+    options.batchReports = false;
+    options.measureLatency = true;
+    options.inputLogger = nullptr;
+    return options;
+}
+
+
+}  // namespace
+
+
+int main() {
+    const long reportCount = 2000;
+    
+    testPosting("direct", makeOptions(), reportCount);
+    
+    // Large enough that nothing is dropped
+    USBHIDInputDispatcher::Options queued = makeOptions();
+    queued.dispatchQueueSize = 65536;
+    testPosting("dispatch queue", queued, reportCount);
+    
+    USBHIDInputDispatcher::Options batched = queued;
+    batched.batchReports = true;
+    testPosting("dispatch queue, batched", batched, reportCount);
+    
+    USBHIDInputDispatcher::Options merged = makeOptions();
+    merged.mergeGroup = "test";
+    testPosting("merge group", merged, reportCount);
+    
+    return usbhid_test::exitStatus();
+}
@@ -0,0 +1,59 @@
+//
+//  test_latency_histogram.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  Checks USBHIDLatencyHistogram's bucket bounds, including the last regular bucket, which must stay
+//  distinct from the overflow bucket.
+//
+
+#include "TestSupport.h"
+#include "USBHIDLatencyHistogram.h"
+
+using namespace mworks;
+
+
+namespace {
+
+
+void testSmallDelays() {
+    USBHIDLatencyHistogram histogram;
+    USBHID_CHECK_EQUAL(histogram.getQuantileNS(0.5), 0u);
+    
+    histogram.record(-5);
+    histogram.record(500);
+    histogram.record(1500);
+    histogram.record(5000);
+    USBHID_CHECK_EQUAL(histogram.getCount(), 4u);
+    USBHID_CHECK_EQUAL(histogram.getMaxNS(), 5000u);
+    
+    USBHID_CHECK_EQUAL(histogram.getQuantileNS(0.0), 1024u);    // First bucket is [0, 1024)
+    USBHID_CHECK_EQUAL(histogram.getQuantileNS(0.5), 1024u);
+    USBHID_CHECK_EQUAL(histogram.getQuantileNS(0.7), 1536u);    // [1280, 1536)
+    USBHID_CHECK_EQUAL(histogram.getQuantileNS(1.0), 5000u);    // Clamped to the exact maximum
+}
+
+
+void testLastRegularBucket() {
+    const std::uint64_t overflowStart = std::uint64_t(1) << 40;
+    
+    USBHIDLatencyHistogram histogram;
+    histogram.record(overflowStart - 1);  // Last regular bucket, [1.75 * 2^39, 2^40)
+    histogram.record(2 * overflowStart);  // Overflow
+    
+    // If the last regular bucket were counted as overflow, the median would be clamped to the maximum
+    USBHID_CHECK_EQUAL(histogram.getQuantileNS(0.0), overflowStart);
+    USBHID_CHECK_EQUAL(histogram.getQuantileNS(1.0), 2 * overflowStart);
+}
+
+
+}  // namespace
+
+
+int main() {
+    testSmallDelays();
+    testLastRegularBucket();
+    return usbhid_test::exitStatus();
+}
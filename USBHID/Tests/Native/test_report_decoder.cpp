@@ -0,0 +1,381 @@
+//
+//  test_report_decoder.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  Parses report descriptors for a few representative devices and checks the extraction ops that
+//  ReportExtractor compiles from them and the values that ReportDecoder decodes from sample reports.
+//
+
+#include "TestSupport.h"
+#include "USBHIDReportDecoder.h"
+
+using namespace mworks::usbhid;
+
+
+namespace {
+
+
+typedef std::vector<std::pair<std::uint32_t, std::int32_t>> DecodedValues;
+
+
+DecodedValues decode(ReportDecoder &decoder, const std::vector<std::uint8_t> &report) {
+    DecodedValues values;
+    decoder.decode(report.data(), report.size(), [&values](const ExtractionOp &op, std::int32_t value) {
+        values.push_back(DecodedValues::value_type(op.usage, value));
+    });
+    return values;
+}
+
+
+void checkVariableOp(const ExtractionOp &op,
+                     std::uint32_t usage,
+                     std::uint8_t reportID,
+                     std::uint32_t bitOffset,
+                     std::uint8_t bitSize,
+                     bool isSigned)
+{
+    USBHID_CHECK_EQUAL(op.usage, usage);
+    USBHID_CHECK_EQUAL(op.reportID, reportID);
+    USBHID_CHECK_EQUAL(op.bitOffset, bitOffset);
+    USBHID_CHECK_EQUAL(op.bitSize, bitSize);
+    USBHID_CHECK_EQUAL(op.isSigned, isSigned);
+    USBHID_CHECK(!op.isArray);
+}
+
+
+void checkArrayOp(const ExtractionOp &op,
+                  std::uint32_t usage,
+                  std::uint32_t bitOffset,
+                  std::uint8_t bitSize,
+                  std::uint32_t arrayCount,
+                  std::int32_t arrayValue)
+{
+    USBHID_CHECK_EQUAL(op.usage, usage);
+    USBHID_CHECK_EQUAL(op.bitOffset, bitOffset);
+    USBHID_CHECK_EQUAL(op.bitSize, bitSize);
+    USBHID_CHECK(op.isArray);
+    USBHID_CHECK_EQUAL(op.arrayCount, arrayCount);
+    USBHID_CHECK_EQUAL(op.arrayValue, arrayValue);
+}
+
+
+void checkValues(const DecodedValues &actual, const DecodedValues &expected, int line) {
+    if (actual != expected) {
+        std::ostringstream message;
+        message << "decoded values differ:";
+        for (const auto &value : actual) {
+            message << " 0x" << std::hex << value.first << "=" << std::dec << value.second;
+        }
+        usbhid_test::fail(__FILE__, line, message.str());
+    }
+}
+
+
+//
+// Gamepad: the Logitech Dual Action, whose descriptor is registered with its device profile.  Four 8-bit
+// axes, a 4-bit hat switch, 12 buttons, and eight vendor-defined bits that share a single usage.
+//
+void testGamepad() {
+    const DeviceProfile *profile = findDeviceProfile("logitech_dual_action");
+    USBHID_CHECK(profile != nullptr);
+    if (!profile) {
+        return;
+    }
+    
+    const ReportDescriptor descriptor(profile->reportDescriptor, profile->reportDescriptorSize);
+    USBHID_CHECK(!descriptor.usesReportIDs());
+    USBHID_CHECK_EQUAL(descriptor.getMaxReportSize(ReportType::Input), std::size_t(7));
+    
+    const std::uint32_t x = ReportDescriptor::makeUsage(0x01, 0x30);
+    const std::uint32_t hat = ReportDescriptor::makeUsage(0x01, 0x39);
+    const std::uint32_t button12 = ReportDescriptor::makeUsage(0x09, 12);
+    const std::uint32_t vendor = ReportDescriptor::makeUsage(0xFF00, 0x01);
+    const std::uint32_t missing = ReportDescriptor::makeUsage(0x09, 13);
+    
+    ReportDecoder generic(descriptor, { x, hat, button12, vendor, missing }, false);
+    const ReportExtractor &extractor = generic.getExtractor();
+    USBHID_CHECK(extractor.isTargetMatched(2));
+    USBHID_CHECK(!extractor.isTargetMatched(4));
+    
+    // The vendor-defined usage applies to all eight of its field's values
+    const std::vector<ExtractionOp> &ops = extractor.getOps();
+    USBHID_CHECK_EQUAL(ops.size(), std::size_t(11));
+    if (ops.size() == 11) {
+        checkVariableOp(ops[0], x, 0, 0, 8, false);
+        checkVariableOp(ops[1], hat, 0, 32, 4, false);
+        checkVariableOp(ops[2], button12, 0, 47, 1, false);
+        for (std::uint32_t index = 0; index < 8; index++) {
+            checkVariableOp(ops[3 + index], vendor, 0, 48 + index, 1, false);
+            USBHID_CHECK_EQUAL(ops[3 + index].target, std::size_t(3));
+        }
+    }
+    
+    // X = 0x80, hat = 3, buttons 1 and 12 pressed, first vendor bit set
+    const std::vector<std::uint8_t> report = { 0x80, 0x7F, 0x00, 0xFF, 0x13, 0x80, 0x01 };
+    DecodedValues expected = { { x, 0x80 }, { hat, 3 }, { button12, 1 }, { vendor, 1 } };
+    for (std::size_t index = 1; index < 8; index++) {
+        expected.push_back(DecodedValues::value_type(vendor, 0));
+    }
+    checkValues(decode(generic, report), expected, __LINE__);
+    
+    // Unchanged values aren't repeated
+    checkValues(decode(generic, report), DecodedValues(), __LINE__);
+    
+    const std::vector<std::uint8_t> nextReport = { 0x81, 0x7F, 0x00, 0xFF, 0x18, 0x00, 0x01 };
+    checkValues(decode(generic, nextReport), { { x, 0x81 }, { hat, 8 }, { button12, 0 } }, __LINE__);
+    
+    // The specialized decoder yields exactly what the generic ops do
+    ReportDecoder profiled(descriptor, { x, hat, button12, vendor, missing }, false);
+    USBHID_CHECK(profiled.useProfile(*profile));
+    checkValues(decode(profiled, report), expected, __LINE__);
+    checkValues(decode(profiled, nextReport), { { x, 0x81 }, { hat, 8 }, { button12, 0 } }, __LINE__);
+    
+    // A short report falls back to the generic ops, which skip the fields it doesn't cover
+    checkValues(decode(profiled, { 0x82, 0x7F, 0x00, 0xFF }), { { x, 0x82 } }, __LINE__);
+}
+
+
+//
+// Keyboard: the boot keyboard descriptor.  Eight modifier bits, a constant byte, and a six-slot key code
+// array whose logical range (0-101) matches its usage range.
+//
+const std::uint8_t keyboardDescriptor[] = {
+    0x05, 0x01,        // Usage Page (Generic Desktop)
+    0x09, 0x06,        // Usage (Keyboard)
+    0xA1, 0x01,        // Collection (Application)
+    0x05, 0x07,        //   Usage Page (Keyboard)
+    0x19, 0xE0,        //   Usage Minimum (Left Control)
+    0x29, 0xE7,        //   Usage Maximum (Right GUI)
+    0x15, 0x00,        //   Logical Minimum (0)
+    0x25, 0x01,        //   Logical Maximum (1)
+    0x75, 0x01,        //   Report Size (1)
+    0x95, 0x08,        //   Report Count (8)
+    0x81, 0x02,        //   Input (Data, Variable, Absolute)
+    0x95, 0x01,        //   Report Count (1)
+    0x75, 0x08,        //   Report Size (8)
+    0x81, 0x01,        //   Input (Constant)
+    0x95, 0x06,        //   Report Count (6)
+    0x75, 0x08,        //   Report Size (8)
+    0x15, 0x00,        //   Logical Minimum (0)
+    0x25, 0x65,        //   Logical Maximum (101)
+    0x19, 0x00,        //   Usage Minimum (0)
+    0x29, 0x65,        //   Usage Maximum (101)
+    0x81, 0x00,        //   Input (Data, Array, Absolute)
+    0xC0               // End Collection
+};
+
+
+void testKeyboard() {
+    const ReportDescriptor descriptor(keyboardDescriptor, sizeof(keyboardDescriptor));
+    USBHID_CHECK_EQUAL(descriptor.getMaxReportSize(ReportType::Input), std::size_t(8));
+    
+    const std::uint32_t leftShift = ReportDescriptor::makeUsage(0x07, 0xE1);
+    const std::uint32_t keyA = ReportDescriptor::makeUsage(0x07, 0x04);
+    const std::uint32_t keyZ = ReportDescriptor::makeUsage(0x07, 0x1D);
+    const std::uint32_t beyondRange = ReportDescriptor::makeUsage(0x07, 0x66);
+    
+    ReportDecoder decoder(descriptor, { leftShift, keyA, keyZ, beyondRange }, false);
+    USBHID_CHECK(!decoder.getExtractor().isTargetMatched(3));
+    
+    const std::vector<ExtractionOp> &ops = decoder.getExtractor().getOps();
+    USBHID_CHECK_EQUAL(ops.size(), std::size_t(3));
+    if (ops.size() == 3) {
+        checkVariableOp(ops[0], leftShift, 0, 1, 1, false);
+        checkArrayOp(ops[1], keyA, 16, 8, 6, 0x04);
+        checkArrayOp(ops[2], keyZ, 16, 8, 6, 0x1D);
+    }
+    
+    checkValues(decode(decoder, { 0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00 }),
+                { { leftShift, 1 }, { keyA, 1 }, { keyZ, 0 } },
+                __LINE__);
+    
+    // A key reported in a later slot is still found
+    checkValues(decode(decoder, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1D }),
+                { { leftShift, 0 }, { keyA, 0 }, { keyZ, 1 } },
+                __LINE__);
+    
+    // With every usage included, the array yields one op per usage in its range, except for usage 0 ("no
+    // event indicated")
+    const ReportExtractor everything(descriptor, {}, true);
+    USBHID_CHECK_EQUAL(everything.getOps().size(), std::size_t(8 + 101));
+}
+
+
+//
+// Consumer control: an array field whose logical range (0-255) is far larger than its three declared
+// usages.  Only the declared usages get ops, and values beyond them select nothing.
+//
+const std::uint8_t consumerDescriptor[] = {
+    0x05, 0x0C,        // Usage Page (Consumer)
+    0x09, 0x01,        // Usage (Consumer Control)
+    0xA1, 0x01,        // Collection (Application)
+    0x15, 0x00,        //   Logical Minimum (0)
+    0x26, 0xFF, 0x00,  //   Logical Maximum (255)
+    0x09, 0xE9,        //   Usage (Volume Increment)
+    0x09, 0xEA,        //   Usage (Volume Decrement)
+    0x09, 0xE2,        //   Usage (Mute)
+    0x75, 0x08,        //   Report Size (8)
+    0x95, 0x01,        //   Report Count (1)
+    0x81, 0x00,        //   Input (Data, Array, Absolute)
+    0xC0               // End Collection
+};
+
+
+void testSparseArray() {
+    const ReportDescriptor descriptor(consumerDescriptor, sizeof(consumerDescriptor));
+    USBHID_CHECK_EQUAL(descriptor.getFields().size(), std::size_t(1));
+    if (descriptor.getFields().size() == 1) {
+        const ReportField &field = descriptor.getFields()[0];
+        USBHID_CHECK_EQUAL(field.getDeclaredUsageCount(), std::uint32_t(3));
+        USBHID_CHECK_EQUAL(field.usageAtIndex(3), std::uint32_t(0));
+    }
+    
+    const std::uint32_t volumeUp = ReportDescriptor::makeUsage(0x0C, 0xE9);
+    const std::uint32_t volumeDown = ReportDescriptor::makeUsage(0x0C, 0xEA);
+    const std::uint32_t mute = ReportDescriptor::makeUsage(0x0C, 0xE2);
+    
+    ReportDecoder decoder(descriptor, {}, true);
+    const std::vector<ExtractionOp> &ops = decoder.getExtractor().getOps();
+    USBHID_CHECK_EQUAL(ops.size(), std::size_t(3));
+    if (ops.size() == 3) {
+        checkArrayOp(ops[0], volumeUp, 0, 8, 1, 0);
+        checkArrayOp(ops[1], volumeDown, 0, 8, 1, 1);
+        checkArrayOp(ops[2], mute, 0, 8, 1, 2);
+        USBHID_CHECK_EQUAL(ops[0].target, ReportExtractor::noTarget);
+    }
+    
+    checkValues(decode(decoder, { 0x02 }), { { volumeUp, 0 }, { volumeDown, 0 }, { mute, 1 } }, __LINE__);
+    checkValues(decode(decoder, { 0xC8 }), { { mute, 0 } }, __LINE__);
+}
+
+
+//
+// Mouse that multiplexes two reports by report ID: relative X and Y in report 1, and three buttons in
+// report 2
+//
+const std::uint8_t multiplexedDescriptor[] = {
+    0x05, 0x01,        // Usage Page (Generic Desktop)
+    0x09, 0x02,        // Usage (Mouse)
+    0xA1, 0x01,        // Collection (Application)
+    0x85, 0x01,        //   Report ID (1)
+    0x09, 0x30,        //   Usage (X)
+    0x09, 0x31,        //   Usage (Y)
+    0x15, 0x81,        //   Logical Minimum (-127)
+    0x25, 0x7F,        //   Logical Maximum (127)
+    0x75, 0x08,        //   Report Size (8)
+    0x95, 0x02,        //   Report Count (2)
+    0x81, 0x06,        //   Input (Data, Variable, Relative)
+    0x85, 0x02,        //   Report ID (2)
+    0x05, 0x09,        //   Usage Page (Button)
+    0x19, 0x01,        //   Usage Minimum (1)
+    0x29, 0x03,        //   Usage Maximum (3)
+    0x15, 0x00,        //   Logical Minimum (0)
+    0x25, 0x01,        //   Logical Maximum (1)
+    0x75, 0x01,        //   Report Size (1)
+    0x95, 0x03,        //   Report Count (3)
+    0x81, 0x02,        //   Input (Data, Variable, Absolute)
+    0x95, 0x05,        //   Report Count (5)
+    0x81, 0x01,        //   Input (Constant)
+    0xC0               // End Collection
+};
+
+
+void testMultiplexed() {
+    const ReportDescriptor descriptor(multiplexedDescriptor, sizeof(multiplexedDescriptor));
+    USBHID_CHECK(descriptor.usesReportIDs());
+    USBHID_CHECK_EQUAL(descriptor.getMaxReportSize(ReportType::Input), std::size_t(3));
+    
+    const std::uint32_t x = ReportDescriptor::makeUsage(0x01, 0x30);
+    const std::uint32_t y = ReportDescriptor::makeUsage(0x01, 0x31);
+    const std::uint32_t button1 = ReportDescriptor::makeUsage(0x09, 1);
+    const std::uint32_t button2 = ReportDescriptor::makeUsage(0x09, 2);
+    const std::uint32_t button3 = ReportDescriptor::makeUsage(0x09, 3);
+    
+    // The targets are listed out of report order; ops are grouped by report ID regardless
+    ReportDecoder decoder(descriptor, { button1, button2, button3, x, y }, false);
+    USBHID_CHECK(decoder.getExtractor().usesReportIDs());
+    
+    const std::vector<ExtractionOp> &ops = decoder.getExtractor().getOps();
+    USBHID_CHECK_EQUAL(ops.size(), std::size_t(5));
+    if (ops.size() == 5) {
+        checkVariableOp(ops[0], x, 1, 0, 8, true);
+        checkVariableOp(ops[1], y, 1, 8, 8, true);
+        checkVariableOp(ops[2], button1, 2, 0, 1, false);
+        checkVariableOp(ops[3], button2, 2, 1, 1, false);
+        checkVariableOp(ops[4], button3, 2, 2, 1, false);
+        USBHID_CHECK_EQUAL(ops[0].target, std::size_t(3));
+    }
+    
+    // Each report yields only its own values
+    checkValues(decode(decoder, { 0x01, 0xFE, 0x05 }), { { x, -2 }, { y, 5 } }, __LINE__);
+    checkValues(decode(decoder, { 0x02, 0x05 }), { { button1, 1 }, { button2, 0 }, { button3, 1 } }, __LINE__);
+    checkValues(decode(decoder, { 0x01, 0xFE, 0x80 }), { { y, -128 } }, __LINE__);
+    
+    // Reports with an undeclared ID, or with no data at all, yield nothing
+    checkValues(decode(decoder, { 0x03, 0xFF }), DecodedValues(), __LINE__);
+    checkValues(decode(decoder, std::vector<std::uint8_t>()), DecodedValues(), __LINE__);
+}
+
+
+//
+// Vendor device with a 48-bit field (e.g. a timestamp) followed by a 16-bit one.  Values wider than 32
+// bits can't be decoded, so the wide field gets no op, but the field after it is still found at the
+// right offset.
+//
+const std::uint8_t wideFieldDescriptor[] = {
+    0x06, 0x00, 0xFF,              // Usage Page (Vendor Defined 0xFF00)
+    0x09, 0x01,                    // Usage (0x01)
+    0xA1, 0x01,                    // Collection (Application)
+    0x15, 0x00,                    //   Logical Minimum (0)
+    0x27, 0xFF, 0xFF, 0xFF, 0x7F,  //   Logical Maximum (2147483647)
+    0x09, 0x01,                    //   Usage (0x01)
+    0x75, 0x30,                    //   Report Size (48)
+    0x95, 0x01,                    //   Report Count (1)
+    0x81, 0x02,                    //   Input (Data, Variable, Absolute)
+    0x09, 0x02,                    //   Usage (0x02)
+    0x75, 0x10,                    //   Report Size (16)
+    0x81, 0x02,                    //   Input (Data, Variable, Absolute)
+    0xC0                           // End Collection
+};
+
+
+void testWideField() {
+    const ReportDescriptor descriptor(wideFieldDescriptor, sizeof(wideFieldDescriptor));
+    USBHID_CHECK_EQUAL(descriptor.getFields().size(), std::size_t(2));
+    USBHID_CHECK_EQUAL(descriptor.getMaxReportSize(ReportType::Input), std::size_t(8));
+    if (descriptor.getFields().size() == 2) {
+        USBHID_CHECK_EQUAL(descriptor.getFields()[0].bitSize, std::uint32_t(48));
+        USBHID_CHECK_EQUAL(descriptor.getFields()[1].bitOffset, std::uint32_t(48));
+    }
+    
+    const std::uint32_t wide = ReportDescriptor::makeUsage(0xFF00, 0x01);
+    const std::uint32_t narrow = ReportDescriptor::makeUsage(0xFF00, 0x02);
+    
+    ReportDecoder decoder(descriptor, { wide, narrow }, true);
+    USBHID_CHECK(!decoder.getExtractor().isTargetMatched(0));
+    USBHID_CHECK(decoder.getExtractor().isTargetMatched(1));
+    
+    const std::vector<ExtractionOp> &ops = decoder.getExtractor().getOps();
+    USBHID_CHECK_EQUAL(ops.size(), std::size_t(1));
+    if (ops.size() == 1) {
+        checkVariableOp(ops[0], narrow, 0, 48, 16, false);
+    }
+    
+    checkValues(decode(decoder, { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x34, 0x12 }), { { narrow, 0x1234 } }, __LINE__);
+}
+
+
+}  // namespace
+
+
+int main() {
+    testGamepad();
+    testKeyboard();
+    testSparseArray();
+    testMultiplexed();
+    testWideField();
+    return usbhid_test::exitStatus();
+}
@@ -0,0 +1,166 @@
+//
+//  test_shared_state.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  Checks the shared state region's sequence lock: one thread publishes updates in which every field of
+//  every entry is derived from the update number, while another reads snapshots as fast as it can.  Every
+//  snapshot the reader gets must come from a single update, and update counts must never go backwards.
+//
+
+#include <unistd.h>
+
+#include "BenchmarkSupport.h"
+#include "TestSupport.h"
+#include "USBHIDSharedState.h"
+
+using namespace mworks;
+using namespace mworks::usbhid;
+
+
+namespace {
+
+
+const std::size_t entryCount = 16;
+
+
+void setEntries(SharedStateWriter &writer, std::uint64_t update) {
+    for (std::size_t index = 0; index < entryCount; index++) {
+        writer.setValue(index,
+                        std::int64_t(update * entryCount + index),
+                        update * 1000 + index,
+                        std::int64_t(update) - std::int64_t(index));
+    }
+}
+
+
+void testLayout(const std::string &name) {
+    std::vector<SharedStateWriter::UsagePair> usages;
+    for (std::size_t index = 0; index < entryCount; index++) {
+        usages.push_back(SharedStateWriter::UsagePair(0x09, std::uint32_t(index + 1)));
+    }
+    SharedStateWriter writer(name, 0x01, 0x05, usages);
+    const SharedStateReader reader(name);
+    
+    USBHID_CHECK_EQUAL(reader.getUsagePage(), 0x01u);
+    USBHID_CHECK_EQUAL(reader.getUsage(), 0x05u);
+    USBHID_CHECK_EQUAL(reader.getEntryCount(), entryCount);
+    USBHID_CHECK_EQUAL(reader.findEntry(0x09, 3), 2u);
+    USBHID_CHECK(reader.findEntry(0x09, 100) == SharedStateReader::noEntry);
+    
+    std::vector<SharedStateReader::Value> values;
+    std::uint64_t updateCount = 1;
+    USBHID_CHECK(reader.read(values, updateCount));
+    USBHID_CHECK_EQUAL(updateCount, 0u);
+    USBHID_CHECK_EQUAL(values[2].value, 0);
+    
+    // An update in progress is invisible, and a reader gives up rather than see it
+    writer.beginUpdate();
+    setEntries(writer, 1);
+    USBHID_CHECK(!reader.read(values, updateCount, 10));
+    writer.endUpdate();
+    
+    USBHID_CHECK(reader.read(values, updateCount));
+    USBHID_CHECK_EQUAL(updateCount, 1u);
+    USBHID_CHECK_EQUAL(values[2].usage, 3u);
+    USBHID_CHECK_EQUAL(values[2].value, std::int64_t(entryCount + 2));
+    USBHID_CHECK_EQUAL(values[2].timestampNS, 1002u);
+    USBHID_CHECK_EQUAL(values[2].timeUS, -1);
+}
+
+
+void testTornReads(const std::string &name, double durationS) {
+    std::vector<SharedStateWriter::UsagePair> usages;
+    for (std::size_t index = 0; index < entryCount; index++) {
+        usages.push_back(SharedStateWriter::UsagePair(0x01, std::uint32_t(0x30 + index)));
+    }
+    SharedStateWriter writer(name, 0x01, 0x04, usages);
+    const SharedStateReader reader(name);
+    
+    std::atomic<bool> running(true);
+    std::uint64_t publishedCount = 0;
+    
+    boost::thread writerThread([&]() {
+        while (running.load(std::memory_order_relaxed)) {
+            writer.beginUpdate();
+            // The values of one report may arrive in several steps, and beginUpdate may be called repeatedly
+            setEntries(writer, publishedCount + 1);
+            writer.beginUpdate();
+            writer.endUpdate();
+            publishedCount++;
+        }
+    });
+    
+    const boost::shared_ptr<Clock> clock = Clock::instance();
+    const MWTime endTimeNS = clock->getSystemTimeNS() + MWTime(durationS * 1.0e9);
+    std::vector<SharedStateReader::Value> values;
+    std::uint64_t lastUpdateCount = 0, snapshotCount = 0, failedCount = 0, tornCount = 0, backwardsCount = 0;
+    std::uint64_t distinctCount = 0;
+    
+    while (clock->getSystemTimeNS() < endTimeNS) {
+        std::uint64_t updateCount;
+        if (!reader.read(values, updateCount)) {
+            failedCount++;
+            continue;
+        }
+        snapshotCount++;
+        
+        if (updateCount < lastUpdateCount) {
+            backwardsCount++;
+        } else if (updateCount > lastUpdateCount) {
+            distinctCount++;
+        }
+        lastUpdateCount = updateCount;
+        
+        // Every field of every entry must come from the update the sequence number says it does
+        for (std::size_t index = 0; index < entryCount; index++) {
+            const SharedStateReader::Value &value = values[index];
+            if (value.usage != 0x30 + index ||
+                (updateCount == 0 ?
+                 (value.value != 0 || value.timestampNS != 0 || value.timeUS != 0) :
+                 (value.value != std::int64_t(updateCount * entryCount + index) ||
+                  value.timestampNS != updateCount * 1000 + index ||
+                  value.timeUS != std::int64_t(updateCount) - std::int64_t(index))))
+            {
+                tornCount++;
+                break;
+            }
+        }
+    }
+    
+    running = false;
+    writerThread.join();
+    
+    std::printf("%llu updates published, %llu snapshots read (%llu distinct), %llu reads gave up\n",
+                static_cast<unsigned long long>(publishedCount),
+                static_cast<unsigned long long>(snapshotCount),
+                static_cast<unsigned long long>(distinctCount),
+                static_cast<unsigned long long>(failedCount));
+    
+    USBHID_CHECK(snapshotCount > 0);
+    USBHID_CHECK(distinctCount > 1);
+    USBHID_CHECK_EQUAL(tornCount, 0u);
+    USBHID_CHECK_EQUAL(backwardsCount, 0u);
+    USBHID_CHECK(lastUpdateCount <= publishedCount);
+}
+
+
+}  // namespace
+
+
+int main(int argc, char *argv[]) {
+    usbhid_test::BenchmarkOptions options("Checks the shared state sequence lock for torn reads", argc, argv);
+    options.declare("duration", "2", "seconds to read while the writer publishes updates");
+    if (!options.parse()) {
+        return 2;
+    }
+    
+    const std::string name = "/usbhid_test_shared_state_" + std::to_string(getpid());
+    
+    testLayout(name);
+    testTornReads(name, options.getDouble("duration"));
+    
+    return usbhid_test::exitStatus();
+}
@@ -0,0 +1,158 @@
+//
+//  test_start_stop_latency.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  Starts and stops I/O repeatedly, as an experiment that starts and stops its devices every trial does,
+//  and measures how long startIO and stopIO take.  Each I/O thread is given time to block on its event source
+//  before it's stopped, so stopIO has to wake it.  The run fails if the median of either exceeds the limit
+//  (1 ms by default) or if any single stop takes longer than a blocking wait with a timeout would.
+//
+//  Covers the hidraw backend (with no device attached, so its I/O thread waits on epoll for reattachment
+//  or a stop), the poll thread, and the synthetic backend (at one report per second, so that its thread is
+//  always mid-wait).  The IOKit backend's run loop can't be exercised here.
+//
+
+#include "BenchmarkSupport.h"
+#include "TestSupport.h"
+#include "USBHIDHidrawBackend.h"
+#include "USBHIDInputPoller.h"
+#include "USBHIDSyntheticBackend.h"
+
+using namespace mworks;
+
+
+namespace {
+
+
+class NullDelegate : public USBHIDBackend::Delegate {
+public:
+    void handleInputValue(const USBHIDBackend::InputValue &value) override { }
+};
+
+
+struct Latencies {
+    USBHIDLatencyHistogram start;
+    USBHIDLatencyHistogram stop;
+};
+
+
+// Calls start and stop cycleCount times, waiting idleUS between them
+template <typename Start, typename Stop>
+bool measure(Start &&start, Stop &&stop, long cycleCount, long idleUS, Latencies &latencies) {
+    const boost::shared_ptr<Clock> clock = Clock::instance();
+    
+    for (long cycle = 0; cycle < cycleCount; cycle++) {
+        MWTime startTimeNS = clock->getSystemTimeNS();
+        if (!start()) {
+            return false;
+        }
+        latencies.start.record(clock->getSystemTimeNS() - startTimeNS);
+        
+        boost::this_thread::sleep_for(boost::chrono::microseconds(idleUS));
+        
+        startTimeNS = clock->getSystemTimeNS();
+        if (!stop()) {
+            return false;
+        }
+        latencies.stop.record(clock->getSystemTimeNS() - startTimeNS);
+    }
+    
+    return true;
+}
+
+
+void checkLatencies(const char *name, const Latencies &latencies, std::uint64_t limitNS) {
+    std::printf("%s:\n", name);
+    usbhid_test::printLatency("  start", latencies.start);
+    usbhid_test::printLatency("  stop", latencies.stop);
+    
+    USBHID_CHECK(latencies.start.getQuantileNS(0.5) <= limitNS);
+    USBHID_CHECK(latencies.stop.getQuantileNS(0.5) <= limitNS);
+    
+    // Anything near this means stopIO waited out a timeout rather than waking the thread
+    USBHID_CHECK(latencies.stop.getMaxNS() < 100000000);
+}
+
+
+}  // namespace
+
+
+int main(int argc, char *argv[]) {
+    usbhid_test::BenchmarkOptions options("Measures I/O start and stop latency", argc, argv);
+    options.declare("cycles", "200", "number of start/stop cycles per component");
+    options.declare("idle-us", "2000", "time between each start and stop");
+    options.declare("limit-us", "1000", "maximum median start or stop latency");
+    if (!options.parse()) {
+        return 2;
+    }
+    const long cycleCount = options.getLong("cycles");
+    const long idleUS = options.getLong("idle-us");
+    const std::uint64_t limitNS = options.getLong("limit-us") * 1000;
+    
+    // The backends report statistics and a missing device every time they stop
+    setMessagesPrinted(false);
+    
+    NullDelegate delegate;
+    
+    {
+        USBHIDHidrawBackend backend("latency_test");
+        Latencies latencies;
+        USBHID_CHECK(measure([&]() { return backend.startIO(delegate); },
+                             [&]() { return backend.stopIO(); },
+                             cycleCount,
+                             idleUS,
+                             latencies));
+        checkLatencies("hidraw backend (no device)", latencies, limitNS);
+    }
+    
+    {
+        USBHIDInputPoller poller("latency_test",
+                                 std::vector<std::uint8_t>(1, 0),
+                                 8,
+                                 [](std::uint8_t reportID, std::uint8_t *buffer, std::size_t bufferSize) {
+                                     return bufferSize;
+                                 },
+                                 []() { });
+        Latencies latencies;
+        USBHID_CHECK(measure([&]() { return poller.start(USBHIDThreadPolicy()); },
+                             [&]() { poller.stop(); return true; },
+                             cycleCount,
+                             idleUS,
+                             latencies));
+        checkLatencies("poll thread", latencies, limitNS);
+    }
+    
+    {
+        USBHIDSyntheticBackend::Options syntheticOptions;
+        syntheticOptions.reportRate = 1.0;
+        syntheticOptions.valuesPerReport = 0;
+        syntheticOptions.distribution = USBHIDSyntheticBackend::Distribution::RandomWalk;
+        syntheticOptions.valueMin = 0;
+        syntheticOptions.valueMax = 1;
+        syntheticOptions.simulatedProfile = nullptr;
+        syntheticOptions.specializedDecoder = false;
+        
+        USBHIDSyntheticBackend backend("latency_test", syntheticOptions);
+        const USBHIDBackend::DeviceMatchingCriteria criteria = { 1, 4, 0 };
+        USBHID_CHECK(backend.openDevice(criteria));
+        USBHID_CHECK(backend.prepareInputs(std::vector<USBHIDBackend::UsagePair>(1, USBHIDBackend::UsagePair(9, 1)),
+                                           0,
+                                           false,
+                                           false));
+        
+        Latencies latencies;
+        USBHID_CHECK(measure([&]() { return backend.startIO(delegate); },
+                             [&]() { return backend.stopIO(); },
+                             cycleCount,
+                             idleUS,
+                             latencies));
+        checkLatencies("synthetic backend (1 report/s)", latencies, limitNS);
+    }
+    
+    setMessagesPrinted(true);
+    
+    return usbhid_test::exitStatus();
+}
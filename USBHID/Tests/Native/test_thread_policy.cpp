@@ -0,0 +1,175 @@
+//
+//  test_thread_policy.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  Checks USBHIDThreadPolicy's parameter parsing and validation, and applies policies to new threads,
+//  reading the results back through the POSIX scheduling APIs.  Real-time scheduling needs privileges that
+//  a test run may not have, so where it's refused, the test checks for the warning instead.
+//
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "TestSupport.h"
+#include "USBHIDThreadPolicy.h"
+
+using namespace mworks;
+
+
+namespace {
+
+
+template <typename Function>
+bool throwsSimpleException(Function &&function) {
+    try {
+        function();
+    } catch (const SimpleException &) {
+        return true;
+    }
+    return false;
+}
+
+
+void testParseCPUList() {
+    USBHID_CHECK(USBHIDThreadPolicy::parseCPUList("").empty());
+    USBHID_CHECK(USBHIDThreadPolicy::parseCPUList("3") == std::vector<int>({ 3 }));
+    USBHID_CHECK(USBHIDThreadPolicy::parseCPUList("2,4-6") == std::vector<int>({ 2, 4, 5, 6 }));
+    USBHID_CHECK(USBHIDThreadPolicy::parseCPUList("0-0,7") == std::vector<int>({ 0, 7 }));
+    USBHID_CHECK(USBHIDThreadPolicy::parseCPUList(std::to_string(CPU_SETSIZE - 1)) ==
+                 std::vector<int>({ CPU_SETSIZE - 1 }));
+    
+    for (const char *cpuList : { "a", "1,", ",1", "1,,2", "-1", "3-", "-", "5-2", "1.5", "2 ", "1-2-3" }) {
+        if (!throwsSimpleException([cpuList]() { USBHIDThreadPolicy::parseCPUList(cpuList); })) {
+            usbhid_test::fail(__FILE__, __LINE__, std::string("accepted CPU list \"") + cpuList + "\"");
+        }
+    }
+    USBHID_CHECK(throwsSimpleException([]() { USBHIDThreadPolicy::parseCPUList(std::to_string(CPU_SETSIZE)); }));
+}
+
+
+void testParseSchedulingClass() {
+    USBHID_CHECK(USBHIDThreadPolicy::parseSchedulingClass("default") == USBHIDThreadPolicy::SchedulingClass::Default);
+    USBHID_CHECK(USBHIDThreadPolicy::parseSchedulingClass("fifo") == USBHIDThreadPolicy::SchedulingClass::FIFO);
+    USBHID_CHECK(USBHIDThreadPolicy::parseSchedulingClass("round_robin") ==
+                 USBHIDThreadPolicy::SchedulingClass::RoundRobin);
+    USBHID_CHECK(throwsSimpleException([]() { USBHIDThreadPolicy::parseSchedulingClass("FIFO"); }));
+    USBHID_CHECK(throwsSimpleException([]() { USBHIDThreadPolicy::parseSchedulingClass(""); }));
+}
+
+
+void testValidatePriority() {
+    typedef USBHIDThreadPolicy::SchedulingClass SchedulingClass;
+    
+    // The default class ignores the priority
+    USBHID_CHECK(!throwsSimpleException([]() { USBHIDThreadPolicy::validatePriority(SchedulingClass::Default, -50); }));
+    
+    for (auto pair : { std::make_pair(SchedulingClass::FIFO, SCHED_FIFO),
+                       std::make_pair(SchedulingClass::RoundRobin, SCHED_RR) })
+    {
+        const SchedulingClass schedulingClass = pair.first;
+        const int minPriority = sched_get_priority_min(pair.second);
+        const int maxPriority = sched_get_priority_max(pair.second);
+        
+        USBHID_CHECK(!throwsSimpleException([=]() { USBHIDThreadPolicy::validatePriority(schedulingClass, minPriority); }));
+        USBHID_CHECK(!throwsSimpleException([=]() { USBHIDThreadPolicy::validatePriority(schedulingClass, maxPriority); }));
+        USBHID_CHECK(throwsSimpleException([=]() { USBHIDThreadPolicy::validatePriority(schedulingClass, minPriority - 1); }));
+        USBHID_CHECK(throwsSimpleException([=]() { USBHIDThreadPolicy::validatePriority(schedulingClass, maxPriority + 1); }));
+    }
+}
+
+
+struct AppliedSettings {
+    cpu_set_t cpuSet;
+    int policy;
+    int priority;
+    std::size_t warningCount;
+};
+
+
+// Applies the policy on a new thread and reads back the settings it ended up with
+AppliedSettings applyOnNewThread(const USBHIDThreadPolicy &policy) {
+    AppliedSettings settings;
+    boost::thread thread([&policy, &settings]() {
+        const std::size_t initialWarningCount = getMessageCount(MessageType::Warning);
+        policy.applyToCurrentThread("thread_policy_test", "test");
+        settings.warningCount = getMessageCount(MessageType::Warning) - initialWarningCount;
+        
+        CPU_ZERO(&settings.cpuSet);
+        (void)pthread_getaffinity_np(pthread_self(), sizeof(settings.cpuSet), &settings.cpuSet);
+        
+        struct sched_param param;
+        (void)pthread_getschedparam(pthread_self(), &settings.policy, &param);
+        settings.priority = param.sched_priority;
+        
+        // For a thread, sched_getscheduler(0) reports the same policy
+        USBHID_CHECK_EQUAL(sched_getscheduler(0), settings.policy);
+    });
+    thread.join();
+    return settings;
+}
+
+
+void testApplyAffinity() {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    USBHID_CHECK_EQUAL(pthread_getaffinity_np(pthread_self(), sizeof(allowed), &allowed), 0);
+    
+    int allowedCPU = 0;
+    while (allowedCPU < CPU_SETSIZE && !CPU_ISSET(allowedCPU, &allowed)) {
+        allowedCPU++;
+    }
+    USBHID_CHECK(allowedCPU < CPU_SETSIZE);
+    
+    const AppliedSettings settings = applyOnNewThread(USBHIDThreadPolicy(USBHIDThreadPolicy::SchedulingClass::Default,
+                                                                         0,
+                                                                         std::vector<int>(1, allowedCPU)));
+    USBHID_CHECK_EQUAL(settings.warningCount, 0u);
+    USBHID_CHECK_EQUAL(CPU_COUNT(&settings.cpuSet), 1);
+    USBHID_CHECK(CPU_ISSET(allowedCPU, &settings.cpuSet));
+    USBHID_CHECK_EQUAL(settings.policy, SCHED_OTHER);
+    
+    // A CPU that doesn't exist is reported, and the thread keeps its inherited affinity
+    const AppliedSettings unavailable = applyOnNewThread(USBHIDThreadPolicy(USBHIDThreadPolicy::SchedulingClass::Default,
+                                                                            0,
+                                                                            std::vector<int>(1, CPU_SETSIZE - 1)));
+    USBHID_CHECK_EQUAL(unavailable.warningCount, 1u);
+    USBHID_CHECK(CPU_EQUAL(&unavailable.cpuSet, &allowed));
+}
+
+
+void testApplySchedulingClass() {
+    const int priority = sched_get_priority_min(SCHED_FIFO);
+    const AppliedSettings settings = applyOnNewThread(USBHIDThreadPolicy(USBHIDThreadPolicy::SchedulingClass::FIFO,
+                                                                         priority,
+                                                                         std::vector<int>()));
+    if (settings.warningCount == 0) {
+        USBHID_CHECK_EQUAL(settings.policy, SCHED_FIFO);
+        USBHID_CHECK_EQUAL(settings.priority, priority);
+    } else {
+        // Not permitted here, so the thread must have kept its default policy
+        std::printf("SCHED_FIFO not permitted; checked the fallback only\n");
+        USBHID_CHECK_EQUAL(settings.warningCount, 1u);
+        USBHID_CHECK_EQUAL(settings.policy, SCHED_OTHER);
+    }
+}
+
+
+}  // namespace
+
+
+int main() {
+    testParseCPUList();
+    testParseSchedulingClass();
+    testValidatePriority();
+    
+    // applyToCurrentThread reports the resulting settings each time
+    setMessagesPrinted(false);
+    testApplyAffinity();
+    testApplySchedulingClass();
+    setMessagesPrinted(true);
+    
+    return usbhid_test::exitStatus();
+}
@@ -0,0 +1,59 @@
+//
+//  USBHIDAxisScaler.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDAxisScaler.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+USBHIDAxisScaler::USBHIDAxisScaler() :
+    active(false),
+    rawMin(0.0),
+    rawMax(0.0),
+    rawCenter(0.0),
+    scaledCenter(0.0),
+    lowerSlope(0.0),
+    upperSlope(0.0),
+    invert(false)
+{ }
+
+
+USBHIDAxisScaler::USBHIDAxisScaler(double rawMin,
+                                   double rawMax,
+                                   double rawCenter,
+                                   double scaledMin,
+                                   double scaledMax,
+                                   bool invert) :
+    active(true),
+    rawMin(rawMin),
+    rawMax(rawMax),
+    rawCenter(rawCenter),
+    scaledCenter((scaledMin + scaledMax) / 2.0),
+    lowerSlope(0.0),
+    upperSlope(0.0),
+    invert(invert)
+{
+    if (!(rawMin < rawMax)) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid raw range for USBHID channel scaling");
+    }
+    if (rawCenter < rawMin || rawCenter > rawMax) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Raw center for USBHID channel scaling is outside the raw range");
+    }
+    
+    // A center at either end of the raw range leaves only one side to scale
+    if (rawCenter > rawMin) {
+        lowerSlope = (scaledCenter - scaledMin) / (rawCenter - rawMin);
+    }
+    if (rawMax > rawCenter) {
+        upperSlope = (scaledMax - scaledCenter) / (rawMax - rawCenter);
+    }
+}
+
+
+END_NAMESPACE_MW
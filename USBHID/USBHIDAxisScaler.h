@@ -0,0 +1,62 @@
+//
+//  USBHIDAxisScaler.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDAxisScaler__
+#define __USBHID__USBHIDAxisScaler__
+
+#include <algorithm>
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Converts raw integer values from an axis to calibrated floating-point values.  The raw range is clamped
+// and mapped linearly onto the scaled range, except that the raw center maps to the middle of the scaled
+// range, with each side scaled separately.  This compensates for axes whose rest position isn't the
+// midpoint of their logical range.  If inverted, the scaled result is mirrored about the middle.
+//
+class USBHIDAxisScaler {
+    
+public:
+    // The default scaler is inactive and mustn't be used
+    USBHIDAxisScaler();
+    
+    // Throws if the raw range is empty or the center lies outside it
+    USBHIDAxisScaler(double rawMin, double rawMax, double rawCenter, double scaledMin, double scaledMax, bool invert);
+    
+    bool isActive() const { return active; }
+    
+    double scale(long rawValue) const {
+        const double value = std::min(std::max(double(rawValue), rawMin), rawMax);
+        double result;
+        if (value < rawCenter) {
+            result = scaledCenter + (value - rawCenter) * lowerSlope;
+        } else {
+            result = scaledCenter + (value - rawCenter) * upperSlope;
+        }
+        return (invert ? (2.0 * scaledCenter - result) : result);
+    }
+    
+private:
+    bool active;
+    double rawMin;
+    double rawMax;
+    double rawCenter;
+    double scaledCenter;
+    double lowerSlope;
+    double upperSlope;
+    bool invert;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDAxisScaler__)
@@ -0,0 +1,80 @@
+//
+//  USBHIDBackend.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDBackend.h"
+
+#include "USBHIDHidrawBackend.h"
+#include "USBHIDIOKitBackend.h"
+#include "USBHIDReportDecoder.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+const std::size_t USBHIDBackend::noChannel;
+
+
+std::unique_ptr<USBHIDBackend> USBHIDBackend::create(const std::string &deviceTag, bool sharedIO) {
+#if defined(__APPLE__)
+    return std::unique_ptr<USBHIDBackend>(new USBHIDIOKitBackend(deviceTag, sharedIO));
+#elif defined(__linux__)
+    // Each hidraw backend opens only its own node, so there's no bus-wide enumeration to share
+    return std::unique_ptr<USBHIDBackend>(new USBHIDHidrawBackend(deviceTag));
+#else
+#   error "No USBHID backend for this platform"
+#endif
+}
+
+
+bool USBHIDBackend::prepareOutputs(const std::vector<OutputElement> &outputElements) {
+    if (!outputElements.empty()) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN, "HID device \"%s\" does not support output channels", deviceTag.c_str());
+        return false;
+    }
+    return true;
+}
+
+
+bool USBHIDBackend::preparePolling() {
+    merror(M_IODEVICE_MESSAGE_DOMAIN, "HID device \"%s\" does not support polling", deviceTag.c_str());
+    return false;
+}
+
+
+bool USBHIDBackend::pollInputs(Delegate &delegate, std::uint64_t sampleTimeNS) {
+    return false;
+}
+
+
+bool USBHIDBackend::writeOutputs(const std::vector<OutputValue> &values, std::size_t &transferCount) {
+    transferCount = 0;
+    return values.empty();
+}
+
+
+void USBHIDBackend::selectDeviceProfile(usbhid::ReportDecoder &decoder) const {
+    const DeviceInfo info = getDeviceInfo();
+    const usbhid::DeviceProfile *profile = usbhid::findDeviceProfile(info.vendorID, info.productID);
+    if (!profile) {
+        return;
+    }
+    
+    if (decoder.useProfile(*profile)) {
+        mprintf("HID device \"%s\" is using the specialized report decoder for profile \"%s\"",
+                deviceTag.c_str(),
+                profile->name);
+    } else {
+        mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                 "Report layout of HID device \"%s\" doesn't match profile \"%s\"; using the generic report decoder",
+                 deviceTag.c_str(),
+                 profile->name);
+    }
+}
+
+
+END_NAMESPACE_MW
@@ -0,0 +1,170 @@
+//
+//  USBHIDBackend.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDBackend__
+#define __USBHID__USBHIDBackend__
+
+#include <limits>
+#include <memory>
+
+#include "USBHIDThreadPolicy.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+namespace usbhid {
+    class ReportDecoder;
+}
+
+
+//
+// Platform-specific HID device I/O.  A backend finds the device that matches a USBHIDDevice's usage page,
+// usage, and preferred location ID, locates the elements for its channels, and delivers input values to a
+// delegate on its own I/O thread.
+//
+class USBHIDBackend : boost::noncopyable {
+    
+public:
+    typedef std::pair<long, long> UsagePair;
+    
+    static const std::size_t noChannel = std::numeric_limits<std::size_t>::max();
+    
+    struct DeviceMatchingCriteria {
+        long usagePage;
+        long usage;
+        std::uint32_t preferredLocationID;
+    };
+    
+    struct DeviceInfo {
+        std::uint32_t vendorID;
+        std::uint32_t productID;
+        std::uint32_t versionNumber;  // Zero if unknown
+        std::uint32_t locationID;
+        std::string product;
+    };
+    
+    struct InputValue {
+        std::size_t channelIndex;   // Index into the usages passed to prepareInputs, or noChannel
+        std::uint32_t usagePage;
+        std::uint32_t usage;
+        long integerValue;
+        std::uint64_t timestampNS;  // Host time, on the same time base as Clock::getSystemTimeNS
+    };
+    
+    struct OutputElement {
+        long usagePage;
+        long usage;
+        bool feature;  // In a feature report, rather than an output report
+    };
+    
+    struct OutputValue {
+        std::size_t outputIndex;  // Index into the elements passed to prepareOutputs
+        long integerValue;
+    };
+    
+    class Delegate {
+    public:
+        virtual ~Delegate() { }
+        virtual void handleInputValue(const InputValue &value) = 0;
+        virtual void handleWakeup(std::uint64_t currentTimeNS) { }
+        
+        // Called after all the values from one input report (or, where the platform doesn't expose report
+        // boundaries, from one batch of input) have been passed to handleInputValue
+        virtual void handleFrameEnd() { }
+        
+        // Bracket the values delivered by one poll (see pollInputs).  success is false if any of the poll's
+        // report requests failed.
+        virtual void handlePollBegin() { }
+        virtual void handlePollEnd(bool success) { }
+        
+        // Called if the device is removed while I/O is running, and again when an equivalent device is
+        // attached in its place.  gapNS is the time during which no device was attached.
+        virtual void handleDeviceRemoved() { }
+        virtual void handleDeviceReattached(std::uint64_t gapNS) { }
+    };
+    
+    // Returns the backend for the current platform.  If sharedIO is true and the platform supports it, the
+    // backend shares its device enumeration and I/O thread with all other such backends.
+    static std::unique_ptr<USBHIDBackend> create(const std::string &deviceTag, bool sharedIO);
+    
+    virtual ~USBHIDBackend() { }
+    
+    // Each of the following methods reports its own errors and returns false on failure
+    
+    virtual bool openDevice(const DeviceMatchingCriteria &criteria) = 0;
+    
+    // Describes the device selected by openDevice.  Fields the platform doesn't provide are zero or empty.
+    virtual DeviceInfo getDeviceInfo() const = 0;
+    
+    // Only the first requiredChannelCount usages must be present on the device.  A later usage that the
+    // device lacks is not an error; its channel simply never receives values.  If deliverAllValues is true,
+    // values for usages not in channelUsages are also delivered, with channelIndex set to noChannel.  If
+    // rawReports is true, values are decoded from whole input reports.
+    virtual bool prepareInputs(const std::vector<UsagePair> &channelUsages,
+                               std::size_t requiredChannelCount,
+                               bool deliverAllValues,
+                               bool rawReports) = 0;
+    
+    // Delivers the current value of every channel's element, synchronously on the calling thread
+    virtual bool readInitialValues(Delegate &delegate) = 0;
+    
+    // Locates the report fields for output channels.  The default implementation supports no outputs.
+    virtual bool prepareOutputs(const std::vector<OutputElement> &outputElements);
+    
+    virtual bool startIO(Delegate &delegate) = 0;
+    virtual bool stopIO() = 0;
+    virtual bool isRunning() const = 0;
+    
+    // Requests a call to the delegate's handleWakeup, on the I/O thread, at (or shortly after) the given
+    // host time.  Must be called from within a delegate callback, or between readInitialValues and startIO.
+    // If a wakeup is already pending, the earlier of the two times is kept.
+    virtual void requestWakeup(std::uint64_t timeNS) = 0;
+    
+    // Prepares for pollInputs.  Must be called after prepareInputs.  The default implementation reports
+    // that the device can't be polled.
+    virtual bool preparePolling();
+    
+    // Starts a poll, which requests the current contents of every input report that carries a channel's
+    // value, with one request per report.  The requests block until the device responds, so they're made on
+    // a thread of the backend's own, and this method returns without waiting for them.  Once they complete,
+    // the I/O thread calls handlePollBegin, delivers the values that changed since they were last seen, all
+    // time stamped with sampleTimeNS, and then calls handlePollEnd.  Must be called from within a delegate
+    // callback.  Returns false, without starting a poll, if the previous poll hasn't been delivered yet or
+    // the device is detached.  Like writeOutputs, it doesn't report errors itself; instead, handlePollEnd
+    // indicates whether every request succeeded.
+    virtual bool pollInputs(Delegate &delegate, std::uint64_t sampleTimeNS);
+    
+    // Sends the given values to the device, combining all the values that belong to the same report into a
+    // single transfer.  Fields that aren't in values keep the values sent previously.  May block until the
+    // transfers complete, so it must not be called on the I/O thread.  Unlike the methods above, it doesn't
+    // report errors itself (so that a disconnected device doesn't produce a message for every write), but
+    // returns false if any transfer failed.  transferCount receives the number of reports sent.
+    virtual bool writeOutputs(const std::vector<OutputValue> &values, std::size_t &transferCount);
+    
+    // Sets the scheduling policy that the I/O thread (and, when polling, the poll thread) applies to itself
+    // when it starts.  Must be called before startIO.
+    void setIOThreadPolicy(const USBHIDThreadPolicy &policy) { ioThreadPolicy = policy; }
+    
+protected:
+    explicit USBHIDBackend(const std::string &deviceTag) : deviceTag(deviceTag) { }
+    
+    // If the opened device has a registered profile whose layout matches the decoder's ops, switches the
+    // decoder to the profile's specialized extraction.  Otherwise, the decoder is left unchanged.
+    void selectDeviceProfile(usbhid::ReportDecoder &decoder) const;
+    
+    const std::string deviceTag;
+    USBHIDThreadPolicy ioThreadPolicy;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDBackend__)
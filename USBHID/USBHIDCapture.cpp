@@ -0,0 +1,199 @@
+//
+//  USBHIDCapture.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDCapture.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace mworks {
+namespace usbhid {
+
+
+const char captureMagic[8] = { 'M', 'W', 'H', 'I', 'D', 'C', 'A', 'P' };
+
+
+CaptureHeader makeCaptureHeader() {
+    CaptureHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, captureMagic, sizeof(header.magic));
+    header.formatVersion = captureFormatVersion;
+    header.headerSize = sizeof(CaptureHeader);
+    header.recordSize = sizeof(CaptureRecord);
+    return header;
+}
+
+
+CaptureWriter::CaptureWriter(const std::string &path, const CaptureHeader &header, std::size_t bufferedRecords) :
+    path(path),
+    bufferedRecords(std::max<std::size_t>(bufferedRecords, 1)),
+    file(std::fopen(path.c_str(), "wb")),
+    handedOffCount(0),
+    writing(false),
+    stopping(false),
+    failed(false)
+{
+    if (!file) {
+        throw CaptureError("Unable to create capture file \"" + path + "\": " + std::strerror(errno));
+    }
+    
+    if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+        const std::string message = std::strerror(errno);
+        std::fclose(file);
+        throw CaptureError("Unable to write capture file \"" + path + "\": " + message);
+    }
+    
+    // The two buffers are swapped on each hand-off, so neither allocates once both are reserved
+    buffer.reserve(this->bufferedRecords);
+    pendingBuffer.reserve(this->bufferedRecords);
+    
+    try {
+        writerThread = std::thread(&CaptureWriter::writerLoop, this);
+    } catch (const std::system_error &e) {
+        std::fclose(file);
+        throw CaptureError("Unable to start writer for capture file \"" + path + "\": " + e.what());
+    }
+}
+
+
+CaptureWriter::~CaptureWriter() {
+    (void)flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    writerThread.join();
+    std::fclose(file);
+}
+
+
+bool CaptureWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    
+    // Wait for the writer to take the previous buffer, hand it the rest, and wait for it to write them
+    condition.wait(lock, [this]() { return pendingBuffer.empty() && !writing; });
+    if (!buffer.empty()) {
+        handedOffCount += buffer.size();
+        pendingBuffer.swap(buffer);
+        condition.notify_all();
+        condition.wait(lock, [this]() { return pendingBuffer.empty() && !writing; });
+    }
+    
+    if (!failed && std::fflush(file) != 0) {
+        failed = true;
+    }
+    
+    return !failed;
+}
+
+
+void CaptureWriter::handOffBuffer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!pendingBuffer.empty() || writing) {
+            // The writer hasn't finished the previous buffer, so keep filling this one
+            return;
+        }
+        handedOffCount += buffer.size();
+        pendingBuffer.swap(buffer);
+    }
+    condition.notify_all();
+}
+
+
+void CaptureWriter::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    
+    while (true) {
+        condition.wait(lock, [this]() { return !pendingBuffer.empty() || stopping; });
+        if (pendingBuffer.empty()) {
+            // Stopping, and everything has been written
+            return;
+        }
+        
+        writing = true;
+        lock.unlock();
+        const bool success = (std::fwrite(pendingBuffer.data(), sizeof(CaptureRecord), pendingBuffer.size(), file) ==
+                              pendingBuffer.size());
+        lock.lock();
+        writing = false;
+        
+        if (!success) {
+            failed = true;
+        }
+        pendingBuffer.clear();
+        condition.notify_all();
+    }
+}
+
+
+CaptureReader::CaptureReader(const std::string &path) :
+    mappedData(nullptr),
+    mappedSize(0),
+    header(nullptr),
+    records(nullptr),
+    recordCount(0)
+{
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw CaptureError("Unable to open capture file \"" + path + "\": " + std::strerror(errno));
+    }
+    
+    struct stat fileInfo;
+    if (fstat(fd, &fileInfo) != 0) {
+        const std::string message = std::strerror(errno);
+        close(fd);
+        throw CaptureError("Unable to read capture file \"" + path + "\": " + message);
+    }
+    if (fileInfo.st_size < off_t(sizeof(CaptureHeader))) {
+        close(fd);
+        throw CaptureError("\"" + path + "\" is not a HID capture file");
+    }
+    
+    mappedSize = fileInfo.st_size;
+    mappedData = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    const int mapError = errno;
+    close(fd);
+    if (mappedData == MAP_FAILED) {
+        throw CaptureError("Unable to map capture file \"" + path + "\": " + std::strerror(mapError));
+    }
+    
+    header = static_cast<const CaptureHeader *>(mappedData);
+    if (std::memcmp(header->magic, captureMagic, sizeof(captureMagic)) != 0) {
+        munmap(mappedData, mappedSize);
+        throw CaptureError("\"" + path + "\" is not a HID capture file");
+    }
+    if (header->formatVersion != captureFormatVersion ||
+        header->headerSize != sizeof(CaptureHeader) ||
+        header->recordSize != sizeof(CaptureRecord))
+    {
+        munmap(mappedData, mappedSize);
+        throw CaptureError("HID capture file \"" + path + "\" has an unsupported format");
+    }
+    
+    // Ignore any partial record at the end of the file
+    records = reinterpret_cast<const CaptureRecord *>(static_cast<const char *>(mappedData) + sizeof(CaptureHeader));
+    recordCount = (mappedSize - sizeof(CaptureHeader)) / sizeof(CaptureRecord);
+}
+
+
+CaptureReader::~CaptureReader() {
+    munmap(mappedData, mappedSize);
+}
+
+
+}  // namespace usbhid
+}  // namespace mworks
@@ -0,0 +1,165 @@
+//
+//  USBHIDCapture.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  This file has no dependencies on IOKit or MWorksCore, so that it can be built and tested on any platform.
+//
+
+#ifndef __USBHID__USBHIDCapture__
+#define __USBHID__USBHIDCapture__
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+
+namespace mworks {
+namespace usbhid {
+
+
+//
+// A capture file consists of a CaptureHeader followed by any number of CaptureRecords, all in host byte
+// order.  Records are only ever appended, so a capture that was cut short (e.g. by a crash) is still valid
+// up to its last complete record, and the whole file can be memory mapped and read as an array.
+//
+
+struct CaptureHeader {
+    char magic[8];                // captureMagic
+    std::uint32_t formatVersion;  // captureFormatVersion
+    std::uint32_t headerSize;     // sizeof(CaptureHeader)
+    std::uint32_t recordSize;     // sizeof(CaptureRecord)
+    std::uint32_t usagePage;      // Device usage page and usage
+    std::uint32_t usage;
+    std::uint32_t vendorID;
+    std::uint32_t productID;
+    std::uint32_t versionNumber;
+    std::uint32_t locationID;
+    std::uint32_t reserved;
+    char product[80];             // NUL-terminated, possibly truncated
+};
+
+
+struct CaptureRecord {
+    std::uint64_t timestampNS;    // Host time at which the device delivered the value
+    std::uint16_t usagePage;
+    std::uint16_t usage;
+    std::int32_t value;
+};
+
+
+static_assert(sizeof(CaptureHeader) == 128, "Unexpected capture header size");
+static_assert(sizeof(CaptureRecord) == 16, "Unexpected capture record size");
+
+
+extern const char captureMagic[8];
+const std::uint32_t captureFormatVersion = 1;
+
+
+// Returns a header with the format fields filled in and all others zeroed
+CaptureHeader makeCaptureHeader();
+
+
+class CaptureError : public std::runtime_error {
+public:
+    explicit CaptureError(const std::string &what) : std::runtime_error(what) { }
+};
+
+
+//
+// Appends records to a new capture file.  Records are collected in memory, and each full buffer is handed to
+// a dedicated writer thread, so append never waits for the disk and is cheap enough to call from the I/O
+// thread.  If the writer is still busy with the previous buffer when the next one fills, the next one grows
+// (allocating) until the writer is free, so records are never dropped.
+//
+class CaptureWriter {
+    
+public:
+    // Throws CaptureError if the file can't be created or the writer thread can't be started
+    CaptureWriter(const std::string &path, const CaptureHeader &header, std::size_t bufferedRecords = 4096);
+    ~CaptureWriter();
+    
+    CaptureWriter(const CaptureWriter &) = delete;
+    CaptureWriter& operator=(const CaptureWriter &) = delete;
+    
+    void append(const CaptureRecord &record) {
+        buffer.push_back(record);
+        if (buffer.size() >= bufferedRecords) {
+            handOffBuffer();
+        }
+    }
+    
+    // Writes all buffered records to the file, waiting for the writer thread to finish.  Returns false if
+    // any write since the file was created has failed.
+    bool flush();
+    
+    const std::string & getPath() const { return path; }
+    std::uint64_t getRecordCount() const { return handedOffCount + buffer.size(); }
+    
+private:
+    void handOffBuffer();
+    void writerLoop();
+    
+    const std::string path;
+    const std::size_t bufferedRecords;
+    std::FILE *file;
+    
+    // Used only by the thread that calls append and flush
+    std::vector<CaptureRecord> buffer;
+    std::uint64_t handedOffCount;
+    
+    // Guarded by mutex.  The writer thread writes pendingBuffer without holding the mutex while writing is
+    // true.
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<CaptureRecord> pendingBuffer;
+    bool writing;
+    bool stopping;
+    bool failed;
+    
+    std::thread writerThread;
+    
+};
+
+
+//
+// Provides read-only access to a memory-mapped capture file
+//
+class CaptureReader {
+    
+public:
+    // Throws CaptureError if the file can't be mapped or isn't a valid capture
+    explicit CaptureReader(const std::string &path);
+    ~CaptureReader();
+    
+    CaptureReader(const CaptureReader &) = delete;
+    CaptureReader& operator=(const CaptureReader &) = delete;
+    
+    const CaptureHeader & getHeader() const { return *header; }
+    const CaptureRecord * getRecords() const { return records; }
+    std::size_t getRecordCount() const { return recordCount; }
+    
+private:
+    void *mappedData;
+    std::size_t mappedSize;
+    const CaptureHeader *header;
+    const CaptureRecord *records;
+    std::size_t recordCount;
+    
+};
+
+
+}  // namespace usbhid
+}  // namespace mworks
+
+
+#endif // !defined(__USBHID__USBHIDCapture__)
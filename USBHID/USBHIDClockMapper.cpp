@@ -0,0 +1,133 @@
+//
+//  USBHIDClockMapper.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDClockMapper.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+BEGIN_NAMESPACE_MW
+
+
+namespace {
+    const std::uint64_t sampleIntervalNS = 100000000;  // 100ms
+    const double forgettingFactor = 0.99;              // Roughly the last 100 samples dominate the fit
+    
+    const std::int64_t staleLatencyNS = 100000000;     // 100ms
+    const std::int64_t futureToleranceNS = 1000000;    // 1ms
+    
+    // Drift is reported only once there are at least this many samples, spanning at least this many seconds
+    const std::uint64_t minDriftSamples = 20;
+    const double minDriftSpanS = 10.0;
+}
+
+
+USBHIDClockMapper::USBHIDClockMapper(MWTime systemBaseTimeNS) :
+    systemBaseTimeNS(systemBaseTimeNS)
+{
+    reset();
+}
+
+
+void USBHIDClockMapper::reset() {
+    lastTimestampNS = 0;
+    nextSampleTimestampNS = 0;
+    anchorTimestampNS = 0;
+    sumW = sumX = sumY = sumXX = sumXY = sumYY = 0.0;
+    firstX = lastX = 0.0;
+    sampleCount = 0;
+    nonMonotonicCount = 0;
+    staleCount = 0;
+    futureCount = 0;
+}
+
+
+void USBHIDClockMapper::addSample(std::uint64_t timestampNS, MWTime systemTimeNS) {
+    nextSampleTimestampNS = timestampNS + sampleIntervalNS;
+    
+    const std::int64_t latencyNS = std::int64_t(systemTimeNS) - std::int64_t(timestampNS);
+    if (latencyNS > staleLatencyNS) {
+        staleCount++;
+        return;
+    }
+    if (latencyNS < -futureToleranceNS) {
+        futureCount++;
+        return;
+    }
+    
+    if (sampleCount == 0) {
+        anchorTimestampNS = timestampNS;
+    }
+    sampleCount++;
+    
+    const double x = double(std::int64_t(timestampNS - anchorTimestampNS)) / 1.0e9;
+    const double y = double(latencyNS);
+    
+    sumW = forgettingFactor * sumW + 1.0;
+    sumX = forgettingFactor * sumX + x;
+    sumY = forgettingFactor * sumY + y;
+    sumXX = forgettingFactor * sumXX + x * x;
+    sumXY = forgettingFactor * sumXY + x * y;
+    sumYY = forgettingFactor * sumYY + y * y;
+    
+    if (sampleCount == 1) {
+        firstX = x;
+    }
+    lastX = x;
+}
+
+
+double USBHIDClockMapper::getMeanLatencyNS() const {
+    double intercept, slope;
+    if (getFit(intercept, slope)) {
+        return intercept + slope * lastX;
+    }
+    return ((sumW > 0.0) ? (sumY / sumW) : 0.0);
+}
+
+
+double USBHIDClockMapper::getJitterNS() const {
+    double intercept, slope;
+    if (!getFit(intercept, slope)) {
+        return 0.0;
+    }
+    
+    // Weighted mean squared residual, expanded in terms of the running sums
+    const double residualSS = (sumYY
+                               - 2.0 * intercept * sumY
+                               - 2.0 * slope * sumXY
+                               + intercept * intercept * sumW
+                               + 2.0 * intercept * slope * sumX
+                               + slope * slope * sumXX);
+    return std::sqrt(std::max(residualSS / sumW, 0.0));
+}
+
+
+double USBHIDClockMapper::getDriftPPM() const {
+    double intercept, slope;
+    if ((sampleCount >= minDriftSamples) && (lastX - firstX >= minDriftSpanS) && getFit(intercept, slope)) {
+        return slope / 1000.0;
+    }
+    return 0.0;
+}
+
+
+bool USBHIDClockMapper::getFit(double &intercept, double &slope) const {
+    const double denominator = sumW * sumXX - sumX * sumX;
+    if ((sampleCount < 2) || !(denominator > 0.0)) {
+        return false;
+    }
+    
+    slope = (sumW * sumXY - sumX * sumY) / denominator;
+    intercept = (sumY - slope * sumX) / sumW;
+    return true;
+}
+
+
+END_NAMESPACE_MW
@@ -0,0 +1,91 @@
+//
+//  USBHIDClockMapper.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDClockMapper__
+#define __USBHID__USBHIDClockMapper__
+
+#include <cstdint>
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Converts backend time stamps (nanoseconds in the host clock domain) to MWorks time (microseconds since
+// the MWorks base time).  The base time is captured once at construction, so conversion needs no clock
+// calls.
+//
+// The caller periodically pairs a time stamp with the system time at which the value was received.  From
+// these samples, a running linear fit of receive latency against time stamp yields the mean latency, the
+// jitter about the fit, and the drift between the two clocks.  These are diagnostics only.  Backends
+// deliver time stamps in the host clock domain already, so over the fit's window of about 10 seconds, a
+// slope fitted to the latency jitter is mostly noise; applying it would shift time stamps and could reorder
+// them.  Conversion is therefore a fixed offset.  Time stamps that go backwards, or that are too old or in
+// the future when sampled, are counted and excluded from the fit.
+//
+// All methods except the diagnostic getters must be called from the I/O thread.  The getters may be called
+// after I/O stops.
+//
+class USBHIDClockMapper {
+    
+public:
+    explicit USBHIDClockMapper(MWTime systemBaseTimeNS);
+    
+    void reset();
+    
+    // Checks the ordering of a newly received time stamp.  Returns true if the caller should pass it to
+    // addSample.
+    bool checkTimestamp(std::uint64_t timestampNS) {
+        if (timestampNS < lastTimestampNS) {
+            nonMonotonicCount++;
+            return false;
+        }
+        lastTimestampNS = timestampNS;
+        return (timestampNS >= nextSampleTimestampNS);
+    }
+    
+    void addSample(std::uint64_t timestampNS, MWTime systemTimeNS);
+    
+    MWTime toMWorksTime(std::uint64_t timestampNS) const {
+        return (MWTime(timestampNS) - systemBaseTimeNS) / MWTime(1000);
+    }
+    
+    std::uint64_t getSampleCount() const { return sampleCount; }
+    double getMeanLatencyNS() const;
+    double getJitterNS() const;
+    double getDriftPPM() const;  // Zero until enough samples span a long enough interval
+    std::uint64_t getNonMonotonicCount() const { return nonMonotonicCount; }
+    std::uint64_t getStaleCount() const { return staleCount; }
+    std::uint64_t getFutureCount() const { return futureCount; }
+    
+private:
+    bool getFit(double &intercept, double &slope) const;
+    
+    const MWTime systemBaseTimeNS;
+    
+    std::uint64_t lastTimestampNS;
+    std::uint64_t nextSampleTimestampNS;
+    std::uint64_t anchorTimestampNS;  // Time stamp of the first accepted sample
+    
+    // Exponentially weighted sums for the fit, with x in seconds since the anchor and y in nanoseconds of
+    // latency
+    double sumW, sumX, sumY, sumXX, sumXY, sumYY;
+    double firstX, lastX;
+    
+    std::uint64_t sampleCount;
+    std::uint64_t nonMonotonicCount;
+    std::uint64_t staleCount;
+    std::uint64_t futureCount;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDClockMapper__)
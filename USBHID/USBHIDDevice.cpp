@@ -16,6 +16,32 @@ const std::string USBHIDDevice::USAGE_PAGE("usage_page");
 const std::string USBHIDDevice::USAGE("usage");
 const std::string USBHIDDevice::PREFERRED_LOCATION_ID("preferred_location_id");
 const std::string USBHIDDevice::LOG_ALL_INPUT_VALUES("log_all_input_values");
+const std::string USBHIDDevice::DISPATCH_QUEUE_SIZE("dispatch_queue_size");
+const std::string USBHIDDevice::DROPPED_EVENTS("dropped_events");
+const std::string USBHIDDevice::RAW_REPORTS("raw_reports");
+const std::string USBHIDDevice::CAPTURE_FILE("capture_file");
+const std::string USBHIDDevice::BATCH_REPORTS("batch_reports");
+const std::string USBHIDDevice::FRAME_NUMBER("frame_number");
+const std::string USBHIDDevice::MEASURE_LATENCY("measure_latency");
+const std::string USBHIDDevice::LATENCY_STATISTICS("latency_statistics");
+const std::string USBHIDDevice::SHARED_IO("shared_io");
+const std::string USBHIDDevice::MERGE_GROUP("merge_group");
+const std::string USBHIDDevice::MERGE_WINDOW("merge_window");
+const std::string USBHIDDevice::SHARED_MEMORY_NAME("shared_memory_name");
+const std::string USBHIDDevice::MAX_OUTPUT_LATENCY("max_output_latency");
+const std::string USBHIDDevice::POLL_INTERVAL("poll_interval");
+const std::string USBHIDDevice::THREAD_SCHEDULING("thread_scheduling");
+const std::string USBHIDDevice::THREAD_PRIORITY("thread_priority");
+const std::string USBHIDDevice::IO_THREAD_CPUS("io_thread_cpus");
+const std::string USBHIDDevice::DISPATCH_THREAD_CPUS("dispatch_thread_cpus");
+const std::string USBHIDDevice::MEASURE_WAKEUP_JITTER("measure_wakeup_jitter");
+
+
+namespace {
+    const std::size_t inputLoggerQueueSize = 4096;
+    const MWTime inputLoggerReportIntervalUS = 250000;
+    const std::uint64_t wakeupJitterProbeIntervalNS = 1000000;
+}
 
 
 void USBHIDDevice::describeComponent(ComponentInfo &info) {
@@ -27,16 +53,56 @@ void USBHIDDevice::describeComponent(ComponentInfo &info) {
     info.addParameter(USAGE);
     info.addParameter(PREFERRED_LOCATION_ID, "0");
     info.addParameter(LOG_ALL_INPUT_VALUES, "NO");
+    info.addParameter(DISPATCH_QUEUE_SIZE, "0");
+    info.addParameter(DROPPED_EVENTS, false);
+    info.addParameter(RAW_REPORTS, "NO");
+    info.addParameter(CAPTURE_FILE, false);
+    info.addParameter(BATCH_REPORTS, "NO");
+    info.addParameter(FRAME_NUMBER, false);
+    info.addParameter(MEASURE_LATENCY, "NO");
+    info.addParameter(LATENCY_STATISTICS, false);
+    info.addParameter(SHARED_IO, "NO");
+    info.addParameter(MERGE_GROUP, false);
+    info.addParameter(MERGE_WINDOW, "2ms");
+    info.addParameter(SHARED_MEMORY_NAME, false);
+    info.addParameter(MAX_OUTPUT_LATENCY, false);
+    info.addParameter(POLL_INTERVAL, "0");
+    info.addParameter(THREAD_SCHEDULING, "default");
+    info.addParameter(THREAD_PRIORITY, "0");
+    info.addParameter(IO_THREAD_CPUS, false);
+    info.addParameter(DISPATCH_THREAD_CPUS, false);
+    info.addParameter(MEASURE_WAKEUP_JITTER, "NO");
 }
 
 
 USBHIDDevice::USBHIDDevice(const ParameterValueMap &parameters) :
+    USBHIDDevice(parameters, &createPlatformBackend)
+{ }
+
+
+USBHIDDevice::USBHIDDevice(const ParameterValueMap &parameters, BackendFactory createBackend) :
     IODevice(parameters),
     usagePage(parameters[USAGE_PAGE]),
     usage(parameters[USAGE]),
     preferredLocationID(long(parameters[PREFERRED_LOCATION_ID])),
     logAllInputValues(parameters[LOG_ALL_INPUT_VALUES]),
-    hidManager(iohid::ManagerPtr::created(IOHIDManagerCreate(kCFAllocatorDefault, kIOHIDManagerOptionNone)))
+    rawReports(parameters[RAW_REPORTS]),
+    batchReports(parameters[BATCH_REPORTS]),
+    measureLatency(parameters[MEASURE_LATENCY]),
+    measureWakeupJitter(parameters[MEASURE_WAKEUP_JITTER]),
+    maxOutputLatency(0),
+    pollIntervalNS(0),
+    clock(Clock::instance()),
+    nextPollTimeNS(0),
+    pollStartTimeNS(0),
+    pollCount(0),
+    missedPollCount(0),
+    failedPollCount(0),
+    calibrateClockAfterPoll(false),
+    pendingWakeupTimeNS(0),
+    nextJitterProbeTimeNS(0),
+    ioStartTimeNS(0),
+    backend(createBackend(getTag(), parameters))
 {
     if (usagePage <= kHIDPage_Undefined) {
         throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid HID usage page");
@@ -44,11 +110,110 @@ USBHIDDevice::USBHIDDevice(const ParameterValueMap &parameters) :
     if (usage <= kHIDUsage_Undefined) {
         throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid HID usage");
     }
+    
+    const long dispatchQueueSize = parameters[DISPATCH_QUEUE_SIZE];
+    if (dispatchQueueSize < 0) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid dispatch queue size");
+    }
+    
+    USBHIDInputDispatcher::Options dispatcherOptions;
+    dispatcherOptions.dispatchQueueSize = dispatchQueueSize;
+    dispatcherOptions.mergeWindowUS = 0;
+    dispatcherOptions.batchReports = batchReports;
+    dispatcherOptions.measureLatency = measureLatency;
+    dispatcherOptions.inputLogger = nullptr;
+    
+    if (!(parameters[DROPPED_EVENTS].empty())) {
+        droppedEvents = VariablePtr(parameters[DROPPED_EVENTS]);
+    }
+    
+    if (!(parameters[MERGE_GROUP].empty())) {
+        if (dispatchQueueSize > 0) {
+            throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN,
+                                  "USBHID device cannot have both a dispatch queue and a merge group");
+        }
+        const MWTime mergeWindow(parameters[MERGE_WINDOW]);
+        if (mergeWindow < 0) {
+            throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid merge window");
+        }
+        dispatcherOptions.mergeGroup = parameters[MERGE_GROUP].str();
+        dispatcherOptions.mergeWindowUS = mergeWindow;
+    }
+    
+    if (!(parameters[FRAME_NUMBER].empty())) {
+        if (!batchReports) {
+            throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN,
+                                  "USBHID device can have a frame number variable only if report batching is enabled");
+        }
+        frameNumber = VariablePtr(parameters[FRAME_NUMBER]);
+    }
+    
+    if (!(parameters[LATENCY_STATISTICS].empty())) {
+        if (!measureLatency) {
+            throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN,
+                                  "USBHID device can have a latency statistics variable only if latency measurement is enabled");
+        }
+        latencyStatistics = VariablePtr(parameters[LATENCY_STATISTICS]);
+    }
+    
+    if (!(parameters[CAPTURE_FILE].empty())) {
+        captureFilePath = pathFromParameterValue(parameters[CAPTURE_FILE]).string();
+    }
+    
+    if (!(parameters[SHARED_MEMORY_NAME].empty())) {
+        sharedMemoryName = parameters[SHARED_MEMORY_NAME].str();
+        // POSIX requires a leading slash for portable names
+        if (sharedMemoryName.empty() || sharedMemoryName[0] != '/') {
+            sharedMemoryName.insert(0, "/");
+        }
+    }
+    
+    if (!(parameters[MAX_OUTPUT_LATENCY].empty())) {
+        maxOutputLatency = MWTime(parameters[MAX_OUTPUT_LATENCY]);
+        if (maxOutputLatency <= 0) {
+            throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid maximum output latency");
+        }
+    }
+    
+    const MWTime pollInterval(parameters[POLL_INTERVAL]);
+    if (pollInterval < 0) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid poll interval");
+    }
+    pollIntervalNS = std::uint64_t(pollInterval) * 1000;
+    
+    // Both threads share the scheduling class and priority, but each has its own CPUs
+    const USBHIDThreadPolicy::SchedulingClass schedulingClass =
+        USBHIDThreadPolicy::parseSchedulingClass(parameters[THREAD_SCHEDULING].str());
+    const int threadPriority = long(parameters[THREAD_PRIORITY]);
+    USBHIDThreadPolicy::validatePriority(schedulingClass, threadPriority);
+    
+    std::vector<int> ioThreadCPUs;
+    if (!(parameters[IO_THREAD_CPUS].empty())) {
+        ioThreadCPUs = USBHIDThreadPolicy::parseCPUList(parameters[IO_THREAD_CPUS].str());
+    }
+    backend->setIOThreadPolicy(USBHIDThreadPolicy(schedulingClass, threadPriority, ioThreadCPUs));
+    
+    std::vector<int> dispatchThreadCPUs;
+    if (!(parameters[DISPATCH_THREAD_CPUS].empty())) {
+        if (dispatchQueueSize == 0) {
+            throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN,
+                                  "USBHID device can have dispatch thread CPUs only if it has a dispatch queue");
+        }
+        dispatchThreadCPUs = USBHIDThreadPolicy::parseCPUList(parameters[DISPATCH_THREAD_CPUS].str());
+    }
+    dispatcherOptions.dispatchThreadPolicy = USBHIDThreadPolicy(schedulingClass, threadPriority, dispatchThreadCPUs);
+    
+    if (logAllInputValues) {
+        inputLogger.reset(new USBHIDInputLogger(getTag(), inputLoggerQueueSize, inputLoggerReportIntervalUS));
+        dispatcherOptions.inputLogger = inputLogger.get();
+    }
+    
+    inputDispatcher.reset(new USBHIDInputDispatcher(getTag(), *this, dispatcherOptions));
 }
 
 
 USBHIDDevice::~USBHIDDevice() {
-    (void)IOHIDManagerClose(hidManager.get(), kIOHIDOptionsTypeNone);
+    (void)stopDeviceIO();
 }
 
 
@@ -58,6 +223,12 @@ void USBHIDDevice::addChild(std::map<std::string, std::string> parameters,
 {
     boost::shared_ptr<USBHIDInputChannel> newInputChannel = boost::dynamic_pointer_cast<USBHIDInputChannel>(child);
     if (newInputChannel) {
+        BOOST_FOREACH(const boost::shared_ptr<USBHIDMultiUsageChannel> &multiUsageChannel, multiUsageChannels) {
+            if (multiUsageChannel->containsUsage(newInputChannel->getUsagePage(), newInputChannel->getUsage())) {
+                throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN,
+                                      "Cannot create more than one USBHID channel for a given usage page and usage");
+            }
+        }
         boost::shared_ptr<USBHIDInputChannel> &channel = inputChannels[std::make_pair(newInputChannel->getUsagePage(),
                                                                                       newInputChannel->getUsage())];
         if (channel) {
@@ -68,109 +239,117 @@ void USBHIDDevice::addChild(std::map<std::string, std::string> parameters,
         return;
     }
     
+    boost::shared_ptr<USBHIDMultiUsageChannel> newMultiUsageChannel = boost::dynamic_pointer_cast<USBHIDMultiUsageChannel>(child);
+    if (newMultiUsageChannel) {
+        for (std::size_t offset = 0; offset < newMultiUsageChannel->getUsageCount(); offset++) {
+            const UsagePair usagePair = newMultiUsageChannel->getUsage(offset);
+            bool duplicate = (inputChannels.find(usagePair) != inputChannels.end());
+            BOOST_FOREACH(const boost::shared_ptr<USBHIDMultiUsageChannel> &multiUsageChannel, multiUsageChannels) {
+                duplicate = duplicate || multiUsageChannel->containsUsage(usagePair.first, usagePair.second);
+            }
+            if (duplicate) {
+                throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN,
+                                      "Cannot create more than one USBHID channel for a given usage page and usage");
+            }
+        }
+        multiUsageChannels.push_back(newMultiUsageChannel);
+        return;
+    }
+    
+    boost::shared_ptr<USBHIDOutputChannel> newOutputChannel = boost::dynamic_pointer_cast<USBHIDOutputChannel>(child);
+    if (newOutputChannel) {
+        BOOST_FOREACH(const boost::shared_ptr<USBHIDOutputChannel> &outputChannel, outputChannels) {
+            if ((outputChannel->getUsagePage() == newOutputChannel->getUsagePage()) &&
+                (outputChannel->getUsage() == newOutputChannel->getUsage()) &&
+                (outputChannel->isFeature() == newOutputChannel->isFeature()))
+            {
+                throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN,
+                                      "Cannot create more than one USBHID output channel for a given usage page, usage, and report type");
+            }
+        }
+        outputChannels.push_back(newOutputChannel);
+        return;
+    }
+    
     throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid channel type for USBHID device");
 }
 
 
 bool USBHIDDevice::initialize() {
-    if (inputChannels.empty() && !logAllInputValues) {
+    if (inputChannels.empty() && multiUsageChannels.empty() && outputChannels.empty() && !logAllInputValues) {
         throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN,
                               "USBHID device must have at least one channel or have value logging enabled");
     }
     
-    cf::DictionaryPtr deviceMatchingDictionary = createMatchingDictionary(CFSTR(kIOHIDDeviceUsagePageKey),
-                                                                          usagePage,
-                                                                          CFSTR(kIOHIDDeviceUsageKey),
-                                                                          usage);
-    IOHIDManagerSetDeviceMatching(hidManager.get(), deviceMatchingDictionary.get());
-    
-    IOReturn status = IOHIDManagerOpen(hidManager.get(), kIOHIDOptionsTypeNone);
-    if (kIOReturnSuccess != status) {
-        merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to open HID manager (status = %d)", status);
+    const USBHIDBackend::DeviceMatchingCriteria criteria = { usagePage, usage, preferredLocationID };
+    if (!(backend->openDevice(criteria)) || !openCaptureFile()) {
         return false;
     }
     
-    cf::SetPtr matchingDevices = cf::SetPtr::owned(IOHIDManagerCopyDevices(hidManager.get()));
-    const CFIndex numMatchingDevices = (matchingDevices ? CFSetGetCount(matchingDevices.get()) : 0);
-    if (!matchingDevices || (numMatchingDevices < 1)) {
-        merror(M_IODEVICE_MESSAGE_DOMAIN, "No matching HID devices found");
-        return false;
+    std::vector<UsagePair> channelUsages;
+    std::vector<USBHIDInputDispatcher::Channel> dispatcherChannels;
+    channelsByIndex.clear();
+    
+    BOOST_FOREACH(const InputChannelMap::value_type &value, inputChannels) {
+        const USBHIDInputChannel &channel = *(value.second);
+        channelUsages.push_back(value.first);
+        channelsByIndex.push_back(&channel);
+        const USBHIDInputDispatcher::Channel dispatcherChannel = {
+            std::uint32_t(channel.getUsagePage()),
+            std::uint32_t(channel.getUsage()),
+            channel.getDeadband(),
+            channel.getSuppressDuplicates(),
+            channel.getMaxUpdateRate()
+        };
+        dispatcherChannels.push_back(dispatcherChannel);
     }
     
-    std::vector<IOHIDDeviceRef> devices(numMatchingDevices);
-    CFSetGetValues(matchingDevices.get(), (const void **)(devices.data()));
+    // Multi-usage channels follow, with one backend channel per usage.  Those that require all their usages
+    // come first, so that the backend can tell which usages are optional.  (The device needn't have every
+    // usage in a range, since keyboards, for example, rarely implement the whole keyboard page.)
+    std::stable_partition(multiUsageChannels.begin(),
+                          multiUsageChannels.end(),
+                          boost::bind(&USBHIDMultiUsageChannel::requiresAllUsages, _1));
+    std::size_t requiredChannelCount = channelUsages.size();
+    std::vector<std::size_t> multiUsageSizes;
     
-    if (numMatchingDevices == 1) {
-        
-        hidDevice = iohid::DevicePtr::borrowed(devices[0]);
-        
-        if (preferredLocationID) {
-            CFNumberRef locationID = static_cast<CFNumberRef>(IOHIDDeviceGetProperty(hidDevice.get(), CFSTR(kIOHIDLocationIDKey)));
-            if (locationID) {
-                std::uint32_t value;
-                CFNumberGetValue(locationID, kCFNumberSInt32Type, &value);
-                if (preferredLocationID != value) {
-                    mwarning(M_IODEVICE_MESSAGE_DOMAIN,
-                             "Location ID for HID device \"%s\" (%lu) does not match preferred location ID (%lu)",
-                             getTag().c_str(),
-                             static_cast<unsigned long>(value),
-                             static_cast<unsigned long>(preferredLocationID));
-                }
-            }
+    BOOST_FOREACH(const boost::shared_ptr<USBHIDMultiUsageChannel> &multiUsageChannel, multiUsageChannels) {
+        for (std::size_t offset = 0; offset < multiUsageChannel->getUsageCount(); offset++) {
+            channelUsages.push_back(multiUsageChannel->getUsage(offset));
         }
-        
-    } else {
-        
-        std::ostringstream oss;
-        
-        oss << "Found multiple matching HID devices for \"" << getTag() << "\":\n";
-        
-        for (CFIndex deviceNum = 0; deviceNum < numMatchingDevices; deviceNum++) {
-            oss << "\nDevice #" << std::dec << deviceNum + 1 << std::endl;
-            
-            IOHIDDeviceRef device = devices[deviceNum];
-            std::vector<char> stringBuffer(1024);
-            
-            CFStringRef product = static_cast<CFStringRef>(IOHIDDeviceGetProperty(device, CFSTR(kIOHIDProductKey)));
-            if (product) {
-                CFStringGetCString(product, stringBuffer.data(), stringBuffer.size(), kCFStringEncodingUTF8);
-                oss << "\tProduct:\t\t" << stringBuffer.data() << std::endl;
-            }
-            
-            CFStringRef manufacturer = static_cast<CFStringRef>(IOHIDDeviceGetProperty(device, CFSTR(kIOHIDManufacturerKey)));
-            if (manufacturer) {
-                CFStringGetCString(manufacturer, stringBuffer.data(), stringBuffer.size(), kCFStringEncodingUTF8);
-                oss << "\tManufacturer:\t" << stringBuffer.data() << std::endl;
-            }
-            
-            CFNumberRef locationID = static_cast<CFNumberRef>(IOHIDDeviceGetProperty(device, CFSTR(kIOHIDLocationIDKey)));
-            if (locationID) {
-                std::uint32_t value;
-                CFNumberGetValue(locationID, kCFNumberSInt32Type, &value);
-                
-                if (preferredLocationID == value) {
-                    hidDevice = iohid::DevicePtr::borrowed(device);
-                    break;
-                }
-                
-                oss << "\tLocation ID:\t" << std::dec << value << "\t(0x" << std::hex << value << ")" << std::endl;
-            }
+        if (multiUsageChannel->requiresAllUsages()) {
+            requiredChannelCount = channelUsages.size();
         }
-        
-        if (!hidDevice) {
-            oss << "\nPlease set the \"" << PREFERRED_LOCATION_ID
-                << "\" attribute to the Location ID of the desired device.\n";
-            merror(M_IODEVICE_MESSAGE_DOMAIN, "%s", oss.str().c_str());
-            return false;
-        }
-        
+        multiUsageSizes.push_back(multiUsageChannel->getUsageCount());
+    }
+    
+    if (!createSharedState(channelUsages)) {
+        return false;
     }
+    inputDispatcher->configure(dispatcherChannels, multiUsageSizes, captureWriter.get(), sharedStateWriter.get());
     
-    if (!prepareInputChannels()) {
+    if (!(backend->prepareInputs(channelUsages, requiredChannelCount, logAllInputValues, rawReports))) {
+        return false;
+    }
+    if (pollIntervalNS && !(backend->preparePolling())) {
         return false;
     }
     
-    IOHIDDeviceRegisterInputValueCallback(hidDevice.get(), &inputValueCallback, this);
+    std::vector<USBHIDBackend::OutputElement> outputElements;
+    BOOST_FOREACH(const boost::shared_ptr<USBHIDOutputChannel> &outputChannel, outputChannels) {
+        const USBHIDBackend::OutputElement element = {
+            outputChannel->getUsagePage(),
+            outputChannel->getUsage(),
+            outputChannel->isFeature()
+        };
+        outputElements.push_back(element);
+    }
+    if (!(backend->prepareOutputs(outputElements))) {
+        return false;
+    }
+    if (!outputChannels.empty()) {
+        outputWriter.reset(new USBHIDOutputWriter(getTag(), *backend, outputChannels.size(), maxOutputLatency));
+    }
     
     return true;
 }
@@ -178,25 +357,40 @@ bool USBHIDDevice::initialize() {
 
 bool USBHIDDevice::startDeviceIO() {
     if (!isRunning()) {
-        BOOST_FOREACH(const HIDElementMap::value_type &value, hidElements) {
-            IOHIDValueRef elementValue;
-            IOReturn status;
-            if (kIOReturnSuccess == (status = IOHIDDeviceGetValue(hidDevice.get(),
-                                                                  value.second.get(),
-                                                                  &elementValue)))
-            {
-                handleInputValue(elementValue);
-            } else {
-                merror(M_IODEVICE_MESSAGE_DOMAIN, "HID value get failed: %s", mach_error_string(status));
-                return false;
-            }
+        if (inputLogger && !(inputLogger->start())) {
+            return false;
         }
         
-        try {
-            runLoopThread = boost::thread(boost::bind(&USBHIDDevice::runLoop,
-                                                      component_shared_from_this<USBHIDDevice>()));
-        } catch (const boost::thread_resource_error &e) {
-            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start HID device: %s", e.what());
+        ioStartTimeNS = clock->getSystemTimeNS();
+        
+        // Initial values may carry time stamps from long before I/O started, so the dispatcher starts with
+        // clock calibration off, and it's turned on only once they've been read
+        if (!(inputDispatcher->start())) {
+            stopInputLogger();
+            return false;
+        }
+        
+        pendingWakeupTimeNS = 0;
+        if (!(backend->readInitialValues(*this))) {
+            inputDispatcher->stop();
+            stopInputLogger();
+            return false;
+        }
+        
+        startPolling();
+        startWakeupJitterProbe();
+        
+        inputDispatcher->setCalibratingClock(true);
+        if (!(backend->startIO(*this))) {
+            inputDispatcher->stop();
+            stopInputLogger();
+            return false;
+        }
+        
+        if (!startOutputs()) {
+            (void)backend->stopIO();
+            inputDispatcher->stop();
+            stopInputLogger();
             return false;
         }
     }
@@ -207,150 +401,369 @@ bool USBHIDDevice::startDeviceIO() {
 
 bool USBHIDDevice::stopDeviceIO() {
     if (isRunning()) {
-        runLoopThread.interrupt();
-        try {
-            runLoopThread.join();
-        } catch (const boost::system::system_error &e) {
-            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to stop HID device: %s", e.what());
+        // Stop accepting output values first, so that everything already requested is sent before the
+        // device stops
+        stopOutputs();
+        if (!(backend->stopIO())) {
             return false;
         }
+        inputDispatcher->stop();
+        stopInputLogger();
+        flushCaptureFile();
+        reportFilterCounts();
+        reportClockDiagnostics();
+        reportLatencyStatistics();
+        reportPollStatistics();
+        reportWakeupJitter();
     }
     
     return true;
 }
 
 
-cf::DictionaryPtr USBHIDDevice::createMatchingDictionary(CFStringRef usagePageKey,
-                                                         long usagePageValue,
-                                                         CFStringRef usageKey,
-                                                         long usageValue)
+std::unique_ptr<USBHIDBackend> USBHIDDevice::createPlatformBackend(const std::string &deviceTag,
+                                                                 const ParameterValueMap &parameters)
 {
-    cf::NumberPtr usagePage = cf::NumberPtr::created(CFNumberCreate(kCFAllocatorDefault,
-                                                                    kCFNumberLongType,
-                                                                    &usagePageValue));
-    
-    cf::NumberPtr usage = cf::NumberPtr::created(CFNumberCreate(kCFAllocatorDefault,
-                                                                kCFNumberLongType,
-                                                                &usageValue));
-    
-    const CFIndex numValues = 2;
-    const void *keys[numValues] = {usagePageKey, usageKey};
-    const void *values[numValues] = {usagePage.get(), usage.get()};
-    
-    return cf::DictionaryPtr::created(CFDictionaryCreate(kCFAllocatorDefault,
-                                                         keys,
-                                                         values,
-                                                         numValues,
-                                                         &kCFTypeDictionaryKeyCallBacks,
-                                                         &kCFTypeDictionaryValueCallBacks));
+    return USBHIDBackend::create(deviceTag, bool(parameters[SHARED_IO]));
 }
 
 
-void USBHIDDevice::inputValueCallback(void *context, IOReturn result, void *sender, IOHIDValueRef value) {
-    static_cast<USBHIDDevice *>(context)->handleInputValue(value);
+bool USBHIDDevice::startOutputs() {
+    if (outputWriter) {
+        if (!(outputWriter->start())) {
+            return false;
+        }
+        
+        for (std::size_t outputIndex = 0; outputIndex < outputChannels.size(); outputIndex++) {
+            const VariablePtr &value = outputChannels[outputIndex]->getValue();
+            
+            // Send the current value, so that the device matches the variable from the start
+            handleOutputValue(outputIndex, value->getValue());
+            
+            boost::shared_ptr<VariableCallbackNotification> notification(
+                new VariableCallbackNotification(boost::bind(&USBHIDDevice::handleOutputValue, this, outputIndex, _1)));
+            value->addNotification(notification);
+            outputNotifications.push_back(notification);
+        }
+    }
+    
+    return true;
 }
 
 
-bool USBHIDDevice::prepareInputChannels() {
-    std::vector<cf::DictionaryPtr> matchingDicts;
-    std::vector<const void *> matchingArrayItems;
+void USBHIDDevice::stopOutputs() {
+    BOOST_FOREACH(const boost::shared_ptr<VariableCallbackNotification> &notification, outputNotifications) {
+        notification->remove();
+    }
+    outputNotifications.clear();
     
-    BOOST_FOREACH(const InputChannelMap::value_type &value, inputChannels) {
-        const UsagePair &usagePair = value.first;
+    if (outputWriter) {
+        outputWriter->stop();
+    }
+}
+
+
+void USBHIDDevice::startWakeupJitterProbe() {
+    if (measureWakeupJitter) {
+        wakeupJitter.reset();
+        nextJitterProbeTimeNS = clock->getSystemTimeNS() + wakeupJitterProbeIntervalNS;
+        requestWakeup(nextJitterProbeTimeNS);
+    }
+}
+
+
+void USBHIDDevice::startPolling() {
+    if (pollIntervalNS) {
+        // Align the ticks to the MWorks clock, so that every sample falls on a multiple of the poll interval
+        // in MWorks time.  (Backend time stamps share the system clock's time base.)
+        const std::uint64_t baseTimeNS = clock->getSystemBaseTimeNS();
+        const std::uint64_t currentTimeNS = clock->getSystemTimeNS();
+        nextPollTimeNS = baseTimeNS + ((currentTimeNS - baseTimeNS) / pollIntervalNS + 1) * pollIntervalNS;
         
-        cf::DictionaryPtr dict = createMatchingDictionary(CFSTR(kIOHIDElementUsagePageKey),
-                                                          usagePair.first,
-                                                          CFSTR(kIOHIDElementUsageKey),
-                                                          usagePair.second);
-        matchingDicts.push_back(dict);
-        matchingArrayItems.push_back(dict.get());
+        pollStartTimeNS = nextPollTimeNS;
+        pollCount = 0;
+        missedPollCount = 0;
+        failedPollCount = 0;
+        pollJitter.reset();
         
-        cf::ArrayPtr matchingElements = cf::ArrayPtr::owned(IOHIDDeviceCopyMatchingElements(hidDevice.get(),
-                                                                                            dict.get(),
-                                                                                            kIOHIDOptionsTypeNone));
-        bool foundMatch = false;
+        requestWakeup(nextPollTimeNS);
+    }
+}
+
+
+void USBHIDDevice::poll(std::uint64_t currentTimeNS) {
+    pollJitter.record(std::int64_t(currentTimeNS) - std::int64_t(nextPollTimeNS));
+    
+    // Every value from a poll is stamped with the scheduled tick, so samples are evenly spaced regardless
+    // of wakeup jitter.  The backend makes the requests on its own thread and delivers the values later.
+    // If the previous poll is still waiting on the device (or the device is detached), the tick is skipped.
+    if (backend->pollInputs(*this, nextPollTimeNS)) {
+        pollCount++;
+    } else {
+        missedPollCount++;
+    }
+    
+    // If the wakeup came late enough to pass one or more ticks, skip them rather than polling repeatedly to
+    // catch up
+    nextPollTimeNS += pollIntervalNS;
+    if (currentTimeNS >= nextPollTimeNS) {
+        const std::uint64_t skippedCount = (currentTimeNS - nextPollTimeNS) / pollIntervalNS + 1;
+        missedPollCount += skippedCount;
+        nextPollTimeNS += skippedCount * pollIntervalNS;
+    }
+}
+
+
+void USBHIDDevice::handlePollBegin() {
+    // The values' time stamps say nothing about the device's clock, so they're excluded from clock
+    // calibration
+    calibrateClockAfterPoll = inputDispatcher->isCalibratingClock();
+    inputDispatcher->setCalibratingClock(false);
+}
+
+
+void USBHIDDevice::handlePollEnd(bool success) {
+    inputDispatcher->setCalibratingClock(calibrateClockAfterPoll);
+    if (!success) {
+        failedPollCount++;
+    }
+}
+
+
+void USBHIDDevice::stopInputLogger() {
+    if (inputLogger) {
+        inputLogger->stop();
+    }
+}
+
+
+bool USBHIDDevice::openCaptureFile() {
+    if (!captureFilePath.empty()) {
+        const USBHIDBackend::DeviceInfo info = backend->getDeviceInfo();
         
-        if (matchingElements) {
-            const CFIndex matchingElementCount = CFArrayGetCount(matchingElements.get());
-            
-            for (CFIndex index = 0; index < matchingElementCount; index++) {
-                IOHIDElementRef element = (IOHIDElementRef)CFArrayGetValueAtIndex(matchingElements.get(), index);
-                IOHIDElementType elementType = IOHIDElementGetType(element);
-                
-                if ((elementType != kIOHIDElementTypeFeature) && (elementType != kIOHIDElementTypeCollection)) {
-                    hidElements[usagePair] = iohid::ElementPtr::borrowed(element);
-                    foundMatch = true;
-                    break;
-                }
-            }
-        }
+        usbhid::CaptureHeader header = usbhid::makeCaptureHeader();
+        header.usagePage = usagePage;
+        header.usage = usage;
+        header.vendorID = info.vendorID;
+        header.productID = info.productID;
+        header.versionNumber = info.versionNumber;
+        header.locationID = info.locationID;
+        info.product.copy(header.product, sizeof(header.product) - 1);
         
-        if (!foundMatch) {
-            merror(M_IODEVICE_MESSAGE_DOMAIN,
-                   "No matching HID elements for usage page %ld, usage %ld",
-                   usagePair.first,
-                   usagePair.second);
+        try {
+            captureWriter.reset(new usbhid::CaptureWriter(captureFilePath, header));
+        } catch (const usbhid::CaptureError &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "%s", e.what());
             return false;
         }
     }
     
-    if (!logAllInputValues) {
-        cf::ArrayPtr inputValueMatchingArray = cf::ArrayPtr::created(CFArrayCreate(kCFAllocatorDefault,
-                                                                                   &(matchingArrayItems.front()),
-                                                                                   matchingArrayItems.size(),
-                                                                                   &kCFTypeArrayCallBacks));
+    return true;
+}
+
+
+bool USBHIDDevice::createSharedState(const std::vector<UsagePair> &channelUsages) {
+    if (!sharedMemoryName.empty()) {
+        // Entries are indexed by channel index, so that the I/O thread can update them without a lookup
+        std::vector<usbhid::SharedStateWriter::UsagePair> entryUsages;
+        BOOST_FOREACH(const UsagePair &usagePair, channelUsages) {
+            entryUsages.push_back(usbhid::SharedStateWriter::UsagePair(usagePair.first, usagePair.second));
+        }
         
-        IOHIDDeviceSetInputValueMatchingMultiple(hidDevice.get(), inputValueMatchingArray.get());
+        try {
+            sharedStateWriter.reset(new usbhid::SharedStateWriter(sharedMemoryName, usagePage, usage, entryUsages));
+        } catch (const usbhid::SharedStateError &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "%s", e.what());
+            return false;
+        }
     }
     
     return true;
 }
 
 
-void USBHIDDevice::runLoop() {
-    IOHIDManagerScheduleWithRunLoop(hidManager.get(), CFRunLoopGetCurrent(), kCFRunLoopDefaultMode);
+void USBHIDDevice::flushCaptureFile() {
+    // Make everything captured so far visible to readers.  The file stays open, so that values from any
+    // later run of the device are appended to it.
+    if (captureWriter && !(captureWriter->flush())) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN,
+               "Unable to write HID capture file \"%s\"",
+               captureWriter->getPath().c_str());
+    }
+}
+
+
+void USBHIDDevice::handleInputValue(const USBHIDBackend::InputValue &value) {
+    inputDispatcher->handleInputValue(value);
+}
+
+
+void USBHIDDevice::handleWakeup(std::uint64_t currentTimeNS) {
+    if (measureWakeupJitter && pendingWakeupTimeNS) {
+        wakeupJitter.record(std::int64_t(clock->getSystemTimeNS()) - std::int64_t(pendingWakeupTimeNS));
+    }
+    pendingWakeupTimeNS = 0;
     
-    BOOST_SCOPE_EXIT(&hidManager) {
-        IOHIDManagerUnscheduleFromRunLoop(hidManager.get(), CFRunLoopGetCurrent(), kCFRunLoopDefaultMode);
-    } BOOST_SCOPE_EXIT_END
+    if (pollIntervalNS && (currentTimeNS >= nextPollTimeNS)) {
+        poll(currentTimeNS);
+    }
     
-    while (true) {
-        // Run the CFRunLoop for 500ms
-        (void)CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.5, false);
-        
-        // Give another thread a chance to terminate this one
-        boost::this_thread::interruption_point();
+    inputDispatcher->handleWakeup(currentTimeNS);
+    
+    if (pollIntervalNS) {
+        requestWakeup(nextPollTimeNS);
+    }
+    if (measureWakeupJitter) {
+        if (currentTimeNS >= nextJitterProbeTimeNS) {
+            nextJitterProbeTimeNS = currentTimeNS + wakeupJitterProbeIntervalNS;
+        }
+        requestWakeup(nextJitterProbeTimeNS);
     }
 }
 
 
-void USBHIDDevice::handleInputValue(IOHIDValueRef value) {
-    IOHIDElementRef element = IOHIDValueGetElement(value);
-    const uint32_t elementUsagePage = IOHIDElementGetUsagePage(element);
-    const uint32_t elementUsage = IOHIDElementGetUsage(element);
-    const CFIndex integerValue = IOHIDValueGetIntegerValue(value);
+void USBHIDDevice::handleFrameEnd() {
+    inputDispatcher->handleFrameEnd();
+}
+
+
+void USBHIDDevice::handleDeviceRemoved() {
+    handleFrameEnd();
+    mwarning(M_IODEVICE_MESSAGE_DOMAIN, "HID device \"%s\" was disconnected; waiting for it to reconnect", getTag().c_str());
+}
+
+
+void USBHIDDevice::handleDeviceReattached(std::uint64_t gapNS) {
+    mprintf("HID device \"%s\" reconnected after %.1f ms", getTag().c_str(), double(gapNS) / 1.0e6);
+}
+
+
+void USBHIDDevice::reportFilterCounts() const {
+    for (std::size_t channelIndex = 0; channelIndex < inputDispatcher->getChannelCount(); channelIndex++) {
+        const USBHIDInputFilter &filter = inputDispatcher->getInputFilter(channelIndex);
+        if (filter.isActive()) {
+            mprintf("HID channel \"%s\" on device \"%s\" received %llu values and posted %llu",
+                    channelsByIndex[channelIndex]->getTag().c_str(),
+                    getTag().c_str(),
+                    static_cast<unsigned long long>(filter.getReceivedCount()),
+                    static_cast<unsigned long long>(filter.getPostedCount()));
+        }
+    }
+}
+
+
+void USBHIDDevice::reportClockDiagnostics() const {
+    const USBHIDClockMapper &clockMapper = inputDispatcher->getClockMapper();
     
-    const boost::shared_ptr<USBHIDInputChannel> &channel = inputChannels[std::make_pair(long(elementUsagePage),
-                                                                                        long(elementUsage))];
-    if (channel) {
-        // Convert OS absolute time stamp to nanoseconds, subtract MWorks base time, and convert to microseconds
-        MWTime valueTime = ((MWTime(AudioConvertHostTimeToNanos(IOHIDValueGetTimeStamp(value)))
-                                    - Clock::instance()->getSystemBaseTimeNS())
-                            / MWTime(1000));
-        
-        channel->postValue(integerValue, valueTime);
+    if (clockMapper.getSampleCount() > 0) {
+        mprintf("HID device \"%s\" time stamps: mean latency %.3f ms, jitter %.3f ms, clock drift %.1f ppm "
+                "(%llu samples)",
+                getTag().c_str(),
+                clockMapper.getMeanLatencyNS() / 1.0e6,
+                clockMapper.getJitterNS() / 1.0e6,
+                clockMapper.getDriftPPM(),
+                static_cast<unsigned long long>(clockMapper.getSampleCount()));
     }
     
-    if (logAllInputValues) {
-        mprintf("HID input on device \"%s\":\n"
-                "\tUsage page:\t%u\t(0x%02X)\n"
-                "\tUsage:\t\t%u\t(0x%02X)\n"
-                "\tValue:\t\t%ld",
+    if (clockMapper.getNonMonotonicCount() || clockMapper.getStaleCount() || clockMapper.getFutureCount()) {
+        mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                 "HID device \"%s\" delivered %llu out-of-order, %llu stale, and %llu future time stamps",
+                 getTag().c_str(),
+                 static_cast<unsigned long long>(clockMapper.getNonMonotonicCount()),
+                 static_cast<unsigned long long>(clockMapper.getStaleCount()),
+                 static_cast<unsigned long long>(clockMapper.getFutureCount()));
+    }
+}
+
+
+void USBHIDDevice::reportLatencyStatistics() const {
+    if (!(inputDispatcher->isMeasuringLatency())) {
+        return;
+    }
+    
+    const double elapsedS = double(clock->getSystemTimeNS() - MWTime(ioStartTimeNS)) / 1.0e9;
+    Datum::dict_value_type allStatistics;
+    
+    for (std::size_t channelIndex = 0; channelIndex < channelsByIndex.size(); channelIndex++) {
+        const std::string &channelTag = channelsByIndex[channelIndex]->getTag();
+        const USBHIDLatencyHistogram &inputDelay = inputDispatcher->getInputDelay(channelIndex);
+        const USBHIDLatencyHistogram &dispatchDelay = inputDispatcher->getDispatchDelay(channelIndex);
+        const double valuesPerSecond = ((elapsedS > 0.0) ? (double(inputDelay.getCount()) / elapsedS) : 0.0);
+        
+        mprintf("HID channel \"%s\" on device \"%s\" latency (%llu values, %.1f/s):\n"
+                "\tDevice to callback:\tmedian %.3f ms, 99th percentile %.3f ms, max %.3f ms\n"
+                "\tCallback to variable:\tmedian %.3f ms, 99th percentile %.3f ms, max %.3f ms",
+                channelTag.c_str(),
                 getTag().c_str(),
-                elementUsagePage, elementUsagePage,
-                elementUsage, elementUsage,
-                integerValue);
+                static_cast<unsigned long long>(inputDelay.getCount()),
+                valuesPerSecond,
+                double(inputDelay.getQuantileNS(0.5)) / 1.0e6,
+                double(inputDelay.getQuantileNS(0.99)) / 1.0e6,
+                double(inputDelay.getMaxNS()) / 1.0e6,
+                double(dispatchDelay.getQuantileNS(0.5)) / 1.0e6,
+                double(dispatchDelay.getQuantileNS(0.99)) / 1.0e6,
+                double(dispatchDelay.getMaxNS()) / 1.0e6);
+        
+        if (latencyStatistics) {
+            Datum::dict_value_type channelStatistics;
+            channelStatistics[Datum("values_received")] = Datum(long(inputDelay.getCount()));
+            channelStatistics[Datum("values_per_second")] = Datum(valuesPerSecond);
+            channelStatistics[Datum("input_median_us")] = Datum(double(inputDelay.getQuantileNS(0.5)) / 1.0e3);
+            channelStatistics[Datum("input_p99_us")] = Datum(double(inputDelay.getQuantileNS(0.99)) / 1.0e3);
+            channelStatistics[Datum("input_max_us")] = Datum(double(inputDelay.getMaxNS()) / 1.0e3);
+            channelStatistics[Datum("dispatch_median_us")] = Datum(double(dispatchDelay.getQuantileNS(0.5)) / 1.0e3);
+            channelStatistics[Datum("dispatch_p99_us")] = Datum(double(dispatchDelay.getQuantileNS(0.99)) / 1.0e3);
+            channelStatistics[Datum("dispatch_max_us")] = Datum(double(dispatchDelay.getMaxNS()) / 1.0e3);
+            allStatistics[Datum(channelTag)] = Datum(channelStatistics);
+        }
     }
+    
+    if (latencyStatistics) {
+        latencyStatistics->setValue(Datum(allStatistics));
+    }
+}
+
+
+void USBHIDDevice::reportPollStatistics() const {
+    if (!pollIntervalNS || !(pollCount || missedPollCount)) {
+        return;
+    }
+    
+    const double elapsedS = double(std::uint64_t(clock->getSystemTimeNS()) - pollStartTimeNS) / 1.0e9;
+    const double targetRate = 1.0e9 / double(pollIntervalNS);
+    const double effectiveRate = ((elapsedS > 0.0) ? (double(pollCount) / elapsedS) : 0.0);
+    
+    mprintf("HID device \"%s\" polled %llu times (%.1f/s, target %.1f/s); "
+            "wakeup jitter median %.3f ms, 99th percentile %.3f ms, max %.3f ms",
+            getTag().c_str(),
+            static_cast<unsigned long long>(pollCount),
+            effectiveRate,
+            targetRate,
+            double(pollJitter.getQuantileNS(0.5)) / 1.0e6,
+            double(pollJitter.getQuantileNS(0.99)) / 1.0e6,
+            double(pollJitter.getMaxNS()) / 1.0e6);
+    
+    if (missedPollCount || failedPollCount) {
+        mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                 "HID device \"%s\" missed %llu of its poll intervals and failed %llu polls",
+                 getTag().c_str(),
+                 static_cast<unsigned long long>(missedPollCount),
+                 static_cast<unsigned long long>(failedPollCount));
+    }
+}
+
+
+void USBHIDDevice::reportWakeupJitter() const {
+    if (!measureWakeupJitter || !(wakeupJitter.getCount())) {
+        return;
+    }
+    
+    mprintf("HID device \"%s\" wakeup jitter (%llu wakeups): median %.3f ms, 99th percentile %.3f ms, max %.3f ms",
+            getTag().c_str(),
+            static_cast<unsigned long long>(wakeupJitter.getCount()),
+            double(wakeupJitter.getQuantileNS(0.5)) / 1.0e6,
+            double(wakeupJitter.getQuantileNS(0.99)) / 1.0e6,
+            double(wakeupJitter.getMaxNS()) / 1.0e6);
 }
 
 
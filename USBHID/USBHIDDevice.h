@@ -9,30 +9,49 @@
 #ifndef __USBHID__USBHIDDevice__
 #define __USBHID__USBHIDDevice__
 
+#include "USBHIDBackend.h"
+#include "USBHIDCapture.h"
 #include "USBHIDInputChannel.h"
+#include "USBHIDInputDispatcher.h"
+#include "USBHIDInputLogger.h"
+#include "USBHIDInputRangeChannel.h"
+#include "USBHIDInputStickChannel.h"
+#include "USBHIDLatencyHistogram.h"
+#include "USBHIDOutputChannel.h"
+#include "USBHIDOutputWriter.h"
+#include "USBHIDSharedState.h"
+#include "USBHIDThreadPolicy.h"
 
 
 BEGIN_NAMESPACE_MW
 
 
-BEGIN_NAMESPACE(iohid)
-
-
-using DevicePtr = cf::ObjectPtr<IOHIDDeviceRef>;
-using ElementPtr = cf::ObjectPtr<IOHIDElementRef>;
-using ManagerPtr = cf::ObjectPtr<IOHIDManagerRef>;
-
-
-END_NAMESPACE(iohid)
-
-
-class USBHIDDevice : public IODevice, boost::noncopyable {
+class USBHIDDevice : public IODevice, USBHIDBackend::Delegate, USBHIDInputDispatcher::Target, boost::noncopyable {
     
 public:
     static const std::string USAGE_PAGE;
     static const std::string USAGE;
     static const std::string PREFERRED_LOCATION_ID;
     static const std::string LOG_ALL_INPUT_VALUES;
+    static const std::string DISPATCH_QUEUE_SIZE;
+    static const std::string DROPPED_EVENTS;
+    static const std::string RAW_REPORTS;
+    static const std::string CAPTURE_FILE;
+    static const std::string BATCH_REPORTS;
+    static const std::string FRAME_NUMBER;
+    static const std::string MEASURE_LATENCY;
+    static const std::string LATENCY_STATISTICS;
+    static const std::string SHARED_IO;
+    static const std::string MERGE_GROUP;
+    static const std::string MERGE_WINDOW;
+    static const std::string SHARED_MEMORY_NAME;
+    static const std::string MAX_OUTPUT_LATENCY;
+    static const std::string POLL_INTERVAL;
+    static const std::string THREAD_SCHEDULING;
+    static const std::string THREAD_PRIORITY;
+    static const std::string IO_THREAD_CPUS;
+    static const std::string DISPATCH_THREAD_CPUS;
+    static const std::string MEASURE_WAKEUP_JITTER;
     
     static void describeComponent(ComponentInfo &info);
     
@@ -47,34 +66,135 @@ public:
     bool startDeviceIO() MW_OVERRIDE;
     bool stopDeviceIO() MW_OVERRIDE;
     
+protected:
+    typedef std::unique_ptr<USBHIDBackend> (*BackendFactory)(const std::string &deviceTag,
+                                                             const ParameterValueMap &parameters);
+    
+    USBHIDDevice(const ParameterValueMap &parameters, BackendFactory createBackend);
+    
 private:
-    static cf::DictionaryPtr createMatchingDictionary(CFStringRef usagePageKey,
-                                                      long usagePage,
-                                                      CFStringRef usageKey,
-                                                      long usage);
-    static void inputValueCallback(void *context, IOReturn result, void *sender, IOHIDValueRef value);
+    typedef USBHIDBackend::UsagePair UsagePair;
+    
+    static std::unique_ptr<USBHIDBackend> createPlatformBackend(const std::string &deviceTag,
+                                                                const ParameterValueMap &parameters);
     
-    bool prepareInputChannels();
-    bool isRunning() const { return (runLoopThread.get_id() != boost::thread::id()); }
-    void runLoop();
-    void handleInputValue(IOHIDValueRef value);
+    bool isRunning() const { return backend->isRunning(); }
+    bool openCaptureFile();
+    bool createSharedState(const std::vector<UsagePair> &channelUsages);
+    void flushCaptureFile();
+    void stopInputLogger();
+    bool startOutputs();
+    void stopOutputs();
+    void startWakeupJitterProbe();
+    void startPolling();
+    void poll(std::uint64_t currentTimeNS);
+    void handleOutputValue(std::size_t outputIndex, const Datum &data) {
+        outputWriter->setValue(outputIndex, data.getInteger());
+    }
+    void handleInputValue(const USBHIDBackend::InputValue &value) MW_OVERRIDE;
+    void handleWakeup(std::uint64_t currentTimeNS) MW_OVERRIDE;
+    void handleFrameEnd() MW_OVERRIDE;
+    void handlePollBegin() MW_OVERRIDE;
+    void handlePollEnd(bool success) MW_OVERRIDE;
+    void handleDeviceRemoved() MW_OVERRIDE;
+    void handleDeviceReattached(std::uint64_t gapNS) MW_OVERRIDE;
+    void postValue(std::size_t channelIndex, long integerValue, MWTime time) MW_OVERRIDE {
+        channelsByIndex[channelIndex]->postValue(integerValue, time);
+    }
+    void postMultiUsageValues(std::size_t multiUsageIndex, const std::vector<long> &values, MWTime time) MW_OVERRIDE {
+        multiUsageChannels[multiUsageIndex]->postValues(values, time);
+    }
+    void postFrameNumber(long newFrameNumber, MWTime time) MW_OVERRIDE {
+        if (frameNumber) {
+            frameNumber->setValue(newFrameNumber, time);
+        }
+    }
+    void postDroppedEventCount(long droppedEventCount) MW_OVERRIDE {
+        if (droppedEvents) {
+            droppedEvents->setValue(droppedEventCount);
+        }
+    }
+    void requestWakeup(std::uint64_t timeNS) MW_OVERRIDE {
+        if (!pendingWakeupTimeNS || (timeNS < pendingWakeupTimeNS)) {
+            pendingWakeupTimeNS = timeNS;
+        }
+        backend->requestWakeup(timeNS);
+    }
+    void reportFilterCounts() const;
+    void reportClockDiagnostics() const;
+    void reportLatencyStatistics() const;
+    void reportPollStatistics() const;
+    void reportWakeupJitter() const;
     
     const long usagePage;
     const long usage;
     const std::uint32_t preferredLocationID;
     const bool logAllInputValues;
+    const bool rawReports;
+    const bool batchReports;
+    const bool measureLatency;
+    const bool measureWakeupJitter;
+    VariablePtr droppedEvents;
+    VariablePtr frameNumber;
+    VariablePtr latencyStatistics;
+    std::string captureFilePath;
+    std::string sharedMemoryName;
+    MWTime maxOutputLatency;
+    std::uint64_t pollIntervalNS;  // Zero if not polling
+    const boost::shared_ptr<Clock> clock;
     
-    typedef std::pair<long, long> UsagePair;
     typedef std::map< UsagePair, boost::shared_ptr<USBHIDInputChannel> > InputChannelMap;
     InputChannelMap inputChannels;
     
-    const iohid::ManagerPtr hidManager;
-    iohid::DevicePtr hidDevice;
+    // Indexed by the backend's channel index.  Built by initialize and never modified afterwards, so the
+    // input path can read it without locking.  The channels themselves are kept alive by inputChannels.
+    std::vector<const USBHIDInputChannel *> channelsByIndex;
+    
+    // Range and stick channels.  Those that require all their usages are moved to the front by initialize.
+    typedef std::vector< boost::shared_ptr<USBHIDMultiUsageChannel> > MultiUsageChannelList;
+    MultiUsageChannelList multiUsageChannels;
+    
+    // Indexed by the backend's output index
+    typedef std::vector< boost::shared_ptr<USBHIDOutputChannel> > OutputChannelList;
+    OutputChannelList outputChannels;
+    
+    // Used only on the I/O thread while polling, except that statistics may be read after I/O stops
+    std::uint64_t nextPollTimeNS;
+    std::uint64_t pollStartTimeNS;
+    std::uint64_t pollCount;
+    std::uint64_t missedPollCount;   // Ticks skipped because the previous poll was still in progress
+    std::uint64_t failedPollCount;
+    USBHIDLatencyHistogram pollJitter;  // From scheduled tick to start of poll
+    bool calibrateClockAfterPoll;       // Whether to resume clock calibration once a poll is delivered
+    
+    // Used only on the I/O thread, except that the histogram may be read after I/O stops.  The backend keeps
+    // only the earliest requested wakeup, so pendingWakeupTimeNS mirrors it to measure how late each wakeup
+    // is delivered.  When measuring, an additional wakeup is requested periodically, so that there's
+    // always something to measure.
+    std::uint64_t pendingWakeupTimeNS;  // Zero if no wakeup is pending
+    std::uint64_t nextJitterProbeTimeNS;
+    USBHIDLatencyHistogram wakeupJitter;
+    
+    std::uint64_t ioStartTimeNS;  // Used only if measuring latency
+    
+    const std::unique_ptr<USBHIDBackend> backend;
+    
+    // Records every value delivered by the backend, on the I/O thread
+    boost::scoped_ptr<usbhid::CaptureWriter> captureWriter;
+    
+    // Publishes the latest value of every channel to other processes, from the I/O thread
+    boost::scoped_ptr<usbhid::SharedStateWriter> sharedStateWriter;
+    
+    // Sends output channel values while I/O is running.  Null if there are no output channels.
+    boost::scoped_ptr<USBHIDOutputWriter> outputWriter;
+    std::vector< boost::shared_ptr<VariableCallbackNotification> > outputNotifications;
     
-    typedef std::map< UsagePair, iohid::ElementPtr > HIDElementMap;
-    HIDElementMap hidElements;
+    // Formats and emits log_all_input_values messages off the input path
+    boost::scoped_ptr<USBHIDInputLogger> inputLogger;
     
-    boost::thread runLoopThread;
+    // Takes values from the backend and posts them to the channels, through a dispatch queue or merge group
+    // if configured.  Created after the input logger, which it uses.
+    boost::scoped_ptr<USBHIDInputDispatcher> inputDispatcher;
     
 };
 
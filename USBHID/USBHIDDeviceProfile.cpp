@@ -0,0 +1,210 @@
+//
+//  USBHIDDeviceProfile.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDDeviceProfile.h"
+
+#include "USBHIDReportExtractor.h"
+
+
+namespace mworks {
+namespace usbhid {
+
+
+namespace {
+    
+    constexpr std::uint32_t genericDesktop(std::uint32_t usage) { return (0x01u << 16) | usage; }
+    constexpr std::uint32_t button(std::uint32_t usage) { return (0x09u << 16) | usage; }
+    constexpr std::uint32_t vendorDefined(std::uint32_t usage) { return (0xFF00u << 16) | usage; }
+    
+    
+    //
+    // Logitech Dual Action gamepad (046d:c216), as recorded in Tests/USBHID/joystick_replay.hidcap.  Each
+    // 7-byte report holds four 8-bit axes, a 4-bit hat switch, 12 buttons, and 8 vendor-defined bits.
+    //
+    struct LogitechDualAction {
+        static constexpr std::size_t fieldCount = 25;
+        static constexpr ProfileField fields[fieldCount] = {
+            { genericDesktop(0x30),  0, 8, false },  // X
+            { genericDesktop(0x31),  8, 8, false },  // Y
+            { genericDesktop(0x32), 16, 8, false },  // Z
+            { genericDesktop(0x35), 24, 8, false },  // Rz
+            { genericDesktop(0x39), 32, 4, false },  // Hat switch
+            { button(1),  36, 1, false },
+            { button(2),  37, 1, false },
+            { button(3),  38, 1, false },
+            { button(4),  39, 1, false },
+            { button(5),  40, 1, false },
+            { button(6),  41, 1, false },
+            { button(7),  42, 1, false },
+            { button(8),  43, 1, false },
+            { button(9),  44, 1, false },
+            { button(10), 45, 1, false },
+            { button(11), 46, 1, false },
+            { button(12), 47, 1, false },
+            { vendorDefined(1), 48, 1, false },
+            { vendorDefined(1), 49, 1, false },
+            { vendorDefined(1), 50, 1, false },
+            { vendorDefined(1), 51, 1, false },
+            { vendorDefined(1), 52, 1, false },
+            { vendorDefined(1), 53, 1, false },
+            { vendorDefined(1), 54, 1, false },
+            { vendorDefined(1), 55, 1, false }
+        };
+        
+        static const std::uint8_t reportDescriptor[];
+        static const std::size_t reportDescriptorSize;
+    };
+    
+    constexpr ProfileField LogitechDualAction::fields[];
+    
+    const std::uint8_t LogitechDualAction::reportDescriptor[] = {
+        0x05, 0x01,        // Usage Page (Generic Desktop)
+        0x09, 0x04,        // Usage (Joystick)
+        0xA1, 0x01,        // Collection (Application)
+        0xA1, 0x02,        //   Collection (Logical)
+        0x75, 0x08,        //     Report Size (8)
+        0x95, 0x04,        //     Report Count (4)
+        0x15, 0x00,        //     Logical Minimum (0)
+        0x26, 0xFF, 0x00,  //     Logical Maximum (255)
+        0x35, 0x00,        //     Physical Minimum (0)
+        0x46, 0xFF, 0x00,  //     Physical Maximum (255)
+        0x09, 0x30,        //     Usage (X)
+        0x09, 0x31,        //     Usage (Y)
+        0x09, 0x32,        //     Usage (Z)
+        0x09, 0x35,        //     Usage (Rz)
+        0x81, 0x02,        //     Input (Data, Variable, Absolute)
+        0x75, 0x04,        //     Report Size (4)
+        0x95, 0x01,        //     Report Count (1)
+        0x25, 0x07,        //     Logical Maximum (7)
+        0x46, 0x3B, 0x01,  //     Physical Maximum (315)
+        0x65, 0x14,        //     Unit (Degrees)
+        0x09, 0x39,        //     Usage (Hat Switch)
+        0x81, 0x42,        //     Input (Data, Variable, Absolute, Null State)
+        0x65, 0x00,        //     Unit (None)
+        0x75, 0x01,        //     Report Size (1)
+        0x95, 0x0C,        //     Report Count (12)
+        0x25, 0x01,        //     Logical Maximum (1)
+        0x45, 0x01,        //     Physical Maximum (1)
+        0x05, 0x09,        //     Usage Page (Button)
+        0x19, 0x01,        //     Usage Minimum (1)
+        0x29, 0x0C,        //     Usage Maximum (12)
+        0x81, 0x02,        //     Input (Data, Variable, Absolute)
+        0x06, 0x00, 0xFF,  //     Usage Page (Vendor Defined 0xFF00)
+        0x75, 0x01,        //     Report Size (1)
+        0x95, 0x08,        //     Report Count (8)
+        0x25, 0x01,        //     Logical Maximum (1)
+        0x45, 0x01,        //     Physical Maximum (1)
+        0x09, 0x01,        //     Usage (1)
+        0x81, 0x02,        //     Input (Data, Variable, Absolute)
+        0xC0,              //   End Collection
+        0xA1, 0x02,        //   Collection (Logical)
+        0x75, 0x08,        //     Report Size (8)
+        0x95, 0x07,        //     Report Count (7)
+        0x46, 0xFF, 0x00,  //     Physical Maximum (255)
+        0x26, 0xFF, 0x00,  //     Logical Maximum (255)
+        0x09, 0x02,        //     Usage (2)
+        0x91, 0x02,        //     Output (Data, Variable, Absolute)
+        0xC0,              //   End Collection
+        0xC0               // End Collection
+    };
+    
+    const std::size_t LogitechDualAction::reportDescriptorSize = sizeof(LogitechDualAction::reportDescriptor);
+    
+    
+    template <typename Layout>
+    DeviceProfile makeDeviceProfile(const char *name,
+                                    std::uint32_t vendorID,
+                                    std::uint32_t productID,
+                                    std::uint8_t reportID,
+                                    std::size_t reportSize)
+    {
+        static_assert(Layout::fieldCount > 0, "Device profile has no fields");
+        const DeviceProfile profile = {
+            name,
+            vendorID,
+            productID,
+            reportID,
+            reportSize,
+            Layout::fields,
+            Layout::fieldCount,
+            &ProfileExtractor<Layout>::extractAll,
+            Layout::reportDescriptor,
+            Layout::reportDescriptorSize
+        };
+        return profile;
+    }
+    
+    
+    const DeviceProfile profiles[] = {
+        makeDeviceProfile<LogitechDualAction>("logitech_dual_action", 0x046D, 0xC216, 0, 7)
+    };
+    
+}
+
+
+const DeviceProfile * findDeviceProfile(std::uint32_t vendorID, std::uint32_t productID) {
+    for (const DeviceProfile &profile : profiles) {
+        if (profile.vendorID == vendorID && profile.productID == productID) {
+            return &profile;
+        }
+    }
+    return nullptr;
+}
+
+
+const DeviceProfile * findDeviceProfile(const std::string &name) {
+    for (const DeviceProfile &profile : profiles) {
+        if (name == profile.name) {
+            return &profile;
+        }
+    }
+    return nullptr;
+}
+
+
+bool matchProfileFields(const DeviceProfile &profile,
+                        const ReportExtractor &extractor,
+                        std::vector<std::size_t> &fieldIndices)
+{
+    if (extractor.usesReportIDs() != (profile.reportID != 0)) {
+        return false;
+    }
+    
+    const std::vector<ExtractionOp> &ops = extractor.getOps();
+    fieldIndices.assign(ops.size(), 0);
+    
+    for (std::size_t opIndex = 0; opIndex < ops.size(); opIndex++) {
+        const ExtractionOp &op = ops[opIndex];
+        if (op.isArray || op.reportID != profile.reportID) {
+            return false;
+        }
+        
+        bool matched = false;
+        for (std::size_t fieldIndex = 0; fieldIndex < profile.fieldCount; fieldIndex++) {
+            const ProfileField &field = profile.fields[fieldIndex];
+            if (field.usage == op.usage &&
+                field.bitOffset == op.bitOffset &&
+                field.bitSize == op.bitSize &&
+                field.isSigned == op.isSigned)
+            {
+                fieldIndices[opIndex] = fieldIndex;
+                matched = true;
+                break;
+            }
+        }
+        if (!matched) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+
+}  // namespace usbhid
+}  // namespace mworks
@@ -0,0 +1,149 @@
+//
+//  USBHIDDeviceProfile.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  This file has no dependencies on IOKit or MWorksCore, so that it can be built and tested on any platform.
+//
+
+#ifndef __USBHID__USBHIDDeviceProfile__
+#define __USBHID__USBHIDDeviceProfile__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace mworks {
+namespace usbhid {
+
+
+class ReportExtractor;
+
+
+//
+// One variable field of a known device's input report
+//
+struct ProfileField {
+    std::uint32_t usage;      // (usage page << 16) | usage
+    std::uint32_t bitOffset;  // From the start of the report data, excluding the report ID byte
+    std::uint8_t bitSize;
+    bool isSigned;
+};
+
+
+//
+// Describes the input report of a device whose layout is fixed and well known, along with a function,
+// generated at compile time from the layout, that extracts every field at once.  A ReportDecoder uses the
+// profile in place of its generic extraction ops only if every op it would otherwise run matches one of the
+// profile's fields, so a device with unexpected firmware still works, just without the specialized decoder.
+//
+// Profiles are registered in USBHIDDeviceProfile.cpp.
+//
+struct DeviceProfile {
+    const char *name;
+    std::uint32_t vendorID;
+    std::uint32_t productID;
+    
+    std::uint8_t reportID;   // Zero if the device doesn't use report IDs
+    std::size_t reportSize;  // In bytes, excluding the report ID byte
+    const ProfileField *fields;
+    std::size_t fieldCount;
+    
+    // Stores the value of fields[i] in values[i].  data must hold at least reportSize bytes, starting after
+    // the report ID byte (if any).
+    void (*extractAll)(const std::uint8_t *data, std::int32_t *values);
+    
+    // The device's report descriptor, which lets the synthetic device reproduce its reports
+    const std::uint8_t *reportDescriptor;
+    std::size_t reportDescriptorSize;
+};
+
+
+// Each returns null if no profile matches
+const DeviceProfile * findDeviceProfile(std::uint32_t vendorID, std::uint32_t productID);
+const DeviceProfile * findDeviceProfile(const std::string &name);
+
+
+// Finds, for every op of the extractor, the index of the profile field it reads.  Returns false if any op
+// has no matching field.
+bool matchProfileFields(const DeviceProfile &profile,
+                        const ReportExtractor &extractor,
+                        std::vector<std::size_t> &fieldIndices);
+
+
+//
+// Reads one little-endian bit field whose position and size are known at compile time, so that the
+// compiler reduces it to a fixed load, shift, and mask (plus a sign extension, if needed)
+//
+template <std::uint32_t BitOffset, std::uint8_t BitSize, bool IsSigned>
+inline std::int32_t extractProfileField(const std::uint8_t *data) {
+    static_assert(BitSize >= 1 && BitSize <= 32, "Profile fields must be 1 to 32 bits");
+    
+    constexpr std::uint32_t firstByte = BitOffset / 8;
+    constexpr unsigned shift = BitOffset % 8;
+    constexpr unsigned byteCount = (shift + BitSize + 7) / 8;
+    constexpr std::uint64_t mask = (std::uint64_t(1) << BitSize) - 1;
+    
+    std::uint64_t bits = 0;
+    for (unsigned i = 0; i < byteCount; i++) {
+        bits |= std::uint64_t(data[firstByte + i]) << (8 * i);
+    }
+    bits = (bits >> shift) & mask;
+    
+    if (IsSigned && (bits >> (BitSize - 1))) {
+        bits |= ~mask;
+    }
+    return std::int32_t(bits);
+}
+
+
+//
+// Extracts fields Index and up of a layout, one extractProfileField instantiation per field.  (This is a
+// recursive template, rather than a pack expansion over std::index_sequence, so that it builds as C++11.)
+//
+template <typename Layout, std::size_t Index = 0, bool Done = (Index == Layout::fieldCount)>
+struct ProfileFieldExtractor {
+    static void extract(const std::uint8_t *data, std::int32_t *values) {
+        values[Index] = extractProfileField<Layout::fields[Index].bitOffset,
+                                            Layout::fields[Index].bitSize,
+                                            Layout::fields[Index].isSigned>(data);
+        ProfileFieldExtractor<Layout, Index + 1>::extract(data, values);
+    }
+};
+
+
+template <typename Layout, std::size_t Index>
+struct ProfileFieldExtractor<Layout, Index, true> {
+    static void extract(const std::uint8_t *data, std::int32_t *values) { }
+};
+
+
+//
+// Generates DeviceProfile::extractAll for a layout type, which must provide
+//
+//     static constexpr std::size_t fieldCount = ...;
+//     static constexpr ProfileField fields[fieldCount] = { ... };
+//
+// Every field becomes a separate extractProfileField instantiation, so there is no loop or table lookup at
+// run time.
+//
+template <typename Layout>
+class ProfileExtractor {
+    
+public:
+    static void extractAll(const std::uint8_t *data, std::int32_t *values) {
+        ProfileFieldExtractor<Layout>::extract(data, values);
+    }
+    
+};
+
+
+}  // namespace usbhid
+}  // namespace mworks
+
+
+#endif // !defined(__USBHID__USBHIDDeviceProfile__)
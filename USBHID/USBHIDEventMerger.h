@@ -0,0 +1,249 @@
+//
+//  USBHIDEventMerger.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDEventMerger__
+#define __USBHID__USBHIDEventMerger__
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/chrono/duration.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/weak_ptr.hpp>
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Merges the input events of several devices into a single stream, ordered by device time stamp.  Each
+// event is held until the merge window has elapsed since its time stamp, so that events from other
+// devices with earlier time stamps have a chance to arrive first.  Events are then passed, one at a time
+// and in time stamp order, to their client's dispatchMergedEvent method on the merger's own thread.
+//
+// An event that arrives after a later-stamped event has already been dispatched can't be put in order.  It
+// is dispatched as soon as possible, and submit reports it as late.
+//
+// Pending events are held in storage reserved up front, so that submitting doesn't allocate.  If more events
+// than that are ever pending at once, the storage grows and a warning is issued (once per merger).
+//
+// Mergers are shared by name.  A merger exists only while at least one client holds a reference to it,
+// and its window is the largest requested by any of its clients.
+//
+template <typename Client, typename Event>
+class USBHIDEventMerger : boost::noncopyable {
+    
+public:
+    static boost::shared_ptr<USBHIDEventMerger> instance(const std::string &groupName, MWTime windowUS) {
+        boost::mutex::scoped_lock lock(registryMutex);
+        
+        boost::shared_ptr<USBHIDEventMerger> merger = registry[groupName].lock();
+        if (!merger) {
+            merger.reset(new USBHIDEventMerger(groupName));
+            registry[groupName] = merger;
+        }
+        merger->extendWindow(windowUS);
+        
+        return merger;
+    }
+    
+    ~USBHIDEventMerger() {
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            running = false;
+        }
+        condition.notify_all();
+        
+        try {
+            mergeThread.join();
+        } catch (const boost::system::system_error &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to stop HID event merging thread: %s", e.what());
+        }
+    }
+    
+    // Returns false if the event is late
+    bool submit(Client &client, const Event &event, std::uint64_t timestampNS) {
+        bool inOrder;
+        bool newEarliest;
+        bool capacityExceeded = false;
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            inOrder = (timestampNS >= lastDispatchedTimestampNS);
+            newEarliest = (pendingEntries.empty() || (timestampNS < pendingEntries.front().timestampNS));
+            if (pendingEntries.size() == pendingEntries.capacity() && !capacityWarningIssued) {
+                capacityExceeded = capacityWarningIssued = true;
+            }
+            const Entry entry = { timestampNS, nextSequence++, &client, event };
+            pendingEntries.push_back(entry);
+            std::push_heap(pendingEntries.begin(), pendingEntries.end(), Later());
+        }
+        
+        // The merging thread needs to recompute its wait only if this event is now the earliest
+        if (newEarliest) {
+            condition.notify_all();
+        }
+        
+        // The queue grows as needed, so no event is lost, but growing it allocates on the submitting thread
+        if (capacityExceeded) {
+            mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                     "More than %lu HID input values are waiting to be posted by merge group \"%s\".  The merge "
+                     "window may be too long for the input rate, or posting may be falling behind.",
+                     static_cast<unsigned long>(initialPendingCapacity),
+                     groupName.c_str());
+        }
+        
+        return inOrder;
+    }
+    
+    // Dispatches any of the client's events that are still pending, on the calling thread, and waits until
+    // the merging thread is no longer dispatching to the client.  The client must not submit any further
+    // events.
+    void flush(Client &client) {
+        std::vector<Entry> clientEntries;
+        
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            
+            typename std::vector<Entry>::iterator newEnd = std::partition(pendingEntries.begin(),
+                                                                          pendingEntries.end(),
+                                                                          [&client](const Entry &entry) {
+                                                                              return (entry.client != &client);
+                                                                          });
+            clientEntries.assign(newEnd, pendingEntries.end());
+            pendingEntries.erase(newEnd, pendingEntries.end());
+            std::make_heap(pendingEntries.begin(), pendingEntries.end(), Later());
+            
+            while (dispatchingClient == &client) {
+                condition.wait(lock);
+            }
+        }
+        
+        std::sort(clientEntries.begin(), clientEntries.end(), Earlier());
+        BOOST_FOREACH(const Entry &entry, clientEntries) {
+            client.dispatchMergedEvent(entry.event);
+        }
+    }
+    
+private:
+    struct Entry {
+        std::uint64_t timestampNS;
+        std::uint64_t sequence;  // Preserves submission order among events with equal time stamps
+        Client *client;
+        Event event;
+    };
+    
+    struct Earlier {
+        bool operator()(const Entry &a, const Entry &b) const {
+            return ((a.timestampNS < b.timestampNS) ||
+                    ((a.timestampNS == b.timestampNS) && (a.sequence < b.sequence)));
+        }
+    };
+    
+    // Heap comparator that puts the earliest entry at the front
+    struct Later {
+        bool operator()(const Entry &a, const Entry &b) const {
+            return Earlier()(b, a);
+        }
+    };
+    
+    explicit USBHIDEventMerger(const std::string &groupName) :
+        groupName(groupName),
+        clock(Clock::instance()),
+        windowNS(0),
+        running(true),
+        nextSequence(0),
+        lastDispatchedTimestampNS(0),
+        dispatchingClient(nullptr),
+        capacityWarningIssued(false)
+    {
+        // Enough for a burst from several devices, so that submit doesn't normally allocate
+        pendingEntries.reserve(initialPendingCapacity);
+        
+        try {
+            mergeThread = boost::thread(boost::bind(&USBHIDEventMerger::run, this));
+        } catch (const boost::thread_resource_error &e) {
+            throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start HID event merging thread", e.what());
+        }
+    }
+    
+    void extendWindow(MWTime windowUS) {
+        boost::mutex::scoped_lock lock(mutex);
+        windowNS = std::max(windowNS, std::uint64_t(std::max(windowUS, MWTime(0))) * 1000);
+    }
+    
+    void run() {
+        boost::mutex::scoped_lock lock(mutex);
+        
+        while (running) {
+            if (pendingEntries.empty()) {
+                condition.wait(lock);
+                continue;
+            }
+            
+            const std::uint64_t dueTimeNS = pendingEntries.front().timestampNS + windowNS;
+            const std::uint64_t currentTimeNS = clock->getSystemTimeNS();
+            if (currentTimeNS < dueTimeNS) {
+                condition.wait_for(lock, boost::chrono::nanoseconds(dueTimeNS - currentTimeNS));
+                continue;
+            }
+            
+            std::pop_heap(pendingEntries.begin(), pendingEntries.end(), Later());
+            const Entry entry = pendingEntries.back();
+            pendingEntries.pop_back();
+            
+            lastDispatchedTimestampNS = std::max(lastDispatchedTimestampNS, entry.timestampNS);
+            dispatchingClient = entry.client;
+            
+            // Don't hold the lock while dispatching, so that submitters are never blocked by variable
+            // notifications
+            lock.unlock();
+            entry.client->dispatchMergedEvent(entry.event);
+            lock.lock();
+            
+            dispatchingClient = nullptr;
+            condition.notify_all();
+        }
+    }
+    
+    static const std::size_t initialPendingCapacity = 1024;
+    
+    const std::string groupName;
+    const boost::shared_ptr<Clock> clock;
+    
+    boost::mutex mutex;
+    boost::condition_variable condition;
+    std::uint64_t windowNS;
+    bool running;
+    std::vector<Entry> pendingEntries;  // Heap, earliest first
+    std::uint64_t nextSequence;
+    std::uint64_t lastDispatchedTimestampNS;
+    Client *dispatchingClient;
+    bool capacityWarningIssued;
+    boost::thread mergeThread;
+    
+    static boost::mutex registryMutex;
+    static std::map< std::string, boost::weak_ptr<USBHIDEventMerger> > registry;
+    
+};
+
+
+template <typename Client, typename Event>
+boost::mutex USBHIDEventMerger<Client, Event>::registryMutex;
+
+
+template <typename Client, typename Event>
+std::map< std::string, boost::weak_ptr< USBHIDEventMerger<Client, Event> > > USBHIDEventMerger<Client, Event>::registry;
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDEventMerger__)
@@ -0,0 +1,902 @@
+//
+//  USBHIDHidrawBackend.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDHidrawBackend.h"
+
+#if defined(__linux__)
+
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/hidraw.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+
+BEGIN_NAMESPACE_MW
+
+
+namespace {
+    const std::size_t maxReportSize = 4096;  // HID_MAX_BUFFER_SIZE in the kernel
+}
+
+
+USBHIDHidrawBackend::USBHIDHidrawBackend(const std::string &deviceTag) :
+    USBHIDBackend(deviceTag),
+    matchingCriteria(),
+    deviceInfo(),
+    deviceFD(-1),
+    detachTimeNS(0),
+    epollFD(-1),
+    stopEventFD(-1),
+    wakeupTimerFD(-1),
+    devWatchFD(-1),
+    devWatchDescriptor(-1),
+    pollEventFD(-1),
+    wakeupTimeNS(0),
+    delegate(nullptr)
+{ }
+
+
+USBHIDHidrawBackend::~USBHIDHidrawBackend() {
+    (void)stopIO();
+    if (devWatchFD >= 0) {
+        (void)close(devWatchFD);
+    }
+    if (deviceFD >= 0) {
+        (void)close(deviceFD);
+    }
+}
+
+
+bool USBHIDHidrawBackend::openDevice(const DeviceMatchingCriteria &criteria) {
+    std::vector<Candidate> candidates;
+    
+    if (DIR *devDir = opendir("/dev")) {
+        while (struct dirent *entry = readdir(devDir)) {
+            Candidate candidate;
+            if (std::strncmp(entry->d_name, "hidraw", 6) == 0 && readCandidate(entry->d_name, criteria, candidate)) {
+                candidates.push_back(candidate);
+            }
+        }
+        closedir(devDir);
+    }
+    
+    if (candidates.empty()) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN, "No matching HID devices found");
+        return false;
+    }
+    
+    const Candidate *selected = nullptr;
+    
+    if (candidates.size() == 1) {
+        
+        selected = &(candidates.front());
+        
+        if (criteria.preferredLocationID && selected->locationID && (criteria.preferredLocationID != selected->locationID)) {
+            mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                     "Location ID for HID device \"%s\" (%lu) does not match preferred location ID (%lu)",
+                     deviceTag.c_str(),
+                     static_cast<unsigned long>(selected->locationID),
+                     static_cast<unsigned long>(criteria.preferredLocationID));
+        }
+        
+    } else {
+        
+        std::ostringstream oss;
+        
+        oss << "Found multiple matching HID devices for \"" << deviceTag << "\":\n";
+        
+        for (std::size_t deviceNum = 0; deviceNum < candidates.size(); deviceNum++) {
+            const Candidate &candidate = candidates[deviceNum];
+            
+            if (criteria.preferredLocationID == candidate.locationID) {
+                selected = &candidate;
+                break;
+            }
+            
+            oss << "\nDevice #" << std::dec << deviceNum + 1 << std::endl;
+            oss << "\tProduct:\t\t" << candidate.name << std::endl;
+            oss << "\tPath:\t\t" << candidate.path << std::endl;
+            oss << "\tLocation ID:\t" << std::dec << candidate.locationID
+                << "\t(0x" << std::hex << candidate.locationID << ")" << std::endl;
+        }
+        
+        if (!selected) {
+            oss << "\nPlease set the \"preferred_location_id\" attribute to the Location ID of the desired device.\n";
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "%s", oss.str().c_str());
+            return false;
+        }
+        
+    }
+    
+    matchingCriteria = criteria;
+    devicePath = selected->path;
+    deviceInfo.vendorID = selected->vendorID;
+    deviceInfo.productID = selected->productID;
+    deviceInfo.versionNumber = selected->versionNumber;
+    deviceInfo.locationID = selected->locationID;
+    deviceInfo.product = selected->name;
+    descriptorData = selected->descriptor;
+    
+    deviceFD = open(devicePath.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (deviceFD < 0) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to open %s: %s", devicePath.c_str(), std::strerror(errno));
+        return false;
+    }
+    
+    return true;
+}
+
+
+bool USBHIDHidrawBackend::prepareInputs(const std::vector<UsagePair> &channelUsages,
+                                        std::size_t requiredChannelCount,
+                                        bool deliverAllValues,
+                                        bool rawReports)
+{
+    // hidraw delivers only whole input reports, so they're always decoded here, as IOKit does when
+    // rawReports is true.  There are no per-element callbacks to fall back on.
+    if (!rawReports) {
+        mprintf("HID device \"%s\": hidraw provides only whole input reports, so values are decoded from them "
+                "(as with raw_reports)",
+                deviceTag.c_str());
+    }
+    
+    std::vector<std::uint32_t> targetUsages;
+    BOOST_FOREACH(const UsagePair &usagePair, channelUsages) {
+        targetUsages.push_back(usbhid::ReportDescriptor::makeUsage(usagePair.first, usagePair.second));
+    }
+    
+    try {
+        usbhid::ReportDescriptor descriptor(descriptorData.data(), descriptorData.size());
+        reportDecoder.reset(new usbhid::ReportDecoder(descriptor, targetUsages, deliverAllValues));
+    } catch (const usbhid::ReportDescriptorError &e) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN, "Invalid report descriptor for HID device \"%s\": %s", deviceTag.c_str(), e.what());
+        return false;
+    }
+    
+    for (std::size_t target = 0; target < requiredChannelCount; target++) {
+        if (!(reportDecoder->getExtractor().isTargetMatched(target))) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN,
+                   "No matching HID elements for usage page %u, usage %u",
+                   usbhid::ReportDescriptor::usagePageOf(targetUsages[target]),
+                   usbhid::ReportDescriptor::usageOf(targetUsages[target]));
+            return false;
+        }
+    }
+    
+    selectDeviceProfile(*reportDecoder);
+    reportBuffer.assign(maxReportSize, 0);
+    
+    return true;
+}
+
+
+bool USBHIDHidrawBackend::prepareOutputs(const std::vector<OutputElement> &outputElements) {
+    reportEncoder.reset();
+    if (outputElements.empty()) {
+        return true;
+    }
+    
+    std::vector<usbhid::ReportEncoder::Target> targets;
+    BOOST_FOREACH(const OutputElement &element, outputElements) {
+        const usbhid::ReportEncoder::Target target = {
+            (element.feature ? usbhid::ReportType::Feature : usbhid::ReportType::Output),
+            usbhid::ReportDescriptor::makeUsage(element.usagePage, element.usage)
+        };
+        targets.push_back(target);
+    }
+    
+    try {
+        usbhid::ReportDescriptor descriptor(descriptorData.data(), descriptorData.size());
+        reportEncoder.reset(new usbhid::ReportEncoder(descriptor, targets));
+    } catch (const usbhid::ReportDescriptorError &e) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN, "Invalid report descriptor for HID device \"%s\": %s", deviceTag.c_str(), e.what());
+        return false;
+    }
+    
+    for (std::size_t target = 0; target < targets.size(); target++) {
+        if (!(reportEncoder->isTargetMatched(target))) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN,
+                   "No matching HID %s report fields for usage page %ld, usage %ld",
+                   (outputElements[target].feature ? "feature" : "output"),
+                   outputElements[target].usagePage,
+                   outputElements[target].usage);
+            reportEncoder.reset();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+
+bool USBHIDHidrawBackend::readInitialValues(Delegate &delegate) {
+    if (deviceFD < 0) {
+        // The values will arrive when the device is reattached
+        return true;
+    }
+    
+    // Not all devices support requests for input reports, so failures are ignored; the values will arrive
+    // with the next report
+    (void)requestInputReports(currentTimeNS(), delegate);
+    
+    return true;
+}
+
+
+bool USBHIDHidrawBackend::preparePolling() {
+#if defined(HIDIOCGINPUT)
+    // Request each report that carries a value we care about once per poll
+    std::array<bool, 256> reportIDsSeen;
+    reportIDsSeen.fill(false);
+    std::vector<std::uint8_t> pollReportIDs;
+    BOOST_FOREACH(const usbhid::ExtractionOp &op, reportDecoder->getExtractor().getOps()) {
+        if (!reportIDsSeen[op.reportID]) {
+            reportIDsSeen[op.reportID] = true;
+            pollReportIDs.push_back(op.reportID);
+        }
+    }
+    
+    if (pollReportIDs.empty()) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN, "HID device \"%s\" has no input reports to poll", deviceTag.c_str());
+        return false;
+    }
+    
+    poller.reset(new USBHIDInputPoller(deviceTag,
+                                       pollReportIDs,
+                                       reportBuffer.size(),
+                                       boost::bind(&USBHIDHidrawBackend::requestPolledReport, this, _1, _2, _3),
+                                       boost::bind(&USBHIDHidrawBackend::notifyPollCompleted, this)));
+    
+    return true;
+#else
+    merror(M_IODEVICE_MESSAGE_DOMAIN,
+           "Cannot poll HID device \"%s\": this kernel's hidraw interface can't request input reports",
+           deviceTag.c_str());
+    return false;
+#endif
+}
+
+
+bool USBHIDHidrawBackend::pollInputs(Delegate &delegate, std::uint64_t sampleTimeNS) {
+    if (deviceFD < 0 || !poller) {
+        return false;
+    }
+    return poller->requestPoll(sampleTimeNS);
+}
+
+
+bool USBHIDHidrawBackend::startIO(Delegate &newDelegate) {
+    if (!isRunning()) {
+        delegate = &newDelegate;
+        
+        epollFD = epoll_create1(EPOLL_CLOEXEC);
+        stopEventFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        wakeupTimerFD = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        pollEventFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epollFD < 0 || stopEventFD < 0 || wakeupTimerFD < 0 || pollEventFD < 0) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start HID device: %s", std::strerror(errno));
+            (void)stopIO();
+            return false;
+        }
+        
+        // Closing an inotify descriptor blocks for several milliseconds while the kernel tears down its
+        // group, so the descriptor is created once and kept until the backend is destroyed.  The watch on
+        // /dev itself is cheap to add and remove, so it exists only while I/O is running.
+        if (devWatchFD < 0) {
+            devWatchFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (devWatchFD < 0) {
+                merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start HID device: %s", std::strerror(errno));
+                (void)stopIO();
+                return false;
+            }
+        }
+        
+        // New nodes are created by the kernel, but udev may adjust their permissions afterwards, so watch
+        // for attribute changes, too
+        devWatchDescriptor = inotify_add_watch(devWatchFD, "/dev", IN_CREATE | IN_ATTRIB);
+        if (devWatchDescriptor < 0) {
+            mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                     "Cannot watch for reattachment of HID device \"%s\": %s",
+                     deviceTag.c_str(),
+                     std::strerror(errno));
+        }
+        
+        struct epoll_event event = { 0 };
+        event.events = EPOLLIN;
+        event.data.fd = deviceFD;
+        if (deviceFD >= 0 && epoll_ctl(epollFD, EPOLL_CTL_ADD, deviceFD, &event) != 0) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start HID device: %s", std::strerror(errno));
+            (void)stopIO();
+            return false;
+        }
+        
+        event.data.fd = stopEventFD;
+        if (epoll_ctl(epollFD, EPOLL_CTL_ADD, stopEventFD, &event) != 0) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start HID device: %s", std::strerror(errno));
+            (void)stopIO();
+            return false;
+        }
+        
+        event.data.fd = wakeupTimerFD;
+        if (epoll_ctl(epollFD, EPOLL_CTL_ADD, wakeupTimerFD, &event) != 0) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start HID device: %s", std::strerror(errno));
+            (void)stopIO();
+            return false;
+        }
+        
+        event.data.fd = devWatchFD;
+        if (epoll_ctl(epollFD, EPOLL_CTL_ADD, devWatchFD, &event) != 0) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start HID device: %s", std::strerror(errno));
+            (void)stopIO();
+            return false;
+        }
+        
+        event.data.fd = pollEventFD;
+        if (epoll_ctl(epollFD, EPOLL_CTL_ADD, pollEventFD, &event) != 0) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start HID device: %s", std::strerror(errno));
+            (void)stopIO();
+            return false;
+        }
+        
+        if (poller && !(poller->start(ioThreadPolicy))) {
+            (void)stopIO();
+            return false;
+        }
+        
+        // Arm the timer for any wakeup requested while reading initial values
+        armWakeupTimer();
+        
+        try {
+            ioThread = boost::thread(boost::bind(&USBHIDHidrawBackend::ioLoop, this));
+        } catch (const boost::thread_resource_error &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start HID device: %s", e.what());
+            (void)stopIO();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+
+bool USBHIDHidrawBackend::stopIO() {
+    bool success = true;
+    
+    // Stop the poll thread first, so that it never signals pollEventFD after it's closed
+    if (poller) {
+        poller->stop();
+    }
+    
+    if (isRunning()) {
+        const std::uint64_t one = 1;
+        (void)write(stopEventFD, &one, sizeof(one));
+        
+        try {
+            ioThread.join();
+        } catch (const boost::system::system_error &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to stop HID device: %s", e.what());
+            success = false;
+        }
+    }
+    
+    if (stopEventFD >= 0) {
+        (void)close(stopEventFD);
+        stopEventFD = -1;
+    }
+    if (wakeupTimerFD >= 0) {
+        (void)close(wakeupTimerFD);
+        wakeupTimerFD = -1;
+    }
+    wakeupTimeNS = 0;
+    if (pollEventFD >= 0) {
+        (void)close(pollEventFD);
+        pollEventFD = -1;
+    }
+    if (epollFD >= 0) {
+        (void)close(epollFD);
+        epollFD = -1;
+    }
+    if (devWatchDescriptor >= 0) {
+        (void)inotify_rm_watch(devWatchFD, devWatchDescriptor);
+        devWatchDescriptor = -1;
+        
+        // Discard anything queued before the watch was removed, including its IN_IGNORED event
+        alignas(struct inotify_event) char buffer[4096];
+        while (read(devWatchFD, buffer, sizeof(buffer)) > 0) { }
+    }
+    
+    return success;
+}
+
+
+void USBHIDHidrawBackend::requestWakeup(std::uint64_t timeNS) {
+    if (!wakeupTimeNS || (timeNS < wakeupTimeNS)) {
+        wakeupTimeNS = timeNS;
+        armWakeupTimer();
+    }
+}
+
+
+std::uint32_t USBHIDHidrawBackend::getLocationID(const std::string &sysfsDevicePath) {
+    char resolvedPath[PATH_MAX];
+    if (!realpath(sysfsDevicePath.c_str(), resolvedPath)) {
+        return 0;
+    }
+    
+    // A USB interface's path looks like .../usb1/1-2/1-2.1/1-2.1:1.0/0003:046D:C216.0001.  The last
+    // component of the form "<bus>-<port>[.<port>...]" identifies the device's position in the bus.
+    std::uint32_t locationID = 0;
+    std::istringstream components(resolvedPath);
+    std::string component;
+    
+    while (std::getline(components, component, '/')) {
+        const std::size_t dash = component.find('-');
+        if (dash == 0 || dash == std::string::npos ||
+            component.find_first_not_of("0123456789") != dash ||
+            component.find_first_not_of("0123456789.", dash + 1) != std::string::npos)
+        {
+            continue;
+        }
+        
+        std::uint32_t candidateID = (std::strtoul(component.c_str(), nullptr, 10) & 0xFF) << 24;
+        int shift = 20;
+        std::istringstream ports(component.substr(dash + 1));
+        std::string port;
+        while (std::getline(ports, port, '.') && shift >= 0) {
+            candidateID |= (std::strtoul(port.c_str(), nullptr, 10) & 0xF) << shift;
+            shift -= 4;
+        }
+        
+        locationID = candidateID;
+    }
+    
+    return locationID;
+}
+
+
+std::uint32_t USBHIDHidrawBackend::getVersionNumber(const std::string &sysfsDevicePath) {
+    char resolvedPath[PATH_MAX];
+    if (!realpath(sysfsDevicePath.c_str(), resolvedPath)) {
+        return 0;
+    }
+    
+    // bcdDevice belongs to the USB device, which is an ancestor of the HID device (usually its grandparent,
+    // above the USB interface)
+    std::string path(resolvedPath);
+    while (!path.empty() && path != "/sys") {
+        std::ifstream file((path + "/bcdDevice").c_str());
+        std::string value;
+        if (file >> value) {
+            return std::uint32_t(std::strtoul(value.c_str(), nullptr, 16));
+        }
+        path.erase(path.rfind('/'));
+    }
+    
+    return 0;
+}
+
+
+std::uint64_t USBHIDHidrawBackend::currentTimeNS() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return std::uint64_t(now.tv_sec) * 1000000000ull + std::uint64_t(now.tv_nsec);
+}
+
+
+bool USBHIDHidrawBackend::readCandidate(const std::string &nodeName,
+                                        const DeviceMatchingCriteria &criteria,
+                                        Candidate &candidate)
+{
+    candidate.path = "/dev/" + nodeName;
+    
+    const int fd = open(candidate.path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    BOOST_SCOPE_EXIT(fd) {
+        (void)close(fd);
+    } BOOST_SCOPE_EXIT_END
+    
+    int descriptorSize = 0;
+    struct hidraw_report_descriptor descriptor;
+    if (ioctl(fd, HIDIOCGRDESCSIZE, &descriptorSize) < 0 ||
+        descriptorSize <= 0 ||
+        descriptorSize > HID_MAX_DESCRIPTOR_SIZE)
+    {
+        return false;
+    }
+    descriptor.size = descriptorSize;
+    if (ioctl(fd, HIDIOCGRDESC, &descriptor) < 0) {
+        return false;
+    }
+    candidate.descriptor.assign(descriptor.value, descriptor.value + descriptor.size);
+    
+    // Match on the top-level application collections, which is where the device usage page and usage
+    // reported by IOKit come from
+    bool matched = false;
+    try {
+        usbhid::ReportDescriptor parsed(candidate.descriptor.data(), candidate.descriptor.size());
+        BOOST_FOREACH(const usbhid::ApplicationCollection &collection, parsed.getApplicationCollections()) {
+            if (collection.usagePage == criteria.usagePage && collection.usage == criteria.usage) {
+                matched = true;
+                break;
+            }
+        }
+    } catch (const usbhid::ReportDescriptorError &) {
+        return false;
+    }
+    if (!matched) {
+        return false;
+    }
+    
+    struct hidraw_devinfo rawInfo;
+    if (ioctl(fd, HIDIOCGRAWINFO, &rawInfo) >= 0) {
+        candidate.vendorID = std::uint16_t(rawInfo.vendor);
+        candidate.productID = std::uint16_t(rawInfo.product);
+    } else {
+        candidate.vendorID = candidate.productID = 0;
+    }
+    
+    char name[256] = { 0 };
+    if (ioctl(fd, HIDIOCGRAWNAME(sizeof(name) - 1), name) >= 0) {
+        candidate.name = name;
+    }
+    
+    candidate.versionNumber = getVersionNumber("/sys/class/hidraw/" + nodeName + "/device");
+    candidate.locationID = getLocationID("/sys/class/hidraw/" + nodeName + "/device");
+    
+    return true;
+}
+
+
+void USBHIDHidrawBackend::ioLoop() {
+    ioThreadPolicy.applyToCurrentThread(deviceTag, "I/O");
+    
+    std::array<struct epoll_event, 5> events;
+    
+    while (true) {
+        const int numEvents = epoll_wait(epollFD, events.data(), events.size(), -1);
+        if (numEvents < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "HID device \"%s\" wait failed: %s", deviceTag.c_str(), std::strerror(errno));
+            return;
+        }
+        
+        for (int i = 0; i < numEvents; i++) {
+            if (events[i].data.fd == stopEventFD) {
+                return;
+            }
+            if (events[i].data.fd == wakeupTimerFD) {
+                std::uint64_t expirations;
+                (void)read(wakeupTimerFD, &expirations, sizeof(expirations));
+                wakeupTimeNS = 0;
+                delegate->handleWakeup(currentTimeNS());
+                continue;
+            }
+            if (events[i].data.fd == devWatchFD) {
+                handleDevEvents();
+                continue;
+            }
+            if (events[i].data.fd == pollEventFD) {
+                std::uint64_t count;
+                (void)read(pollEventFD, &count, sizeof(count));
+                deliverPolledReports();
+                continue;
+            }
+            if (events[i].data.fd != deviceFD) {
+                // Left over from a device descriptor that was closed earlier in this batch
+                continue;
+            }
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                handleDeviceRemoved();
+                continue;
+            }
+            readReports();
+        }
+    }
+}
+
+
+bool USBHIDHidrawBackend::writeOutputs(const std::vector<OutputValue> &values, std::size_t &transferCount) {
+    transferCount = 0;
+    if (!reportEncoder) {
+        return values.empty();
+    }
+    
+    BOOST_FOREACH(const OutputValue &value, values) {
+        reportEncoder->setValue(value.outputIndex, std::int32_t(value.integerValue));
+    }
+    
+    boost::mutex::scoped_lock lock(outputMutex);
+    
+    const std::size_t failureCount = reportEncoder->sendDirtyReports([this, &transferCount](std::size_t reportIndex) {
+        if (deviceFD < 0) {
+            return false;
+        }
+        const std::vector<std::uint8_t> &report = reportEncoder->getReportData(reportIndex);
+        int result;
+        if (reportEncoder->getReportType(reportIndex) == usbhid::ReportType::Feature) {
+            result = ioctl(deviceFD, HIDIOCSFEATURE(report.size()), report.data());
+        } else {
+            result = int(write(deviceFD, report.data(), report.size()));
+        }
+        if (result < 0) {
+            return false;
+        }
+        transferCount++;
+        return true;
+    });
+    
+    return (failureCount == 0);
+}
+
+
+void USBHIDHidrawBackend::armWakeupTimer() {
+    if (wakeupTimerFD >= 0 && wakeupTimeNS) {
+        // Time stamps come from CLOCK_MONOTONIC, so the wakeup time can be used as an absolute timer value
+        struct itimerspec timerValue = { { 0, 0 }, { 0, 0 } };
+        timerValue.it_value.tv_sec = wakeupTimeNS / 1000000000ull;
+        timerValue.it_value.tv_nsec = wakeupTimeNS % 1000000000ull;
+        (void)timerfd_settime(wakeupTimerFD, TFD_TIMER_ABSTIME, &timerValue, nullptr);
+    }
+}
+
+
+void USBHIDHidrawBackend::readReports() {
+    if (deviceFD < 0) {
+        return;
+    }
+    
+    // Each read returns exactly one report.  Drain everything that's available before waiting again.
+    while (true) {
+        const ssize_t reportLength = read(deviceFD, reportBuffer.data(), reportBuffer.size());
+        if (reportLength < 0) {
+            if (errno != EAGAIN && errno != EINTR) {
+                merror(M_IODEVICE_MESSAGE_DOMAIN, "HID device \"%s\" read failed: %s", deviceTag.c_str(), std::strerror(errno));
+            }
+            if (errno != EINTR) {
+                return;
+            }
+            continue;
+        }
+        
+        handleInputReport(reportBuffer.data(), reportLength, currentTimeNS(), *delegate);
+    }
+}
+
+
+void USBHIDHidrawBackend::handleDeviceRemoved() {
+    (void)epoll_ctl(epollFD, EPOLL_CTL_DEL, deviceFD, nullptr);
+    {
+        boost::mutex::scoped_lock lock(outputMutex);
+        (void)close(deviceFD);
+        deviceFD = -1;
+    }
+    detachTimeNS = currentTimeNS();
+    
+    delegate->handleDeviceRemoved();
+}
+
+
+void USBHIDHidrawBackend::handleDevEvents() {
+    alignas(struct inotify_event) char buffer[4096];
+    
+    while (true) {
+        const ssize_t length = read(devWatchFD, buffer, sizeof(buffer));
+        if (length <= 0) {
+            if (length < 0 && errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        
+        for (ssize_t offset = 0; offset < length; ) {
+            const struct inotify_event &event = *reinterpret_cast<const struct inotify_event *>(buffer + offset);
+            offset += sizeof(struct inotify_event) + event.len;
+            
+            if (deviceFD < 0 && event.len > 0 && std::strncmp(event.name, "hidraw", 6) == 0) {
+                (void)tryReattach(event.name);
+            }
+        }
+    }
+}
+
+
+bool USBHIDHidrawBackend::tryReattach(const std::string &nodeName) {
+    Candidate candidate;
+    if (!readCandidate(nodeName, matchingCriteria, candidate)) {
+        return false;
+    }
+    
+    // The report decoder is reusable only if the new device has the same report descriptor as the original
+    if ((candidate.vendorID != deviceInfo.vendorID) ||
+        (candidate.productID != deviceInfo.productID) ||
+        (candidate.versionNumber != deviceInfo.versionNumber) ||
+        (candidate.descriptor != descriptorData) ||
+        (matchingCriteria.preferredLocationID && (candidate.locationID != matchingCriteria.preferredLocationID)))
+    {
+        return false;
+    }
+    
+    const int fd = open(candidate.path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        // Probably not accessible yet.  Try again when its attributes change.
+        return false;
+    }
+    
+    struct epoll_event event = { 0 };
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFD, EPOLL_CTL_ADD, fd, &event) != 0) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN,
+               "Unable to reattach HID device \"%s\": %s",
+               deviceTag.c_str(),
+               std::strerror(errno));
+        (void)close(fd);
+        return false;
+    }
+    
+    {
+        boost::mutex::scoped_lock lock(outputMutex);
+        deviceFD = fd;
+    }
+    devicePath = candidate.path;
+    deviceInfo.locationID = candidate.locationID;
+    
+    delegate->handleDeviceReattached(currentTimeNS() - detachTimeNS);
+    
+    // Pick up anything the device sent before it was added to the epoll set
+    readReports();
+    
+    return true;
+}
+
+
+bool USBHIDHidrawBackend::requestInputReports(std::uint64_t timestampNS, Delegate &delegate) {
+    bool success = true;
+
+#if defined(HIDIOCGINPUT)
+    // Request the current contents of every input report that carries a value we care about
+    const usbhid::ReportExtractor &extractor = reportDecoder->getExtractor();
+    std::array<bool, 256> reportIDsRequested;
+    reportIDsRequested.fill(false);
+    
+    BOOST_FOREACH(const usbhid::ExtractionOp &op, extractor.getOps()) {
+        if (reportIDsRequested[op.reportID]) {
+            continue;
+        }
+        reportIDsRequested[op.reportID] = true;
+        
+        reportBuffer[0] = op.reportID;
+        const int result = ioctl(deviceFD, HIDIOCGINPUT(reportBuffer.size()), reportBuffer.data());
+        if (result > 0) {
+            // Without report IDs, the kernel still expects (and strips) a leading zero byte
+            const std::uint8_t *report = reportBuffer.data() + (extractor.usesReportIDs() ? 0 : 1);
+            const std::size_t reportLength = result - (extractor.usesReportIDs() ? 0 : 1);
+            handleInputReport(report, reportLength, timestampNS, delegate);
+        } else {
+            success = false;
+        }
+    }
+#else
+    success = false;
+#endif
+    
+    return success;
+}
+
+
+std::size_t USBHIDHidrawBackend::requestPolledReport(std::uint8_t reportID,
+                                                     std::uint8_t *buffer,
+                                                     std::size_t bufferSize)
+{
+#if defined(HIDIOCGINPUT)
+    // Request via a duplicate of deviceFD, so that the I/O thread can close the original (if the device is
+    // removed) without waiting for the request to finish
+    int fd = -1;
+    {
+        boost::mutex::scoped_lock lock(outputMutex);
+        if (deviceFD >= 0) {
+            fd = fcntl(deviceFD, F_DUPFD_CLOEXEC, 0);
+        }
+    }
+    if (fd < 0) {
+        return 0;
+    }
+    
+    // The kernel bounds the request with its USB control transfer timeout
+    buffer[0] = reportID;
+    const int result = ioctl(fd, HIDIOCGINPUT(bufferSize), buffer);
+    (void)close(fd);
+    if (result <= 0) {
+        return 0;
+    }
+    
+    // Without report IDs, the kernel still expects (and strips) a leading zero byte
+    if (!(reportDecoder->getExtractor().usesReportIDs())) {
+        std::memmove(buffer, buffer + 1, result - 1);
+        return (result - 1);
+    }
+    return result;
+#else
+    return 0;
+#endif
+}
+
+
+void USBHIDHidrawBackend::notifyPollCompleted() {
+    const std::uint64_t one = 1;
+    (void)write(pollEventFD, &one, sizeof(one));
+}
+
+
+void USBHIDHidrawBackend::deliverPolledReports() {
+    std::uint64_t sampleTimeNS;
+    if (!(poller->takeCompletedPoll(sampleTimeNS))) {
+        return;
+    }
+    
+    delegate->handlePollBegin();
+    
+    bool success = true;
+    for (std::size_t reportIndex = 0; reportIndex < poller->getReportCount(); reportIndex++) {
+        const std::size_t reportLength = poller->getReportLength(reportIndex);
+        if (!reportLength) {
+            success = false;
+            continue;
+        }
+        handleInputReport(poller->getReportData(reportIndex), reportLength, sampleTimeNS, *delegate);
+    }
+    
+    delegate->handlePollEnd(success);
+}
+
+
+void USBHIDHidrawBackend::handleInputReport(const std::uint8_t *report,
+                                            std::size_t reportLength,
+                                            std::uint64_t timestampNS,
+                                            Delegate &delegate)
+{
+    reportDecoder->decode(report, reportLength, [timestampNS, &delegate](const usbhid::ExtractionOp &op,
+                                                                         std::int32_t integerValue)
+    {
+        const InputValue inputValue = {
+            ((op.target == usbhid::ReportExtractor::noTarget) ? noChannel : op.target),
+            usbhid::ReportDescriptor::usagePageOf(op.usage),
+            usbhid::ReportDescriptor::usageOf(op.usage),
+            integerValue,
+            timestampNS
+        };
+        
+        delegate.handleInputValue(inputValue);
+    });
+    
+    delegate.handleFrameEnd();
+}
+
+
+END_NAMESPACE_MW
+
+
+#endif // defined(__linux__)
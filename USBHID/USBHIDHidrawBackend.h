@@ -0,0 +1,130 @@
+//
+//  USBHIDHidrawBackend.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDHidrawBackend__
+#define __USBHID__USBHIDHidrawBackend__
+
+#if defined(__linux__)
+
+#include <boost/thread/mutex.hpp>
+
+#include "USBHIDBackend.h"
+#include "USBHIDInputPoller.h"
+#include "USBHIDReportDecoder.h"
+#include "USBHIDReportEncoder.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Reads raw input reports from a Linux /dev/hidraw* node, using non-blocking reads driven by an epoll loop.
+// Values are always decoded from whole reports via the device's report descriptor, so the rawReports
+// argument to prepareInputs is ignored.  Virtual devices created via /dev/uhid appear as hidraw nodes, too,
+// so they can stand in for physical hardware.
+//
+// If the device node goes away while I/O is running, the backend watches /dev for a node with the same
+// vendor and product IDs and report descriptor (and, if a preferred location ID was given, at that
+// location), and then attaches to it, reusing the existing report decoder.
+//
+class USBHIDHidrawBackend : public USBHIDBackend {
+    
+public:
+    explicit USBHIDHidrawBackend(const std::string &deviceTag);
+    ~USBHIDHidrawBackend();
+    
+    bool openDevice(const DeviceMatchingCriteria &criteria) MW_OVERRIDE;
+    DeviceInfo getDeviceInfo() const MW_OVERRIDE { return deviceInfo; }
+    bool prepareInputs(const std::vector<UsagePair> &channelUsages,
+                       std::size_t requiredChannelCount,
+                       bool deliverAllValues,
+                       bool rawReports) MW_OVERRIDE;
+    bool readInitialValues(Delegate &delegate) MW_OVERRIDE;
+    bool prepareOutputs(const std::vector<OutputElement> &outputElements) MW_OVERRIDE;
+    bool startIO(Delegate &delegate) MW_OVERRIDE;
+    bool stopIO() MW_OVERRIDE;
+    bool isRunning() const MW_OVERRIDE { return (ioThread.get_id() != boost::thread::id()); }
+    void requestWakeup(std::uint64_t timeNS) MW_OVERRIDE;
+    bool preparePolling() MW_OVERRIDE;
+    bool pollInputs(Delegate &delegate, std::uint64_t sampleTimeNS) MW_OVERRIDE;
+    bool writeOutputs(const std::vector<OutputValue> &values, std::size_t &transferCount) MW_OVERRIDE;
+    
+    // Derives a macOS-style location ID (bus number in the high byte, followed by one nibble per hub port)
+    // from the sysfs path of a USB HID device.  Returns zero for non-USB devices.
+    static std::uint32_t getLocationID(const std::string &sysfsDevicePath);
+    
+    // Reads the release number (bcdDevice) of the USB device that contains a HID device, given its sysfs
+    // path.  Returns zero for non-USB devices, whose release number isn't exposed.
+    static std::uint32_t getVersionNumber(const std::string &sysfsDevicePath);
+    
+private:
+    struct Candidate {
+        std::string path;
+        std::string name;
+        std::uint32_t vendorID;
+        std::uint32_t productID;
+        std::uint32_t versionNumber;
+        std::uint32_t locationID;
+        std::vector<std::uint8_t> descriptor;
+    };
+    
+    static std::uint64_t currentTimeNS();
+    static bool readCandidate(const std::string &nodeName, const DeviceMatchingCriteria &criteria, Candidate &candidate);
+    
+    void ioLoop();
+    void armWakeupTimer();
+    void readReports();
+    void handleDeviceRemoved();
+    void handleDevEvents();
+    bool tryReattach(const std::string &nodeName);
+    bool requestInputReports(std::uint64_t timestampNS, Delegate &delegate);
+    std::size_t requestPolledReport(std::uint8_t reportID, std::uint8_t *buffer, std::size_t bufferSize);
+    void notifyPollCompleted();
+    void deliverPolledReports();
+    void handleInputReport(const std::uint8_t *report, std::size_t reportLength, std::uint64_t timestampNS, Delegate &delegate);
+    
+    std::string devicePath;
+    DeviceMatchingCriteria matchingCriteria;
+    DeviceInfo deviceInfo;
+    int deviceFD;  // Negative while the device is removed
+    std::uint64_t detachTimeNS;
+    std::vector<std::uint8_t> descriptorData;
+    
+    boost::scoped_ptr<usbhid::ReportDecoder> reportDecoder;
+    std::vector<std::uint8_t> reportBuffer;
+    
+    // Used only by the thread that writes outputs.  Reports are written with a leading report ID byte,
+    // which is zero if the device doesn't use report IDs, as hidraw requires.
+    boost::scoped_ptr<usbhid::ReportEncoder> reportEncoder;
+    
+    // Held while writing outputs, while the poll thread duplicates deviceFD, and while the I/O thread closes
+    // or replaces deviceFD
+    boost::mutex outputMutex;
+    
+    // Null if not polling
+    boost::scoped_ptr<USBHIDInputPoller> poller;
+    
+    boost::thread ioThread;
+    int epollFD;
+    int stopEventFD;
+    int wakeupTimerFD;
+    int devWatchFD;          // Open from the first startIO until the backend is destroyed
+    int devWatchDescriptor;  // The watch on /dev, which exists only while I/O is running
+    int pollEventFD;         // Signaled by the poll thread when a poll completes
+    std::uint64_t wakeupTimeNS;  // Zero if no wakeup is pending
+    Delegate *delegate;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // defined(__linux__)
+
+#endif // !defined(__USBHID__USBHIDHidrawBackend__)
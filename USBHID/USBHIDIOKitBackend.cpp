@@ -0,0 +1,1083 @@
+//
+//  USBHIDIOKitBackend.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDIOKitBackend.h"
+
+#if defined(__APPLE__)
+
+
+BEGIN_NAMESPACE_MW
+
+
+namespace {
+    const CFTimeInterval distantFuture = 1.0e10;
+}
+
+
+USBHIDIOKitBackend::USBHIDIOKitBackend(const std::string &deviceTag, bool sharedIO) :
+    USBHIDBackend(deviceTag),
+    sharedService(sharedIO ? USBHIDIOKitService::instance() : boost::shared_ptr<USBHIDIOKitService>()),
+    hidManager(sharedIO ?
+               iohid::ManagerPtr() :
+               iohid::ManagerPtr::created(IOHIDManagerCreate(kCFAllocatorDefault, kIOHIDManagerOptionNone))),
+    hidDeviceOpened(false),
+    matchingCriteria(),
+    attachedDeviceInfo(),
+    deviceAttached(false),
+    detachTimeNS(0),
+    requiredChannelCount(0),
+    channelElementsStale(false),
+    ioRunLoop(nullptr),
+    ioRunning(false),
+    wakeupTimeNS(0),
+    frameOpen(false),
+    delegate(nullptr)
+{
+    CFRunLoopSourceContext stopSourceContext = { 0 };
+    stopSourceContext.info = this;
+    stopSourceContext.perform = &stopSourceCallback;
+    stopSource = RunLoopSourcePtr::created(CFRunLoopSourceCreate(kCFAllocatorDefault, 0, &stopSourceContext));
+    
+    CFRunLoopSourceContext pollSourceContext = { 0 };
+    pollSourceContext.info = this;
+    pollSourceContext.perform = &pollSourceCallback;
+    pollSource = RunLoopSourcePtr::created(CFRunLoopSourceCreate(kCFAllocatorDefault, 0, &pollSourceContext));
+    
+    // The timer stays scheduled while I/O is running, but its fire date is in the distant future unless a
+    // wakeup is pending
+    CFRunLoopTimerContext wakeupTimerContext = { 0 };
+    wakeupTimerContext.info = this;
+    wakeupTimer = RunLoopTimerPtr::created(CFRunLoopTimerCreate(kCFAllocatorDefault,
+                                                                 distantFuture,
+                                                                 distantFuture,
+                                                                 0,
+                                                                 0,
+                                                                 &wakeupTimerCallback,
+                                                                 &wakeupTimerContext));
+    
+    CFRunLoopObserverContext frameEndObserverContext = { 0 };
+    frameEndObserverContext.info = this;
+    frameEndObserver = RunLoopObserverPtr::created(CFRunLoopObserverCreate(kCFAllocatorDefault,
+                                                                           kCFRunLoopBeforeWaiting,
+                                                                           true,
+                                                                           0,
+                                                                           &frameEndObserverCallback,
+                                                                           &frameEndObserverContext));
+}
+
+
+USBHIDIOKitBackend::~USBHIDIOKitBackend() {
+    (void)stopIO();
+    if (sharedService) {
+        if (hidDeviceOpened) {
+            (void)IOHIDDeviceClose(hidDevice.get(), kIOHIDOptionsTypeNone);
+        }
+    } else {
+        (void)IOHIDManagerClose(hidManager.get(), kIOHIDOptionsTypeNone);
+    }
+}
+
+
+bool USBHIDIOKitBackend::openDevice(const DeviceMatchingCriteria &criteria) {
+    std::vector<iohid::DevicePtr> devices;
+    
+    if (sharedService) {
+        devices = sharedService->copyMatchingDevices(criteria.usagePage, criteria.usage);
+    } else {
+        cf::DictionaryPtr deviceMatchingDictionary = createMatchingDictionary(CFSTR(kIOHIDDeviceUsagePageKey),
+                                                                              criteria.usagePage,
+                                                                              CFSTR(kIOHIDDeviceUsageKey),
+                                                                              criteria.usage);
+        IOHIDManagerSetDeviceMatching(hidManager.get(), deviceMatchingDictionary.get());
+        
+        IOReturn status = IOHIDManagerOpen(hidManager.get(), kIOHIDOptionsTypeNone);
+        if (kIOReturnSuccess != status) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to open HID manager (status = %d)", status);
+            return false;
+        }
+        
+        cf::SetPtr matchingDevices = cf::SetPtr::owned(IOHIDManagerCopyDevices(hidManager.get()));
+        if (matchingDevices) {
+            std::vector<IOHIDDeviceRef> deviceRefs(CFSetGetCount(matchingDevices.get()));
+            CFSetGetValues(matchingDevices.get(), (const void **)(deviceRefs.data()));
+            BOOST_FOREACH(IOHIDDeviceRef device, deviceRefs) {
+                devices.push_back(iohid::DevicePtr::borrowed(device));
+            }
+        }
+    }
+    
+    const CFIndex numMatchingDevices = devices.size();
+    if (numMatchingDevices < 1) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN, "No matching HID devices found");
+        return false;
+    }
+    
+    if (numMatchingDevices == 1) {
+        
+        hidDevice = devices[0];
+        
+        if (criteria.preferredLocationID) {
+            CFNumberRef locationID = static_cast<CFNumberRef>(IOHIDDeviceGetProperty(hidDevice.get(), CFSTR(kIOHIDLocationIDKey)));
+            if (locationID) {
+                std::uint32_t value;
+                CFNumberGetValue(locationID, kCFNumberSInt32Type, &value);
+                if (criteria.preferredLocationID != value) {
+                    mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                             "Location ID for HID device \"%s\" (%lu) does not match preferred location ID (%lu)",
+                             deviceTag.c_str(),
+                             static_cast<unsigned long>(value),
+                             static_cast<unsigned long>(criteria.preferredLocationID));
+                }
+            }
+        }
+        
+    } else {
+        
+        std::ostringstream oss;
+        
+        oss << "Found multiple matching HID devices for \"" << deviceTag << "\":\n";
+        
+        for (CFIndex deviceNum = 0; deviceNum < numMatchingDevices; deviceNum++) {
+            oss << "\nDevice #" << std::dec << deviceNum + 1 << std::endl;
+            
+            IOHIDDeviceRef device = devices[deviceNum].get();
+            std::vector<char> stringBuffer(1024);
+            
+            CFStringRef product = static_cast<CFStringRef>(IOHIDDeviceGetProperty(device, CFSTR(kIOHIDProductKey)));
+            if (product) {
+                CFStringGetCString(product, stringBuffer.data(), stringBuffer.size(), kCFStringEncodingUTF8);
+                oss << "\tProduct:\t\t" << stringBuffer.data() << std::endl;
+            }
+            
+            CFStringRef manufacturer = static_cast<CFStringRef>(IOHIDDeviceGetProperty(device, CFSTR(kIOHIDManufacturerKey)));
+            if (manufacturer) {
+                CFStringGetCString(manufacturer, stringBuffer.data(), stringBuffer.size(), kCFStringEncodingUTF8);
+                oss << "\tManufacturer:\t" << stringBuffer.data() << std::endl;
+            }
+            
+            CFNumberRef locationID = static_cast<CFNumberRef>(IOHIDDeviceGetProperty(device, CFSTR(kIOHIDLocationIDKey)));
+            if (locationID) {
+                std::uint32_t value;
+                CFNumberGetValue(locationID, kCFNumberSInt32Type, &value);
+                
+                if (criteria.preferredLocationID == value) {
+                    hidDevice = iohid::DevicePtr::borrowed(device);
+                    break;
+                }
+                
+                oss << "\tLocation ID:\t" << std::dec << value << "\t(0x" << std::hex << value << ")" << std::endl;
+            }
+        }
+        
+        if (!hidDevice) {
+            oss << "\nPlease set the \"preferred_location_id\" attribute to the Location ID of the desired device.\n";
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "%s", oss.str().c_str());
+            return false;
+        }
+        
+    }
+    
+    // The shared manager is never opened, so each backend opens its own device
+    if (sharedService) {
+        IOReturn status = IOHIDDeviceOpen(hidDevice.get(), kIOHIDOptionsTypeNone);
+        if (kIOReturnSuccess != status) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to open HID device \"%s\" (status = %d)", deviceTag.c_str(), status);
+            return false;
+        }
+        hidDeviceOpened = true;
+    }
+    
+    matchingCriteria = criteria;
+    attachedDeviceInfo = readDeviceInfo(hidDevice.get());
+    deviceAttached = true;
+    
+    return true;
+}
+
+
+USBHIDBackend::DeviceInfo USBHIDIOKitBackend::getDeviceInfo() const {
+    return readDeviceInfo(hidDevice.get());
+}
+
+
+bool USBHIDIOKitBackend::prepareInputs(const std::vector<UsagePair> &usages,
+                                       std::size_t newRequiredChannelCount,
+                                       bool deliverAllValues,
+                                       bool rawReports)
+{
+    std::vector<cf::DictionaryPtr> matchingDicts;
+    std::vector<const void *> matchingArrayItems;
+    std::map<UsagePair, std::size_t> channelIndexByUsage;
+    
+    channelUsages = usages;
+    requiredChannelCount = newRequiredChannelCount;
+    channelElements.assign(channelUsages.size(), iohid::ElementPtr());
+    channelElementsStale = false;
+    channelIndexByCookie.clear();
+    inputValueMatchingArray = cf::ArrayPtr();
+    
+    for (std::size_t channelIndex = 0; channelIndex < channelUsages.size(); channelIndex++) {
+        const UsagePair &usagePair = channelUsages[channelIndex];
+        
+        cf::DictionaryPtr dict = createMatchingDictionary(CFSTR(kIOHIDElementUsagePageKey),
+                                                          usagePair.first,
+                                                          CFSTR(kIOHIDElementUsageKey),
+                                                          usagePair.second);
+        matchingDicts.push_back(dict);
+        matchingArrayItems.push_back(dict.get());
+        
+        channelIndexByUsage.insert(std::make_pair(usagePair, channelIndex));
+    }
+    
+    // Walk the device's element tree once, rather than once per channel, since devices like full keyboards
+    // may have hundreds of elements
+    cf::ArrayPtr allElements = cf::ArrayPtr::owned(IOHIDDeviceCopyMatchingElements(hidDevice.get(),
+                                                                                   nullptr,
+                                                                                   kIOHIDOptionsTypeNone));
+    if (allElements) {
+        const CFIndex elementCount = CFArrayGetCount(allElements.get());
+        
+        for (CFIndex index = 0; index < elementCount; index++) {
+            IOHIDElementRef element = (IOHIDElementRef)CFArrayGetValueAtIndex(allElements.get(), index);
+            IOHIDElementType elementType = IOHIDElementGetType(element);
+            
+            if ((elementType == kIOHIDElementTypeOutput) ||
+                (elementType == kIOHIDElementTypeFeature) ||
+                (elementType == kIOHIDElementTypeCollection))
+            {
+                continue;
+            }
+            
+            std::map<UsagePair, std::size_t>::const_iterator iter =
+                channelIndexByUsage.find(UsagePair(IOHIDElementGetUsagePage(element), IOHIDElementGetUsage(element)));
+            if (iter == channelIndexByUsage.end()) {
+                continue;
+            }
+            
+            const std::size_t channelIndex = iter->second;
+            if (!channelElements[channelIndex]) {
+                channelElements[channelIndex] = iohid::ElementPtr::borrowed(element);
+            }
+            
+            // Every element with this usage delivers values to the channel, so every element's cookie needs
+            // an entry in the lookup table
+            const IOHIDElementCookie cookie = IOHIDElementGetCookie(element);
+            if (cookie >= channelIndexByCookie.size()) {
+                channelIndexByCookie.resize(cookie + 1, noChannel);
+            }
+            channelIndexByCookie[cookie] = channelIndex;
+        }
+    }
+    
+    for (std::size_t channelIndex = 0; channelIndex < requiredChannelCount; channelIndex++) {
+        if (!channelElements[channelIndex]) {
+            const UsagePair &usagePair = channelUsages[channelIndex];
+            merror(M_IODEVICE_MESSAGE_DOMAIN,
+                   "No matching HID elements for usage page %ld, usage %ld",
+                   usagePair.first,
+                   usagePair.second);
+            return false;
+        }
+    }
+    
+    if (rawReports) {
+        if (!prepareInputReports(deliverAllValues)) {
+            return false;
+        }
+    } else {
+        reportDecoder.reset();
+        if (!deliverAllValues) {
+            inputValueMatchingArray = cf::ArrayPtr::created(CFArrayCreate(kCFAllocatorDefault,
+                                                                          &(matchingArrayItems.front()),
+                                                                          matchingArrayItems.size(),
+                                                                          &kCFTypeArrayCallBacks));
+        }
+    }
+    
+    // With shared I/O, the device is already scheduled, so callbacks are registered only while I/O is
+    // running
+    if (!sharedService) {
+        registerInputCallbacks();
+    }
+    
+    return true;
+}
+
+
+bool USBHIDIOKitBackend::prepareOutputs(const std::vector<OutputElement> &outputElements) {
+    reportEncoder.reset();
+    if (outputElements.empty()) {
+        return true;
+    }
+    
+    // Outputs are always sent as whole reports, so that all the changes to one report go out in a single
+    // transfer, rather than one per element
+    CFDataRef descriptorData = static_cast<CFDataRef>(IOHIDDeviceGetProperty(hidDevice.get(),
+                                                                             CFSTR(kIOHIDReportDescriptorKey)));
+    if (!descriptorData) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to obtain report descriptor for HID device \"%s\"", deviceTag.c_str());
+        return false;
+    }
+    
+    std::vector<usbhid::ReportEncoder::Target> targets;
+    BOOST_FOREACH(const OutputElement &element, outputElements) {
+        const usbhid::ReportEncoder::Target target = {
+            (element.feature ? usbhid::ReportType::Feature : usbhid::ReportType::Output),
+            usbhid::ReportDescriptor::makeUsage(element.usagePage, element.usage)
+        };
+        targets.push_back(target);
+    }
+    
+    try {
+        usbhid::ReportDescriptor descriptor(CFDataGetBytePtr(descriptorData), CFDataGetLength(descriptorData));
+        reportEncoder.reset(new usbhid::ReportEncoder(descriptor, targets));
+    } catch (const usbhid::ReportDescriptorError &e) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN, "Cannot use output channels with HID device \"%s\": %s", deviceTag.c_str(), e.what());
+        return false;
+    }
+    
+    for (std::size_t target = 0; target < targets.size(); target++) {
+        if (!(reportEncoder->isTargetMatched(target))) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN,
+                   "No matching HID %s report fields for usage page %ld, usage %ld",
+                   (outputElements[target].feature ? "feature" : "output"),
+                   outputElements[target].usagePage,
+                   outputElements[target].usage);
+            reportEncoder.reset();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+
+bool USBHIDIOKitBackend::readInitialValues(Delegate &delegate) {
+    if (!deviceAttached) {
+        // The values will arrive when the device is reattached
+        return true;
+    }
+    if (channelElementsStale && !refreshChannelElements()) {
+        return false;
+    }
+    
+    // Fetch every channel's value in a single request.  Any element missing from the result (or all of
+    // them, if the device doesn't support multiple-value requests) is fetched individually.
+    std::vector<const void *> elementArrayItems;
+    BOOST_FOREACH(const iohid::ElementPtr &element, channelElements) {
+        if (element) {
+            elementArrayItems.push_back(element.get());
+        }
+    }
+    
+    cf::DictionaryPtr elementValues;
+    if (!elementArrayItems.empty()) {
+        cf::ArrayPtr elementArray = cf::ArrayPtr::created(CFArrayCreate(kCFAllocatorDefault,
+                                                                        &(elementArrayItems.front()),
+                                                                        elementArrayItems.size(),
+                                                                        &kCFTypeArrayCallBacks));
+        CFDictionaryRef multipleValues = nullptr;
+        if (kIOReturnSuccess == IOHIDDeviceCopyValueMultiple(hidDevice.get(), elementArray.get(), &multipleValues)) {
+            elementValues = cf::DictionaryPtr::owned(multipleValues);
+        }
+    }
+    
+    for (std::size_t channelIndex = 0; channelIndex < channelElements.size(); channelIndex++) {
+        IOHIDElementRef element = channelElements[channelIndex].get();
+        IOHIDValueRef elementValue = nullptr;
+        
+        if (!element) {
+            continue;
+        }
+        
+        if (elementValues) {
+            elementValue = (IOHIDValueRef)CFDictionaryGetValue(elementValues.get(), element);
+        }
+        
+        if (!elementValue) {
+            IOReturn status = IOHIDDeviceGetValue(hidDevice.get(), element, &elementValue);
+            if (kIOReturnSuccess != status) {
+                merror(M_IODEVICE_MESSAGE_DOMAIN, "HID value get failed: %s", mach_error_string(status));
+                return false;
+            }
+        }
+        
+        // Ensure that the first input report (or poll) doesn't re-post the initial value
+        const UsagePair &usagePair = channelUsages[channelIndex];
+        const std::uint32_t targetUsage = usbhid::ReportDescriptor::makeUsage(usagePair.first, usagePair.second);
+        if (reportDecoder) {
+            reportDecoder->seedValue(targetUsage, IOHIDValueGetIntegerValue(elementValue));
+        }
+        if (pollDecoder) {
+            pollDecoder->seedValue(targetUsage, IOHIDValueGetIntegerValue(elementValue));
+        }
+        handleInputValue(elementValue, delegate);
+    }
+    
+    frameOpen = false;
+    delegate.handleFrameEnd();
+    
+    return true;
+}
+
+
+bool USBHIDIOKitBackend::startIO(Delegate &newDelegate) {
+    if (!isRunning()) {
+        delegate = &newDelegate;
+        
+        if (sharedService) {
+            if (!(ioThreadPolicy.isDefault())) {
+                mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                         "HID device \"%s\" uses shared I/O, so its I/O thread scheduling settings are ignored",
+                         deviceTag.c_str());
+            }
+            sharedService->perform(boost::bind(&USBHIDIOKitBackend::scheduleWithSharedRunLoop, this, _1));
+        } else {
+            boost::promise<CFRunLoopRef> runLoopStarted;
+            boost::unique_future<CFRunLoopRef> runLoopStartedFuture = runLoopStarted.get_future();
+            ioRunning = true;
+            
+            try {
+                runLoopThread = boost::thread(boost::bind(&USBHIDIOKitBackend::runLoop,
+                                                          this,
+                                                          boost::ref(runLoopStarted)));
+            } catch (const boost::thread_resource_error &e) {
+                ioRunning = false;
+                merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start HID device: %s", e.what());
+                return false;
+            }
+            
+            // Wait until the HID manager is scheduled, so that no input is missed and stopIO can always find
+            // the run loop
+            ioRunLoop = runLoopStartedFuture.get();
+        }
+        
+        // The poll thread wakes ioRunLoop, so it can't start any earlier
+        if (poller && !(poller->start(ioThreadPolicy))) {
+            (void)stopIO();
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+
+bool USBHIDIOKitBackend::stopIO() {
+    if (isRunning()) {
+        // Stop the poll thread first, so that it never wakes a run loop that's gone
+        if (poller) {
+            poller->stop();
+        }
+        
+        if (sharedService) {
+            // Once this returns, no callbacks for this backend can be running or pending
+            sharedService->perform(boost::bind(&USBHIDIOKitBackend::unscheduleFromSharedRunLoop, this, _1));
+        } else {
+            // Wake the I/O thread immediately, rather than waiting for its run loop to time out
+            ioRunning = false;
+            CFRunLoopSourceSignal(stopSource.get());
+            CFRunLoopWakeUp(ioRunLoop);
+            
+            try {
+                runLoopThread.join();
+            } catch (const boost::system::system_error &e) {
+                merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to stop HID device: %s", e.what());
+                return false;
+            }
+        }
+        
+        ioRunLoop = nullptr;
+        
+        // Discard any pending wakeup
+        wakeupTimeNS = 0;
+        CFRunLoopTimerSetNextFireDate(wakeupTimer.get(), CFAbsoluteTimeGetCurrent() + distantFuture);
+    }
+    
+    return true;
+}
+
+
+void USBHIDIOKitBackend::requestWakeup(std::uint64_t timeNS) {
+    if (!wakeupTimeNS || (timeNS < wakeupTimeNS)) {
+        wakeupTimeNS = timeNS;
+        const double delaySeconds = double(std::int64_t(timeNS - currentTimeNS())) / 1.0e9;
+        CFRunLoopTimerSetNextFireDate(wakeupTimer.get(), CFAbsoluteTimeGetCurrent() + std::max(delaySeconds, 0.0));
+    }
+}
+
+
+bool USBHIDIOKitBackend::preparePolling() {
+    pollDecoder.reset();
+    std::size_t maxReportSize = reportBuffer.size();
+    
+    if (!reportDecoder) {
+        CFDataRef descriptorData = static_cast<CFDataRef>(IOHIDDeviceGetProperty(hidDevice.get(),
+                                                                                 CFSTR(kIOHIDReportDescriptorKey)));
+        if (!descriptorData) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to obtain report descriptor for HID device \"%s\"", deviceTag.c_str());
+            return false;
+        }
+        
+        std::vector<std::uint32_t> targetUsages;
+        BOOST_FOREACH(const UsagePair &usagePair, channelUsages) {
+            targetUsages.push_back(usbhid::ReportDescriptor::makeUsage(usagePair.first, usagePair.second));
+        }
+        
+        try {
+            usbhid::ReportDescriptor descriptor(CFDataGetBytePtr(descriptorData), CFDataGetLength(descriptorData));
+            pollDecoder.reset(new usbhid::ReportDecoder(descriptor, targetUsages, false));
+            maxReportSize = descriptor.getMaxReportSize(usbhid::ReportType::Input);
+        } catch (const usbhid::ReportDescriptorError &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Cannot poll HID device \"%s\": %s", deviceTag.c_str(), e.what());
+            return false;
+        }
+        selectDeviceProfile(*pollDecoder);
+    }
+    
+    // Request each report that carries a value we care about once per poll
+    const usbhid::ReportDecoder &decoder = (reportDecoder ? *reportDecoder : *pollDecoder);
+    std::array<bool, 256> reportIDsSeen;
+    reportIDsSeen.fill(false);
+    std::vector<std::uint8_t> pollReportIDs;
+    BOOST_FOREACH(const usbhid::ExtractionOp &op, decoder.getExtractor().getOps()) {
+        if (!reportIDsSeen[op.reportID]) {
+            reportIDsSeen[op.reportID] = true;
+            pollReportIDs.push_back(op.reportID);
+        }
+    }
+    
+    if (pollReportIDs.empty() || maxReportSize == 0) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN, "HID device \"%s\" has no input reports to poll", deviceTag.c_str());
+        pollDecoder.reset();
+        return false;
+    }
+    
+    poller.reset(new USBHIDInputPoller(deviceTag,
+                                       pollReportIDs,
+                                       maxReportSize,
+                                       boost::bind(&USBHIDIOKitBackend::requestPolledReport, this, _1, _2, _3),
+                                       boost::bind(&USBHIDIOKitBackend::notifyPollCompleted, this)));
+    
+    return true;
+}
+
+
+bool USBHIDIOKitBackend::pollInputs(Delegate &delegate, std::uint64_t sampleTimeNS) {
+    if (!deviceAttached || !poller) {
+        return false;
+    }
+    return poller->requestPoll(sampleTimeNS);
+}
+
+
+std::size_t USBHIDIOKitBackend::requestPolledReport(std::uint8_t reportID,
+                                                    std::uint8_t *buffer,
+                                                    std::size_t bufferSize)
+{
+    // Hold a reference to the device, so that the I/O thread can release or replace hidDevice (if the
+    // device is removed) without waiting for the request to finish
+    iohid::DevicePtr device;
+    {
+        boost::mutex::scoped_lock lock(outputMutex);
+        if (!deviceAttached) {
+            return 0;
+        }
+        device = hidDevice;
+    }
+    
+    CFIndex reportLength = bufferSize;
+    if (kIOReturnSuccess != IOHIDDeviceGetReport(device.get(), kIOHIDReportTypeInput, reportID, buffer, &reportLength)) {
+        return 0;
+    }
+    return reportLength;
+}
+
+
+void USBHIDIOKitBackend::notifyPollCompleted() {
+    CFRunLoopSourceSignal(pollSource.get());
+    CFRunLoopWakeUp(ioRunLoop);
+}
+
+
+void USBHIDIOKitBackend::deliverPolledReports() {
+    std::uint64_t sampleTimeNS;
+    if (!(poller->takeCompletedPoll(sampleTimeNS))) {
+        return;
+    }
+    
+    delegate->handlePollBegin();
+    
+    usbhid::ReportDecoder &decoder = (reportDecoder ? *reportDecoder : *pollDecoder);
+    bool success = true;
+    for (std::size_t reportIndex = 0; reportIndex < poller->getReportCount(); reportIndex++) {
+        const std::size_t reportLength = poller->getReportLength(reportIndex);
+        if (!reportLength) {
+            success = false;
+            continue;
+        }
+        deliverReportValues(decoder, poller->getReportData(reportIndex), reportLength, sampleTimeNS, *delegate);
+    }
+    
+    // All the values from one poll form a single frame
+    frameOpen = false;
+    delegate->handleFrameEnd();
+    
+    delegate->handlePollEnd(success);
+}
+
+
+bool USBHIDIOKitBackend::writeOutputs(const std::vector<OutputValue> &values, std::size_t &transferCount) {
+    transferCount = 0;
+    if (!reportEncoder) {
+        return values.empty();
+    }
+    
+    BOOST_FOREACH(const OutputValue &value, values) {
+        reportEncoder->setValue(value.outputIndex, std::int32_t(value.integerValue));
+    }
+    
+    boost::mutex::scoped_lock lock(outputMutex);
+    
+    const std::size_t failureCount = reportEncoder->sendDirtyReports([this, &transferCount](std::size_t reportIndex) {
+        if (!deviceAttached) {
+            return false;
+        }
+        
+        // IOKit expects the report ID byte only if the device uses report IDs
+        const std::vector<std::uint8_t> &report = reportEncoder->getReportData(reportIndex);
+        const std::size_t skip = (reportEncoder->usesReportIDs() ? 0 : 1);
+        const IOHIDReportType reportType = ((reportEncoder->getReportType(reportIndex) == usbhid::ReportType::Feature) ?
+                                            kIOHIDReportTypeFeature :
+                                            kIOHIDReportTypeOutput);
+        
+        if (kIOReturnSuccess != IOHIDDeviceSetReport(hidDevice.get(),
+                                                     reportType,
+                                                     reportEncoder->getReportID(reportIndex),
+                                                     report.data() + skip,
+                                                     report.size() - skip))
+        {
+            return false;
+        }
+        transferCount++;
+        return true;
+    });
+    
+    return (failureCount == 0);
+}
+
+
+cf::DictionaryPtr USBHIDIOKitBackend::createMatchingDictionary(CFStringRef usagePageKey,
+                                                               long usagePageValue,
+                                                               CFStringRef usageKey,
+                                                               long usageValue)
+{
+    cf::NumberPtr usagePage = cf::NumberPtr::created(CFNumberCreate(kCFAllocatorDefault,
+                                                                    kCFNumberLongType,
+                                                                    &usagePageValue));
+    
+    cf::NumberPtr usage = cf::NumberPtr::created(CFNumberCreate(kCFAllocatorDefault,
+                                                                kCFNumberLongType,
+                                                                &usageValue));
+    
+    const CFIndex numValues = 2;
+    const void *keys[numValues] = {usagePageKey, usageKey};
+    const void *values[numValues] = {usagePage.get(), usage.get()};
+    
+    return cf::DictionaryPtr::created(CFDictionaryCreate(kCFAllocatorDefault,
+                                                         keys,
+                                                         values,
+                                                         numValues,
+                                                         &kCFTypeDictionaryKeyCallBacks,
+                                                         &kCFTypeDictionaryValueCallBacks));
+}
+
+
+std::uint32_t USBHIDIOKitBackend::getIntegerProperty(IOHIDDeviceRef device, CFStringRef key) {
+    std::uint32_t value = 0;
+    CFNumberRef number = static_cast<CFNumberRef>(IOHIDDeviceGetProperty(device, key));
+    if (number) {
+        CFNumberGetValue(number, kCFNumberSInt32Type, &value);
+    }
+    return value;
+}
+
+
+USBHIDBackend::DeviceInfo USBHIDIOKitBackend::readDeviceInfo(IOHIDDeviceRef device) {
+    DeviceInfo info = {
+        getIntegerProperty(device, CFSTR(kIOHIDVendorIDKey)),
+        getIntegerProperty(device, CFSTR(kIOHIDProductIDKey)),
+        getIntegerProperty(device, CFSTR(kIOHIDVersionNumberKey)),
+        getIntegerProperty(device, CFSTR(kIOHIDLocationIDKey))
+    };
+    
+    CFStringRef product = static_cast<CFStringRef>(IOHIDDeviceGetProperty(device, CFSTR(kIOHIDProductKey)));
+    if (product) {
+        std::vector<char> stringBuffer(1024);
+        if (CFStringGetCString(product, stringBuffer.data(), stringBuffer.size(), kCFStringEncodingUTF8)) {
+            info.product = stringBuffer.data();
+        }
+    }
+    
+    return info;
+}
+
+
+void USBHIDIOKitBackend::inputValueCallback(void *context, IOReturn result, void *sender, IOHIDValueRef value) {
+    USBHIDIOKitBackend &backend = *static_cast<USBHIDIOKitBackend *>(context);
+    backend.handleInputValue(value, *(backend.delegate));
+}
+
+
+void USBHIDIOKitBackend::inputReportCallback(void *context,
+                                             IOReturn result,
+                                             void *sender,
+                                             IOHIDReportType type,
+                                             uint32_t reportID,
+                                             uint8_t *report,
+                                             CFIndex reportLength,
+                                             uint64_t timeStamp)
+{
+    static_cast<USBHIDIOKitBackend *>(context)->handleInputReport(report, reportLength, timeStamp);
+}
+
+
+void USBHIDIOKitBackend::deviceRemovalCallback(void *context, IOReturn result, void *sender) {
+    static_cast<USBHIDIOKitBackend *>(context)->handleDeviceRemoved();
+}
+
+
+void USBHIDIOKitBackend::deviceMatchingCallback(void *context, IOReturn result, void *sender, IOHIDDeviceRef device) {
+    static_cast<USBHIDIOKitBackend *>(context)->handleDeviceMatched(device);
+}
+
+
+void USBHIDIOKitBackend::stopSourceCallback(void *info) {
+    CFRunLoopStop(CFRunLoopGetCurrent());
+}
+
+
+void USBHIDIOKitBackend::pollSourceCallback(void *info) {
+    static_cast<USBHIDIOKitBackend *>(info)->deliverPolledReports();
+}
+
+
+void USBHIDIOKitBackend::wakeupTimerCallback(CFRunLoopTimerRef timer, void *info) {
+    USBHIDIOKitBackend &backend = *static_cast<USBHIDIOKitBackend *>(info);
+    
+    backend.wakeupTimeNS = 0;
+    CFRunLoopTimerSetNextFireDate(timer, CFAbsoluteTimeGetCurrent() + distantFuture);
+    
+    // The delegate may request another wakeup from within this call
+    backend.delegate->handleWakeup(currentTimeNS());
+}
+
+
+void USBHIDIOKitBackend::frameEndObserverCallback(CFRunLoopObserverRef observer,
+                                                  CFRunLoopActivity activity,
+                                                  void *info)
+{
+    USBHIDIOKitBackend &backend = *static_cast<USBHIDIOKitBackend *>(info);
+    if (backend.frameOpen) {
+        backend.frameOpen = false;
+        backend.delegate->handleFrameEnd();
+    }
+}
+
+
+std::uint64_t USBHIDIOKitBackend::currentTimeNS() {
+    return AudioConvertHostTimeToNanos(AudioGetCurrentHostTime());
+}
+
+
+bool USBHIDIOKitBackend::prepareInputReports(bool deliverAllValues) {
+    CFDataRef descriptorData = static_cast<CFDataRef>(IOHIDDeviceGetProperty(hidDevice.get(),
+                                                                             CFSTR(kIOHIDReportDescriptorKey)));
+    if (!descriptorData) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to obtain report descriptor for HID device \"%s\"", deviceTag.c_str());
+        return false;
+    }
+    
+    std::vector<std::uint32_t> targetUsages;
+    BOOST_FOREACH(const UsagePair &usagePair, channelUsages) {
+        targetUsages.push_back(usbhid::ReportDescriptor::makeUsage(usagePair.first, usagePair.second));
+    }
+    
+    std::size_t maxReportSize;
+    
+    try {
+        usbhid::ReportDescriptor descriptor(CFDataGetBytePtr(descriptorData), CFDataGetLength(descriptorData));
+        reportDecoder.reset(new usbhid::ReportDecoder(descriptor, targetUsages, deliverAllValues));
+        maxReportSize = descriptor.getMaxReportSize(usbhid::ReportType::Input);
+    } catch (const usbhid::ReportDescriptorError &e) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN, "Cannot use raw reports with HID device \"%s\": %s", deviceTag.c_str(), e.what());
+        return false;
+    }
+    
+    for (std::size_t target = 0; target < requiredChannelCount; target++) {
+        if (!(reportDecoder->getExtractor().isTargetMatched(target))) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN,
+                   "No matching input report fields for usage page %u, usage %u",
+                   usbhid::ReportDescriptor::usagePageOf(targetUsages[target]),
+                   usbhid::ReportDescriptor::usageOf(targetUsages[target]));
+            return false;
+        }
+    }
+    
+    // Prefer the size reported by the OS, in case the descriptor parser missed something
+    CFNumberRef maxInputReportSize = static_cast<CFNumberRef>(IOHIDDeviceGetProperty(hidDevice.get(),
+                                                                                     CFSTR(kIOHIDMaxInputReportSizeKey)));
+    if (maxInputReportSize) {
+        long value;
+        CFNumberGetValue(maxInputReportSize, kCFNumberLongType, &value);
+        maxReportSize = std::max(maxReportSize, std::size_t(value));
+    }
+    if (maxReportSize == 0) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN, "HID device \"%s\" has no input reports", deviceTag.c_str());
+        return false;
+    }
+    
+    selectDeviceProfile(*reportDecoder);
+    reportBuffer.assign(maxReportSize, 0);
+    
+    return true;
+}
+
+
+void USBHIDIOKitBackend::runLoop(boost::promise<CFRunLoopRef> &runLoopStarted) {
+    ioThreadPolicy.applyToCurrentThread(deviceTag, "I/O");
+    
+    CFRunLoopRef runLoop = CFRunLoopGetCurrent();
+    
+    IOHIDManagerRegisterDeviceMatchingCallback(hidManager.get(), &deviceMatchingCallback, this);
+    IOHIDManagerScheduleWithRunLoop(hidManager.get(), runLoop, kCFRunLoopDefaultMode);
+    CFRunLoopAddSource(runLoop, stopSource.get(), kCFRunLoopDefaultMode);
+    CFRunLoopAddSource(runLoop, pollSource.get(), kCFRunLoopDefaultMode);
+    CFRunLoopAddTimer(runLoop, wakeupTimer.get(), kCFRunLoopDefaultMode);
+    CFRunLoopAddObserver(runLoop, frameEndObserver.get(), kCFRunLoopDefaultMode);
+    
+    BOOST_SCOPE_EXIT(&hidManager, &stopSource, &pollSource, &wakeupTimer, &frameEndObserver, runLoop) {
+        CFRunLoopRemoveObserver(runLoop, frameEndObserver.get(), kCFRunLoopDefaultMode);
+        CFRunLoopRemoveTimer(runLoop, wakeupTimer.get(), kCFRunLoopDefaultMode);
+        CFRunLoopRemoveSource(runLoop, pollSource.get(), kCFRunLoopDefaultMode);
+        CFRunLoopRemoveSource(runLoop, stopSource.get(), kCFRunLoopDefaultMode);
+        IOHIDManagerUnscheduleFromRunLoop(hidManager.get(), runLoop, kCFRunLoopDefaultMode);
+        IOHIDManagerRegisterDeviceMatchingCallback(hidManager.get(), nullptr, nullptr);
+    } BOOST_SCOPE_EXIT_END
+    
+    runLoopStarted.set_value(runLoop);
+    
+    // Sleep until input arrives or stopIO signals the stop source.  The stop source also ensures that the
+    // run loop always has at least one source, so CFRunLoopRunInMode never returns immediately.
+    while (ioRunning) {
+        (void)CFRunLoopRunInMode(kCFRunLoopDefaultMode, 1.0e10, false);
+    }
+}
+
+
+void USBHIDIOKitBackend::scheduleWithSharedRunLoop(CFRunLoopRef runLoop) {
+    if (deviceAttached) {
+        registerInputCallbacks();
+    }
+    sharedService->addDeviceMatchingListener(*this);
+    CFRunLoopAddSource(runLoop, pollSource.get(), kCFRunLoopDefaultMode);
+    CFRunLoopAddTimer(runLoop, wakeupTimer.get(), kCFRunLoopDefaultMode);
+    CFRunLoopAddObserver(runLoop, frameEndObserver.get(), kCFRunLoopDefaultMode);
+    ioRunLoop = runLoop;
+}
+
+
+void USBHIDIOKitBackend::unscheduleFromSharedRunLoop(CFRunLoopRef runLoop) {
+    CFRunLoopRemoveObserver(runLoop, frameEndObserver.get(), kCFRunLoopDefaultMode);
+    CFRunLoopRemoveTimer(runLoop, wakeupTimer.get(), kCFRunLoopDefaultMode);
+    CFRunLoopRemoveSource(runLoop, pollSource.get(), kCFRunLoopDefaultMode);
+    sharedService->removeDeviceMatchingListener(*this);
+    if (deviceAttached) {
+        unregisterInputCallbacks();
+    }
+}
+
+
+bool USBHIDIOKitBackend::refreshChannelElements() {
+    // The reattached device has the same element layout as the original, so the cookie index is still
+    // valid, and only the element references need to be replaced
+    channelElements.assign(channelUsages.size(), iohid::ElementPtr());
+    
+    cf::ArrayPtr allElements = cf::ArrayPtr::owned(IOHIDDeviceCopyMatchingElements(hidDevice.get(),
+                                                                                   nullptr,
+                                                                                   kIOHIDOptionsTypeNone));
+    if (allElements) {
+        const CFIndex elementCount = CFArrayGetCount(allElements.get());
+        for (CFIndex index = 0; index < elementCount; index++) {
+            IOHIDElementRef element = (IOHIDElementRef)CFArrayGetValueAtIndex(allElements.get(), index);
+            const std::size_t channelIndex = lookupChannelIndex(IOHIDElementGetCookie(element));
+            if ((channelIndex != noChannel) && !channelElements[channelIndex]) {
+                channelElements[channelIndex] = iohid::ElementPtr::borrowed(element);
+            }
+        }
+    }
+    
+    for (std::size_t channelIndex = 0; channelIndex < requiredChannelCount; channelIndex++) {
+        if (!channelElements[channelIndex]) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Elements of reattached HID device \"%s\" have changed", deviceTag.c_str());
+            return false;
+        }
+    }
+    
+    channelElementsStale = false;
+    return true;
+}
+
+
+void USBHIDIOKitBackend::registerInputCallbacks() {
+    IOHIDDeviceRegisterRemovalCallback(hidDevice.get(), &deviceRemovalCallback, this);
+    
+    if (reportDecoder) {
+        IOHIDDeviceRegisterInputReportWithTimeStampCallback(hidDevice.get(),
+                                                            reportBuffer.data(),
+                                                            reportBuffer.size(),
+                                                            &inputReportCallback,
+                                                            this);
+    } else {
+        if (inputValueMatchingArray) {
+            IOHIDDeviceSetInputValueMatchingMultiple(hidDevice.get(), inputValueMatchingArray.get());
+        }
+        IOHIDDeviceRegisterInputValueCallback(hidDevice.get(), &inputValueCallback, this);
+    }
+}
+
+
+void USBHIDIOKitBackend::unregisterInputCallbacks() {
+    IOHIDDeviceRegisterRemovalCallback(hidDevice.get(), nullptr, nullptr);
+    
+    if (reportDecoder) {
+        IOHIDDeviceRegisterInputReportWithTimeStampCallback(hidDevice.get(),
+                                                            reportBuffer.data(),
+                                                            reportBuffer.size(),
+                                                            nullptr,
+                                                            nullptr);
+    } else {
+        IOHIDDeviceRegisterInputValueCallback(hidDevice.get(), nullptr, nullptr);
+    }
+}
+
+
+void USBHIDIOKitBackend::handleDeviceRemoved() {
+    if (!deviceAttached) {
+        return;
+    }
+    
+    {
+        boost::mutex::scoped_lock lock(outputMutex);
+        deviceAttached = false;
+    }
+    detachTimeNS = currentTimeNS();
+    channelElementsStale = true;
+    
+    if (frameOpen) {
+        frameOpen = false;
+        delegate->handleFrameEnd();
+    }
+    
+    if (sharedService) {
+        unregisterInputCallbacks();
+        if (hidDeviceOpened) {
+            (void)IOHIDDeviceClose(hidDevice.get(), kIOHIDOptionsTypeNone);
+            hidDeviceOpened = false;
+        }
+    }
+    
+    delegate->handleDeviceRemoved();
+}
+
+
+void USBHIDIOKitBackend::handleDeviceMatched(IOHIDDeviceRef device) {
+    if (deviceAttached || !IOHIDDeviceConformsTo(device, matchingCriteria.usagePage, matchingCriteria.usage)) {
+        return;
+    }
+    
+    // The element index is reusable only if the new device is the same model as the original
+    const DeviceInfo info = readDeviceInfo(device);
+    if ((info.vendorID != attachedDeviceInfo.vendorID) ||
+        (info.productID != attachedDeviceInfo.productID) ||
+        (info.versionNumber != attachedDeviceInfo.versionNumber) ||
+        (matchingCriteria.preferredLocationID && (info.locationID != matchingCriteria.preferredLocationID)))
+    {
+        return;
+    }
+    
+    if (sharedService) {
+        IOReturn status = IOHIDDeviceOpen(device, kIOHIDOptionsTypeNone);
+        if (kIOReturnSuccess != status) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN,
+                   "Unable to open reattached HID device \"%s\" (status = %d)",
+                   deviceTag.c_str(),
+                   status);
+            return;
+        }
+        hidDeviceOpened = true;
+    }
+    
+    {
+        boost::mutex::scoped_lock lock(outputMutex);
+        hidDevice = iohid::DevicePtr::borrowed(device);
+        deviceAttached = true;
+    }
+    registerInputCallbacks();
+    
+    delegate->handleDeviceReattached(currentTimeNS() - detachTimeNS);
+}
+
+
+void USBHIDIOKitBackend::handleInputValue(IOHIDValueRef value, Delegate &delegate) {
+    IOHIDElementRef element = IOHIDValueGetElement(value);
+    const InputValue inputValue = {
+        lookupChannelIndex(IOHIDElementGetCookie(element)),
+        IOHIDElementGetUsagePage(element),
+        IOHIDElementGetUsage(element),
+        IOHIDValueGetIntegerValue(value),
+        AudioConvertHostTimeToNanos(IOHIDValueGetTimeStamp(value))
+    };
+    
+    frameOpen = true;
+    delegate.handleInputValue(inputValue);
+}
+
+
+void USBHIDIOKitBackend::handleInputReport(const std::uint8_t *report, CFIndex reportLength, std::uint64_t timestamp) {
+    deliverReportValues(*reportDecoder, report, reportLength, AudioConvertHostTimeToNanos(timestamp), *delegate);
+    delegate->handleFrameEnd();
+}
+
+
+void USBHIDIOKitBackend::deliverReportValues(usbhid::ReportDecoder &decoder,
+                                             const std::uint8_t *report,
+                                             CFIndex reportLength,
+                                             std::uint64_t timestampNS,
+                                             Delegate &delegate)
+{
+    decoder.decode(report, reportLength, [timestampNS, &delegate](const usbhid::ExtractionOp &op,
+                                                                  std::int32_t integerValue)
+    {
+        const InputValue inputValue = {
+            ((op.target == usbhid::ReportExtractor::noTarget) ? noChannel : op.target),
+            usbhid::ReportDescriptor::usagePageOf(op.usage),
+            usbhid::ReportDescriptor::usageOf(op.usage),
+            integerValue,
+            timestampNS
+        };
+        
+        delegate.handleInputValue(inputValue);
+    });
+}
+
+
+END_NAMESPACE_MW
+
+
+#endif // defined(__APPLE__)
@@ -0,0 +1,164 @@
+//
+//  USBHIDIOKitBackend.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDIOKitBackend__
+#define __USBHID__USBHIDIOKitBackend__
+
+#if defined(__APPLE__)
+
+#include "USBHIDBackend.h"
+#include "USBHIDInputPoller.h"
+#include "USBHIDIOKitService.h"
+#include "USBHIDReportDecoder.h"
+#include "USBHIDReportEncoder.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Receives input via IOKit's HID manager.  By default, each backend has its own manager and run loop
+// thread.  With shared I/O, all backends use the manager and thread of a single USBHIDIOKitService.
+//
+// If the device is removed while I/O is running, the backend waits for a device of the same model (and,
+// if a preferred location ID was given, at that location) to appear, and then attaches to it, reusing the
+// existing element index.
+//
+class USBHIDIOKitBackend : public USBHIDBackend, private USBHIDIOKitService::DeviceMatchingListener {
+    
+public:
+    USBHIDIOKitBackend(const std::string &deviceTag, bool sharedIO);
+    ~USBHIDIOKitBackend();
+    
+    bool openDevice(const DeviceMatchingCriteria &criteria) MW_OVERRIDE;
+    DeviceInfo getDeviceInfo() const MW_OVERRIDE;
+    bool prepareInputs(const std::vector<UsagePair> &channelUsages,
+                       std::size_t requiredChannelCount,
+                       bool deliverAllValues,
+                       bool rawReports) MW_OVERRIDE;
+    bool readInitialValues(Delegate &delegate) MW_OVERRIDE;
+    bool prepareOutputs(const std::vector<OutputElement> &outputElements) MW_OVERRIDE;
+    bool startIO(Delegate &delegate) MW_OVERRIDE;
+    bool stopIO() MW_OVERRIDE;
+    bool isRunning() const MW_OVERRIDE { return (ioRunLoop != nullptr); }
+    void requestWakeup(std::uint64_t timeNS) MW_OVERRIDE;
+    bool preparePolling() MW_OVERRIDE;
+    bool pollInputs(Delegate &delegate, std::uint64_t sampleTimeNS) MW_OVERRIDE;
+    bool writeOutputs(const std::vector<OutputValue> &values, std::size_t &transferCount) MW_OVERRIDE;
+    
+private:
+    static cf::DictionaryPtr createMatchingDictionary(CFStringRef usagePageKey,
+                                                      long usagePage,
+                                                      CFStringRef usageKey,
+                                                      long usage);
+    static std::uint32_t getIntegerProperty(IOHIDDeviceRef device, CFStringRef key);
+    static DeviceInfo readDeviceInfo(IOHIDDeviceRef device);
+    static void deviceRemovalCallback(void *context, IOReturn result, void *sender);
+    static void deviceMatchingCallback(void *context, IOReturn result, void *sender, IOHIDDeviceRef device);
+    static void inputValueCallback(void *context, IOReturn result, void *sender, IOHIDValueRef value);
+    static void inputReportCallback(void *context,
+                                    IOReturn result,
+                                    void *sender,
+                                    IOHIDReportType type,
+                                    uint32_t reportID,
+                                    uint8_t *report,
+                                    CFIndex reportLength,
+                                    uint64_t timeStamp);
+    static void stopSourceCallback(void *info);
+    static void pollSourceCallback(void *info);
+    static void wakeupTimerCallback(CFRunLoopTimerRef timer, void *info);
+    static void frameEndObserverCallback(CFRunLoopObserverRef observer, CFRunLoopActivity activity, void *info);
+    static std::uint64_t currentTimeNS();
+    
+    bool prepareInputReports(bool deliverAllValues);
+    bool refreshChannelElements();
+    void registerInputCallbacks();
+    void unregisterInputCallbacks();
+    void handleDeviceRemoved();
+    void handleDeviceMatched(IOHIDDeviceRef device) MW_OVERRIDE;
+    void runLoop(boost::promise<CFRunLoopRef> &runLoopStarted);
+    void scheduleWithSharedRunLoop(CFRunLoopRef runLoop);
+    void unscheduleFromSharedRunLoop(CFRunLoopRef runLoop);
+    void handleInputValue(IOHIDValueRef value, Delegate &delegate);
+    void handleInputReport(const std::uint8_t *report, CFIndex reportLength, std::uint64_t timestamp);
+    std::size_t requestPolledReport(std::uint8_t reportID, std::uint8_t *buffer, std::size_t bufferSize);
+    void notifyPollCompleted();
+    void deliverPolledReports();
+    void deliverReportValues(usbhid::ReportDecoder &decoder,
+                             const std::uint8_t *report,
+                             CFIndex reportLength,
+                             std::uint64_t timestampNS,
+                             Delegate &delegate);
+    
+    std::size_t lookupChannelIndex(IOHIDElementCookie cookie) const {
+        return ((cookie < channelIndexByCookie.size()) ? channelIndexByCookie[cookie] : noChannel);
+    }
+    
+    const boost::shared_ptr<USBHIDIOKitService> sharedService;
+    const iohid::ManagerPtr hidManager;  // Null if using shared I/O
+    iohid::DevicePtr hidDevice;
+    bool hidDeviceOpened;  // Used only with shared I/O
+    
+    // Used to recognize the device if it's removed and reattached
+    DeviceMatchingCriteria matchingCriteria;
+    DeviceInfo attachedDeviceInfo;
+    bool deviceAttached;
+    std::uint64_t detachTimeNS;
+    
+    // Built by prepareInputs and never modified afterwards, so the input path can read it without locking
+    std::vector<std::size_t> channelIndexByCookie;
+    
+    // Indexed by channel index.  Channels beyond requiredChannelCount may have no element.
+    std::vector<UsagePair> channelUsages;
+    std::size_t requiredChannelCount;
+    std::vector<iohid::ElementPtr> channelElements;
+    bool channelElementsStale;  // After reattaching, the elements belong to the old device
+    
+    // Null if delivering all values
+    cf::ArrayPtr inputValueMatchingArray;
+    
+    // Used only in raw report mode
+    boost::scoped_ptr<usbhid::ReportDecoder> reportDecoder;
+    std::vector<std::uint8_t> reportBuffer;
+    
+    // Used only when polling.  In raw report mode, polled reports are decoded by reportDecoder, so that a
+    // value already delivered by a report isn't delivered again; otherwise, pollDecoder is used.  The poll
+    // thread signals pollSource when a poll completes.
+    boost::scoped_ptr<usbhid::ReportDecoder> pollDecoder;
+    boost::scoped_ptr<USBHIDInputPoller> poller;
+    RunLoopSourcePtr pollSource;
+    
+    // Used only by the thread that writes outputs.  Null if there are no output channels.
+    boost::scoped_ptr<usbhid::ReportEncoder> reportEncoder;
+    
+    // Held while writing outputs, while the poll thread copies hidDevice, and while the I/O thread detaches
+    // or replaces hidDevice
+    boost::mutex outputMutex;
+    
+    boost::thread runLoopThread;
+    CFRunLoopRef ioRunLoop;
+    std::atomic_bool ioRunning;
+    RunLoopSourcePtr stopSource;
+    RunLoopTimerPtr wakeupTimer;
+    std::uint64_t wakeupTimeNS;  // Zero if no wakeup is pending
+    
+    // Value callbacks don't indicate where one report ends, so a frame ends whenever the run loop is
+    // about to sleep
+    RunLoopObserverPtr frameEndObserver;
+    bool frameOpen;
+    Delegate *delegate;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // defined(__APPLE__)
+
+#endif // !defined(__USBHID__USBHIDIOKitBackend__)
@@ -0,0 +1,193 @@
+//
+//  USBHIDIOKitService.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDIOKitService.h"
+
+#include <algorithm>
+
+#include <boost/make_shared.hpp>
+
+#if defined(__APPLE__)
+
+
+BEGIN_NAMESPACE_MW
+
+
+boost::mutex USBHIDIOKitService::instanceMutex;
+boost::weak_ptr<USBHIDIOKitService> USBHIDIOKitService::sharedInstance;
+
+
+boost::shared_ptr<USBHIDIOKitService> USBHIDIOKitService::instance() {
+    boost::mutex::scoped_lock lock(instanceMutex);
+    
+    boost::shared_ptr<USBHIDIOKitService> service = sharedInstance.lock();
+    if (!service) {
+        service.reset(new USBHIDIOKitService());
+        sharedInstance = service;
+    }
+    
+    return service;
+}
+
+
+USBHIDIOKitService::USBHIDIOKitService() :
+    hidManager(iohid::ManagerPtr::created(IOHIDManagerCreate(kCFAllocatorDefault, kIOHIDManagerOptionNone))),
+    ioRunLoop(nullptr),
+    ioRunning(false)
+{
+    // Match every HID device.  Backends open only the devices they use.
+    IOHIDManagerSetDeviceMatching(hidManager.get(), nullptr);
+    
+    CFRunLoopSourceContext taskSourceContext = { 0 };
+    taskSourceContext.info = this;
+    taskSourceContext.perform = &taskSourceCallback;
+    taskSource = RunLoopSourcePtr::created(CFRunLoopSourceCreate(kCFAllocatorDefault, 0, &taskSourceContext));
+    
+    boost::promise<CFRunLoopRef> runLoopStarted;
+    boost::unique_future<CFRunLoopRef> runLoopStartedFuture = runLoopStarted.get_future();
+    ioRunning = true;
+    
+    try {
+        runLoopThread = boost::thread(boost::bind(&USBHIDIOKitService::runLoop,
+                                                  this,
+                                                  boost::ref(runLoopStarted)));
+    } catch (const boost::thread_resource_error &e) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start shared HID I/O thread", e.what());
+    }
+    
+    ioRunLoop = runLoopStartedFuture.get();
+}
+
+
+USBHIDIOKitService::~USBHIDIOKitService() {
+    // A task signals the source, so the run loop stops even if it hasn't started running yet
+    ioRunning = false;
+    perform(&CFRunLoopStop);
+    
+    try {
+        runLoopThread.join();
+    } catch (const boost::system::system_error &e) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to stop shared HID I/O thread: %s", e.what());
+    }
+}
+
+
+std::vector<iohid::DevicePtr> USBHIDIOKitService::copyMatchingDevices(long usagePage, long usage) {
+    std::vector<iohid::DevicePtr> matchingDevices;
+    
+    // The manager's device set is updated on the I/O thread, so read it there
+    perform([this, usagePage, usage, &matchingDevices](CFRunLoopRef runLoop) {
+        cf::SetPtr allDevices = cf::SetPtr::owned(IOHIDManagerCopyDevices(hidManager.get()));
+        if (allDevices) {
+            std::vector<IOHIDDeviceRef> devices(CFSetGetCount(allDevices.get()));
+            CFSetGetValues(allDevices.get(), (const void **)(devices.data()));
+            
+            BOOST_FOREACH(IOHIDDeviceRef device, devices) {
+                if (IOHIDDeviceConformsTo(device, usagePage, usage)) {
+                    matchingDevices.push_back(iohid::DevicePtr::borrowed(device));
+                }
+            }
+        }
+    });
+    
+    return matchingDevices;
+}
+
+
+void USBHIDIOKitService::addDeviceMatchingListener(DeviceMatchingListener &listener) {
+    deviceMatchingListeners.push_back(&listener);
+}
+
+
+void USBHIDIOKitService::removeDeviceMatchingListener(DeviceMatchingListener &listener) {
+    deviceMatchingListeners.erase(std::remove(deviceMatchingListeners.begin(), deviceMatchingListeners.end(), &listener),
+                                  deviceMatchingListeners.end());
+}
+
+
+void USBHIDIOKitService::perform(const Task &task) {
+    PendingTask pendingTask = { task, boost::make_shared< boost::promise<void> >() };
+    boost::unique_future<void> done = pendingTask.done->get_future();
+    
+    {
+        boost::mutex::scoped_lock lock(pendingTasksMutex);
+        pendingTasks.push_back(pendingTask);
+    }
+    CFRunLoopSourceSignal(taskSource.get());
+    CFRunLoopWakeUp(ioRunLoop);
+    
+    done.wait();
+}
+
+
+void USBHIDIOKitService::taskSourceCallback(void *info) {
+    static_cast<USBHIDIOKitService *>(info)->runPendingTasks();
+}
+
+
+void USBHIDIOKitService::deviceMatchingCallback(void *context, IOReturn result, void *sender, IOHIDDeviceRef device) {
+    USBHIDIOKitService &service = *static_cast<USBHIDIOKitService *>(context);
+    BOOST_FOREACH(DeviceMatchingListener *listener, service.deviceMatchingListeners) {
+        listener->handleDeviceMatched(device);
+    }
+}
+
+
+void USBHIDIOKitService::runLoop(boost::promise<CFRunLoopRef> &runLoopStarted) {
+    CFRunLoopRef runLoop = CFRunLoopGetCurrent();
+    
+    // Scheduling the manager also schedules every device it matches, now or later, so backends never
+    // schedule their devices themselves.  Backends register their input callbacks only while I/O is
+    // running, so no input is delivered before then.
+    IOHIDManagerRegisterDeviceMatchingCallback(hidManager.get(), &deviceMatchingCallback, this);
+    IOHIDManagerScheduleWithRunLoop(hidManager.get(), runLoop, kCFRunLoopDefaultMode);
+    CFRunLoopAddSource(runLoop, taskSource.get(), kCFRunLoopDefaultMode);
+    
+    BOOST_SCOPE_EXIT(&hidManager, &taskSource, runLoop) {
+        CFRunLoopRemoveSource(runLoop, taskSource.get(), kCFRunLoopDefaultMode);
+        IOHIDManagerUnscheduleFromRunLoop(hidManager.get(), runLoop, kCFRunLoopDefaultMode);
+        IOHIDManagerRegisterDeviceMatchingCallback(hidManager.get(), nullptr, nullptr);
+    } BOOST_SCOPE_EXIT_END
+    
+    runLoopStarted.set_value(runLoop);
+    
+    // The task source ensures that the run loop always has at least one source, so CFRunLoopRunInMode
+    // never returns immediately
+    while (ioRunning) {
+        (void)CFRunLoopRunInMode(kCFRunLoopDefaultMode, 1.0e10, false);
+    }
+    
+    // Don't leave any caller of perform waiting
+    runPendingTasks();
+}
+
+
+void USBHIDIOKitService::runPendingTasks() {
+    CFRunLoopRef runLoop = CFRunLoopGetCurrent();
+    
+    while (true) {
+        PendingTask pendingTask;
+        {
+            boost::mutex::scoped_lock lock(pendingTasksMutex);
+            if (pendingTasks.empty()) {
+                break;
+            }
+            pendingTask = pendingTasks.front();
+            pendingTasks.pop_front();
+        }
+        
+        pendingTask.task(runLoop);
+        pendingTask.done->set_value();
+    }
+}
+
+
+END_NAMESPACE_MW
+
+
+#endif // defined(__APPLE__)
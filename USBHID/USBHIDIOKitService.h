@@ -0,0 +1,114 @@
+//
+//  USBHIDIOKitService.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDIOKitService__
+#define __USBHID__USBHIDIOKitService__
+
+#if defined(__APPLE__)
+
+#include <deque>
+
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/weak_ptr.hpp>
+
+
+BEGIN_NAMESPACE_MW
+
+
+BEGIN_NAMESPACE(iohid)
+
+
+using DevicePtr = cf::ObjectPtr<IOHIDDeviceRef>;
+using ElementPtr = cf::ObjectPtr<IOHIDElementRef>;
+using ManagerPtr = cf::ObjectPtr<IOHIDManagerRef>;
+
+
+END_NAMESPACE(iohid)
+
+
+using RunLoopSourcePtr = cf::ObjectPtr<CFRunLoopSourceRef>;
+using RunLoopTimerPtr = cf::ObjectPtr<CFRunLoopTimerRef>;
+using RunLoopObserverPtr = cf::ObjectPtr<CFRunLoopObserverRef>;
+
+
+//
+// A single HID manager and I/O thread shared by every IOKit backend created with shared I/O enabled.  The
+// manager matches all HID devices, so the bus is enumerated once, no matter how many devices are in use.
+// Each backend opens its own device and registers its own callbacks on it, so input is still routed to the
+// right backend by device.
+//
+// The service exists only while at least one backend holds a reference to it.
+//
+class USBHIDIOKitService : boost::noncopyable {
+    
+public:
+    typedef boost::function<void (CFRunLoopRef runLoop)> Task;
+    
+    class DeviceMatchingListener {
+    public:
+        virtual ~DeviceMatchingListener() { }
+        virtual void handleDeviceMatched(IOHIDDeviceRef device) = 0;
+    };
+    
+    static boost::shared_ptr<USBHIDIOKitService> instance();
+    
+    ~USBHIDIOKitService();
+    
+    // Returns every currently attached device that conforms to the given usage page and usage
+    std::vector<iohid::DevicePtr> copyMatchingDevices(long usagePage, long usage);
+    
+    // Listeners are notified, on the I/O thread, of every device that's attached while they're registered.
+    // These methods must be called on the I/O thread (i.e. from a task).
+    void addDeviceMatchingListener(DeviceMatchingListener &listener);
+    void removeDeviceMatchingListener(DeviceMatchingListener &listener);
+    
+    // Runs task on the I/O thread and waits for it to finish.  Because no callbacks can be running while the
+    // task runs, tasks can safely schedule and unschedule run loop sources.  Must not be called from the
+    // I/O thread.
+    void perform(const Task &task);
+    
+private:
+    struct PendingTask {
+        Task task;
+        boost::shared_ptr< boost::promise<void> > done;
+    };
+    
+    USBHIDIOKitService();
+    
+    static void taskSourceCallback(void *info);
+    static void deviceMatchingCallback(void *context, IOReturn result, void *sender, IOHIDDeviceRef device);
+    
+    void runLoop(boost::promise<CFRunLoopRef> &runLoopStarted);
+    void runPendingTasks();
+    
+    const iohid::ManagerPtr hidManager;
+    
+    boost::thread runLoopThread;
+    CFRunLoopRef ioRunLoop;
+    std::atomic_bool ioRunning;
+    RunLoopSourcePtr taskSource;
+    
+    boost::mutex pendingTasksMutex;
+    std::deque<PendingTask> pendingTasks;
+    
+    // Used only on the I/O thread
+    std::vector<DeviceMatchingListener *> deviceMatchingListeners;
+    
+    static boost::mutex instanceMutex;
+    static boost::weak_ptr<USBHIDIOKitService> sharedInstance;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // defined(__APPLE__)
+
+#endif // !defined(__USBHID__USBHIDIOKitService__)
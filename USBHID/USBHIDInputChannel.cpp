@@ -15,6 +15,15 @@ BEGIN_NAMESPACE_MW
 const std::string USBHIDInputChannel::USAGE_PAGE("usage_page");
 const std::string USBHIDInputChannel::USAGE("usage");
 const std::string USBHIDInputChannel::VALUE("value");
+const std::string USBHIDInputChannel::DEADBAND("deadband");
+const std::string USBHIDInputChannel::SUPPRESS_DUPLICATES("suppress_duplicates");
+const std::string USBHIDInputChannel::MAX_UPDATE_RATE("max_update_rate");
+const std::string USBHIDInputChannel::RAW_MIN("raw_min");
+const std::string USBHIDInputChannel::RAW_MAX("raw_max");
+const std::string USBHIDInputChannel::RAW_CENTER("raw_center");
+const std::string USBHIDInputChannel::SCALED_MIN("scaled_min");
+const std::string USBHIDInputChannel::SCALED_MAX("scaled_max");
+const std::string USBHIDInputChannel::INVERT("invert");
 
 
 void USBHIDInputChannel::describeComponent(ComponentInfo &info) {
@@ -25,6 +34,15 @@ void USBHIDInputChannel::describeComponent(ComponentInfo &info) {
     info.addParameter(USAGE_PAGE);
     info.addParameter(USAGE);
     info.addParameter(VALUE);
+    info.addParameter(DEADBAND, "0");
+    info.addParameter(SUPPRESS_DUPLICATES, "NO");
+    info.addParameter(MAX_UPDATE_RATE, "0");
+    info.addParameter(RAW_MIN, false);
+    info.addParameter(RAW_MAX, false);
+    info.addParameter(RAW_CENTER, false);
+    info.addParameter(SCALED_MIN, "-1.0");
+    info.addParameter(SCALED_MAX, "1.0");
+    info.addParameter(INVERT, "NO");
 }
 
 
@@ -32,7 +50,10 @@ USBHIDInputChannel::USBHIDInputChannel(const ParameterValueMap &parameters) :
     Component(parameters),
     usagePage(parameters[USAGE_PAGE]),
     usage(parameters[USAGE]),
-    value(parameters[VALUE])
+    value(parameters[VALUE]),
+    deadband(parameters[DEADBAND]),
+    suppressDuplicates(parameters[SUPPRESS_DUPLICATES]),
+    maxUpdateRate(parameters[MAX_UPDATE_RATE])
 {
     if (usagePage <= kHIDPage_Undefined) {
         throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid HID usage page");
@@ -40,6 +61,25 @@ USBHIDInputChannel::USBHIDInputChannel(const ParameterValueMap &parameters) :
     if (usage <= kHIDUsage_Undefined) {
         throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid HID usage");
     }
+    if (deadband < 0) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid deadband");
+    }
+    if (maxUpdateRate < 0.0) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid maximum update rate");
+    }
+    
+    // Scaling is enabled by giving the raw range.  The center defaults to its midpoint.
+    if (!(parameters[RAW_MIN].empty()) || !(parameters[RAW_MAX].empty())) {
+        if (parameters[RAW_MIN].empty() || parameters[RAW_MAX].empty()) {
+            throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "USBHID channel scaling requires both raw_min and raw_max");
+        }
+        const double rawMin = parameters[RAW_MIN];
+        const double rawMax = parameters[RAW_MAX];
+        const double rawCenter = (parameters[RAW_CENTER].empty() ? ((rawMin + rawMax) / 2.0) : double(parameters[RAW_CENTER]));
+        scaler = USBHIDAxisScaler(rawMin, rawMax, rawCenter, parameters[SCALED_MIN], parameters[SCALED_MAX], parameters[INVERT]);
+    } else if (!(parameters[RAW_CENTER].empty()) || bool(parameters[INVERT])) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "USBHID channel scaling requires both raw_min and raw_max");
+    }
 }
 
 
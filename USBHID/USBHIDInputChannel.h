@@ -9,6 +9,8 @@
 #ifndef __USBHID__USBHIDInputChannel__
 #define __USBHID__USBHIDInputChannel__
 
+#include "USBHIDAxisScaler.h"
+
 
 BEGIN_NAMESPACE_MW
 
@@ -19,6 +21,15 @@ public:
     static const std::string USAGE_PAGE;
     static const std::string USAGE;
     static const std::string VALUE;
+    static const std::string DEADBAND;
+    static const std::string SUPPRESS_DUPLICATES;
+    static const std::string MAX_UPDATE_RATE;
+    static const std::string RAW_MIN;
+    static const std::string RAW_MAX;
+    static const std::string RAW_CENTER;
+    static const std::string SCALED_MIN;
+    static const std::string SCALED_MAX;
+    static const std::string INVERT;
     
     static void describeComponent(ComponentInfo &info);
     
@@ -26,15 +37,27 @@ public:
     
     long getUsagePage() const { return usagePage; }
     long getUsage() const { return usage; }
+    long getDeadband() const { return deadband; }
+    bool getSuppressDuplicates() const { return suppressDuplicates; }
+    double getMaxUpdateRate() const { return maxUpdateRate; }
     
-    void postValue(CFIndex integerValue, MWTime time) const {
-        value->setValue(integerValue, time);
+    // If scaling is enabled, the variable receives the scaled value instead of the raw one
+    void postValue(long integerValue, MWTime time) const {
+        if (scaler.isActive()) {
+            value->setValue(scaler.scale(integerValue), time);
+        } else {
+            value->setValue(integerValue, time);
+        }
     }
     
 private:
     const long usagePage;
     const long usage;
     const VariablePtr value;
+    const long deadband;
+    const bool suppressDuplicates;
+    const double maxUpdateRate;
+    USBHIDAxisScaler scaler;
     
 };
 
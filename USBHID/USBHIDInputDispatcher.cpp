@@ -0,0 +1,464 @@
+//
+//  USBHIDInputDispatcher.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDInputDispatcher.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+USBHIDInputDispatcher::USBHIDInputDispatcher(const std::string &deviceTag, Target &target, const Options &options) :
+    deviceTag(deviceTag),
+    target(target),
+    batchReports(options.batchReports),
+    measureLatency(options.measureLatency),
+    dispatchThreadPolicy(options.dispatchThreadPolicy),
+    inputLogger(options.inputLogger),
+    captureWriter(nullptr),
+    sharedStateWriter(nullptr),
+    multiUsageUpdatePending(false),
+    clock(Clock::instance()),
+    clockMapper(clock->getSystemBaseTimeNS()),
+    calibrateClock(false),
+    postedFrameCount(0),
+    dispatchRunning(false),
+    dispatcherWaiting(false),
+    droppedEventCount(0),
+    lastReportedDroppedEventCount(0),
+    lateMergedEventCount(0)
+{
+    if (options.dispatchQueueSize > 0) {
+        eventQueue.reset(new InputEventQueue(options.dispatchQueueSize));
+    }
+    if (!(options.mergeGroup.empty())) {
+        eventMerger = EventMerger::instance(options.mergeGroup, options.mergeWindowUS);
+    }
+}
+
+
+USBHIDInputDispatcher::~USBHIDInputDispatcher() {
+    stop();
+}
+
+
+void USBHIDInputDispatcher::configure(const std::vector<Channel> &newChannels,
+                                      const std::vector<std::size_t> &multiUsageSizes,
+                                      usbhid::CaptureWriter *newCaptureWriter,
+                                      usbhid::SharedStateWriter *newSharedStateWriter)
+{
+    channels = newChannels;
+    captureWriter = newCaptureWriter;
+    sharedStateWriter = newSharedStateWriter;
+    
+    inputFilters.clear();
+    BOOST_FOREACH(const Channel &channel, channels) {
+        inputFilters.push_back(USBHIDInputFilter(channel.deadband, channel.suppressDuplicates, channel.maxUpdateRate));
+    }
+    
+    multiUsageElements.clear();
+    multiUsageValues.clear();
+    for (std::size_t multiUsageIndex = 0; multiUsageIndex < multiUsageSizes.size(); multiUsageIndex++) {
+        for (std::size_t offset = 0; offset < multiUsageSizes[multiUsageIndex]; offset++) {
+            const MultiUsageElement element = { multiUsageIndex, offset };
+            multiUsageElements.push_back(element);
+        }
+        multiUsageValues.push_back(std::vector<long>(multiUsageSizes[multiUsageIndex], 0));
+    }
+    multiUsageChanged.assign(multiUsageValues.size(), false);
+    
+    // Reserve enough space that a typical report never causes an allocation on the I/O thread
+    frameEvents.clear();
+    frameEvents.reserve(2 * (channels.size() + multiUsageElements.size()) + 16);
+    
+    if (measureLatency) {
+        channelLatencies.reset(new ChannelLatency[channels.size()]);
+    }
+}
+
+
+bool USBHIDInputDispatcher::start() {
+    BOOST_FOREACH(USBHIDInputFilter &filter, inputFilters) {
+        filter.reset();
+    }
+    frameEvents.clear();
+    
+    // Post every multi-usage channel in full with the first report
+    BOOST_FOREACH(std::vector<long> &values, multiUsageValues) {
+        std::fill(values.begin(), values.end(), 0);
+    }
+    multiUsageChanged.assign(multiUsageValues.size(), true);
+    multiUsageUpdatePending = false;
+    
+    if (channelLatencies) {
+        for (std::size_t channelIndex = 0; channelIndex < channels.size(); channelIndex++) {
+            channelLatencies[channelIndex].inputDelay.reset();
+            channelLatencies[channelIndex].dispatchDelay.reset();
+        }
+    }
+    
+    clockMapper.reset();
+    calibrateClock = false;
+    
+    return startDispatchThread();
+}
+
+
+void USBHIDInputDispatcher::stop() {
+    stopDispatchThread();
+    flushMergedEvents();
+}
+
+
+bool USBHIDInputDispatcher::startDispatchThread() {
+    if (eventQueue) {
+        dispatchRunning = true;
+        try {
+            dispatchThread = boost::thread(boost::bind(&USBHIDInputDispatcher::dispatchLoop, this));
+        } catch (const boost::thread_resource_error &e) {
+            dispatchRunning = false;
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start HID dispatch thread: %s", e.what());
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+
+void USBHIDInputDispatcher::stopDispatchThread() {
+    if (dispatchThread.get_id() != boost::thread::id()) {
+        dispatchRunning = false;
+        dispatchSemaphore.signal();
+        try {
+            dispatchThread.join();
+        } catch (const boost::system::system_error &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to stop HID dispatch thread: %s", e.what());
+        }
+    }
+}
+
+
+void USBHIDInputDispatcher::dispatchLoop() {
+    dispatchThreadPolicy.applyToCurrentThread(deviceTag, "dispatch");
+    
+    InputEvent event;
+    
+    while (true) {
+        while (eventQueue->pop(event)) {
+            dispatchInputEvent(event);
+        }
+        
+        reportDroppedEvents();
+        
+        if (!dispatchRunning) {
+            // The I/O thread has already stopped, so the queue is fully drained
+            break;
+        }
+        
+        // Tell the producer that we're about to sleep, then check the queue once more in case an event
+        // arrived before it could see the flag
+        dispatcherWaiting = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!(eventQueue->empty()) || !dispatchRunning) {
+            dispatcherWaiting = false;
+            continue;
+        }
+        
+        dispatchSemaphore.wait();
+    }
+}
+
+
+void USBHIDInputDispatcher::handleInputValue(const USBHIDBackend::InputValue &value) {
+    if (captureWriter) {
+        const usbhid::CaptureRecord record = {
+            value.timestampNS,
+            std::uint16_t(value.usagePage),
+            std::uint16_t(value.usage),
+            std::int32_t(value.integerValue)
+        };
+        captureWriter->append(record);
+    }
+    
+    if (calibrateClock && clockMapper.checkTimestamp(value.timestampNS)) {
+        clockMapper.addSample(value.timestampNS, clock->getSystemTimeNS());
+    }
+    
+    InputEvent event = { value, clockMapper.toMWorksTime(value.timestampNS), 0, true, bool(inputLogger), false, false };
+    
+    // Every channel index other than noChannel has an entry.  Readers see the values once the report ends.
+    if (sharedStateWriter && (value.channelIndex != USBHIDBackend::noChannel)) {
+        sharedStateWriter->beginUpdate();
+        sharedStateWriter->setValue(value.channelIndex, value.integerValue, value.timestampNS, event.time);
+    }
+    
+    if (channelLatencies && (value.channelIndex < channels.size())) {
+        event.receivedTimeNS = clock->getSystemTimeNS();
+        channelLatencies[value.channelIndex].inputDelay.record(std::int64_t(event.receivedTimeNS) -
+                                                               std::int64_t(value.timestampNS));
+    }
+    
+    if (value.channelIndex < inputFilters.size()) {
+        USBHIDInputFilter &filter = inputFilters[value.channelIndex];
+        if (filter.isActive()) {
+            std::uint64_t wakeupTimeNS = 0;
+            event.post = filter.filter(value.integerValue, value.timestampNS, wakeupTimeNS);
+            if (wakeupTimeNS) {
+                target.requestWakeup(wakeupTimeNS);
+            }
+            if (!(event.post || event.log)) {
+                return;
+            }
+        }
+    }
+    
+    if (batchReports) {
+        addToFrame(event);
+    } else {
+        if (isMultiUsageChannelIndex(value.channelIndex)) {
+            lastMultiUsageEvent = event;
+            multiUsageUpdatePending = true;
+        }
+        postInputEvent(event);
+    }
+}
+
+
+void USBHIDInputDispatcher::handleWakeup(std::uint64_t currentTimeNS) {
+    std::uint64_t nextWakeupTimeNS = 0;
+    
+    for (std::size_t channelIndex = 0; channelIndex < inputFilters.size(); channelIndex++) {
+        long integerValue;
+        std::uint64_t timestampNS;
+        if (inputFilters[channelIndex].takeDueValue(currentTimeNS, integerValue, timestampNS, nextWakeupTimeNS)) {
+            const Channel &channel = channels[channelIndex];
+            
+            // The value was logged when it arrived, so don't log it again
+            const InputEvent event = {
+                {
+                    channelIndex,
+                    channel.usagePage,
+                    channel.usage,
+                    integerValue,
+                    timestampNS
+                },
+                clockMapper.toMWorksTime(timestampNS),
+                0,  // Held back deliberately, so excluded from latency measurement
+                true,
+                false,
+                false,
+                false
+            };
+            if (batchReports) {
+                addToFrame(event);
+            } else {
+                postInputEvent(event);
+            }
+        }
+    }
+    
+    if (batchReports) {
+        commitFrame();
+    }
+    
+    if (nextWakeupTimeNS) {
+        target.requestWakeup(nextWakeupTimeNS);
+    }
+}
+
+
+void USBHIDInputDispatcher::handleFrameEnd() {
+    if (sharedStateWriter) {
+        sharedStateWriter->endUpdate();
+    }
+    
+    if (batchReports) {
+        commitFrame();
+    } else if (multiUsageUpdatePending) {
+        // Post the multi-usage channels after the last of their values from this report, with the same time
+        // stamp
+        InputEvent event = lastMultiUsageEvent;
+        event.value.channelIndex = USBHIDBackend::noChannel;
+        event.receivedTimeNS = 0;
+        event.post = false;
+        event.log = false;
+        event.postMultiUsage = true;
+        postInputEvent(event);
+        multiUsageUpdatePending = false;
+    }
+}
+
+
+void USBHIDInputDispatcher::postInputEvent(const InputEvent &event) {
+    if (eventMerger) {
+        submitMergedEvent(event);
+    } else if (!eventQueue) {
+        dispatchInputEvent(event);
+    } else if (enqueueInputEvent(event)) {
+        wakeDispatcher();
+    }
+}
+
+
+void USBHIDInputDispatcher::addToFrame(const InputEvent &event) {
+    // Backends that can't see report boundaries may deliver several reports before ending a frame, but
+    // values from different reports always have different time stamps
+    if (!frameEvents.empty() && (frameEvents.front().value.timestampNS != event.value.timestampNS)) {
+        commitFrame();
+    }
+    frameEvents.push_back(event);
+}
+
+
+void USBHIDInputDispatcher::commitFrame() {
+    if (frameEvents.empty()) {
+        return;
+    }
+    
+    // Give every value the same time stamp, and mark the last value to be posted, so that the frame number
+    // is updated only after the whole frame is posted
+    const std::uint64_t frameTimestampNS = frameEvents.front().value.timestampNS;
+    const MWTime frameTime = frameEvents.front().time;
+    InputEvent *lastPostedEvent = nullptr;
+    BOOST_FOREACH(InputEvent &event, frameEvents) {
+        event.value.timestampNS = frameTimestampNS;
+        event.time = frameTime;
+        if (event.post) {
+            lastPostedEvent = &event;
+        }
+    }
+    if (lastPostedEvent) {
+        lastPostedEvent->endsFrame = true;
+        lastPostedEvent->postMultiUsage = !(multiUsageValues.empty());
+    }
+    
+    if (eventMerger) {
+        BOOST_FOREACH(const InputEvent &event, frameEvents) {
+            submitMergedEvent(event);
+        }
+    } else if (!eventQueue) {
+        BOOST_FOREACH(const InputEvent &event, frameEvents) {
+            dispatchInputEvent(event);
+        }
+    } else {
+        bool enqueued = false;
+        BOOST_FOREACH(const InputEvent &event, frameEvents) {
+            enqueued = enqueueInputEvent(event) || enqueued;
+        }
+        // One wakeup per frame
+        if (enqueued) {
+            wakeDispatcher();
+        }
+    }
+    
+    frameEvents.clear();
+}
+
+
+void USBHIDInputDispatcher::submitMergedEvent(const InputEvent &event) {
+    if (!(eventMerger->submit(*this, event, event.value.timestampNS))) {
+        lateMergedEventCount++;
+    }
+}
+
+
+void USBHIDInputDispatcher::flushMergedEvents() {
+    if (eventMerger) {
+        eventMerger->flush(*this);
+        
+        if (lateMergedEventCount) {
+            mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                     "HID device \"%s\" delivered %llu input values too late to be merged in time stamp order",
+                     deviceTag.c_str(),
+                     static_cast<unsigned long long>(lateMergedEventCount));
+            lateMergedEventCount = 0;
+        }
+    }
+}
+
+
+bool USBHIDInputDispatcher::enqueueInputEvent(const InputEvent &event) {
+    if (!(eventQueue->push(event))) {
+        droppedEventCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+
+void USBHIDInputDispatcher::wakeDispatcher() {
+    // Wake the dispatcher only if it's waiting, so that bursts of input cost no system calls
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (dispatcherWaiting.exchange(false)) {
+        dispatchSemaphore.signal();
+    }
+}
+
+
+void USBHIDInputDispatcher::dispatchInputEvent(const InputEvent &event) {
+    const USBHIDBackend::InputValue &value = event.value;
+    
+    if (event.post && (value.channelIndex < channels.size())) {
+        target.postValue(value.channelIndex, value.integerValue, event.time);
+        if (event.receivedTimeNS) {
+            channelLatencies[value.channelIndex].dispatchDelay.record(clock->getSystemTimeNS() -
+                                                                      MWTime(event.receivedTimeNS));
+        }
+    } else if (event.post && isMultiUsageChannelIndex(value.channelIndex)) {
+        updateMultiUsageValue(value.channelIndex, value.integerValue);
+    }
+    
+    if (event.postMultiUsage) {
+        postChangedMultiUsageChannels(event.time);
+    }
+    
+    if (event.endsFrame) {
+        postedFrameCount++;
+        target.postFrameNumber(long(postedFrameCount), event.time);
+    }
+    
+    if (event.log && inputLogger) {
+        inputLogger->log(value.usagePage, value.usage, value.integerValue);
+    }
+}
+
+
+void USBHIDInputDispatcher::updateMultiUsageValue(std::size_t channelIndex, long integerValue) {
+    const MultiUsageElement &element = multiUsageElements[channelIndex - channels.size()];
+    long &currentValue = multiUsageValues[element.multiUsageIndex][element.offset];
+    if (currentValue != integerValue) {
+        currentValue = integerValue;
+        multiUsageChanged[element.multiUsageIndex] = true;
+    }
+}
+
+
+void USBHIDInputDispatcher::postChangedMultiUsageChannels(MWTime time) {
+    for (std::size_t multiUsageIndex = 0; multiUsageIndex < multiUsageValues.size(); multiUsageIndex++) {
+        if (multiUsageChanged[multiUsageIndex]) {
+            target.postMultiUsageValues(multiUsageIndex, multiUsageValues[multiUsageIndex], time);
+            multiUsageChanged[multiUsageIndex] = false;
+        }
+    }
+}
+
+
+void USBHIDInputDispatcher::reportDroppedEvents() {
+    const std::uint64_t currentDroppedEventCount = droppedEventCount.load(std::memory_order_relaxed);
+    if (currentDroppedEventCount != lastReportedDroppedEventCount) {
+        mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                 "HID device \"%s\" dropped %llu input events (dispatch queue full)",
+                 deviceTag.c_str(),
+                 static_cast<unsigned long long>(currentDroppedEventCount - lastReportedDroppedEventCount));
+        target.postDroppedEventCount(long(currentDroppedEventCount));
+        lastReportedDroppedEventCount = currentDroppedEventCount;
+    }
+}
+
+
+END_NAMESPACE_MW
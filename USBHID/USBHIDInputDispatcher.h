@@ -0,0 +1,226 @@
+//
+//  USBHIDInputDispatcher.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDInputDispatcher__
+#define __USBHID__USBHIDInputDispatcher__
+
+#include <atomic>
+#include <type_traits>
+
+#include <boost/scoped_array.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "USBHIDBackend.h"
+#include "USBHIDCapture.h"
+#include "USBHIDClockMapper.h"
+#include "USBHIDEventMerger.h"
+#include "USBHIDInputFilter.h"
+#include "USBHIDInputLogger.h"
+#include "USBHIDLatencyHistogram.h"
+#include "USBHIDRingBuffer.h"
+#include "USBHIDSemaphore.h"
+#include "USBHIDSharedState.h"
+#include "USBHIDThreadPolicy.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// The input path of a USBHID device, from the values delivered by its backend to the posting of its channels.
+// Values are captured, published to shared memory, filtered, time stamped in MWorks time, and batched into
+// frames on the I/O thread, then posted directly, through a dispatch queue and thread, or through a merge
+// group.  Posting itself is left to a Target, so that nothing here depends on MWorksCore.
+//
+// Regular channels have indices [0, channelCount), and the usages of multi-usage channels follow, in order.
+// Every method except those of the Target is called on the I/O thread, apart from start and stop and the
+// diagnostic getters, which may be called only while I/O is stopped.
+//
+class USBHIDInputDispatcher : boost::noncopyable {
+    
+public:
+    // Receives values on whichever thread posts them (the I/O thread, the dispatch thread, or a merge group's
+    // thread), except for requestWakeup, which is always called on the I/O thread
+    class Target {
+    public:
+        virtual ~Target() { }
+        virtual void postValue(std::size_t channelIndex, long integerValue, MWTime time) = 0;
+        virtual void postMultiUsageValues(std::size_t multiUsageIndex, const std::vector<long> &values, MWTime time) = 0;
+        virtual void postFrameNumber(long frameNumber, MWTime time) = 0;
+        virtual void postDroppedEventCount(long droppedEventCount) = 0;
+        virtual void requestWakeup(std::uint64_t timeNS) = 0;
+    };
+    
+    struct Options {
+        std::size_t dispatchQueueSize;    // Zero to post on the I/O thread
+        std::string mergeGroup;           // Empty if not merging.  Can't be combined with a dispatch queue.
+        MWTime mergeWindowUS;
+        bool batchReports;
+        bool measureLatency;
+        USBHIDThreadPolicy dispatchThreadPolicy;
+        USBHIDInputLogger *inputLogger;   // Receives every value if not null
+    };
+    
+    struct Channel {
+        std::uint32_t usagePage;
+        std::uint32_t usage;
+        long deadband;
+        bool suppressDuplicates;
+        double maxUpdateRate;
+    };
+    
+    USBHIDInputDispatcher(const std::string &deviceTag, Target &target, const Options &options);
+    ~USBHIDInputDispatcher();
+    
+    // Sets the channels, and the number of usages of each multi-usage channel.  The writers, if not null,
+    // must outlive the dispatcher.
+    void configure(const std::vector<Channel> &channels,
+                   const std::vector<std::size_t> &multiUsageSizes,
+                   usbhid::CaptureWriter *captureWriter,
+                   usbhid::SharedStateWriter *sharedStateWriter);
+    
+    // Called before the backend delivers its initial values, and after it stops delivering values
+    bool start();
+    void stop();
+    
+    // Initial and polled values carry time stamps that say nothing about the device's clock, so the caller
+    // excludes them from clock calibration
+    bool isCalibratingClock() const { return calibrateClock; }
+    void setCalibratingClock(bool calibrate) { calibrateClock = calibrate; }
+    
+    void handleInputValue(const USBHIDBackend::InputValue &value);
+    void handleWakeup(std::uint64_t currentTimeNS);
+    void handleFrameEnd();
+    
+    std::size_t getChannelCount() const { return channels.size(); }
+    const USBHIDInputFilter & getInputFilter(std::size_t channelIndex) const { return inputFilters[channelIndex]; }
+    const USBHIDClockMapper & getClockMapper() const { return clockMapper; }
+    
+    // Empty unless measuring latency
+    bool isMeasuringLatency() const { return bool(channelLatencies); }
+    const USBHIDLatencyHistogram & getInputDelay(std::size_t channelIndex) const {
+        return channelLatencies[channelIndex].inputDelay;
+    }
+    const USBHIDLatencyHistogram & getDispatchDelay(std::size_t channelIndex) const {
+        return channelLatencies[channelIndex].dispatchDelay;
+    }
+    
+    std::uint64_t getDroppedEventCount() const { return droppedEventCount.load(std::memory_order_relaxed); }
+    
+private:
+    struct InputEvent {
+        USBHIDBackend::InputValue value;
+        MWTime time;                  // The value's time stamp, converted to MWorks time
+        std::uint64_t receivedTimeNS; // When the backend delivered the value (zero if not measuring latency)
+        bool post;                    // Post to the value's channel (if any)
+        bool log;                     // Pass to the input logger (if any)
+        bool endsFrame;
+        bool postMultiUsage;          // Post every multi-usage channel that changed since the last such event
+    };
+    
+    // Events are copied into the dispatch queue, the current frame, and merge groups on the I/O thread, so
+    // they must never own memory
+    static_assert(std::is_trivially_copyable<InputEvent>::value, "InputEvent must be trivially copyable");
+    
+    struct MultiUsageElement {
+        std::size_t multiUsageIndex;  // Index into multiUsageValues
+        std::size_t offset;           // Index of the usage within the channel
+    };
+    
+    struct ChannelLatency {
+        USBHIDLatencyHistogram inputDelay;     // From device time stamp to backend delivery
+        USBHIDLatencyHistogram dispatchDelay;  // From backend delivery to variable update
+    };
+    
+    typedef USBHIDEventMerger<USBHIDInputDispatcher, InputEvent> EventMerger;
+    friend class USBHIDEventMerger<USBHIDInputDispatcher, InputEvent>;
+    
+    bool isMultiUsageChannelIndex(std::size_t channelIndex) const {
+        return ((channelIndex >= channels.size()) &&
+                (channelIndex - channels.size() < multiUsageElements.size()));
+    }
+    bool startDispatchThread();
+    void stopDispatchThread();
+    void dispatchLoop();
+    void postInputEvent(const InputEvent &event);
+    void addToFrame(const InputEvent &event);
+    void commitFrame();
+    bool enqueueInputEvent(const InputEvent &event);
+    void wakeDispatcher();
+    void dispatchInputEvent(const InputEvent &event);
+    void updateMultiUsageValue(std::size_t channelIndex, long integerValue);
+    void postChangedMultiUsageChannels(MWTime time);
+    void dispatchMergedEvent(const InputEvent &event) { dispatchInputEvent(event); }
+    void submitMergedEvent(const InputEvent &event);
+    void flushMergedEvents();
+    void reportDroppedEvents();
+    
+    const std::string deviceTag;
+    Target &target;
+    const bool batchReports;
+    const bool measureLatency;
+    const USBHIDThreadPolicy dispatchThreadPolicy;
+    USBHIDInputLogger * const inputLogger;
+    
+    // Built by configure and never modified while I/O is running, so the input path can read them without
+    // locking
+    std::vector<Channel> channels;
+    std::vector<MultiUsageElement> multiUsageElements;
+    usbhid::CaptureWriter *captureWriter;
+    usbhid::SharedStateWriter *sharedStateWriter;
+    
+    // Indexed by multi-usage channel, and used only by whichever thread posts values.  Each channel is
+    // posted as a whole, once per report, when an event with postMultiUsage set is dispatched.
+    std::vector< std::vector<long> > multiUsageValues;
+    std::vector<bool> multiUsageChanged;
+    
+    // Indexed by channel index (regular channels only), but used only on the I/O thread
+    std::vector<USBHIDInputFilter> inputFilters;
+    
+    // Outside of batch mode, the last multi-usage channel event from the current report, used as the
+    // template for the event that posts those channels when the report ends.  Used only on the I/O thread.
+    InputEvent lastMultiUsageEvent;
+    bool multiUsageUpdatePending;
+    
+    // In batch mode, the values from the current report, which are collected on the I/O thread and
+    // posted as a unit when the report ends
+    std::vector<InputEvent> frameEvents;
+    
+    // Used only on the I/O thread, except that diagnostics may be read after I/O stops
+    const boost::shared_ptr<Clock> clock;
+    USBHIDClockMapper clockMapper;
+    bool calibrateClock;
+    
+    // Used by whichever thread posts values
+    std::uint64_t postedFrameCount;
+    
+    // Indexed by channel index (regular channels only).  Empty unless measuring latency.
+    boost::scoped_array<ChannelLatency> channelLatencies;
+    
+    // Optional hand-off between the I/O thread and posting
+    typedef USBHIDRingBuffer<InputEvent> InputEventQueue;
+    boost::scoped_ptr<InputEventQueue> eventQueue;
+    boost::thread dispatchThread;
+    USBHIDSemaphore dispatchSemaphore;
+    std::atomic_bool dispatchRunning;
+    std::atomic_bool dispatcherWaiting;
+    std::atomic<std::uint64_t> droppedEventCount;
+    std::uint64_t lastReportedDroppedEventCount;
+    
+    // Optional hand-off to a stage that merges events from several devices in time stamp order
+    boost::shared_ptr<EventMerger> eventMerger;
+    std::uint64_t lateMergedEventCount;  // Used only on the I/O thread
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDInputDispatcher__)
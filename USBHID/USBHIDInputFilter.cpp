@@ -0,0 +1,101 @@
+//
+//  USBHIDInputFilter.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDInputFilter.h"
+
+#include <cstdlib>
+
+
+BEGIN_NAMESPACE_MW
+
+
+USBHIDInputFilter::USBHIDInputFilter(long deadband, bool suppressDuplicates, double maxUpdateRate) :
+    deadband(deadband),
+    suppressDuplicates(suppressDuplicates),
+    minIntervalNS((maxUpdateRate > 0.0) ? std::uint64_t(1.0e9 / maxUpdateRate) : 0)
+{
+    reset();
+}
+
+
+void USBHIDInputFilter::reset() {
+    hasPosted = false;
+    lastPostedValue = 0;
+    lastPostTimeNS = 0;
+    hasPending = false;
+    pendingValue = 0;
+    pendingTimeNS = 0;
+    receivedCount = 0;
+    postedCount = 0;
+}
+
+
+bool USBHIDInputFilter::filter(long value, std::uint64_t timeNS, std::uint64_t &wakeupTimeNS) {
+    receivedCount++;
+    
+    if (hasPosted) {
+        if (((deadband > 0) && (std::labs(value - lastPostedValue) <= deadband)) ||
+            (suppressDuplicates && (value == lastPostedValue)))
+        {
+            // The latest value doesn't need posting, so neither does any value held back before it
+            hasPending = false;
+            return false;
+        }
+        
+        if (minIntervalNS && (timeNS < lastPostTimeNS + minIntervalNS)) {
+            hasPending = true;
+            pendingValue = value;
+            pendingTimeNS = timeNS;
+            wakeupTimeNS = lastPostTimeNS + minIntervalNS;
+            return false;
+        }
+    }
+    
+    hasPending = false;
+    recordPost(value, timeNS);
+    return true;
+}
+
+
+bool USBHIDInputFilter::takeDueValue(std::uint64_t currentTimeNS,
+                                     long &value,
+                                     std::uint64_t &timeNS,
+                                     std::uint64_t &nextWakeupTimeNS)
+{
+    if (!hasPending) {
+        return false;
+    }
+    
+    const std::uint64_t dueTimeNS = lastPostTimeNS + minIntervalNS;
+    if (currentTimeNS < dueTimeNS) {
+        if (!nextWakeupTimeNS || (dueTimeNS < nextWakeupTimeNS)) {
+            nextWakeupTimeNS = dueTimeNS;
+        }
+        return false;
+    }
+    
+    hasPending = false;
+    value = pendingValue;
+    timeNS = pendingTimeNS;
+    
+    // Measure the next interval from when the value is actually posted
+    recordPost(pendingValue, currentTimeNS);
+    
+    return true;
+}
+
+
+void USBHIDInputFilter::recordPost(long value, std::uint64_t timeNS) {
+    hasPosted = true;
+    lastPostedValue = value;
+    lastPostTimeNS = timeNS;
+    postedCount++;
+}
+
+
+END_NAMESPACE_MW
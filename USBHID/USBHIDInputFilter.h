@@ -0,0 +1,72 @@
+//
+//  USBHIDInputFilter.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDInputFilter__
+#define __USBHID__USBHIDInputFilter__
+
+#include <cstdint>
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Decides which of a channel's input values are worth posting.  A value is discarded if it's within the
+// deadband of (or, with duplicate suppression, equal to) the last posted value.  With a maximum update
+// rate, a value that arrives too soon after the last post is held back, replacing any value already held
+// back, and is posted once the minimum interval has elapsed.  This guarantees that the most recent change
+// is always posted eventually.
+//
+// All methods must be called from the I/O thread, except that the counts may be read after I/O stops.
+//
+class USBHIDInputFilter {
+    
+public:
+    USBHIDInputFilter(long deadband, bool suppressDuplicates, double maxUpdateRate);
+    
+    bool isActive() const { return (deadband > 0) || suppressDuplicates || (minIntervalNS > 0); }
+    
+    void reset();
+    
+    // Returns true if the value should be posted now.  If the value is held back, sets wakeupTimeNS to the
+    // time at which it becomes due.
+    bool filter(long value, std::uint64_t timeNS, std::uint64_t &wakeupTimeNS);
+    
+    // If a held-back value is due at currentTimeNS, returns true and sets value and timeNS to its value and
+    // original time stamp.  If a held-back value isn't due yet, lowers nextWakeupTimeNS (where zero means
+    // "none") to the time at which it will be.
+    bool takeDueValue(std::uint64_t currentTimeNS, long &value, std::uint64_t &timeNS, std::uint64_t &nextWakeupTimeNS);
+    
+    std::uint64_t getReceivedCount() const { return receivedCount; }
+    std::uint64_t getPostedCount() const { return postedCount; }
+    
+private:
+    void recordPost(long value, std::uint64_t timeNS);
+    
+    const long deadband;
+    const bool suppressDuplicates;
+    const std::uint64_t minIntervalNS;
+    
+    bool hasPosted;
+    long lastPostedValue;
+    std::uint64_t lastPostTimeNS;
+    
+    bool hasPending;
+    long pendingValue;
+    std::uint64_t pendingTimeNS;
+    
+    std::uint64_t receivedCount;
+    std::uint64_t postedCount;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDInputFilter__)
@@ -0,0 +1,135 @@
+//
+//  USBHIDInputLogger.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDInputLogger.h"
+
+#include <boost/chrono/duration.hpp>
+
+
+BEGIN_NAMESPACE_MW
+
+
+USBHIDInputLogger::USBHIDInputLogger(const std::string &deviceTag, std::size_t queueSize, MWTime reportIntervalUS) :
+    deviceTag(deviceTag),
+    reportIntervalUS(reportIntervalUS),
+    queue(queueSize),
+    droppedEntryCount(0),
+    lastReportedDroppedEntryCount(0),
+    stopRequested(false)
+{ }
+
+
+USBHIDInputLogger::~USBHIDInputLogger() {
+    stop();
+}
+
+
+bool USBHIDInputLogger::start() {
+    if (loggingThread.get_id() == boost::thread::id()) {
+        stopRequested = false;
+        try {
+            loggingThread = boost::thread(boost::bind(&USBHIDInputLogger::run, this));
+        } catch (const boost::thread_resource_error &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start HID input logging thread: %s", e.what());
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+
+void USBHIDInputLogger::stop() {
+    if (loggingThread.get_id() != boost::thread::id()) {
+        {
+            boost::mutex::scoped_lock lock(stopMutex);
+            stopRequested = true;
+        }
+        stopCondition.notify_all();
+        
+        try {
+            loggingThread.join();
+        } catch (const boost::system::system_error &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to stop HID input logging thread: %s", e.what());
+        }
+    }
+}
+
+
+void USBHIDInputLogger::run() {
+    boost::mutex::scoped_lock lock(stopMutex);
+    
+    while (!stopRequested) {
+        stopCondition.wait_for(lock, boost::chrono::microseconds(reportIntervalUS));
+        
+        // Don't hold the lock while reporting, so that stop() is never delayed by message output
+        lock.unlock();
+        report();
+        lock.lock();
+    }
+    
+    // Report anything logged since the last pass
+    lock.unlock();
+    report();
+}
+
+
+void USBHIDInputLogger::report() {
+    Entry entry;
+    while (queue.pop(entry)) {
+        const std::pair<std::uint32_t, std::uint32_t> key(entry.usagePage, entry.usage);
+        std::map<std::pair<std::uint32_t, std::uint32_t>, std::size_t>::iterator iter = summaryIndices.find(key);
+        if (iter == summaryIndices.end()) {
+            const Summary summary = { entry.usagePage, entry.usage, entry.integerValue, 1 };
+            summaryIndices.insert(std::make_pair(key, summaries.size()));
+            summaries.push_back(summary);
+        } else {
+            Summary &summary = summaries[iter->second];
+            summary.lastValue = entry.integerValue;
+            summary.changeCount++;
+        }
+    }
+    
+    BOOST_FOREACH(const Summary &summary, summaries) {
+        if (summary.changeCount == 1) {
+            mprintf("HID input on device \"%s\":\n"
+                    "\tUsage page:\t%u\t(0x%02X)\n"
+                    "\tUsage:\t\t%u\t(0x%02X)\n"
+                    "\tValue:\t\t%ld",
+                    deviceTag.c_str(),
+                    summary.usagePage, summary.usagePage,
+                    summary.usage, summary.usage,
+                    summary.lastValue);
+        } else {
+            mprintf("HID input on device \"%s\":\n"
+                    "\tUsage page:\t%u\t(0x%02X)\n"
+                    "\tUsage:\t\t%u\t(0x%02X)\n"
+                    "\tValue:\t\t%ld\t(changed %lu times)",
+                    deviceTag.c_str(),
+                    summary.usagePage, summary.usagePage,
+                    summary.usage, summary.usage,
+                    summary.lastValue,
+                    static_cast<unsigned long>(summary.changeCount));
+        }
+    }
+    
+    summaries.clear();
+    summaryIndices.clear();
+    
+    const std::uint64_t currentDroppedEntryCount = droppedEntryCount.load(std::memory_order_relaxed);
+    if (currentDroppedEntryCount != lastReportedDroppedEntryCount) {
+        mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                 "HID device \"%s\" did not log %llu input values (logging queue full)",
+                 deviceTag.c_str(),
+                 static_cast<unsigned long long>(currentDroppedEntryCount - lastReportedDroppedEntryCount));
+        lastReportedDroppedEntryCount = currentDroppedEntryCount;
+    }
+}
+
+
+END_NAMESPACE_MW
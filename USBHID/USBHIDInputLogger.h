@@ -0,0 +1,85 @@
+//
+//  USBHIDInputLogger.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDInputLogger__
+#define __USBHID__USBHIDInputLogger__
+
+#include <map>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "USBHIDRingBuffer.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Reports input values for log_all_input_values.  log() only copies the value into a preallocated queue;
+// a background thread drains the queue periodically and emits one message per usage that changed during
+// the period.  A usage that changed more than once is summarized with its change count and last value.
+//
+class USBHIDInputLogger : boost::noncopyable {
+    
+public:
+    USBHIDInputLogger(const std::string &deviceTag, std::size_t queueSize, MWTime reportIntervalUS);
+    ~USBHIDInputLogger();
+    
+    bool start();
+    void stop();
+    
+    // May be called from only one thread at a time.  Never blocks.
+    void log(std::uint32_t usagePage, std::uint32_t usage, long integerValue) {
+        const Entry entry = { usagePage, usage, integerValue };
+        if (!(queue.push(entry))) {
+            droppedEntryCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    
+private:
+    struct Entry {
+        std::uint32_t usagePage;
+        std::uint32_t usage;
+        long integerValue;
+    };
+    
+    struct Summary {
+        std::uint32_t usagePage;
+        std::uint32_t usage;
+        long lastValue;
+        std::size_t changeCount;
+    };
+    
+    void run();
+    void report();
+    
+    const std::string deviceTag;
+    const MWTime reportIntervalUS;
+    
+    USBHIDRingBuffer<Entry> queue;
+    std::atomic<std::uint64_t> droppedEntryCount;
+    std::uint64_t lastReportedDroppedEntryCount;
+    
+    // Used only by the logging thread.  Summaries appear in order of each usage's first change.
+    std::vector<Summary> summaries;
+    std::map<std::pair<std::uint32_t, std::uint32_t>, std::size_t> summaryIndices;
+    
+    boost::thread loggingThread;
+    boost::mutex stopMutex;
+    boost::condition_variable stopCondition;
+    bool stopRequested;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDInputLogger__)
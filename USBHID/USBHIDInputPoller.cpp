@@ -0,0 +1,128 @@
+//
+//  USBHIDInputPoller.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDInputPoller.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+USBHIDInputPoller::USBHIDInputPoller(const std::string &deviceTag,
+                                     const std::vector<std::uint8_t> &reportIDs,
+                                     std::size_t maxReportSize,
+                                     const ReportRequester &requestReport,
+                                     const CompletionNotifier &notifyCompletion) :
+    deviceTag(deviceTag),
+    reportIDs(reportIDs),
+    requestReport(requestReport),
+    notifyCompletion(notifyCompletion),
+    reportBuffers(reportIDs.size(), std::vector<std::uint8_t>(maxReportSize, 0)),
+    reportLengths(reportIDs.size(), 0),
+    state(State::Idle),
+    pollSampleTimeNS(0),
+    stopRequested(false)
+{ }
+
+
+USBHIDInputPoller::~USBHIDInputPoller() {
+    stop();
+}
+
+
+bool USBHIDInputPoller::start(const USBHIDThreadPolicy &threadPolicy) {
+    if (pollThread.get_id() == boost::thread::id()) {
+        state = State::Idle;
+        stopRequested = false;
+        
+        try {
+            pollThread = boost::thread(boost::bind(&USBHIDInputPoller::run, this, threadPolicy));
+        } catch (const boost::thread_resource_error &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start HID poll thread: %s", e.what());
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+
+void USBHIDInputPoller::stop() {
+    if (pollThread.get_id() != boost::thread::id()) {
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            stopRequested = true;
+        }
+        condition.notify_all();
+        
+        try {
+            pollThread.join();
+        } catch (const boost::system::system_error &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to stop HID poll thread: %s", e.what());
+        }
+        
+        state = State::Idle;
+    }
+}
+
+
+bool USBHIDInputPoller::requestPoll(std::uint64_t sampleTimeNS) {
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        if (state != State::Idle) {
+            return false;
+        }
+        state = State::Requested;
+        pollSampleTimeNS = sampleTimeNS;
+    }
+    
+    condition.notify_one();
+    return true;
+}
+
+
+bool USBHIDInputPoller::takeCompletedPoll(std::uint64_t &sampleTimeNS) {
+    boost::mutex::scoped_lock lock(mutex);
+    if (state != State::Completed) {
+        return false;
+    }
+    state = State::Idle;
+    sampleTimeNS = pollSampleTimeNS;
+    return true;
+}
+
+
+void USBHIDInputPoller::run(const USBHIDThreadPolicy &threadPolicy) {
+    threadPolicy.applyToCurrentThread(deviceTag, "poll");
+    
+    while (true) {
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            while (state != State::Requested && !stopRequested) {
+                condition.wait(lock);
+            }
+            if (stopRequested) {
+                break;
+            }
+        }
+        
+        // Don't hold the lock while requesting, so that the I/O thread never waits for the device
+        for (std::size_t reportIndex = 0; reportIndex < reportIDs.size(); reportIndex++) {
+            std::vector<std::uint8_t> &buffer = reportBuffers[reportIndex];
+            reportLengths[reportIndex] = requestReport(reportIDs[reportIndex], buffer.data(), buffer.size());
+        }
+        
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            state = State::Completed;
+        }
+        notifyCompletion();
+    }
+}
+
+
+END_NAMESPACE_MW
@@ -0,0 +1,100 @@
+//
+//  USBHIDInputPoller.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDInputPoller__
+#define __USBHID__USBHIDInputPoller__
+
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "USBHIDThreadPolicy.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Makes the blocking report requests of a poll on a dedicated thread, so that a slow or unresponsive device
+// never holds up the I/O thread.  The I/O thread starts a poll with requestPoll().  When every report has
+// been requested, the poll thread calls the completion notifier, which must wake the I/O thread; the I/O
+// thread then calls takeCompletedPoll() and decodes the fetched reports as usual.  At most one poll is in
+// progress at a time.
+//
+// Report buffers are allocated up front, so polling never allocates.
+//
+class USBHIDInputPoller : boost::noncopyable {
+    
+public:
+    // Called on the poll thread.  Stores the current contents of the input report with the given ID in
+    // buffer, and returns its length (without any leading byte that the platform adds for devices that
+    // don't use report IDs), or zero if the request failed.
+    typedef boost::function<std::size_t (std::uint8_t reportID, std::uint8_t *buffer, std::size_t bufferSize)> ReportRequester;
+    
+    // Called on the poll thread after each poll.  Must not block.
+    typedef boost::function<void ()> CompletionNotifier;
+    
+    USBHIDInputPoller(const std::string &deviceTag,
+                      const std::vector<std::uint8_t> &reportIDs,
+                      std::size_t maxReportSize,
+                      const ReportRequester &requestReport,
+                      const CompletionNotifier &notifyCompletion);
+    ~USBHIDInputPoller();
+    
+    bool start(const USBHIDThreadPolicy &threadPolicy);
+    
+    // Waits for any request in progress to finish.  A poll that completes afterwards is discarded.
+    void stop();
+    
+    // Called on the I/O thread.  Returns false, without starting a poll, if the previous poll hasn't been
+    // taken yet.
+    bool requestPoll(std::uint64_t sampleTimeNS);
+    
+    // Called on the I/O thread.  If a poll has completed since the last call, stores its sample time and
+    // returns true.  The fetched reports can then be read with the accessors below until the next
+    // requestPoll().
+    bool takeCompletedPoll(std::uint64_t &sampleTimeNS);
+    
+    std::size_t getReportCount() const { return reportIDs.size(); }
+    const std::uint8_t * getReportData(std::size_t reportIndex) const { return reportBuffers[reportIndex].data(); }
+    std::size_t getReportLength(std::size_t reportIndex) const { return reportLengths[reportIndex]; }  // Zero if failed
+    
+private:
+    enum class State {
+        Idle,
+        Requested,
+        Completed
+    };
+    
+    void run(const USBHIDThreadPolicy &threadPolicy);
+    
+    const std::string deviceTag;
+    const std::vector<std::uint8_t> reportIDs;
+    const ReportRequester requestReport;
+    const CompletionNotifier notifyCompletion;
+    
+    // Written by the poll thread only while state is Requested, and read by the I/O thread only while it
+    // isn't
+    std::vector<std::vector<std::uint8_t>> reportBuffers;
+    std::vector<std::size_t> reportLengths;
+    
+    boost::mutex mutex;
+    boost::condition_variable condition;
+    State state;
+    std::uint64_t pollSampleTimeNS;
+    bool stopRequested;
+    
+    boost::thread pollThread;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDInputPoller__)
@@ -0,0 +1,86 @@
+//
+//  USBHIDInputRangeChannel.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDInputRangeChannel.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+const std::string USBHIDInputRangeChannel::USAGE_PAGE("usage_page");
+const std::string USBHIDInputRangeChannel::USAGE_MIN("usage_min");
+const std::string USBHIDInputRangeChannel::USAGE_MAX("usage_max");
+const std::string USBHIDInputRangeChannel::VALUE("value");
+const std::string USBHIDInputRangeChannel::FORMAT("format");
+
+
+void USBHIDInputRangeChannel::describeComponent(ComponentInfo &info) {
+    USBHIDMultiUsageChannel::describeComponent(info);
+    
+    info.setSignature("iochannel/usbhid_generic_input_range_channel");
+    
+    info.addParameter(USAGE_PAGE);
+    info.addParameter(USAGE_MIN);
+    info.addParameter(USAGE_MAX);
+    info.addParameter(VALUE);
+    info.addParameter(FORMAT, "list");
+}
+
+
+USBHIDInputRangeChannel::USBHIDInputRangeChannel(const ParameterValueMap &parameters) :
+    USBHIDMultiUsageChannel(parameters),
+    usagePage(parameters[USAGE_PAGE]),
+    usageMin(parameters[USAGE_MIN]),
+    usageMax(parameters[USAGE_MAX]),
+    value(parameters[VALUE]),
+    bitmask(false)
+{
+    if (usagePage <= kHIDPage_Undefined) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid HID usage page");
+    }
+    if (usageMin <= kHIDUsage_Undefined || usageMin > 0xFFFF) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid minimum HID usage");
+    }
+    if (usageMax < usageMin || usageMax > 0xFFFF) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid maximum HID usage");
+    }
+    
+    const std::string format = parameters[FORMAT].str();
+    if (format == "bitmask") {
+        if (getUsageCount() > maxBitmaskSize) {
+            throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN,
+                                  "USBHID range channel with bitmask format can span at most 64 usages");
+        }
+        bitmask = true;
+    } else if (format != "list") {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid format for USBHID range channel", format);
+    }
+}
+
+
+void USBHIDInputRangeChannel::postValues(const std::vector<long> &values, MWTime time) const {
+    if (bitmask) {
+        std::uint64_t bits = 0;
+        for (std::size_t offset = 0; offset < values.size(); offset++) {
+            if (values[offset]) {
+                bits |= std::uint64_t(1) << offset;
+            }
+        }
+        value->setValue(Datum(static_cast<long long>(bits)), time);
+    } else {
+        Datum::list_value_type list;
+        list.reserve(values.size());
+        BOOST_FOREACH(long integerValue, values) {
+            list.push_back(Datum(integerValue));
+        }
+        value->setValue(Datum(list), time);
+    }
+}
+
+
+END_NAMESPACE_MW
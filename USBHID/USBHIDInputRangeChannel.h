@@ -0,0 +1,60 @@
+//
+//  USBHIDInputRangeChannel.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDInputRangeChannel__
+#define __USBHID__USBHIDInputRangeChannel__
+
+#include "USBHIDMultiUsageChannel.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Binds a contiguous range of usages on one usage page (e.g. all the keys of a keyboard, or a block of
+// buttons) to a single variable.  The variable holds either a list with one entry per usage or, for
+// ranges of at most 64 usages, a bitmask in which bit n is set if the value for usage_min + n is nonzero.
+//
+class USBHIDInputRangeChannel : public USBHIDMultiUsageChannel {
+    
+public:
+    static const std::string USAGE_PAGE;
+    static const std::string USAGE_MIN;
+    static const std::string USAGE_MAX;
+    static const std::string VALUE;
+    static const std::string FORMAT;
+    
+    static const std::size_t maxBitmaskSize = 64;
+    
+    static void describeComponent(ComponentInfo &info);
+    
+    explicit USBHIDInputRangeChannel(const ParameterValueMap &parameters);
+    
+    std::size_t getUsageCount() const MW_OVERRIDE { return std::size_t(usageMax - usageMin + 1); }
+    UsagePair getUsage(std::size_t offset) const MW_OVERRIDE { return UsagePair(usagePage, usageMin + long(offset)); }
+    bool containsUsage(long page, long usage) const MW_OVERRIDE {
+        return (page == usagePage) && (usage >= usageMin) && (usage <= usageMax);
+    }
+    bool requiresAllUsages() const MW_OVERRIDE { return false; }
+    
+    void postValues(const std::vector<long> &values, MWTime time) const MW_OVERRIDE;
+    
+private:
+    const long usagePage;
+    const long usageMin;
+    const long usageMax;
+    const VariablePtr value;
+    bool bitmask;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDInputRangeChannel__)
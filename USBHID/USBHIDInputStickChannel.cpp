@@ -0,0 +1,92 @@
+//
+//  USBHIDInputStickChannel.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDInputStickChannel.h"
+
+#include <cmath>
+
+
+BEGIN_NAMESPACE_MW
+
+
+const std::string USBHIDInputStickChannel::USAGE_PAGE("usage_page");
+const std::string USBHIDInputStickChannel::X_USAGE("x_usage");
+const std::string USBHIDInputStickChannel::Y_USAGE("y_usage");
+const std::string USBHIDInputStickChannel::RAW_MIN("raw_min");
+const std::string USBHIDInputStickChannel::RAW_MAX("raw_max");
+const std::string USBHIDInputStickChannel::RAW_CENTER("raw_center");
+const std::string USBHIDInputStickChannel::INVERT_X("invert_x");
+const std::string USBHIDInputStickChannel::INVERT_Y("invert_y");
+const std::string USBHIDInputStickChannel::VALUE("value");
+
+
+void USBHIDInputStickChannel::describeComponent(ComponentInfo &info) {
+    USBHIDMultiUsageChannel::describeComponent(info);
+    
+    info.setSignature("iochannel/usbhid_generic_input_stick_channel");
+    
+    info.addParameter(USAGE_PAGE, "1");  // Generic Desktop
+    info.addParameter(X_USAGE);
+    info.addParameter(Y_USAGE);
+    info.addParameter(RAW_MIN);
+    info.addParameter(RAW_MAX);
+    info.addParameter(RAW_CENTER, false);
+    info.addParameter(INVERT_X, "NO");
+    info.addParameter(INVERT_Y, "NO");
+    info.addParameter(VALUE);
+}
+
+
+USBHIDInputStickChannel::USBHIDInputStickChannel(const ParameterValueMap &parameters) :
+    USBHIDMultiUsageChannel(parameters),
+    usagePage(parameters[USAGE_PAGE]),
+    xUsage(parameters[X_USAGE]),
+    yUsage(parameters[Y_USAGE]),
+    xScaler(parameters[RAW_MIN], parameters[RAW_MAX], getRawCenter(parameters), -1.0, 1.0, parameters[INVERT_X]),
+    yScaler(parameters[RAW_MIN], parameters[RAW_MAX], getRawCenter(parameters), -1.0, 1.0, parameters[INVERT_Y]),
+    value(parameters[VALUE]),
+    xKey("x"),
+    yKey("y"),
+    magnitudeKey("magnitude"),
+    angleKey("angle")
+{
+    if (usagePage <= kHIDPage_Undefined) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid HID usage page");
+    }
+    if (xUsage <= kHIDUsage_Undefined || yUsage <= kHIDUsage_Undefined || xUsage == yUsage) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid HID usage for USBHID stick channel axis");
+    }
+}
+
+
+void USBHIDInputStickChannel::postValues(const std::vector<long> &values, MWTime time) const {
+    const double x = xScaler.scale(values[0]);
+    const double y = yScaler.scale(values[1]);
+    const double magnitude = std::sqrt(x * x + y * y);
+    const double angle = ((magnitude > 0.0) ? (std::atan2(y, x) * 180.0 / M_PI) : 0.0);
+    
+    // The variable keeps its own copy of whatever is posted, so the dictionary has to be built (and
+    // allocated) anew each time
+    Datum::dict_value_type stick;
+    stick[xKey] = Datum(x);
+    stick[yKey] = Datum(y);
+    stick[magnitudeKey] = Datum(magnitude);
+    stick[angleKey] = Datum(angle);
+    value->setValue(Datum(stick), time);
+}
+
+
+double USBHIDInputStickChannel::getRawCenter(const ParameterValueMap &parameters) {
+    if (!(parameters[RAW_CENTER].empty())) {
+        return parameters[RAW_CENTER];
+    }
+    return (double(parameters[RAW_MIN]) + double(parameters[RAW_MAX])) / 2.0;
+}
+
+
+END_NAMESPACE_MW
@@ -0,0 +1,75 @@
+//
+//  USBHIDInputStickChannel.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDInputStickChannel__
+#define __USBHID__USBHIDInputStickChannel__
+
+#include "USBHIDAxisScaler.h"
+#include "USBHIDMultiUsageChannel.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Combines two axes (typically the X and Y axes of a joystick or thumbstick) into a single variable.  Each
+// axis is scaled to the range [-1, 1], and the variable is set to a dictionary holding the scaled
+// coordinates and the corresponding magnitude and angle.
+//
+// Posting the dictionary allocates (as does posting a range channel's list), so unlike single-usage
+// channels and bitmask range channels, stick channels are not free of allocations on the dispatch path.
+//
+class USBHIDInputStickChannel : public USBHIDMultiUsageChannel {
+    
+public:
+    static const std::string USAGE_PAGE;
+    static const std::string X_USAGE;
+    static const std::string Y_USAGE;
+    static const std::string RAW_MIN;
+    static const std::string RAW_MAX;
+    static const std::string RAW_CENTER;
+    static const std::string INVERT_X;
+    static const std::string INVERT_Y;
+    static const std::string VALUE;
+    
+    static void describeComponent(ComponentInfo &info);
+    
+    explicit USBHIDInputStickChannel(const ParameterValueMap &parameters);
+    
+    std::size_t getUsageCount() const MW_OVERRIDE { return 2; }
+    UsagePair getUsage(std::size_t offset) const MW_OVERRIDE { return UsagePair(usagePage, ((offset == 0) ? xUsage : yUsage)); }
+    bool containsUsage(long page, long usage) const MW_OVERRIDE {
+        return (page == usagePage) && ((usage == xUsage) || (usage == yUsage));
+    }
+    bool requiresAllUsages() const MW_OVERRIDE { return true; }
+    
+    void postValues(const std::vector<long> &values, MWTime time) const MW_OVERRIDE;
+    
+private:
+    static double getRawCenter(const ParameterValueMap &parameters);
+    
+    const long usagePage;
+    const long xUsage;
+    const long yUsage;
+    const USBHIDAxisScaler xScaler;
+    const USBHIDAxisScaler yScaler;
+    const VariablePtr value;
+    
+    // Built once, so that posting a value doesn't construct the keys again
+    const Datum xKey;
+    const Datum yKey;
+    const Datum magnitudeKey;
+    const Datum angleKey;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDInputStickChannel__)
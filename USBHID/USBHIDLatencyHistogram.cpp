@@ -0,0 +1,79 @@
+//
+//  USBHIDLatencyHistogram.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDLatencyHistogram.h"
+
+#include <algorithm>
+#include <limits>
+
+
+BEGIN_NAMESPACE_MW
+
+
+USBHIDLatencyHistogram::USBHIDLatencyHistogram() {
+    reset();
+}
+
+
+void USBHIDLatencyHistogram::reset() {
+    for (std::size_t index = 0; index < bucketCount; index++) {
+        counts[index].store(0, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+
+double USBHIDLatencyHistogram::getMeanNS() const {
+    const std::uint64_t currentCount = getCount();
+    if (currentCount == 0) {
+        return 0.0;
+    }
+    return double(sum.load(std::memory_order_relaxed)) / double(currentCount);
+}
+
+
+std::uint64_t USBHIDLatencyHistogram::getQuantileNS(double quantile) const {
+    const std::uint64_t currentCount = getCount();
+    if (currentCount == 0) {
+        return 0;
+    }
+    
+    const std::uint64_t rank = std::uint64_t(quantile * double(currentCount - 1)) + 1;
+    std::uint64_t cumulativeCount = 0;
+    
+    for (std::size_t index = 0; index < bucketCount; index++) {
+        cumulativeCount += counts[index].load(std::memory_order_relaxed);
+        if (cumulativeCount >= rank) {
+            // The maximum is exact, so never report a bound above it
+            return std::min(bucketUpperBound(index), getMaxNS());
+        }
+    }
+    
+    return getMaxNS();
+}
+
+
+std::uint64_t USBHIDLatencyHistogram::bucketUpperBound(std::size_t index) {
+    if (index == 0) {
+        return (std::uint64_t(1) << minExponent);
+    }
+    if (index == overflowIndex) {
+        return std::numeric_limits<std::uint64_t>::max();
+    }
+    
+    const std::size_t exponent = ((index - 1) >> subBucketBits) + minExponent;
+    const std::uint64_t subBucket = (index - 1) & ((1 << subBucketBits) - 1);
+    const std::size_t shift = exponent - subBucketBits;
+    
+    return (((std::uint64_t(1) << subBucketBits) + subBucket + 1) << shift);
+}
+
+
+END_NAMESPACE_MW
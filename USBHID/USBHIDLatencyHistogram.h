@@ -0,0 +1,87 @@
+//
+//  USBHIDLatencyHistogram.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDLatencyHistogram__
+#define __USBHID__USBHIDLatencyHistogram__
+
+#include <atomic>
+#include <cstdint>
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Fixed-bucket histogram of delays in nanoseconds.  Delays under about 1us share the first bucket; above
+// that, each power of two is split into four buckets, so any delay is resolved to within 25%.  Delays
+// beyond about 18 minutes share the last bucket.
+//
+// record() may be called from only one thread at a time.  It never blocks or allocates, and other threads
+// may read the histogram concurrently (although a concurrent reader may see a partially updated state).
+//
+class USBHIDLatencyHistogram : boost::noncopyable {
+    
+public:
+    USBHIDLatencyHistogram();
+    
+    void reset();
+    
+    void record(std::int64_t delayNS) {
+        const std::uint64_t value = ((delayNS > 0) ? std::uint64_t(delayNS) : 0);
+        increment(counts[bucketIndex(value)]);
+        increment(count);
+        sum.store(sum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        if (value > max.load(std::memory_order_relaxed)) {
+            max.store(value, std::memory_order_relaxed);
+        }
+    }
+    
+    std::uint64_t getCount() const { return count.load(std::memory_order_relaxed); }
+    double getMeanNS() const;
+    std::uint64_t getMaxNS() const { return max.load(std::memory_order_relaxed); }
+    
+    // Returns the upper bound of the bucket containing the given quantile (0 to 1)
+    std::uint64_t getQuantileNS(double quantile) const;
+    
+private:
+    static const std::size_t subBucketBits = 2;
+    static const std::size_t minExponent = 10;  // First bucket is [0, 2^10)
+    static const std::size_t maxExponent = 40;
+    static const std::size_t overflowIndex = ((maxExponent - minExponent) << subBucketBits) + 1;
+    static const std::size_t bucketCount = overflowIndex + 1;
+    
+    static std::size_t bucketIndex(std::uint64_t value) {
+        if (value < (std::uint64_t(1) << minExponent)) {
+            return 0;
+        }
+        const std::size_t exponent = 63 - __builtin_clzll(value);
+        if (exponent >= maxExponent) {
+            return overflowIndex;
+        }
+        const std::size_t subBucket = (value >> (exponent - subBucketBits)) & ((1 << subBucketBits) - 1);
+        return ((exponent - minExponent) << subBucketBits) + subBucket + 1;
+    }
+    
+    static std::uint64_t bucketUpperBound(std::size_t index);
+    
+    static void increment(std::atomic<std::uint64_t> &counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    
+    std::atomic<std::uint64_t> counts[bucketCount];
+    std::atomic<std::uint64_t> count;
+    std::atomic<std::uint64_t> sum;
+    std::atomic<std::uint64_t> max;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDLatencyHistogram__)
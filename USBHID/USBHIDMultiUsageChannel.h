@@ -0,0 +1,45 @@
+//
+//  USBHIDMultiUsageChannel.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDMultiUsageChannel__
+#define __USBHID__USBHIDMultiUsageChannel__
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Base class for channels that combine the values of several usages into a single variable.  The device
+// tracks the current value of each usage and, once per input report in which any of them changed, passes
+// all of them to postValues, on whichever thread posts values.
+//
+class USBHIDMultiUsageChannel : public Component {
+    
+public:
+    typedef std::pair<long, long> UsagePair;
+    
+    virtual std::size_t getUsageCount() const = 0;
+    virtual UsagePair getUsage(std::size_t offset) const = 0;
+    virtual bool containsUsage(long usagePage, long usage) const = 0;
+    
+    // If false, the device needn't have every usage, and missing usages always have value zero
+    virtual bool requiresAllUsages() const = 0;
+    
+    // values holds the current value of each usage, in order
+    virtual void postValues(const std::vector<long> &values, MWTime time) const = 0;
+    
+protected:
+    explicit USBHIDMultiUsageChannel(const ParameterValueMap &parameters) : Component(parameters) { }
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDMultiUsageChannel__)
@@ -0,0 +1,60 @@
+//
+//  USBHIDOutputChannel.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDOutputChannel.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+const std::string USBHIDOutputChannel::USAGE_PAGE("usage_page");
+const std::string USBHIDOutputChannel::USAGE("usage");
+const std::string USBHIDOutputChannel::VALUE("value");
+const std::string USBHIDOutputChannel::REPORT_TYPE("report_type");
+
+
+void USBHIDOutputChannel::describeComponent(ComponentInfo &info) {
+    Component::describeComponent(info);
+    
+    info.setSignature("iochannel/usbhid_generic_output_channel");
+    
+    info.addParameter(USAGE_PAGE);
+    info.addParameter(USAGE);
+    info.addParameter(VALUE);
+    info.addParameter(REPORT_TYPE, "output");
+}
+
+
+USBHIDOutputChannel::USBHIDOutputChannel(const ParameterValueMap &parameters) :
+    Component(parameters),
+    usagePage(parameters[USAGE_PAGE]),
+    usage(parameters[USAGE]),
+    value(parameters[VALUE]),
+    feature(isFeatureReportType(parameters[REPORT_TYPE].str()))
+{
+    if (usagePage <= kHIDPage_Undefined) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid HID usage page");
+    }
+    if (usage <= kHIDUsage_Undefined) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid HID usage");
+    }
+}
+
+
+bool USBHIDOutputChannel::isFeatureReportType(const std::string &reportType) {
+    if (reportType == "feature") {
+        return true;
+    }
+    if (reportType != "output") {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid report type for USBHID output channel", reportType);
+    }
+    return false;
+}
+
+
+END_NAMESPACE_MW
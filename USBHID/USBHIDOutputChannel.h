@@ -0,0 +1,51 @@
+//
+//  USBHIDOutputChannel.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDOutputChannel__
+#define __USBHID__USBHIDOutputChannel__
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Sends the value of a variable to one element of an output or feature report (e.g. an LED, a rumble
+// motor, or a response box light) whenever the variable changes
+//
+class USBHIDOutputChannel : public Component {
+    
+public:
+    static const std::string USAGE_PAGE;
+    static const std::string USAGE;
+    static const std::string VALUE;
+    static const std::string REPORT_TYPE;
+    
+    static void describeComponent(ComponentInfo &info);
+    
+    explicit USBHIDOutputChannel(const ParameterValueMap &parameters);
+    
+    long getUsagePage() const { return usagePage; }
+    long getUsage() const { return usage; }
+    bool isFeature() const { return feature; }
+    const VariablePtr & getValue() const { return value; }
+    
+private:
+    static bool isFeatureReportType(const std::string &reportType);
+    
+    const long usagePage;
+    const long usage;
+    const VariablePtr value;
+    const bool feature;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDOutputChannel__)
@@ -0,0 +1,202 @@
+//
+//  USBHIDOutputWriter.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDOutputWriter.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+USBHIDOutputWriter::USBHIDOutputWriter(const std::string &deviceTag,
+                                       USBHIDBackend &backend,
+                                       std::size_t outputCount,
+                                       MWTime maxLatencyUS) :
+    deviceTag(deviceTag),
+    backend(backend),
+    maxLatencyNS(std::uint64_t(maxLatencyUS) * 1000),
+    clock(Clock::instance()),
+    stopRequested(false),
+    requestedValueCount(0),
+    supersededValueCount(0),
+    sentValueCount(0),
+    transferCount(0),
+    failedValueCount(0),
+    lateValueCount(0)
+{
+    const Slot emptySlot = { 0, 0, false };
+    slots.assign(outputCount, emptySlot);
+    pendingIndices.reserve(outputCount);
+    batch.reserve(outputCount);
+    batchRequestTimesNS.reserve(outputCount);
+}
+
+
+USBHIDOutputWriter::~USBHIDOutputWriter() {
+    stop();
+}
+
+
+bool USBHIDOutputWriter::start() {
+    if (writerThread.get_id() == boost::thread::id()) {
+        stopRequested = false;
+        requestedValueCount = 0;
+        supersededValueCount = 0;
+        sentValueCount = 0;
+        transferCount = 0;
+        failedValueCount = 0;
+        lateValueCount = 0;
+        latency.reset();
+        
+        try {
+            writerThread = boost::thread(boost::bind(&USBHIDOutputWriter::run, this));
+        } catch (const boost::thread_resource_error &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start HID output thread: %s", e.what());
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+
+void USBHIDOutputWriter::stop() {
+    if (writerThread.get_id() != boost::thread::id()) {
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            stopRequested = true;
+        }
+        condition.notify_all();
+        
+        try {
+            writerThread.join();
+        } catch (const boost::system::system_error &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to stop HID output thread: %s", e.what());
+        }
+        
+        reportStatistics();
+    }
+}
+
+
+void USBHIDOutputWriter::setValue(std::size_t outputIndex, long integerValue) {
+    const std::uint64_t requestTimeNS = clock->getSystemTimeNS();
+    
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        
+        Slot &slot = slots[outputIndex];
+        if (slot.pending) {
+            supersededValueCount++;
+        } else {
+            slot.pending = true;
+            pendingIndices.push_back(outputIndex);
+        }
+        slot.integerValue = integerValue;
+        slot.requestTimeNS = requestTimeNS;
+        requestedValueCount++;
+    }
+    
+    condition.notify_one();
+}
+
+
+void USBHIDOutputWriter::run() {
+    bool lateValueReported = false;
+    
+    while (true) {
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            
+            while (pendingIndices.empty() && !stopRequested) {
+                condition.wait(lock);
+            }
+            if (pendingIndices.empty()) {
+                // Stop was requested, and everything has been sent
+                break;
+            }
+            
+            batch.clear();
+            batchRequestTimesNS.clear();
+            BOOST_FOREACH(std::size_t outputIndex, pendingIndices) {
+                Slot &slot = slots[outputIndex];
+                const USBHIDBackend::OutputValue value = { outputIndex, slot.integerValue };
+                batch.push_back(value);
+                batchRequestTimesNS.push_back(slot.requestTimeNS);
+                slot.pending = false;
+            }
+            pendingIndices.clear();
+        }
+        
+        // Don't hold the lock while writing, so that setValue() never waits for the device
+        std::size_t batchTransferCount = 0;
+        if (!(backend.writeOutputs(batch, batchTransferCount))) {
+            if (!failedValueCount) {
+                merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to send output values to HID device \"%s\"", deviceTag.c_str());
+            }
+            failedValueCount += batch.size();
+        }
+        transferCount += batchTransferCount;
+        sentValueCount += batch.size();
+        
+        const std::uint64_t previousLateValueCount = lateValueCount;
+        recordLatencies(clock->getSystemTimeNS());
+        if (!lateValueReported && (lateValueCount > previousLateValueCount)) {
+            mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                     "HID device \"%s\" took longer than %.3f ms to send an output value",
+                     deviceTag.c_str(),
+                     double(maxLatencyNS) / 1.0e6);
+            lateValueReported = true;
+        }
+    }
+}
+
+
+void USBHIDOutputWriter::recordLatencies(std::uint64_t sentTimeNS) {
+    BOOST_FOREACH(std::uint64_t requestTimeNS, batchRequestTimesNS) {
+        const std::int64_t delayNS = std::int64_t(sentTimeNS) - std::int64_t(requestTimeNS);
+        latency.record(delayNS);
+        if (maxLatencyNS && (delayNS > std::int64_t(maxLatencyNS))) {
+            lateValueCount++;
+        }
+    }
+}
+
+
+void USBHIDOutputWriter::reportStatistics() const {
+    if (!requestedValueCount) {
+        return;
+    }
+    
+    mprintf("HID device \"%s\" sent %llu output values in %llu transfers (%llu superseded values dropped); "
+            "change-to-sent delay median %.3f ms, 99th percentile %.3f ms, maximum %.3f ms",
+            deviceTag.c_str(),
+            static_cast<unsigned long long>(sentValueCount - failedValueCount),
+            static_cast<unsigned long long>(transferCount),
+            static_cast<unsigned long long>(supersededValueCount),
+            double(latency.getQuantileNS(0.5)) / 1.0e6,
+            double(latency.getQuantileNS(0.99)) / 1.0e6,
+            double(latency.getMaxNS()) / 1.0e6);
+    
+    if (failedValueCount) {
+        mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                 "HID device \"%s\" failed to send %llu output values",
+                 deviceTag.c_str(),
+                 static_cast<unsigned long long>(failedValueCount));
+    }
+    
+    if (lateValueCount) {
+        mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                 "HID device \"%s\" took longer than %.3f ms to send %llu output values",
+                 deviceTag.c_str(),
+                 double(maxLatencyNS) / 1.0e6,
+                 static_cast<unsigned long long>(lateValueCount));
+    }
+}
+
+
+END_NAMESPACE_MW
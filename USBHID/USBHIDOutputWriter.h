@@ -0,0 +1,93 @@
+//
+//  USBHIDOutputWriter.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDOutputWriter__
+#define __USBHID__USBHIDOutputWriter__
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "USBHIDBackend.h"
+#include "USBHIDLatencyHistogram.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Sends output channel values to the device on a dedicated thread, so that a variable change never waits
+// for a USB transfer.  setValue() only records the value in a per-channel slot and wakes the thread.  If a
+// channel changes again before its previous value was sent, the previous value is dropped.  The thread
+// takes every pending value at once and passes them to the backend, which combines the values that belong
+// to the same report into a single transfer.
+//
+// The delay from each setValue() call to the completion of the transfer that carried its value is recorded
+// and summarized when the writer stops.  If maxLatencyUS is nonzero, values that take longer are counted,
+// and the first such value in each run produces a warning.
+//
+class USBHIDOutputWriter : boost::noncopyable {
+    
+public:
+    USBHIDOutputWriter(const std::string &deviceTag,
+                       USBHIDBackend &backend,
+                       std::size_t outputCount,
+                       MWTime maxLatencyUS);
+    ~USBHIDOutputWriter();
+    
+    bool start();
+    
+    // Sends any values that are still pending before returning
+    void stop();
+    
+    // May be called from any thread.  Never blocks on the device.
+    void setValue(std::size_t outputIndex, long integerValue);
+    
+private:
+    struct Slot {
+        long integerValue;
+        std::uint64_t requestTimeNS;
+        bool pending;
+    };
+    
+    void run();
+    void recordLatencies(std::uint64_t sentTimeNS);
+    void reportStatistics() const;
+    
+    const std::string deviceTag;
+    USBHIDBackend &backend;
+    const std::uint64_t maxLatencyNS;
+    const boost::shared_ptr<Clock> clock;
+    
+    // Guarded by mutex.  pendingIndices lists the slots with pending values, in the order in which they
+    // became pending, and has capacity for every slot, so setValue() never allocates.
+    boost::mutex mutex;
+    boost::condition_variable condition;
+    std::vector<Slot> slots;
+    std::vector<std::size_t> pendingIndices;
+    bool stopRequested;
+    std::uint64_t requestedValueCount;
+    std::uint64_t supersededValueCount;
+    
+    // Used only by the writer thread, except that statistics are read after it exits
+    std::vector<USBHIDBackend::OutputValue> batch;
+    std::vector<std::uint64_t> batchRequestTimesNS;
+    std::uint64_t sentValueCount;
+    std::uint64_t transferCount;
+    std::uint64_t failedValueCount;
+    std::uint64_t lateValueCount;
+    USBHIDLatencyHistogram latency;
+    
+    boost::thread writerThread;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDOutputWriter__)
@@ -6,7 +6,8 @@
 //  Copyright (c) 2013 The MWorks Project. All rights reserved.
 //
 
-#include "USBHIDDevice.h"
+#include "USBHIDReplayDevice.h"
+#include "USBHIDSyntheticDevice.h"
 
 
 BEGIN_NAMESPACE_MW
@@ -15,7 +16,12 @@ BEGIN_NAMESPACE_MW
 class USBHIDPlugin : public Plugin {
     void registerComponents(boost::shared_ptr<ComponentRegistry> registry) MW_OVERRIDE {
         registry->registerFactory<StandardComponentFactory, USBHIDDevice>();
+        registry->registerFactory<StandardComponentFactory, USBHIDReplayDevice>();
+        registry->registerFactory<StandardComponentFactory, USBHIDSyntheticDevice>();
         registry->registerFactory<StandardComponentFactory, USBHIDInputChannel>();
+        registry->registerFactory<StandardComponentFactory, USBHIDInputRangeChannel>();
+        registry->registerFactory<StandardComponentFactory, USBHIDInputStickChannel>();
+        registry->registerFactory<StandardComponentFactory, USBHIDOutputChannel>();
     }
 };
 
@@ -0,0 +1,256 @@
+//
+//  USBHIDReplayBackend.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDReplayBackend.h"
+
+#include <cstring>
+
+#include <boost/chrono/duration.hpp>
+
+#include "USBHIDReportDescriptor.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+USBHIDReplayBackend::USBHIDReplayBackend(const std::string &deviceTag, const std::string &capturePath, double speed) :
+    USBHIDBackend(deviceTag),
+    capturePath(capturePath),
+    speed(speed),
+    deliverAllValues(false),
+    stopRequested(false),
+    wakeupTimeNS(0),
+    delegate(nullptr)
+{ }
+
+
+USBHIDReplayBackend::~USBHIDReplayBackend() {
+    (void)stopIO();
+}
+
+
+bool USBHIDReplayBackend::openDevice(const DeviceMatchingCriteria &criteria) {
+    try {
+        capture.reset(new usbhid::CaptureReader(capturePath));
+    } catch (const usbhid::CaptureError &e) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN, "%s", e.what());
+        return false;
+    }
+    
+    const usbhid::CaptureHeader &header = capture->getHeader();
+    
+    if (header.usagePage != criteria.usagePage || header.usage != criteria.usage) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN,
+               "HID capture file \"%s\" was recorded from a device with usage page %u, usage %u",
+               capturePath.c_str(),
+               header.usagePage,
+               header.usage);
+        return false;
+    }
+    
+    if (criteria.preferredLocationID && header.locationID && (criteria.preferredLocationID != header.locationID)) {
+        mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                 "Location ID for HID device \"%s\" (%lu) does not match preferred location ID (%lu)",
+                 deviceTag.c_str(),
+                 static_cast<unsigned long>(header.locationID),
+                 static_cast<unsigned long>(criteria.preferredLocationID));
+    }
+    
+    return true;
+}
+
+
+USBHIDBackend::DeviceInfo USBHIDReplayBackend::getDeviceInfo() const {
+    const usbhid::CaptureHeader &header = capture->getHeader();
+    DeviceInfo info = {
+        header.vendorID,
+        header.productID,
+        header.versionNumber,
+        header.locationID,
+        std::string(header.product, strnlen(header.product, sizeof(header.product)))
+    };
+    return info;
+}
+
+
+bool USBHIDReplayBackend::prepareInputs(const std::vector<UsagePair> &channelUsages,
+                                        std::size_t requiredChannelCount,
+                                        bool newDeliverAllValues,
+                                        bool rawReports)
+{
+    // Captured values are already decoded, so rawReports makes no difference here.  A capture doesn't record
+    // which usages the device has, so every channel is treated as optional.
+    
+    std::vector< std::pair<std::uint32_t, std::size_t> > usages;
+    for (std::size_t channelIndex = 0; channelIndex < channelUsages.size(); channelIndex++) {
+        usages.push_back(std::make_pair(usbhid::ReportDescriptor::makeUsage(channelUsages[channelIndex].first,
+                                                                            channelUsages[channelIndex].second),
+                                        channelIndex));
+    }
+    std::sort(usages.begin(), usages.end());
+    
+    sortedUsages.clear();
+    sortedChannelIndices.clear();
+    for (std::size_t i = 0; i < usages.size(); i++) {
+        sortedUsages.push_back(usages[i].first);
+        sortedChannelIndices.push_back(usages[i].second);
+    }
+    
+    deliverAllValues = newDeliverAllValues;
+    
+    return true;
+}
+
+
+bool USBHIDReplayBackend::readInitialValues(Delegate &delegate) {
+    // A capture begins with the initial values read by the recording device, so there's nothing to do here
+    return true;
+}
+
+
+bool USBHIDReplayBackend::startIO(Delegate &newDelegate) {
+    if (!isRunning()) {
+        delegate = &newDelegate;
+        stopRequested = false;
+        
+        try {
+            replayThread = boost::thread(boost::bind(&USBHIDReplayBackend::replayLoop, this));
+        } catch (const boost::thread_resource_error &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start HID replay: %s", e.what());
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+
+bool USBHIDReplayBackend::stopIO() {
+    if (isRunning()) {
+        {
+            boost::mutex::scoped_lock lock(stopMutex);
+            stopRequested = true;
+        }
+        stopCondition.notify_all();
+        
+        try {
+            replayThread.join();
+        } catch (const boost::system::system_error &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to stop HID replay: %s", e.what());
+            return false;
+        }
+        
+        // Discard any pending wakeup
+        wakeupTimeNS = 0;
+    }
+    
+    return true;
+}
+
+
+void USBHIDReplayBackend::requestWakeup(std::uint64_t timeNS) {
+    if (!wakeupTimeNS || (timeNS < wakeupTimeNS)) {
+        wakeupTimeNS = timeNS;
+    }
+}
+
+
+void USBHIDReplayBackend::replayLoop() {
+    ioThreadPolicy.applyToCurrentThread(deviceTag, "I/O");
+    
+    boost::shared_ptr<Clock> clock = Clock::instance();
+    const usbhid::CaptureRecord *records = capture->getRecords();
+    const std::size_t recordCount = capture->getRecordCount();
+    
+    const std::uint64_t startTimeNS = clock->getSystemTimeNS();
+    const std::uint64_t firstTimestampNS = (recordCount ? records[0].timestampNS : 0);
+    
+    std::uint64_t timestampNS = 0;
+    
+    for (std::size_t recordIndex = 0; recordIndex < recordCount; recordIndex++) {
+        const usbhid::CaptureRecord &record = records[recordIndex];
+        
+        // Values from the same report share a time stamp, and they keep sharing one on replay
+        if ((recordIndex == 0) || (records[recordIndex - 1].timestampNS != record.timestampNS)) {
+            if (speed > 0.0) {
+                const std::uint64_t offsetNS = ((record.timestampNS > firstTimestampNS) ?
+                                                record.timestampNS - firstTimestampNS :
+                                                0);
+                timestampNS = startTimeNS + std::uint64_t(double(offsetNS) / speed);
+                if (!deliverWakeups(timestampNS) || !waitUntil(timestampNS)) {
+                    return;
+                }
+            } else {
+                timestampNS = clock->getSystemTimeNS();
+                if (!deliverWakeups(timestampNS) || stopRequested) {
+                    return;
+                }
+            }
+        }
+        
+        const std::size_t channelIndex = lookupChannelIndex(usbhid::ReportDescriptor::makeUsage(record.usagePage,
+                                                                                                record.usage));
+        if (channelIndex != noChannel || deliverAllValues) {
+            const InputValue value = {
+                channelIndex,
+                record.usagePage,
+                record.usage,
+                record.value,
+                timestampNS
+            };
+            
+            delegate->handleInputValue(value);
+        }
+        
+        if ((recordIndex + 1 == recordCount) || (records[recordIndex + 1].timestampNS != record.timestampNS)) {
+            delegate->handleFrameEnd();
+        }
+    }
+    
+    // Let any values held back by the delegate come due
+    if (!deliverWakeups(std::numeric_limits<std::uint64_t>::max())) {
+        return;
+    }
+    
+    mprintf("Finished replaying %lu HID input values on device \"%s\"",
+            static_cast<unsigned long>(recordCount),
+            deviceTag.c_str());
+}
+
+
+bool USBHIDReplayBackend::deliverWakeups(std::uint64_t untilTimeNS) {
+    while (wakeupTimeNS && (wakeupTimeNS <= untilTimeNS)) {
+        const std::uint64_t timeNS = wakeupTimeNS;
+        if (!waitUntil(timeNS)) {
+            return false;
+        }
+        wakeupTimeNS = 0;
+        delegate->handleWakeup(timeNS);
+    }
+    
+    return true;
+}
+
+
+bool USBHIDReplayBackend::waitUntil(std::uint64_t timeNS) {
+    boost::shared_ptr<Clock> clock = Clock::instance();
+    boost::mutex::scoped_lock lock(stopMutex);
+    
+    while (!stopRequested) {
+        const std::uint64_t currentTimeNS = clock->getSystemTimeNS();
+        if (currentTimeNS >= timeNS) {
+            return true;
+        }
+        stopCondition.wait_for(lock, boost::chrono::nanoseconds(timeNS - currentTimeNS));
+    }
+    
+    return false;
+}
+
+
+END_NAMESPACE_MW
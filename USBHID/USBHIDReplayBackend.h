@@ -0,0 +1,83 @@
+//
+//  USBHIDReplayBackend.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDReplayBackend__
+#define __USBHID__USBHIDReplayBackend__
+
+#include <algorithm>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "USBHIDBackend.h"
+#include "USBHIDCapture.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Delivers the values stored in a capture file, in order, on its own thread.  If speed is positive, values
+// are delivered with their original spacing, divided by speed, and time stamped with the time at which
+// they were scheduled.  If speed is zero, values are delivered as fast as possible and time stamped with
+// the current time.
+//
+class USBHIDReplayBackend : public USBHIDBackend {
+    
+public:
+    USBHIDReplayBackend(const std::string &deviceTag, const std::string &capturePath, double speed);
+    ~USBHIDReplayBackend();
+    
+    bool openDevice(const DeviceMatchingCriteria &criteria) MW_OVERRIDE;
+    DeviceInfo getDeviceInfo() const MW_OVERRIDE;
+    bool prepareInputs(const std::vector<UsagePair> &channelUsages,
+                       std::size_t requiredChannelCount,
+                       bool deliverAllValues,
+                       bool rawReports) MW_OVERRIDE;
+    bool readInitialValues(Delegate &delegate) MW_OVERRIDE;
+    bool startIO(Delegate &delegate) MW_OVERRIDE;
+    bool stopIO() MW_OVERRIDE;
+    bool isRunning() const MW_OVERRIDE { return (replayThread.get_id() != boost::thread::id()); }
+    void requestWakeup(std::uint64_t timeNS) MW_OVERRIDE;
+    
+private:
+    void replayLoop();
+    bool waitUntil(std::uint64_t timeNS);
+    bool deliverWakeups(std::uint64_t untilTimeNS);
+    
+    std::size_t lookupChannelIndex(std::uint32_t usage) const {
+        std::vector<std::uint32_t>::const_iterator iter = std::lower_bound(sortedUsages.begin(), sortedUsages.end(), usage);
+        if (iter == sortedUsages.end() || *iter != usage) {
+            return noChannel;
+        }
+        return sortedChannelIndices[iter - sortedUsages.begin()];
+    }
+    
+    const std::string capturePath;
+    const double speed;
+    boost::scoped_ptr<usbhid::CaptureReader> capture;
+    
+    // Usages (as (usage page << 16) | usage) in ascending order, and the corresponding channel indices
+    std::vector<std::uint32_t> sortedUsages;
+    std::vector<std::size_t> sortedChannelIndices;
+    bool deliverAllValues;
+    
+    boost::thread replayThread;
+    boost::mutex stopMutex;
+    boost::condition_variable stopCondition;
+    std::atomic_bool stopRequested;
+    std::uint64_t wakeupTimeNS;  // Zero if no wakeup is pending
+    Delegate *delegate;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDReplayBackend__)
@@ -0,0 +1,50 @@
+//
+//  USBHIDReplayDevice.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDReplayDevice.h"
+
+#include "USBHIDReplayBackend.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+const std::string USBHIDReplayDevice::REPLAY_FILE("replay_file");
+const std::string USBHIDReplayDevice::REPLAY_SPEED("replay_speed");
+
+
+void USBHIDReplayDevice::describeComponent(ComponentInfo &info) {
+    USBHIDDevice::describeComponent(info);
+    
+    info.setSignature("iodevice/usbhid_replay");
+    
+    info.addParameter(REPLAY_FILE);
+    info.addParameter(REPLAY_SPEED, "1.0");
+}
+
+
+USBHIDReplayDevice::USBHIDReplayDevice(const ParameterValueMap &parameters) :
+    USBHIDDevice(parameters, &createReplayBackend)
+{ }
+
+
+std::unique_ptr<USBHIDBackend> USBHIDReplayDevice::createReplayBackend(const std::string &deviceTag,
+                                                                       const ParameterValueMap &parameters)
+{
+    const double speed = parameters[REPLAY_SPEED];
+    if (speed < 0.0) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid replay speed");
+    }
+    
+    return std::unique_ptr<USBHIDBackend>(new USBHIDReplayBackend(deviceTag,
+                                                                  pathFromParameterValue(parameters[REPLAY_FILE]).string(),
+                                                                  speed));
+}
+
+
+END_NAMESPACE_MW
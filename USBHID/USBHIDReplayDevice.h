@@ -0,0 +1,41 @@
+//
+//  USBHIDReplayDevice.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDReplayDevice__
+#define __USBHID__USBHIDReplayDevice__
+
+#include "USBHIDDevice.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Plays back a capture recorded by a USBHIDDevice, through the same channels and dispatch path
+//
+class USBHIDReplayDevice : public USBHIDDevice {
+    
+public:
+    static const std::string REPLAY_FILE;
+    static const std::string REPLAY_SPEED;
+    
+    static void describeComponent(ComponentInfo &info);
+    
+    explicit USBHIDReplayDevice(const ParameterValueMap &parameters);
+    
+private:
+    static std::unique_ptr<USBHIDBackend> createReplayBackend(const std::string &deviceTag,
+                                                              const ParameterValueMap &parameters);
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDReplayDevice__)
@@ -0,0 +1,138 @@
+//
+//  USBHIDReportDecoder.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  This file has no dependencies on IOKit or MWorksCore, so that it can be built and tested on any platform.
+//
+
+#ifndef __USBHID__USBHIDReportDecoder__
+#define __USBHID__USBHIDReportDecoder__
+
+#include "USBHIDDeviceProfile.h"
+#include "USBHIDReportExtractor.h"
+
+
+namespace mworks {
+namespace usbhid {
+
+
+//
+// Runs a ReportExtractor over successive input reports and passes on only the values that changed since
+// the previous report, matching the semantics of per-element value callbacks.  If the device matches a
+// DeviceProfile, the profile's specialized extraction can be used instead of the extractor's ops.
+//
+class ReportDecoder {
+    
+public:
+    ReportDecoder(const ReportDescriptor &descriptor,
+                  const std::vector<std::uint32_t> &targetUsages,
+                  bool includeOtherUsages) :
+        extractor(descriptor, targetUsages, includeOtherUsages),
+        lastValues(extractor.getOps().size()),
+        profile(nullptr)
+    { }
+    
+    const ReportExtractor & getExtractor() const { return extractor; }
+    const DeviceProfile * getProfile() const { return profile; }
+    
+    // Decodes reports with the profile's extractAll, if every op corresponds to one of its fields.  Returns
+    // false, and leaves the decoder unchanged, otherwise.
+    bool useProfile(const DeviceProfile &newProfile) {
+        std::vector<std::size_t> fieldIndices;
+        if (!matchProfileFields(newProfile, extractor, fieldIndices)) {
+            return false;
+        }
+        profile = &newProfile;
+        profileFieldIndices.swap(fieldIndices);
+        profileValues.assign(newProfile.fieldCount, 0);
+        return true;
+    }
+    
+    // Records a value obtained by other means (e.g. an initial element read), so that the next report
+    // doesn't repeat it
+    void seedValue(std::uint32_t usage, std::int32_t value) {
+        const std::vector<ExtractionOp> &ops = extractor.getOps();
+        for (std::size_t opIndex = 0; opIndex < ops.size(); opIndex++) {
+            if (ops[opIndex].usage == usage) {
+                lastValues[opIndex].value = value;
+                lastValues[opIndex].valid = true;
+            }
+        }
+    }
+    
+    // Calls handler(op, value) for every value in the report that differs from its previous value
+    template <typename Handler>
+    void decode(const std::uint8_t *report, std::size_t length, Handler &&handler) {
+        // Reports the profile doesn't describe (e.g. short ones) fall back to the generic ops
+        if (profile && decodeWithProfile(report, length, handler)) {
+            return;
+        }
+        
+        extractor.extract(report, length, [this, &handler](std::uint32_t opIndex,
+                                                           const ExtractionOp &op,
+                                                           std::int32_t value)
+        {
+            passIfChanged(opIndex, op, value, handler);
+        });
+    }
+    
+private:
+    template <typename Handler>
+    bool decodeWithProfile(const std::uint8_t *report, std::size_t length, Handler &handler) {
+        if (profile->reportID) {
+            if (length < 1 || report[0] != profile->reportID) {
+                return false;
+            }
+            report++;
+            length--;
+        }
+        if (length < profile->reportSize) {
+            return false;
+        }
+        
+        profile->extractAll(report, profileValues.data());
+        
+        const std::vector<ExtractionOp> &ops = extractor.getOps();
+        for (std::size_t opIndex = 0; opIndex < ops.size(); opIndex++) {
+            passIfChanged(opIndex, ops[opIndex], profileValues[profileFieldIndices[opIndex]], handler);
+        }
+        
+        return true;
+    }
+    
+    template <typename Handler>
+    void passIfChanged(std::size_t opIndex, const ExtractionOp &op, std::int32_t value, Handler &handler) {
+        LastValue &lastValue = lastValues[opIndex];
+        if (lastValue.valid && (lastValue.value == value)) {
+            return;
+        }
+        lastValue.value = value;
+        lastValue.valid = true;
+        handler(op, value);
+    }
+    
+    struct LastValue {
+        LastValue() : value(0), valid(false) { }
+        std::int32_t value;
+        bool valid;
+    };
+    
+    const ReportExtractor extractor;
+    std::vector<LastValue> lastValues;
+    
+    // Null unless useProfile succeeded.  profileFieldIndices is indexed by op index.
+    const DeviceProfile *profile;
+    std::vector<std::size_t> profileFieldIndices;
+    std::vector<std::int32_t> profileValues;
+    
+};
+
+
+}  // namespace usbhid
+}  // namespace mworks
+
+
+#endif // !defined(__USBHID__USBHIDReportDecoder__)
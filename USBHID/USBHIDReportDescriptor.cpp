@@ -0,0 +1,353 @@
+//
+//  USBHIDReportDescriptor.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDReportDescriptor.h"
+
+#include <algorithm>
+#include <array>
+
+
+namespace mworks {
+namespace usbhid {
+
+
+namespace {
+
+
+enum ItemType : std::uint8_t {
+    MainItem = 0,
+    GlobalItem = 1,
+    LocalItem = 2
+};
+
+
+enum ItemTag : std::uint8_t {
+    // Main
+    InputTag = 0x8,
+    OutputTag = 0x9,
+    CollectionTag = 0xA,
+    FeatureTag = 0xB,
+    EndCollectionTag = 0xC,
+    
+    // Global
+    UsagePageTag = 0x0,
+    LogicalMinimumTag = 0x1,
+    LogicalMaximumTag = 0x2,
+    PhysicalMinimumTag = 0x3,
+    PhysicalMaximumTag = 0x4,
+    ReportSizeTag = 0x7,
+    ReportIDTag = 0x8,
+    ReportCountTag = 0x9,
+    PushTag = 0xA,
+    PopTag = 0xB,
+    
+    // Local
+    UsageTag = 0x0,
+    UsageMinimumTag = 0x1,
+    UsageMaximumTag = 0x2
+};
+
+
+const std::uint8_t longItemPrefix = 0xFE;
+const std::uint32_t applicationCollectionType = 0x01;
+
+
+struct GlobalState {
+    std::uint16_t usagePage = 0;
+    std::int32_t logicalMinimum = 0;
+    std::int32_t logicalMaximum = 0;
+    std::int32_t physicalMinimum = 0;
+    std::int32_t physicalMaximum = 0;
+    std::uint32_t reportSize = 0;
+    std::uint8_t reportID = 0;
+    std::uint32_t reportCount = 0;
+};
+
+
+struct LocalState {
+    std::vector<std::uint32_t> usages;
+    std::uint32_t usageMinimum = 0;
+    std::uint32_t usageMaximum = 0;
+    bool haveUsageMinimum = false;
+    bool haveUsageMaximum = false;
+};
+
+
+inline std::uint32_t makeLocalUsage(std::uint32_t value, std::size_t size, std::uint16_t usagePage) {
+    // A four-byte usage includes its own usage page
+    return ((size == 4) ? value : ReportDescriptor::makeUsage(usagePage, value));
+}
+
+
+inline std::int32_t signExtend(std::uint32_t value, std::size_t size) {
+    switch (size) {
+        case 1:
+            return std::int8_t(value);
+        case 2:
+            return std::int16_t(value);
+        default:
+            return std::int32_t(value);
+    }
+}
+
+
+inline std::size_t reportTypeIndex(ReportType reportType) {
+    return static_cast<std::size_t>(reportType);
+}
+
+
+}  // anonymous namespace
+
+
+std::uint32_t ReportField::getDeclaredUsageCount() const {
+    if (hasUsageRange()) {
+        return ((usageMaximum < usageMinimum) ? 0 : usageMaximum - usageMinimum + 1);
+    }
+    return std::uint32_t(usages.size());
+}
+
+
+std::uint32_t ReportField::usageAtIndex(std::uint32_t index) const {
+    if (hasUsageRange()) {
+        if (usageMaximum < usageMinimum || index > usageMaximum - usageMinimum) {
+            return 0;
+        }
+        return usageMinimum + index;
+    }
+    
+    if (isArray()) {
+        // An array selector outside the declared usages has no usage
+        return ((index < usages.size()) ? usages[index] : 0);
+    }
+    
+    // Per the HID spec, if a variable field has fewer usages than values, the last usage applies to the rest
+    return usages[std::min<std::size_t>(index, usages.size() - 1)];
+}
+
+
+ReportDescriptor::ReportDescriptor(const std::uint8_t *data, std::size_t length) :
+    reportIDsUsed(false)
+{
+    GlobalState globals;
+    std::vector<GlobalState> globalsStack;
+    LocalState locals;
+    std::size_t collectionDepth = 0;
+    
+    typedef std::array<std::uint32_t, 256> ReportOffsets;
+    std::array<ReportOffsets, 3> reportOffsets;
+    for (auto &offsets : reportOffsets) {
+        offsets.fill(0);
+    }
+    
+    std::size_t position = 0;
+    while (position < length) {
+        const std::uint8_t prefix = data[position++];
+        
+        if (prefix == longItemPrefix) {
+            // Long items have no defined uses, so just skip them
+            if (position + 2 > length) {
+                throw ReportDescriptorError("Truncated long item in HID report descriptor");
+            }
+            position += 2 + data[position];
+            continue;
+        }
+        
+        const std::size_t size = ((prefix & 0x3) == 3 ? 4 : (prefix & 0x3));
+        const std::uint8_t type = (prefix >> 2) & 0x3;
+        const std::uint8_t tag = (prefix >> 4) & 0xF;
+        
+        if (position + size > length) {
+            throw ReportDescriptorError("Truncated item in HID report descriptor");
+        }
+        std::uint32_t value = 0;
+        for (std::size_t i = 0; i < size; i++) {
+            value |= std::uint32_t(data[position + i]) << (8 * i);
+        }
+        position += size;
+        
+        switch (type) {
+            case MainItem: {
+                ReportType reportType;
+                
+                switch (tag) {
+                    case InputTag:
+                        reportType = ReportType::Input;
+                        break;
+                    
+                    case OutputTag:
+                        reportType = ReportType::Output;
+                        break;
+                    
+                    case FeatureTag:
+                        reportType = ReportType::Feature;
+                        break;
+                    
+                    case CollectionTag:
+                        if (value == applicationCollectionType && !locals.usages.empty()) {
+                            const std::uint32_t usage = locals.usages.front();
+                            ApplicationCollection collection = { usagePageOf(usage), usageOf(usage) };
+                            applicationCollections.push_back(collection);
+                        }
+                        collectionDepth++;
+                        locals = LocalState();
+                        continue;
+                    
+                    case EndCollectionTag:
+                        if (collectionDepth == 0) {
+                            throw ReportDescriptorError("Unbalanced End Collection in HID report descriptor");
+                        }
+                        collectionDepth--;
+                        locals = LocalState();
+                        continue;
+                    
+                    default:
+                        locals = LocalState();
+                        continue;
+                }
+                
+                std::uint32_t &offset = reportOffsets[reportTypeIndex(reportType)][globals.reportID];
+                
+                ReportField field;
+                field.reportType = reportType;
+                field.reportID = globals.reportID;
+                field.bitOffset = offset;
+                field.bitSize = globals.reportSize;
+                field.count = globals.reportCount;
+                field.flags = value;
+                field.logicalMinimum = globals.logicalMinimum;
+                field.logicalMaximum = globals.logicalMaximum;
+                field.physicalMinimum = globals.physicalMinimum;
+                field.physicalMaximum = globals.physicalMaximum;
+                field.usages.swap(locals.usages);
+                field.usageMinimum = locals.usageMinimum;
+                field.usageMaximum = locals.usageMaximum;
+                
+                if (field.usages.empty() && !(locals.haveUsageMinimum && locals.haveUsageMaximum)) {
+                    // Padding or an unlabeled field; nothing can refer to it
+                    field.usageMinimum = 1;
+                    field.usageMaximum = 0;
+                }
+                
+                offset += field.bitSize * field.count;
+                fields.push_back(std::move(field));
+                locals = LocalState();
+                break;
+            }
+            
+            case GlobalItem:
+                switch (tag) {
+                    case UsagePageTag:
+                        globals.usagePage = value;
+                        break;
+                    
+                    case LogicalMinimumTag:
+                        globals.logicalMinimum = signExtend(value, size);
+                        break;
+                    
+                    case LogicalMaximumTag:
+                        // Many devices declare an unsigned range whose maximum has its high bit set (e.g. 0 to
+                        // 0xFF in one byte), so only sign extend the maximum if the minimum is negative
+                        globals.logicalMaximum = ((globals.logicalMinimum < 0) ? signExtend(value, size)
+                                                                                : std::int32_t(value));
+                        break;
+                    
+                    case PhysicalMinimumTag:
+                        globals.physicalMinimum = signExtend(value, size);
+                        break;
+                    
+                    case PhysicalMaximumTag:
+                        globals.physicalMaximum = ((globals.physicalMinimum < 0) ? signExtend(value, size)
+                                                                                  : std::int32_t(value));
+                        break;
+                    
+                    case ReportSizeTag:
+                        globals.reportSize = value;
+                        break;
+                    
+                    case ReportIDTag:
+                        if (value == 0 || value > 0xFF) {
+                            throw ReportDescriptorError("Invalid report ID in HID report descriptor");
+                        }
+                        globals.reportID = value;
+                        reportIDsUsed = true;
+                        break;
+                    
+                    case ReportCountTag:
+                        globals.reportCount = value;
+                        break;
+                    
+                    case PushTag:
+                        globalsStack.push_back(globals);
+                        break;
+                    
+                    case PopTag:
+                        if (globalsStack.empty()) {
+                            throw ReportDescriptorError("Unbalanced Pop in HID report descriptor");
+                        }
+                        globals = globalsStack.back();
+                        globalsStack.pop_back();
+                        break;
+                    
+                    default:
+                        break;
+                }
+                break;
+            
+            case LocalItem:
+                switch (tag) {
+                    case UsageTag:
+                        locals.usages.push_back(makeLocalUsage(value, size, globals.usagePage));
+                        break;
+                    
+                    case UsageMinimumTag:
+                        locals.usageMinimum = makeLocalUsage(value, size, globals.usagePage);
+                        locals.haveUsageMinimum = true;
+                        break;
+                    
+                    case UsageMaximumTag:
+                        locals.usageMaximum = makeLocalUsage(value, size, globals.usagePage);
+                        locals.haveUsageMaximum = true;
+                        break;
+                    
+                    default:
+                        break;
+                }
+                break;
+            
+            default:
+                throw ReportDescriptorError("Reserved item type in HID report descriptor");
+        }
+    }
+    
+    if (collectionDepth != 0) {
+        throw ReportDescriptorError("Unterminated collection in HID report descriptor");
+    }
+}
+
+
+std::size_t ReportDescriptor::getMaxReportSize(ReportType reportType) const {
+    std::array<std::uint32_t, 256> reportBits;
+    reportBits.fill(0);
+    
+    for (const auto &field : fields) {
+        if (field.reportType == reportType) {
+            std::uint32_t &bits = reportBits[field.reportID];
+            bits = std::max(bits, field.bitOffset + field.bitSize * field.count);
+        }
+    }
+    
+    const std::uint32_t maxBits = *std::max_element(reportBits.begin(), reportBits.end());
+    if (maxBits == 0) {
+        return 0;
+    }
+    return (maxBits + 7) / 8 + (reportIDsUsed ? 1 : 0);
+}
+
+
+}  // namespace usbhid
+}  // namespace mworks
@@ -0,0 +1,116 @@
+//
+//  USBHIDReportDescriptor.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  This file has no dependencies on IOKit or MWorksCore, so that it can be built and tested on any platform.
+//
+
+#ifndef __USBHID__USBHIDReportDescriptor__
+#define __USBHID__USBHIDReportDescriptor__
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+namespace mworks {
+namespace usbhid {
+
+
+enum class ReportType {
+    Input,
+    Output,
+    Feature
+};
+
+
+//
+// One main item (Input, Output, or Feature) from a report descriptor, with the global and local state
+// that was in effect when it was declared
+//
+struct ReportField {
+    ReportType reportType;
+    std::uint8_t reportID;
+    std::uint32_t bitOffset;  // From the start of the report data, excluding the report ID byte
+    std::uint32_t bitSize;    // Size of each value
+    std::uint32_t count;
+    std::uint32_t flags;
+    std::int32_t logicalMinimum;
+    std::int32_t logicalMaximum;
+    std::int32_t physicalMinimum;
+    std::int32_t physicalMaximum;
+    
+    // Each usage is (usage page << 16) | usage.  If the descriptor declared a usage range, usageMinimum and
+    // usageMaximum hold its bounds, and usages is empty.
+    std::vector<std::uint32_t> usages;
+    std::uint32_t usageMinimum;
+    std::uint32_t usageMaximum;
+    
+    static const std::uint32_t constantFlag = (1 << 0);
+    static const std::uint32_t variableFlag = (1 << 1);
+    static const std::uint32_t relativeFlag = (1 << 2);
+    
+    bool isConstant() const { return (flags & constantFlag); }
+    bool isVariable() const { return (flags & variableFlag); }
+    bool isArray() const { return !isVariable(); }
+    bool isSigned() const { return (logicalMinimum < 0); }
+    bool hasUsageRange() const { return usages.empty(); }
+    
+    // Number of usages the descriptor declared for the field, either individually or as a range
+    std::uint32_t getDeclaredUsageCount() const;
+    
+    // Usage associated with the value at the given index (for variable fields) or with the given logical
+    // value minus the logical minimum (for array fields).  Returns zero if there is none.
+    std::uint32_t usageAtIndex(std::uint32_t index) const;
+};
+
+
+struct ApplicationCollection {
+    std::uint16_t usagePage;
+    std::uint16_t usage;
+};
+
+
+class ReportDescriptorError : public std::runtime_error {
+public:
+    explicit ReportDescriptorError(const std::string &what) : std::runtime_error(what) { }
+};
+
+
+class ReportDescriptor {
+    
+public:
+    // Throws ReportDescriptorError if the descriptor is malformed
+    ReportDescriptor(const std::uint8_t *data, std::size_t length);
+    
+    const std::vector<ReportField> & getFields() const { return fields; }
+    const std::vector<ApplicationCollection> & getApplicationCollections() const { return applicationCollections; }
+    bool usesReportIDs() const { return reportIDsUsed; }
+    
+    // Size in bytes of the largest report of the given type, including the report ID byte (if any)
+    std::size_t getMaxReportSize(ReportType reportType) const;
+    
+    static std::uint32_t makeUsage(std::uint16_t usagePage, std::uint16_t usage) {
+        return ((std::uint32_t(usagePage) << 16) | usage);
+    }
+    static std::uint16_t usagePageOf(std::uint32_t usage) { return (usage >> 16); }
+    static std::uint16_t usageOf(std::uint32_t usage) { return (usage & 0xFFFF); }
+    
+private:
+    std::vector<ReportField> fields;
+    std::vector<ApplicationCollection> applicationCollections;
+    bool reportIDsUsed;
+    
+};
+
+
+}  // namespace usbhid
+}  // namespace mworks
+
+
+#endif // !defined(__USBHID__USBHIDReportDescriptor__)
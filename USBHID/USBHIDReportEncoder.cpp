@@ -0,0 +1,87 @@
+//
+//  USBHIDReportEncoder.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDReportEncoder.h"
+
+#include <algorithm>
+
+
+namespace mworks {
+namespace usbhid {
+
+
+const std::size_t ReportEncoder::noReport;
+
+
+ReportEncoder::ReportEncoder(const ReportDescriptor &descriptor, const std::vector<Target> &targets) :
+    reportIDsUsed(descriptor.usesReportIDs())
+{
+    const TargetField unmatched = { noReport, 0, 0 };
+    fieldsByTarget.assign(targets.size(), unmatched);
+    
+    auto findReport = [this](ReportType reportType, std::uint8_t reportID) {
+        for (std::size_t reportIndex = 0; reportIndex < reports.size(); reportIndex++) {
+            if (reports[reportIndex].reportType == reportType && reports[reportIndex].data[0] == reportID) {
+                return reportIndex;
+            }
+        }
+        const Report report = { reportType, std::vector<std::uint8_t>(1, reportID), false };
+        reports.push_back(report);
+        return (reports.size() - 1);
+    };
+    
+    for (const auto &field : descriptor.getFields()) {
+        if (field.reportType == ReportType::Input ||
+            field.isConstant() ||
+            field.isArray() ||
+            field.bitSize == 0 ||
+            field.bitSize > 32)
+        {
+            continue;
+        }
+        
+        for (std::uint32_t index = 0; index < field.count; index++) {
+            const std::uint32_t usage = field.usageAtIndex(index);
+            if (!usage) {
+                continue;
+            }
+            
+            for (std::size_t target = 0; target < targets.size(); target++) {
+                // The first matching field wins
+                if (targets[target].reportType == field.reportType &&
+                    targets[target].usage == usage &&
+                    fieldsByTarget[target].reportIndex == noReport)
+                {
+                    TargetField &targetField = fieldsByTarget[target];
+                    targetField.reportIndex = findReport(field.reportType, field.reportID);
+                    targetField.bitOffset = field.bitOffset + index * field.bitSize;
+                    targetField.bitSize = field.bitSize;
+                }
+            }
+        }
+    }
+    
+    // Size each report to hold every field the descriptor declares for it, not just the targets, since
+    // devices may reject short reports
+    for (const auto &field : descriptor.getFields()) {
+        for (Report &report : reports) {
+            if (report.reportType == field.reportType && report.data[0] == field.reportID) {
+                const std::size_t dataSize = 1 + (field.bitOffset + field.bitSize * field.count + 7) / 8;
+                if (report.data.size() < dataSize) {
+                    report.data.resize(dataSize, 0);
+                }
+            }
+        }
+    }
+    
+    dirtyReports.reserve(reports.size());
+}
+
+
+}  // namespace usbhid
+}  // namespace mworks
@@ -0,0 +1,126 @@
+//
+//  USBHIDReportEncoder.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  This file has no dependencies on IOKit or MWorksCore, so that it can be built and tested on any platform.
+//
+
+#ifndef __USBHID__USBHIDReportEncoder__
+#define __USBHID__USBHIDReportEncoder__
+
+#include <limits>
+
+#include "USBHIDReportDescriptor.h"
+
+
+namespace mworks {
+namespace usbhid {
+
+
+//
+// Keeps a copy of every output or feature report that contains a target usage, and writes target values
+// into them.  Reports whose values change are marked dirty, so that all the changes to one report can be
+// sent to the device in a single transfer.  Fields that are never written keep their initial value of zero.
+//
+// Only variable fields can be targets.  (Array fields in output reports are rare, and have no meaningful
+// per-usage value.)
+//
+class ReportEncoder {
+    
+public:
+    static const std::size_t noReport = std::numeric_limits<std::size_t>::max();
+    
+    struct Target {
+        ReportType reportType;  // Output or Feature
+        std::uint32_t usage;    // (usage page << 16) | usage
+    };
+    
+    ReportEncoder(const ReportDescriptor &descriptor, const std::vector<Target> &targets);
+    
+    bool usesReportIDs() const { return reportIDsUsed; }
+    bool isTargetMatched(std::size_t target) const { return (fieldsByTarget.at(target).reportIndex != noReport); }
+    
+    std::size_t getReportCount() const { return reports.size(); }
+    ReportType getReportType(std::size_t reportIndex) const { return reports[reportIndex].reportType; }
+    std::uint8_t getReportID(std::size_t reportIndex) const { return reports[reportIndex].data[0]; }
+    
+    // The report's contents, preceded by its report ID (which is zero if the descriptor doesn't use
+    // report IDs)
+    const std::vector<std::uint8_t> & getReportData(std::size_t reportIndex) const { return reports[reportIndex].data; }
+    
+    // Stores the value in the target's field (truncated to the field size) and marks the report dirty.
+    // Does nothing if the target is unmatched.
+    void setValue(std::size_t target, std::int32_t value) {
+        const TargetField &field = fieldsByTarget[target];
+        if (field.reportIndex != noReport) {
+            Report &report = reports[field.reportIndex];
+            writeValue(report.data.data() + 1, field.bitOffset, field.bitSize, value);
+            if (!report.dirty) {
+                report.dirty = true;
+                dirtyReports.push_back(field.reportIndex);
+            }
+        }
+    }
+    
+    // Calls send(reportIndex) for every dirty report, in the order in which they became dirty, and marks
+    // them clean.  Returns the number of reports for which send returned false.
+    template <typename Sender>
+    std::size_t sendDirtyReports(Sender &&send) {
+        std::size_t failureCount = 0;
+        for (std::size_t reportIndex : dirtyReports) {
+            reports[reportIndex].dirty = false;
+            if (!send(reportIndex)) {
+                failureCount++;
+            }
+        }
+        dirtyReports.clear();
+        return failureCount;
+    }
+    
+    std::size_t getDirtyReportCount() const { return dirtyReports.size(); }
+    
+    // Writes a little-endian bit field of 1 to 32 bits.  The caller must ensure that the field lies within
+    // the data.
+    static void writeValue(std::uint8_t *data, std::uint32_t bitOffset, std::uint8_t bitSize, std::int32_t value) {
+        std::uint8_t *firstByte = data + bitOffset / 8;
+        const unsigned shift = bitOffset % 8;
+        const unsigned byteCount = (shift + bitSize + 7) / 8;
+        
+        const std::uint64_t mask = ((std::uint64_t(1) << bitSize) - 1) << shift;
+        const std::uint64_t bits = (std::uint64_t(std::uint32_t(value)) << shift) & mask;
+        
+        for (unsigned i = 0; i < byteCount; i++) {
+            const std::uint8_t byteMask = std::uint8_t(mask >> (8 * i));
+            firstByte[i] = (firstByte[i] & ~byteMask) | std::uint8_t(bits >> (8 * i));
+        }
+    }
+    
+private:
+    struct TargetField {
+        std::size_t reportIndex;
+        std::uint32_t bitOffset;
+        std::uint8_t bitSize;
+    };
+    
+    struct Report {
+        ReportType reportType;
+        std::vector<std::uint8_t> data;
+        bool dirty;
+    };
+    
+    bool reportIDsUsed;
+    std::vector<TargetField> fieldsByTarget;
+    std::vector<Report> reports;
+    std::vector<std::size_t> dirtyReports;
+    
+};
+
+
+}  // namespace usbhid
+}  // namespace mworks
+
+
+#endif // !defined(__USBHID__USBHIDReportEncoder__)
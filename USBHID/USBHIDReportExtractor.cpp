@@ -0,0 +1,108 @@
+//
+//  USBHIDReportExtractor.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDReportExtractor.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+
+namespace mworks {
+namespace usbhid {
+
+
+const std::size_t ReportExtractor::noTarget;
+
+
+ReportExtractor::ReportExtractor(const ReportDescriptor &descriptor,
+                                 const std::vector<std::uint32_t> &targetUsages,
+                                 bool includeOtherUsages) :
+    reportIDsUsed(descriptor.usesReportIDs()),
+    targetMatched(targetUsages.size(), false)
+{
+    std::unordered_multimap<std::uint32_t, std::size_t> targetsByUsage;
+    for (std::size_t target = 0; target < targetUsages.size(); target++) {
+        targetsByUsage.emplace(targetUsages[target], target);
+    }
+    
+    auto addOps = [&](ExtractionOp op) {
+        auto targets = targetsByUsage.equal_range(op.usage);
+        if (targets.first != targets.second) {
+            for (auto iter = targets.first; iter != targets.second; ++iter) {
+                op.target = iter->second;
+                ops.push_back(op);
+                targetMatched[op.target] = true;
+            }
+        } else if (includeOtherUsages && ReportDescriptor::usageOf(op.usage) != 0) {
+            op.target = noTarget;
+            ops.push_back(op);
+        }
+    };
+    
+    for (const auto &field : descriptor.getFields()) {
+        if (field.reportType != ReportType::Input ||
+            field.isConstant() ||
+            field.bitSize == 0 ||
+            field.bitSize > 32 ||
+            field.count == 0)
+        {
+            continue;
+        }
+        
+        ExtractionOp op;
+        op.bitSize = field.bitSize;
+        op.reportID = field.reportID;
+        op.isSigned = field.isSigned();
+        op.isArray = field.isArray();
+        op.arrayCount = 0;
+        op.arrayValue = 0;
+        
+        if (field.isVariable()) {
+            for (std::uint32_t index = 0; index < field.count; index++) {
+                if (const std::uint32_t usage = field.usageAtIndex(index)) {
+                    op.bitOffset = field.bitOffset + index * field.bitSize;
+                    op.usage = usage;
+                    addOps(op);
+                }
+            }
+        } else {
+            // Each value in the logical range of an array field selects one of its declared usages.  Values
+            // beyond the declared usages select nothing, so the number of ops is bounded by the usages, not
+            // by the (possibly much larger) logical range.
+            op.bitOffset = field.bitOffset;
+            op.arrayCount = field.count;
+            const std::int64_t logicalCount = std::int64_t(field.logicalMaximum) - std::int64_t(field.logicalMinimum) + 1;
+            const std::int64_t usageCount = std::min<std::int64_t>(logicalCount, field.getDeclaredUsageCount());
+            for (std::int64_t index = 0; index < usageCount; index++) {
+                if (const std::uint32_t usage = field.usageAtIndex(std::uint32_t(index))) {
+                    op.arrayValue = std::int32_t(field.logicalMinimum + index);
+                    op.usage = usage;
+                    addOps(op);
+                }
+            }
+        }
+    }
+    
+    // Group the ops by report ID, preserving descriptor order within each report
+    std::stable_sort(ops.begin(), ops.end(), [](const ExtractionOp &a, const ExtractionOp &b) {
+        return (a.reportID < b.reportID);
+    });
+    
+    opRanges.fill(OpRange(0, 0));
+    for (std::uint32_t opIndex = 0; opIndex < ops.size(); opIndex++) {
+        OpRange &range = opRanges[ops[opIndex].reportID];
+        if (range.first == range.second) {
+            range.first = opIndex;
+        }
+        range.second = opIndex + 1;
+    }
+}
+
+
+}  // namespace usbhid
+}  // namespace mworks
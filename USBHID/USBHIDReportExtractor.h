@@ -0,0 +1,142 @@
+//
+//  USBHIDReportExtractor.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  This file has no dependencies on IOKit or MWorksCore, so that it can be built and tested on any platform.
+//
+
+#ifndef __USBHID__USBHIDReportExtractor__
+#define __USBHID__USBHIDReportExtractor__
+
+#include <array>
+#include <limits>
+#include <utility>
+
+#include "USBHIDReportDescriptor.h"
+
+
+namespace mworks {
+namespace usbhid {
+
+
+//
+// One step in the program that decodes a single value from an input report
+//
+struct ExtractionOp {
+    std::uint32_t bitOffset;   // From the start of the report data, excluding the report ID byte
+    std::uint8_t bitSize;
+    std::uint8_t reportID;
+    bool isSigned;
+    bool isArray;
+    std::uint32_t arrayCount;  // For array ops, the number of slots to search
+    std::int32_t arrayValue;   // For array ops, the slot value that indicates the usage is active
+    std::uint32_t usage;       // (usage page << 16) | usage
+    std::size_t target;        // Index into the target usages passed to the ReportExtractor constructor
+};
+
+
+//
+// Compiles a report descriptor and a set of target usages into a flat list of extraction ops, grouped by
+// report ID, that decode the target values from raw input reports without further reference to the
+// descriptor.
+//
+// Variable fields yield their value (sign extended if the logical minimum is negative).  Array fields, such
+// as keyboard key code arrays, yield 1 if any slot holds the usage and 0 otherwise.
+//
+class ReportExtractor {
+    
+public:
+    static const std::size_t noTarget = std::numeric_limits<std::size_t>::max();
+    
+    // If includeOtherUsages is true, ops are also generated for every labeled input usage that is not a
+    // target, with target set to noTarget
+    ReportExtractor(const ReportDescriptor &descriptor,
+                    const std::vector<std::uint32_t> &targetUsages,
+                    bool includeOtherUsages = false);
+    
+    const std::vector<ExtractionOp> & getOps() const { return ops; }
+    bool usesReportIDs() const { return reportIDsUsed; }
+    bool isTargetMatched(std::size_t target) const { return targetMatched.at(target); }
+    
+    // Calls handler(opIndex, op, value) for every op that applies to the given report.  Ops that lie
+    // (partly) beyond the end of a short report are skipped.
+    template <typename Handler>
+    void extract(const std::uint8_t *report, std::size_t length, Handler &&handler) const {
+        std::uint8_t reportID = 0;
+        if (reportIDsUsed) {
+            if (length < 1) {
+                return;
+            }
+            reportID = report[0];
+            report++;
+            length--;
+        }
+        
+        const OpRange &range = opRanges[reportID];
+        const std::uint64_t lengthInBits = std::uint64_t(length) * 8;
+        
+        for (std::uint32_t opIndex = range.first; opIndex < range.second; opIndex++) {
+            const ExtractionOp &op = ops[opIndex];
+            const std::uint32_t slots = (op.isArray ? op.arrayCount : 1);
+            if (op.bitOffset + std::uint64_t(op.bitSize) * slots > lengthInBits) {
+                continue;
+            }
+            
+            std::int32_t value;
+            if (!op.isArray) {
+                value = readValue(report, op.bitOffset, op.bitSize, op.isSigned);
+            } else {
+                value = 0;
+                for (std::uint32_t slot = 0; slot < slots; slot++) {
+                    if (readValue(report, op.bitOffset + slot * op.bitSize, op.bitSize, op.isSigned) == op.arrayValue) {
+                        value = 1;
+                        break;
+                    }
+                }
+            }
+            
+            handler(opIndex, op, value);
+        }
+    }
+    
+    // Reads a little-endian bit field of 1 to 32 bits.  The caller must ensure that the field lies within
+    // the data.
+    static std::int32_t readValue(const std::uint8_t *data, std::uint32_t bitOffset, std::uint8_t bitSize, bool isSigned) {
+        const std::uint8_t *firstByte = data + bitOffset / 8;
+        const unsigned shift = bitOffset % 8;
+        const unsigned byteCount = (shift + bitSize + 7) / 8;
+        
+        std::uint64_t bits = 0;
+        for (unsigned i = 0; i < byteCount; i++) {
+            bits |= std::uint64_t(firstByte[i]) << (8 * i);
+        }
+        bits >>= shift;
+        
+        const std::uint64_t mask = (std::uint64_t(1) << bitSize) - 1;
+        bits &= mask;
+        
+        if (isSigned && (bits >> (bitSize - 1))) {
+            bits |= ~mask;
+        }
+        return std::int32_t(bits);
+    }
+    
+private:
+    typedef std::pair<std::uint32_t, std::uint32_t> OpRange;
+    
+    bool reportIDsUsed;
+    std::vector<ExtractionOp> ops;
+    std::array<OpRange, 256> opRanges;
+    std::vector<bool> targetMatched;
+    
+};
+
+
+}  // namespace usbhid
+}  // namespace mworks
+
+
+#endif // !defined(__USBHID__USBHIDReportExtractor__)
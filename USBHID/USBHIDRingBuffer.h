@@ -0,0 +1,91 @@
+//
+//  USBHIDRingBuffer.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDRingBuffer__
+#define __USBHID__USBHIDRingBuffer__
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Bounded, lock-free queue for exactly one producer thread and one consumer thread.  All slots are
+// allocated at construction, so neither push() nor pop() ever allocates memory or takes a lock.
+//
+template <typename T>
+class USBHIDRingBuffer : boost::noncopyable {
+    
+public:
+    explicit USBHIDRingBuffer(std::size_t minCapacity) :
+        slots(roundUpToPowerOfTwo(minCapacity)),
+        mask(slots.size() - 1),
+        head(0),
+        tail(0)
+    { }
+    
+    std::size_t capacity() const { return slots.size(); }
+    
+    // Producer only.  Returns false (and leaves the buffer unchanged) if the buffer is full.
+    bool push(const T &item) {
+        const std::size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead - tail.load(std::memory_order_acquire) >= slots.size()) {
+            return false;
+        }
+        slots[currentHead & mask] = item;
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+    
+    // Consumer only.  Returns false if the buffer is empty.
+    bool pop(T &item) {
+        const std::size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = slots[currentTail & mask];
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+    
+    bool empty() const {
+        return (tail.load(std::memory_order_acquire) == head.load(std::memory_order_acquire));
+    }
+    
+private:
+    static std::size_t roundUpToPowerOfTwo(std::size_t value) {
+        std::size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+    
+    // Keep the producer and consumer indices on separate cache lines.  (We pad rather than use alignas,
+    // because operator new doesn't honor extended alignment before C++17.)
+    static const std::size_t cacheLineSize = 64;
+    
+    std::vector<T> slots;
+    const std::size_t mask;
+    char headPadding[cacheLineSize];
+    std::atomic<std::size_t> head;
+    char tailPadding[cacheLineSize - sizeof(std::atomic<std::size_t>)];
+    std::atomic<std::size_t> tail;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDRingBuffer__)
@@ -0,0 +1,56 @@
+//
+//  USBHIDSemaphore.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDSemaphore__
+#define __USBHID__USBHIDSemaphore__
+
+#if defined(__APPLE__)
+#  include <dispatch/dispatch.h>
+#else
+#  include <cerrno>
+#  include <semaphore.h>
+#endif
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Counting semaphore.  signal() never blocks and, when no thread is waiting, doesn't enter the kernel.
+//
+class USBHIDSemaphore : boost::noncopyable {
+    
+public:
+#if defined(__APPLE__)
+    USBHIDSemaphore() : semaphore(dispatch_semaphore_create(0)) { }
+    ~USBHIDSemaphore() { dispatch_release(semaphore); }
+    
+    void signal() { (void)dispatch_semaphore_signal(semaphore); }
+    void wait() { (void)dispatch_semaphore_wait(semaphore, DISPATCH_TIME_FOREVER); }
+#else
+    USBHIDSemaphore() { (void)sem_init(&semaphore, 0, 0); }
+    ~USBHIDSemaphore() { (void)sem_destroy(&semaphore); }
+    
+    void signal() { (void)sem_post(&semaphore); }
+    void wait() { while (sem_wait(&semaphore) != 0 && errno == EINTR) { } }
+#endif
+    
+private:
+#if defined(__APPLE__)
+    dispatch_semaphore_t semaphore;
+#else
+    sem_t semaphore;
+#endif
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDSemaphore__)
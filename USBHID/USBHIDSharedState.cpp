@@ -0,0 +1,86 @@
+//
+//  USBHIDSharedState.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDSharedState.h"
+
+#include <new>
+
+
+namespace mworks {
+namespace usbhid {
+
+
+SharedStateWriter::SharedStateWriter(const std::string &name,
+                                     std::uint32_t usagePage,
+                                     std::uint32_t usage,
+                                     const std::vector<UsagePair> &entryUsages) :
+    name(name),
+    mappedData(MAP_FAILED),
+    mappedSize(sizeof(SharedStateHeader) + entryUsages.size() * sizeof(SharedStateEntry)),
+    header(nullptr),
+    entries(nullptr),
+    sequence(0),
+    updating(false)
+{
+    // Start from a fresh object, since readers may still have an old one (possibly of a different size)
+    // mapped, and not all platforms allow an existing object to be resized
+    (void)shm_unlink(name.c_str());
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        throw SharedStateError("Unable to create HID shared state \"" + name + "\": " + std::strerror(errno));
+    }
+    
+    if (ftruncate(fd, off_t(mappedSize)) != 0) {
+        const std::string message = std::strerror(errno);
+        close(fd);
+        (void)shm_unlink(name.c_str());
+        throw SharedStateError("Unable to size HID shared state \"" + name + "\": " + message);
+    }
+    
+    mappedData = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int mapError = errno;
+    close(fd);
+    if (mappedData == MAP_FAILED) {
+        (void)shm_unlink(name.c_str());
+        throw SharedStateError("Unable to map HID shared state \"" + name + "\": " + std::strerror(mapError));
+    }
+    
+    // The new object is zero filled, so only the fixed fields need to be set
+    header = new(mappedData) SharedStateHeader();
+    header->formatVersion = sharedStateFormatVersion;
+    header->headerSize = sizeof(SharedStateHeader);
+    header->entrySize = sizeof(SharedStateEntry);
+    header->entryCount = std::uint32_t(entryUsages.size());
+    header->usagePage = usagePage;
+    header->usage = usage;
+    header->sequence.store(0, std::memory_order_relaxed);
+    
+    entries = reinterpret_cast<SharedStateEntry *>(static_cast<char *>(mappedData) + sizeof(SharedStateHeader));
+    for (std::size_t index = 0; index < entryUsages.size(); index++) {
+        SharedStateEntry *entry = new(entries + index) SharedStateEntry();
+        entry->usagePage = entryUsages[index].first;
+        entry->usage = entryUsages[index].second;
+        entry->value.store(0, std::memory_order_relaxed);
+        entry->timestampNS.store(0, std::memory_order_relaxed);
+        entry->timeUS.store(0, std::memory_order_relaxed);
+    }
+    
+    // Tell readers that the region is ready
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, sharedStateMagic, sizeof(sharedStateMagic));
+}
+
+
+SharedStateWriter::~SharedStateWriter() {
+    munmap(mappedData, mappedSize);
+    (void)shm_unlink(name.c_str());
+}
+
+
+}  // namespace usbhid
+}  // namespace mworks
@@ -0,0 +1,270 @@
+//
+//  USBHIDSharedState.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+//  This file has no dependencies on IOKit or MWorksCore, so that it can be built and tested on any platform.
+//  The reader is header-only, so that external processes can use it without linking against the plugin.
+//
+
+#ifndef __USBHID__USBHIDSharedState__
+#define __USBHID__USBHIDSharedState__
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+namespace mworks {
+namespace usbhid {
+
+
+//
+// A shared state region is a POSIX shared memory object holding a SharedStateHeader followed by one
+// SharedStateEntry per channel, all in host byte order.  It always holds the most recent value of every
+// channel of one USB HID device.
+//
+// The region is guarded by a sequence lock.  The writer makes the header's sequence number odd before it
+// modifies any entry and even again once all the values from an input report are in place, so a reader
+// that sees the same even sequence number before and after copying the entries has a consistent snapshot
+// of a whole report.  The writer never waits for readers, and readers never block one another; a reader
+// that overlaps an update simply tries again.
+//
+
+struct SharedStateHeader {
+    char magic[8];                        // sharedStateMagic, written last
+    std::uint32_t formatVersion;          // sharedStateFormatVersion
+    std::uint32_t headerSize;             // sizeof(SharedStateHeader)
+    std::uint32_t entrySize;              // sizeof(SharedStateEntry)
+    std::uint32_t entryCount;
+    std::uint32_t usagePage;              // Device usage page and usage
+    std::uint32_t usage;
+    std::atomic<std::uint64_t> sequence;  // Odd while an update is in progress
+    std::uint8_t reserved[24];
+};
+
+
+struct SharedStateEntry {
+    std::uint32_t usagePage;              // Fixed when the region is created
+    std::uint32_t usage;
+    std::atomic<std::int64_t> value;
+    std::atomic<std::uint64_t> timestampNS;  // Host time at which the device delivered the value
+    std::atomic<std::int64_t> timeUS;        // The same time, converted to MWorks time
+};
+
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "Shared state requires lock-free 64-bit atomics");
+static_assert(sizeof(SharedStateHeader) == 64, "Unexpected shared state header size");
+static_assert(sizeof(SharedStateEntry) == 32, "Unexpected shared state entry size");
+
+
+const char sharedStateMagic[8] = { 'M', 'W', 'H', 'I', 'D', 'S', 'H', 'M' };
+const std::uint32_t sharedStateFormatVersion = 1;
+
+
+class SharedStateError : public std::runtime_error {
+public:
+    explicit SharedStateError(const std::string &what) : std::runtime_error(what) { }
+};
+
+
+//
+// Creates a shared state region and updates it.  Only one thread may update the region.
+//
+class SharedStateWriter {
+    
+public:
+    typedef std::pair<std::uint32_t, std::uint32_t> UsagePair;
+    
+    // Replaces any existing object with the same name.  Throws SharedStateError on failure.
+    SharedStateWriter(const std::string &name,
+                      std::uint32_t usagePage,
+                      std::uint32_t usage,
+                      const std::vector<UsagePair> &entryUsages);
+    
+    // Removes the name.  Readers that already have the region mapped can continue to use it.
+    ~SharedStateWriter();
+    
+    SharedStateWriter(const SharedStateWriter &) = delete;
+    SharedStateWriter& operator=(const SharedStateWriter &) = delete;
+    
+    const std::string & getName() const { return name; }
+    
+    // Starts an update, if one isn't already in progress
+    void beginUpdate() {
+        if (!updating) {
+            header->sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            updating = true;
+        }
+    }
+    
+    // Must be called between beginUpdate and endUpdate
+    void setValue(std::size_t index, std::int64_t value, std::uint64_t timestampNS, std::int64_t timeUS) {
+        SharedStateEntry &entry = entries[index];
+        entry.value.store(value, std::memory_order_relaxed);
+        entry.timestampNS.store(timestampNS, std::memory_order_relaxed);
+        entry.timeUS.store(timeUS, std::memory_order_relaxed);
+    }
+    
+    // Publishes the values set since beginUpdate.  Does nothing if no update is in progress.
+    void endUpdate() {
+        if (updating) {
+            sequence += 2;
+            header->sequence.store(sequence, std::memory_order_release);
+            updating = false;
+        }
+    }
+    
+private:
+    const std::string name;
+    void *mappedData;
+    std::size_t mappedSize;
+    SharedStateHeader *header;
+    SharedStateEntry *entries;
+    std::uint64_t sequence;
+    bool updating;
+    
+};
+
+
+//
+// Maps a shared state region read-only and takes consistent snapshots of it
+//
+class SharedStateReader {
+    
+public:
+    static const std::size_t noEntry = std::numeric_limits<std::size_t>::max();
+    
+    struct Value {
+        std::uint32_t usagePage;
+        std::uint32_t usage;
+        std::int64_t value;
+        std::uint64_t timestampNS;
+        std::int64_t timeUS;
+    };
+    
+    // Throws SharedStateError if the region doesn't exist (or isn't ready yet) or has an unsupported format
+    explicit SharedStateReader(const std::string &name) :
+        mappedData(MAP_FAILED),
+        mappedSize(0),
+        header(nullptr),
+        entries(nullptr)
+    {
+        const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            throw SharedStateError("Unable to open HID shared state \"" + name + "\": " + std::strerror(errno));
+        }
+        
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < off_t(sizeof(SharedStateHeader))) {
+            close(fd);
+            throw SharedStateError("HID shared state \"" + name + "\" is not ready");
+        }
+        
+        mappedSize = info.st_size;
+        mappedData = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+        const int mapError = errno;
+        close(fd);
+        if (mappedData == MAP_FAILED) {
+            throw SharedStateError("Unable to map HID shared state \"" + name + "\": " + std::strerror(mapError));
+        }
+        
+        header = static_cast<const SharedStateHeader *>(mappedData);
+        entries = reinterpret_cast<const SharedStateEntry *>(static_cast<const char *>(mappedData) +
+                                                             sizeof(SharedStateHeader));
+        
+        // The writer fills in the magic number last
+        const bool ready = (std::memcmp(header->magic, sharedStateMagic, sizeof(sharedStateMagic)) == 0);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!ready ||
+            header->formatVersion != sharedStateFormatVersion ||
+            header->headerSize != sizeof(SharedStateHeader) ||
+            header->entrySize != sizeof(SharedStateEntry) ||
+            mappedSize < sizeof(SharedStateHeader) + std::size_t(header->entryCount) * sizeof(SharedStateEntry))
+        {
+            munmap(mappedData, mappedSize);
+            throw SharedStateError("HID shared state \"" + name + "\" is not ready or has an unsupported format");
+        }
+    }
+    
+    ~SharedStateReader() {
+        munmap(mappedData, mappedSize);
+    }
+    
+    SharedStateReader(const SharedStateReader &) = delete;
+    SharedStateReader& operator=(const SharedStateReader &) = delete;
+    
+    std::uint32_t getUsagePage() const { return header->usagePage; }
+    std::uint32_t getUsage() const { return header->usage; }
+    std::size_t getEntryCount() const { return header->entryCount; }
+    
+    std::size_t findEntry(std::uint32_t usagePage, std::uint32_t usage) const {
+        for (std::size_t index = 0; index < getEntryCount(); index++) {
+            if (entries[index].usagePage == usagePage && entries[index].usage == usage) {
+                return index;
+            }
+        }
+        return noEntry;
+    }
+    
+    // Copies a consistent snapshot of every entry into values, which must have room for getEntryCount()
+    // values, and returns the number of updates published so far.  Returns false if no consistent snapshot
+    // could be taken in maxAttempts attempts.
+    bool read(Value *values, std::uint64_t &updateCount, unsigned maxAttempts = 1000) const {
+        for (unsigned attempt = 0; attempt < maxAttempts; attempt++) {
+            const std::uint64_t before = header->sequence.load(std::memory_order_acquire);
+            if (before % 2) {
+                continue;
+            }
+            
+            for (std::size_t index = 0; index < getEntryCount(); index++) {
+                const SharedStateEntry &entry = entries[index];
+                values[index].usagePage = entry.usagePage;
+                values[index].usage = entry.usage;
+                values[index].value = entry.value.load(std::memory_order_relaxed);
+                values[index].timestampNS = entry.timestampNS.load(std::memory_order_relaxed);
+                values[index].timeUS = entry.timeUS.load(std::memory_order_relaxed);
+            }
+            
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (header->sequence.load(std::memory_order_relaxed) == before) {
+                updateCount = before / 2;
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    bool read(std::vector<Value> &values, std::uint64_t &updateCount, unsigned maxAttempts = 1000) const {
+        values.resize(getEntryCount());
+        return read(values.data(), updateCount, maxAttempts);
+    }
+    
+private:
+    void *mappedData;
+    std::size_t mappedSize;
+    const SharedStateHeader *header;
+    const SharedStateEntry *entries;
+    
+};
+
+
+}  // namespace usbhid
+}  // namespace mworks
+
+
+#endif // !defined(__USBHID__USBHIDSharedState__)
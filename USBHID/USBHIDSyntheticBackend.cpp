@@ -0,0 +1,429 @@
+//
+//  USBHIDSyntheticBackend.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDSyntheticBackend.h"
+
+#include <boost/chrono/duration.hpp>
+
+#include "USBHIDReportEncoder.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+USBHIDSyntheticBackend::USBHIDSyntheticBackend(const std::string &deviceTag, const Options &options) :
+    USBHIDBackend(deviceTag),
+    options(options),
+    clock(Clock::instance()),
+    nextChannelIndex(0),
+    stopRequested(false),
+    wakeupTimeNS(0),
+    delegate(nullptr),
+    startTimeNS(0),
+    stopTimeNS(0),
+    reportCount(0),
+    valueCount(0),
+    lateReportCount(0),
+    maxLagNS(0),
+    decodeTimeNS(0)
+{ }
+
+
+USBHIDSyntheticBackend::~USBHIDSyntheticBackend() {
+    (void)stopIO();
+}
+
+
+bool USBHIDSyntheticBackend::openDevice(const DeviceMatchingCriteria &criteria) {
+    // There's nothing to find
+    return true;
+}
+
+
+USBHIDBackend::DeviceInfo USBHIDSyntheticBackend::getDeviceInfo() const {
+    DeviceInfo info = { 0, 0, 0, 0, "Synthetic HID device" };
+    if (options.simulatedProfile) {
+        info.vendorID = options.simulatedProfile->vendorID;
+        info.productID = options.simulatedProfile->productID;
+        info.product = std::string("Synthetic ") + options.simulatedProfile->name;
+    }
+    return info;
+}
+
+
+bool USBHIDSyntheticBackend::prepareInputs(const std::vector<UsagePair> &usages,
+                                           std::size_t requiredChannelCount,
+                                           bool deliverAllValues,
+                                           bool rawReports)
+{
+    // Every channel's usage is generated, and no others, so the remaining arguments make no difference here
+    channelUsages = usages;
+    
+    if (options.simulatedProfile) {
+        return prepareSimulatedReports();
+    }
+    
+    return true;
+}
+
+
+bool USBHIDSyntheticBackend::prepareSimulatedReports() {
+    const usbhid::DeviceProfile &profile = *(options.simulatedProfile);
+    
+    std::vector<std::uint32_t> targetUsages;
+    for (auto &usage : channelUsages) {
+        targetUsages.push_back(usbhid::ReportDescriptor::makeUsage(usage.first, usage.second));
+    }
+    
+    try {
+        const usbhid::ReportDescriptor descriptor(profile.reportDescriptor, profile.reportDescriptorSize);
+        reportDecoder.reset(new usbhid::ReportDecoder(descriptor, targetUsages, false));
+    } catch (const usbhid::ReportDescriptorError &e) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN,
+               "Cannot simulate profile \"%s\" for HID device \"%s\": %s",
+               profile.name,
+               deviceTag.c_str(),
+               e.what());
+        return false;
+    }
+    
+    if (options.specializedDecoder && !reportDecoder->useProfile(profile)) {
+        merror(M_IODEVICE_MESSAGE_DOMAIN,
+               "Report layout of profile \"%s\" doesn't match its own descriptor",
+               profile.name);
+        return false;
+    }
+    
+    const std::vector<usbhid::ExtractionOp> &ops = reportDecoder->getExtractor().getOps();
+    channelFields.assign(channelUsages.size(), usbhid::ExtractionOp());
+    std::vector<bool> channelMatched(channelUsages.size(), false);
+    for (auto &op : ops) {
+        if (op.target != usbhid::ReportExtractor::noTarget && !op.isArray) {
+            channelFields[op.target] = op;
+            channelMatched[op.target] = true;
+        }
+    }
+    
+    for (std::size_t channelIndex = 0; channelIndex < channelUsages.size(); channelIndex++) {
+        if (!channelMatched[channelIndex]) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN,
+                   "Profile \"%s\" has no input field for usage page %ld, usage %ld",
+                   profile.name,
+                   channelUsages[channelIndex].first,
+                   channelUsages[channelIndex].second);
+            return false;
+        }
+    }
+    
+    reportBuffer.assign((profile.reportID ? 1 : 0) + profile.reportSize, 0);
+    if (profile.reportID) {
+        reportBuffer[0] = profile.reportID;
+    }
+    decodedValues.reserve(ops.size());
+    
+    return true;
+}
+
+
+bool USBHIDSyntheticBackend::readInitialValues(Delegate &delegate) {
+    // Start every channel at the bottom of the range, and reseed, so that each run generates the same values
+    channelValues.assign(channelUsages.size(), options.valueMin);
+    nextChannelIndex = 0;
+    randomEngine.seed();
+    
+    if (reportDecoder) {
+        // Seed the decoder with the initial values, so that the first report passes on only what changed
+        for (std::size_t channelIndex = 0; channelIndex < channelUsages.size(); channelIndex++) {
+            encodeSimulatedValue(channelIndex, channelValues[channelIndex]);
+        }
+        decodeSimulatedReport(clock->getSystemTimeNS());
+        decodedValues.clear();
+    }
+    
+    const std::uint64_t timestampNS = clock->getSystemTimeNS();
+    for (std::size_t channelIndex = 0; channelIndex < channelUsages.size(); channelIndex++) {
+        const InputValue value = {
+            channelIndex,
+            std::uint32_t(channelUsages[channelIndex].first),
+            std::uint32_t(channelUsages[channelIndex].second),
+            channelValues[channelIndex],
+            timestampNS
+        };
+        delegate.handleInputValue(value);
+    }
+    delegate.handleFrameEnd();
+    
+    return true;
+}
+
+
+bool USBHIDSyntheticBackend::startIO(Delegate &newDelegate) {
+    if (!isRunning()) {
+        delegate = &newDelegate;
+        stopRequested = false;
+        
+        try {
+            generatorThread = boost::thread(boost::bind(&USBHIDSyntheticBackend::generatorLoop, this));
+        } catch (const boost::thread_resource_error &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to start synthetic HID device: %s", e.what());
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+
+bool USBHIDSyntheticBackend::stopIO() {
+    if (isRunning()) {
+        {
+            boost::mutex::scoped_lock lock(stopMutex);
+            stopRequested = true;
+        }
+        stopCondition.notify_all();
+        
+        try {
+            generatorThread.join();
+        } catch (const boost::system::system_error &e) {
+            merror(M_IODEVICE_MESSAGE_DOMAIN, "Unable to stop synthetic HID device: %s", e.what());
+            return false;
+        }
+        
+        // Discard any pending wakeup
+        wakeupTimeNS = 0;
+        
+        reportStatistics();
+    }
+    
+    return true;
+}
+
+
+void USBHIDSyntheticBackend::requestWakeup(std::uint64_t timeNS) {
+    if (!wakeupTimeNS || (timeNS < wakeupTimeNS)) {
+        wakeupTimeNS = timeNS;
+    }
+}
+
+
+void USBHIDSyntheticBackend::generatorLoop() {
+    ioThreadPolicy.applyToCurrentThread(deviceTag, "I/O");
+    
+    const std::uint64_t intervalNS = ((options.reportRate > 0.0) ? std::uint64_t(1.0e9 / options.reportRate) : 0);
+    
+    startTimeNS = clock->getSystemTimeNS();
+    reportCount = 0;
+    valueCount = 0;
+    lateReportCount = 0;
+    maxLagNS = 0;
+    decodeTimeNS = 0;
+    
+    std::uint64_t nextReportTimeNS = startTimeNS + intervalNS;
+    
+    while (!stopRequested) {
+        if (intervalNS) {
+            // Reports are time stamped with their scheduled time, as a device would, so any time spent
+            // catching up shows up as input latency
+            if (!deliverWakeups(nextReportTimeNS) || !waitUntil(nextReportTimeNS)) {
+                break;
+            }
+            generateReport(nextReportTimeNS);
+            
+            const std::uint64_t lagNS = clock->getSystemTimeNS() - nextReportTimeNS;
+            maxLagNS = std::max(maxLagNS, lagNS);
+            if (lagNS > intervalNS) {
+                lateReportCount++;
+            }
+            nextReportTimeNS += intervalNS;
+        } else {
+            const std::uint64_t currentTimeNS = clock->getSystemTimeNS();
+            if (!deliverWakeups(currentTimeNS)) {
+                break;
+            }
+            generateReport(currentTimeNS);
+        }
+    }
+    
+    stopTimeNS = clock->getSystemTimeNS();
+}
+
+
+void USBHIDSyntheticBackend::generateReport(std::uint64_t timestampNS) {
+    const std::size_t channelCount = channelUsages.size();
+    const std::size_t valuesPerReport = ((options.valuesPerReport && options.valuesPerReport < channelCount) ?
+                                         options.valuesPerReport :
+                                         channelCount);
+    
+    for (std::size_t i = 0; i < valuesPerReport; i++) {
+        const std::size_t channelIndex = nextChannelIndex;
+        nextChannelIndex = (nextChannelIndex + 1) % channelCount;
+        
+        long &channelValue = channelValues[channelIndex];
+        channelValue = nextValue(channelValue);
+        
+        if (reportDecoder) {
+            encodeSimulatedValue(channelIndex, channelValue);
+        } else {
+            const InputValue value = {
+                channelIndex,
+                std::uint32_t(channelUsages[channelIndex].first),
+                std::uint32_t(channelUsages[channelIndex].second),
+                channelValue,
+                timestampNS
+            };
+            delegate->handleInputValue(value);
+        }
+    }
+    
+    if (reportDecoder) {
+        decodeSimulatedReport(timestampNS);
+        
+        // Only the values that survived truncation and changed are delivered
+        for (auto &value : decodedValues) {
+            delegate->handleInputValue(value);
+        }
+        valueCount += decodedValues.size();
+        decodedValues.clear();
+    } else {
+        valueCount += valuesPerReport;
+    }
+    
+    delegate->handleFrameEnd();
+    
+    reportCount++;
+}
+
+
+void USBHIDSyntheticBackend::encodeSimulatedValue(std::size_t channelIndex, long value) {
+    // The value is truncated to the field size, as the device would
+    const usbhid::ExtractionOp &field = channelFields[channelIndex];
+    usbhid::ReportEncoder::writeValue(reportBuffer.data() + (options.simulatedProfile->reportID ? 1 : 0),
+                                      field.bitOffset,
+                                      field.bitSize,
+                                      std::int32_t(value));
+}
+
+
+void USBHIDSyntheticBackend::decodeSimulatedReport(std::uint64_t timestampNS) {
+    // Time only the decoding, not the delivery, which is the same for both decoders.  decodedValues has
+    // room for every op, so this doesn't allocate.
+    const std::uint64_t decodeStartTimeNS = clock->getSystemTimeNS();
+    
+    reportDecoder->decode(reportBuffer.data(), reportBuffer.size(), [this, timestampNS](const usbhid::ExtractionOp &op,
+                                                                                        std::int32_t integerValue)
+    {
+        const InputValue value = {
+            op.target,
+            usbhid::ReportDescriptor::usagePageOf(op.usage),
+            usbhid::ReportDescriptor::usageOf(op.usage),
+            integerValue,
+            timestampNS
+        };
+        decodedValues.push_back(value);
+    });
+    
+    decodeTimeNS += clock->getSystemTimeNS() - decodeStartTimeNS;
+}
+
+
+long USBHIDSyntheticBackend::nextValue(long currentValue) {
+    switch (options.distribution) {
+        case Distribution::RandomWalk: {
+            const long maxStep = std::max(1L, (options.valueMax - options.valueMin) / 64);
+            const long step = std::uniform_int_distribution<long>(-maxStep, maxStep)(randomEngine);
+            return std::min(std::max(currentValue + step, options.valueMin), options.valueMax);
+        }
+        
+        case Distribution::Uniform:
+            return std::uniform_int_distribution<long>(options.valueMin, options.valueMax)(randomEngine);
+        
+        case Distribution::Alternating:
+        default:
+            return ((currentValue == options.valueMin) ? options.valueMax : options.valueMin);
+    }
+}
+
+
+bool USBHIDSyntheticBackend::deliverWakeups(std::uint64_t untilTimeNS) {
+    while (wakeupTimeNS && (wakeupTimeNS <= untilTimeNS)) {
+        const std::uint64_t timeNS = wakeupTimeNS;
+        if (!waitUntil(timeNS)) {
+            return false;
+        }
+        wakeupTimeNS = 0;
+        delegate->handleWakeup(timeNS);
+    }
+    
+    return true;
+}
+
+
+bool USBHIDSyntheticBackend::waitUntil(std::uint64_t timeNS) {
+    // Skip the lock entirely when already behind schedule, since that's the common case at high rates
+    if (!stopRequested && std::uint64_t(clock->getSystemTimeNS()) >= timeNS) {
+        return true;
+    }
+    
+    boost::mutex::scoped_lock lock(stopMutex);
+    
+    while (!stopRequested) {
+        const std::uint64_t currentTimeNS = clock->getSystemTimeNS();
+        if (currentTimeNS >= timeNS) {
+            return true;
+        }
+        stopCondition.wait_for(lock, boost::chrono::nanoseconds(timeNS - currentTimeNS));
+    }
+    
+    return false;
+}
+
+
+void USBHIDSyntheticBackend::reportStatistics() const {
+    const double elapsedS = double(stopTimeNS - startTimeNS) / 1.0e9;
+    if (elapsedS <= 0.0) {
+        return;
+    }
+    
+    mprintf("Synthetic HID device \"%s\" generated %llu values in %llu reports over %.3f s "
+            "(%.0f values/s, %.0f reports/s)",
+            deviceTag.c_str(),
+            static_cast<unsigned long long>(valueCount),
+            static_cast<unsigned long long>(reportCount),
+            elapsedS,
+            double(valueCount) / elapsedS,
+            double(reportCount) / elapsedS);
+    
+    if (options.simulatedProfile && reportCount) {
+        mprintf("Synthetic HID device \"%s\" decoded reports of profile \"%s\" with the %s decoder in %.1f ns "
+                "per report (including clock overhead)",
+                deviceTag.c_str(),
+                options.simulatedProfile->name,
+                (reportDecoder->getProfile() ? "specialized" : "generic"),
+                double(decodeTimeNS) / double(reportCount));
+    }
+    
+    if (options.reportRate > 0.0) {
+        if (lateReportCount) {
+            mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                     "Synthetic HID device \"%s\" fell behind its report rate of %g/s: %llu reports were late, "
+                     "by up to %.3f ms",
+                     deviceTag.c_str(),
+                     options.reportRate,
+                     static_cast<unsigned long long>(lateReportCount),
+                     double(maxLagNS) / 1.0e6);
+        } else {
+            mprintf("Synthetic HID device \"%s\" kept up with its report rate of %g/s (maximum lag %.3f ms)",
+                    deviceTag.c_str(),
+                    options.reportRate,
+                    double(maxLagNS) / 1.0e6);
+        }
+    }
+}
+
+
+END_NAMESPACE_MW
@@ -0,0 +1,125 @@
+//
+//  USBHIDSyntheticBackend.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDSyntheticBackend__
+#define __USBHID__USBHIDSyntheticBackend__
+
+#include <random>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "USBHIDBackend.h"
+#include "USBHIDReportDecoder.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Generates input reports for the configured channels on its own thread, at a fixed rate or as fast as
+// possible, so that the whole input path can be measured without hardware.  Each report changes the values
+// of valuesPerReport channels (or of every channel, if zero), cycling through the channels in order.  When
+// I/O stops, the number of values generated, the rate achieved, and how far generation fell behind
+// schedule are reported.  Output channels are accepted, and their values discarded, so that the output
+// path can be measured, too.
+//
+// If simulatedProfile is set, the generated values are instead packed into input reports laid out as the
+// profile's device would send them, and each report is decoded, with either the profile's specialized
+// extraction or the generic ops, before delivery.  The mean decode time per report is reported along with
+// the other statistics, so that the two decoders can be compared.
+//
+class USBHIDSyntheticBackend : public USBHIDBackend {
+    
+public:
+    enum class Distribution {
+        RandomWalk,   // Small random steps, as from an analog axis
+        Uniform,      // Independent values spread across the whole range
+        Alternating   // Minimum and maximum in turn, as from a button
+    };
+    
+    struct Options {
+        double reportRate;          // Reports per second, or zero for as fast as possible
+        std::size_t valuesPerReport;
+        Distribution distribution;
+        long valueMin;
+        long valueMax;
+        const usbhid::DeviceProfile *simulatedProfile;  // Null to deliver values directly
+        bool specializedDecoder;                         // Ignored if simulatedProfile is null
+    };
+    
+    USBHIDSyntheticBackend(const std::string &deviceTag, const Options &options);
+    ~USBHIDSyntheticBackend();
+    
+    bool openDevice(const DeviceMatchingCriteria &criteria) MW_OVERRIDE;
+    DeviceInfo getDeviceInfo() const MW_OVERRIDE;
+    bool prepareInputs(const std::vector<UsagePair> &channelUsages,
+                       std::size_t requiredChannelCount,
+                       bool deliverAllValues,
+                       bool rawReports) MW_OVERRIDE;
+    bool readInitialValues(Delegate &delegate) MW_OVERRIDE;
+    bool prepareOutputs(const std::vector<OutputElement> &outputElements) MW_OVERRIDE { return true; }
+    bool startIO(Delegate &delegate) MW_OVERRIDE;
+    bool stopIO() MW_OVERRIDE;
+    bool isRunning() const MW_OVERRIDE { return (generatorThread.get_id() != boost::thread::id()); }
+    void requestWakeup(std::uint64_t timeNS) MW_OVERRIDE;
+    
+    // Output values are discarded, as if every output channel were in the same report
+    bool writeOutputs(const std::vector<OutputValue> &values, std::size_t &transferCount) MW_OVERRIDE {
+        transferCount = (values.empty() ? 0 : 1);
+        return true;
+    }
+    
+private:
+    void generatorLoop();
+    void generateReport(std::uint64_t timestampNS);
+    bool prepareSimulatedReports();
+    void encodeSimulatedValue(std::size_t channelIndex, long value);
+    void decodeSimulatedReport(std::uint64_t timestampNS);
+    long nextValue(long currentValue);
+    bool waitUntil(std::uint64_t timeNS);
+    bool deliverWakeups(std::uint64_t untilTimeNS);
+    void reportStatistics() const;
+    
+    const Options options;
+    const boost::shared_ptr<Clock> clock;
+    
+    std::vector<UsagePair> channelUsages;
+    std::vector<long> channelValues;
+    std::size_t nextChannelIndex;
+    std::minstd_rand randomEngine;
+    
+    // Used only with a simulated profile.  channelFields holds the op that reads each channel's field.
+    std::unique_ptr<usbhid::ReportDecoder> reportDecoder;
+    std::vector<usbhid::ExtractionOp> channelFields;
+    std::vector<std::uint8_t> reportBuffer;
+    std::vector<InputValue> decodedValues;
+    
+    boost::thread generatorThread;
+    boost::mutex stopMutex;
+    boost::condition_variable stopCondition;
+    std::atomic_bool stopRequested;
+    std::uint64_t wakeupTimeNS;  // Zero if no wakeup is pending
+    Delegate *delegate;
+    
+    // Written by the generator thread and read after it exits
+    std::uint64_t startTimeNS;
+    std::uint64_t stopTimeNS;
+    std::uint64_t reportCount;
+    std::uint64_t valueCount;
+    std::uint64_t lateReportCount;  // Delivered more than one report interval after their scheduled time
+    std::uint64_t maxLagNS;
+    std::uint64_t decodeTimeNS;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDSyntheticBackend__)
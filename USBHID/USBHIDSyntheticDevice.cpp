@@ -0,0 +1,93 @@
+//
+//  USBHIDSyntheticDevice.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDSyntheticDevice.h"
+
+#include "USBHIDSyntheticBackend.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+const std::string USBHIDSyntheticDevice::REPORT_RATE("report_rate");
+const std::string USBHIDSyntheticDevice::VALUES_PER_REPORT("values_per_report");
+const std::string USBHIDSyntheticDevice::VALUE_DISTRIBUTION("value_distribution");
+const std::string USBHIDSyntheticDevice::VALUE_MIN("value_min");
+const std::string USBHIDSyntheticDevice::VALUE_MAX("value_max");
+const std::string USBHIDSyntheticDevice::SIMULATED_DEVICE("simulated_device");
+const std::string USBHIDSyntheticDevice::SPECIALIZED_DECODER("specialized_decoder");
+
+
+void USBHIDSyntheticDevice::describeComponent(ComponentInfo &info) {
+    USBHIDDevice::describeComponent(info);
+    
+    info.setSignature("iodevice/usbhid_synthetic");
+    
+    info.addParameter(REPORT_RATE, "1000");
+    info.addParameter(VALUES_PER_REPORT, "0");
+    info.addParameter(VALUE_DISTRIBUTION, "random_walk");
+    info.addParameter(VALUE_MIN, "0");
+    info.addParameter(VALUE_MAX, "255");
+    info.addParameter(SIMULATED_DEVICE, false);
+    info.addParameter(SPECIALIZED_DECODER, "YES");
+}
+
+
+USBHIDSyntheticDevice::USBHIDSyntheticDevice(const ParameterValueMap &parameters) :
+    USBHIDDevice(parameters, &createSyntheticBackend)
+{ }
+
+
+std::unique_ptr<USBHIDBackend> USBHIDSyntheticDevice::createSyntheticBackend(const std::string &deviceTag,
+                                                                             const ParameterValueMap &parameters)
+{
+    USBHIDSyntheticBackend::Options options;
+    
+    options.reportRate = parameters[REPORT_RATE];
+    if (options.reportRate < 0.0) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid report rate");
+    }
+    
+    const long valuesPerReport = parameters[VALUES_PER_REPORT];
+    if (valuesPerReport < 0) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid number of values per report");
+    }
+    options.valuesPerReport = valuesPerReport;
+    
+    const std::string distribution = parameters[VALUE_DISTRIBUTION].str();
+    if (distribution == "random_walk") {
+        options.distribution = USBHIDSyntheticBackend::Distribution::RandomWalk;
+    } else if (distribution == "uniform") {
+        options.distribution = USBHIDSyntheticBackend::Distribution::Uniform;
+    } else if (distribution == "alternating") {
+        options.distribution = USBHIDSyntheticBackend::Distribution::Alternating;
+    } else {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid value distribution", distribution);
+    }
+    
+    options.valueMin = parameters[VALUE_MIN];
+    options.valueMax = parameters[VALUE_MAX];
+    if (options.valueMin >= options.valueMax) {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Synthetic value minimum must be less than maximum");
+    }
+    
+    options.simulatedProfile = nullptr;
+    if (!(parameters[SIMULATED_DEVICE].empty())) {
+        const std::string profileName = parameters[SIMULATED_DEVICE].str();
+        options.simulatedProfile = usbhid::findDeviceProfile(profileName);
+        if (!options.simulatedProfile) {
+            throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Unknown device profile", profileName);
+        }
+    }
+    options.specializedDecoder = parameters[SPECIALIZED_DECODER];
+    
+    return std::unique_ptr<USBHIDBackend>(new USBHIDSyntheticBackend(deviceTag, options));
+}
+
+
+END_NAMESPACE_MW
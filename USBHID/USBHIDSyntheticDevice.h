@@ -0,0 +1,47 @@
+//
+//  USBHIDSyntheticDevice.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDSyntheticDevice__
+#define __USBHID__USBHIDSyntheticDevice__
+
+#include "USBHIDDevice.h"
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Feeds generated input values through the same channels and dispatch path as a USBHIDDevice, for
+// measuring throughput and latency without hardware
+//
+class USBHIDSyntheticDevice : public USBHIDDevice {
+    
+public:
+    static const std::string REPORT_RATE;
+    static const std::string VALUES_PER_REPORT;
+    static const std::string VALUE_DISTRIBUTION;
+    static const std::string VALUE_MIN;
+    static const std::string VALUE_MAX;
+    static const std::string SIMULATED_DEVICE;
+    static const std::string SPECIALIZED_DECODER;
+    
+    static void describeComponent(ComponentInfo &info);
+    
+    explicit USBHIDSyntheticDevice(const ParameterValueMap &parameters);
+    
+private:
+    static std::unique_ptr<USBHIDBackend> createSyntheticBackend(const std::string &deviceTag,
+                                                                 const ParameterValueMap &parameters);
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDSyntheticDevice__)
@@ -0,0 +1,191 @@
+//
+//  USBHIDThreadPolicy.cpp
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#include "USBHIDThreadPolicy.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#include <pthread.h>
+#include <sched.h>
+
+
+BEGIN_NAMESPACE_MW
+
+
+namespace {
+    
+    int posixPolicy(USBHIDThreadPolicy::SchedulingClass schedulingClass) {
+        switch (schedulingClass) {
+            case USBHIDThreadPolicy::SchedulingClass::FIFO:
+                return SCHED_FIFO;
+            case USBHIDThreadPolicy::SchedulingClass::RoundRobin:
+                return SCHED_RR;
+            case USBHIDThreadPolicy::SchedulingClass::Default:
+            default:
+                return SCHED_OTHER;
+        }
+    }
+    
+    const char * posixPolicyName(int policy) {
+        switch (policy) {
+            case SCHED_FIFO:
+                return "SCHED_FIFO";
+            case SCHED_RR:
+                return "SCHED_RR";
+            case SCHED_OTHER:
+                return "SCHED_OTHER";
+            default:
+                return "unknown";
+        }
+    }
+
+#if defined(__linux__)
+    const int maxCPU = CPU_SETSIZE - 1;
+#else
+    const int maxCPU = 1023;
+#endif
+
+}
+
+
+USBHIDThreadPolicy::SchedulingClass USBHIDThreadPolicy::parseSchedulingClass(const std::string &name) {
+    if (name == "default") {
+        return SchedulingClass::Default;
+    } else if (name == "fifo") {
+        return SchedulingClass::FIFO;
+    } else if (name == "round_robin") {
+        return SchedulingClass::RoundRobin;
+    }
+    throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid thread scheduling class", name);
+}
+
+
+void USBHIDThreadPolicy::validatePriority(SchedulingClass schedulingClass, int priority) {
+    if (schedulingClass != SchedulingClass::Default) {
+        const int policy = posixPolicy(schedulingClass);
+        if (priority < sched_get_priority_min(policy) || priority > sched_get_priority_max(policy)) {
+            std::ostringstream os;
+            os << "Thread priority for " << posixPolicyName(policy) << " must be between "
+               << sched_get_priority_min(policy) << " and " << sched_get_priority_max(policy);
+            throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, os.str());
+        }
+    }
+}
+
+
+std::vector<int> USBHIDThreadPolicy::parseCPUList(const std::string &cpuList) {
+    std::vector<int> cpus;
+    std::istringstream is(cpuList);
+    std::string item;
+    
+    // getline doesn't yield the empty item after a trailing comma
+    if (!cpuList.empty() && cpuList.back() == ',') {
+        throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid CPU list", cpuList);
+    }
+    
+    while (std::getline(is, item, ',')) {
+        const char *start = item.c_str();
+        char *end;
+        const long first = std::strtol(start, &end, 10);
+        long last = first;
+        if (*end == '-') {
+            start = end + 1;
+            last = std::strtol(start, &end, 10);
+        }
+        if (end == start || *end != '\0' || first < 0 || last < first || last > maxCPU) {
+            throw SimpleException(M_IODEVICE_MESSAGE_DOMAIN, "Invalid CPU list", cpuList);
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(int(cpu));
+        }
+    }
+    
+    return cpus;
+}
+
+
+void USBHIDThreadPolicy::applyToCurrentThread(const std::string &deviceTag, const char *threadName) const {
+    if (isDefault()) {
+        return;
+    }
+    
+    const pthread_t thread = pthread_self();
+    
+    if (schedulingClass != SchedulingClass::Default) {
+        struct sched_param param;
+        std::memset(&param, 0, sizeof(param));
+        param.sched_priority = priority;
+        
+        const int error = pthread_setschedparam(thread, posixPolicy(schedulingClass), &param);
+        if (error) {
+            mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                     "Unable to set %s priority %d for %s thread of HID device \"%s\": %s%s",
+                     posixPolicyName(posixPolicy(schedulingClass)),
+                     priority,
+                     threadName,
+                     deviceTag.c_str(),
+                     std::strerror(error),
+                     ((error == EPERM) ? " (real-time scheduling requires additional privileges)" : ""));
+        }
+    }
+    
+    std::string affinity;
+    
+    if (!cpus.empty()) {
+#if defined(__linux__)
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (int cpu : cpus) {
+            CPU_SET(cpu, &cpuSet);
+        }
+        
+        int error = pthread_setaffinity_np(thread, sizeof(cpuSet), &cpuSet);
+        if (error) {
+            mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                     "Unable to set CPU affinity for %s thread of HID device \"%s\": %s",
+                     threadName,
+                     deviceTag.c_str(),
+                     std::strerror(error));
+        }
+        
+        // Report the CPUs actually in use, which may differ from those requested if some are offline
+        error = pthread_getaffinity_np(thread, sizeof(cpuSet), &cpuSet);
+        if (!error) {
+            std::ostringstream os;
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if (CPU_ISSET(cpu, &cpuSet)) {
+                    os << (os.tellp() > 0 ? "," : "") << cpu;
+                }
+            }
+            affinity = ", on CPUs " + os.str();
+        }
+#else
+        mwarning(M_IODEVICE_MESSAGE_DOMAIN,
+                 "CPU affinity is not supported on this platform; ignoring it for %s thread of HID device \"%s\"",
+                 threadName,
+                 deviceTag.c_str());
+#endif
+    }
+    
+    int policy;
+    struct sched_param param;
+    if (0 == pthread_getschedparam(thread, &policy, &param)) {
+        mprintf("HID device \"%s\": %s thread is running with %s priority %d%s",
+                deviceTag.c_str(),
+                threadName,
+                posixPolicyName(policy),
+                param.sched_priority,
+                affinity.c_str());
+    }
+}
+
+
+END_NAMESPACE_MW
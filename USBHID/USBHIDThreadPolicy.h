@@ -0,0 +1,69 @@
+//
+//  USBHIDThreadPolicy.h
+//  USBHID
+//
+//  Created by agent on 10/17/26.
+//  Copyright (c) 2026 The MWorks Project. All rights reserved.
+//
+
+#ifndef __USBHID__USBHIDThreadPolicy__
+#define __USBHID__USBHIDThreadPolicy__
+
+#include <vector>
+
+
+BEGIN_NAMESPACE_MW
+
+
+//
+// Scheduling class, priority, and CPU affinity for one of a device's threads.  The thread applies the
+// policy to itself when it starts.  Anything that can't be applied (typically for lack of privileges, or
+// because the platform doesn't support CPU affinity) is reported with a warning and skipped, and the thread
+// runs with its default settings instead.
+//
+class USBHIDThreadPolicy {
+    
+public:
+    enum class SchedulingClass {
+        Default,     // Whatever the thread inherits
+        FIFO,        // SCHED_FIFO
+        RoundRobin   // SCHED_RR
+    };
+    
+    // Each of the following throws SimpleException if its argument is invalid
+    static SchedulingClass parseSchedulingClass(const std::string &name);
+    static void validatePriority(SchedulingClass schedulingClass, int priority);
+    
+    // Accepts a comma-separated list of CPU numbers and ranges (e.g. "2,4-6"), as taskset does.  An empty
+    // string yields an empty list, meaning no affinity.
+    static std::vector<int> parseCPUList(const std::string &cpuList);
+    
+    USBHIDThreadPolicy() :
+        schedulingClass(SchedulingClass::Default),
+        priority(0)
+    { }
+    
+    USBHIDThreadPolicy(SchedulingClass schedulingClass, int priority, const std::vector<int> &cpus) :
+        schedulingClass(schedulingClass),
+        priority(priority),
+        cpus(cpus)
+    { }
+    
+    bool isDefault() const { return (schedulingClass == SchedulingClass::Default && cpus.empty()); }
+    
+    // Applies the policy to the calling thread, and reports the resulting settings.  threadName describes
+    // the thread in messages (e.g. "I/O").
+    void applyToCurrentThread(const std::string &deviceTag, const char *threadName) const;
+    
+private:
+    SchedulingClass schedulingClass;
+    int priority;  // Ignored with SchedulingClass::Default
+    std::vector<int> cpus;
+    
+};
+
+
+END_NAMESPACE_MW
+
+
+#endif // !defined(__USBHID__USBHIDThreadPolicy__)